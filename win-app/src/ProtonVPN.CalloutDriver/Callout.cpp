@@ -5,128 +5,254 @@
 #include "Trace.h"
 #include "Public.h"
 #include "Callout.h"
+#include "RedirectPolicy.h"
+#include "DnsPacket.h"
+#include "PacketPool.h"
+#include "Statistics.h"
+#include "RedirectCache.h"
 #include "Callout.tmh"
 #include "stdio.h"
 
 const UINT8 TCP_PROTOCOL_ID = 6;
 
-void SetSocketIPv4Addr(const SOCKADDR_STORAGE& sockAddrStorage, const IN_ADDR& addr)
+//
+// Settings found in a provider context, as kept by RedirectCache.h. Besides the flags they hold
+// the offset of each section value found in the context, in units of PROVIDER_CONTEXT_ALIGNMENT,
+// so classifies do not look the sections up again. An offset of 0 means there is no such section.
+//
+const UINT64 REDIRECT_SETTINGS_VALID = 0x1;
+const UINT64 REDIRECT_SETTINGS_INVALID = 0x2;
+const UINT32 REDIRECT_SETTINGS_OFFSET_SHIFT = 4;
+const UINT32 REDIRECT_SETTINGS_OFFSET_BITS = 12;
+const UINT64 REDIRECT_SETTINGS_OFFSET_MASK = (1ull << REDIRECT_SETTINGS_OFFSET_BITS) - 1;
+
+enum REDIRECT_SETTINGS_SECTION
 {
-	INETADDR_SET_ADDRESS((PSOCKADDR) & (sockAddrStorage), &(addr.S_un.S_un_b.s_b1));
-}
-
-bool isLocalNetwork(UINT32 addr)
+	RedirectSectionLocalAddressV4,
+	RedirectSectionLocalAddressV6,
+	RedirectSectionExcludedPrefixesV4,
+	RedirectSectionExcludedPrefixesV6,
+	RedirectSectionDnsPolicy,
+};
+
+const PREFIX_TABLE* GetPrefixTableFromSection(const void* value, UINT32 length, UINT8 addressLength)
 {
-	if (IN4_IS_ADDR_LOOPBACK(reinterpret_cast<IN_ADDR*>(&addr)) || //127/8
-		IN4_IS_ADDR_LINKLOCAL(reinterpret_cast<IN_ADDR*>(&addr)) || //169.254/16
-		IN4_IS_ADDR_RFC1918(reinterpret_cast<IN_ADDR*>(&addr)) || //10/8, 172.16/12, 192.168/16
-		IN4_IS_ADDR_MC_LINKLOCAL(reinterpret_cast<IN_ADDR*>(&addr)) || //224.0.0/24
-		IN4_IS_ADDR_BROADCAST(reinterpret_cast<IN_ADDR*>(&addr)) || //255.255.255.255
-		IN4_IS_ADDR_MC_ADMINLOCAL(reinterpret_cast<IN_ADDR*>(&addr))) //239.255/16
+	auto table = PrefixTableFromBuffer(value, length);
+	if (table == nullptr || table->addressLength != addressLength)
 	{
-		return true;
+		return nullptr;
 	}
 
-	return false;
+	return table;
 }
 
-const CONNECT_REDIRECT_DATA* GetConnectRedirectDataFromProviderContext(const FWPM_PROVIDER_CONTEXT* context)
+//
+// Reads the callout configuration from the provider context attached to the filter.
+// Supports both the legacy CONNECT_REDIRECT_DATA and the versioned format from ProviderContext.h.
+//
+bool GetRedirectConfigFromProviderContext(const FWPM_PROVIDER_CONTEXT* context, REDIRECT_CONFIG* config)
 {
+	RtlZeroMemory(config, sizeof(REDIRECT_CONFIG));
+
 	if (context == nullptr)
 	{
-		return nullptr;
+		return false;
 	}
 
 	if (context->type != FWPM_GENERAL_CONTEXT)
 	{
-		return nullptr;
+		return false;
 	}
 
-	if (context->dataBuffer == nullptr)
+	if (context->dataBuffer == nullptr || context->dataBuffer->data == nullptr)
 	{
-		return nullptr;
+		return false;
 	}
 
-	if (context->dataBuffer->size != sizeof(CONNECT_REDIRECT_DATA))
+	if (context->dataBuffer->size == sizeof(CONNECT_REDIRECT_DATA))
 	{
-		return nullptr;
+		config->localAddressV4 = &reinterpret_cast<CONNECT_REDIRECT_DATA*>(context->dataBuffer->data)->localAddress;
+		return true;
+	}
+
+	auto providerContext = ProviderContextFromBuffer(context->dataBuffer->data, context->dataBuffer->size);
+	if (providerContext == nullptr)
+	{
+		return false;
 	}
 
-	return reinterpret_cast<CONNECT_REDIRECT_DATA*>(context->dataBuffer->data);
+	UINT32 length = 0;
+	auto value = ProviderContextFindSection(providerContext, PROVIDER_CONTEXT_BIND_ADDRESS_V4, &length);
+	if (value != nullptr && length == sizeof(IN_ADDR))
+	{
+		config->localAddressV4 = static_cast<const IN_ADDR*>(value);
+	}
+
+	value = ProviderContextFindSection(providerContext, PROVIDER_CONTEXT_BIND_ADDRESS_V6, &length);
+	if (value != nullptr && length == sizeof(IN6_ADDR))
+	{
+		config->localAddressV6 = static_cast<const IN6_ADDR*>(value);
+	}
+
+	value = ProviderContextFindSection(providerContext, PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V4, &length);
+	if (value != nullptr)
+	{
+		config->excludedPrefixesV4 = GetPrefixTableFromSection(value, length, sizeof(IN_ADDR));
+	}
+
+	value = ProviderContextFindSection(providerContext, PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V6, &length);
+	if (value != nullptr)
+	{
+		config->excludedPrefixesV6 = GetPrefixTableFromSection(value, length, sizeof(IN6_ADDR));
+	}
+
+	value = ProviderContextFindSection(providerContext, PROVIDER_CONTEXT_DNS_POLICY, &length);
+	if (value != nullptr && length == sizeof(PROVIDER_CONTEXT_DNS_POLICY_DATA))
+	{
+		config->dnsPolicy = static_cast<const PROVIDER_CONTEXT_DNS_POLICY_DATA*>(value);
+	}
+
+	return true;
 }
 
-void NTAPI RedirectConnection(
-	IN const FWPS_INCOMING_VALUES* inFixedValues,
-	IN const FWPS_INCOMING_METADATA_VALUES*,
-	IN OUT void*,
-	IN const void* classifyContext,
-	IN const FWPS_FILTER* filter,
-	IN UINT64,
-	IN OUT FWPS_CLASSIFY_OUT* classifyOut
-)
+//
+// Records the offset of the section value within the provider context.
+// Returns false if the offset does not fit in the settings.
+//
+bool SetRedirectSettingsOffset(UINT64* settings, REDIRECT_SETTINGS_SECTION section, const void* context, const void* value)
 {
-	classifyOut->actionType = FWP_ACTION_PERMIT;
-
-	if (inFixedValues == nullptr)
+	if (value == nullptr)
 	{
-		return;
+		return true;
 	}
 
-	if (inFixedValues->layerId != FWPS_LAYER_ALE_CONNECT_REDIRECT_V4)
+	auto offset = static_cast<UINT64>(static_cast<const UINT8*>(value) - static_cast<const UINT8*>(context));
+	if (offset % PROVIDER_CONTEXT_ALIGNMENT != 0 ||
+		offset / PROVIDER_CONTEXT_ALIGNMENT > REDIRECT_SETTINGS_OFFSET_MASK)
 	{
-		return;
+		return false;
 	}
 
-	if ((classifyOut->rights & FWPS_RIGHT_ACTION_WRITE) == 0)
+	*settings |= (offset / PROVIDER_CONTEXT_ALIGNMENT) << (REDIRECT_SETTINGS_OFFSET_SHIFT + section * REDIRECT_SETTINGS_OFFSET_BITS);
+
+	return true;
+}
+
+const void* GetRedirectSettingsValue(UINT64 settings, REDIRECT_SETTINGS_SECTION section, const void* context)
+{
+	auto offset = (settings >> (REDIRECT_SETTINGS_OFFSET_SHIFT + section * REDIRECT_SETTINGS_OFFSET_BITS)) & REDIRECT_SETTINGS_OFFSET_MASK;
+	if (offset == 0)
 	{
-		return;
+		return nullptr;
 	}
 
-	auto flags = inFixedValues->incomingValue[FWPS_FIELD_ALE_CONNECT_REDIRECT_V4_FLAGS].value.uint32;
-	if (flags & FWP_CONDITION_FLAG_IS_REAUTHORIZE)
+	return static_cast<const UINT8*>(context) + offset * PROVIDER_CONTEXT_ALIGNMENT;
+}
+
+//
+// Returns the settings to cache for a valid configuration read from the provider context,
+// or false if its sections lie too far into the context to be recorded.
+//
+bool GetRedirectConfigSettings(const FWPM_PROVIDER_CONTEXT* context, const REDIRECT_CONFIG* config, UINT64* settings)
+{
+	*settings = REDIRECT_SETTINGS_VALID;
+
+	auto data = context->dataBuffer->data;
+	if (context->dataBuffer->size == sizeof(CONNECT_REDIRECT_DATA))
 	{
-		return;
+		return true;
 	}
 
-	auto connectRedirectData = GetConnectRedirectDataFromProviderContext(filter->providerContext);
-	if (connectRedirectData == nullptr)
+	return SetRedirectSettingsOffset(settings, RedirectSectionLocalAddressV4, data, config->localAddressV4) &&
+		SetRedirectSettingsOffset(settings, RedirectSectionLocalAddressV6, data, config->localAddressV6) &&
+		SetRedirectSettingsOffset(settings, RedirectSectionExcludedPrefixesV4, data, config->excludedPrefixesV4) &&
+		SetRedirectSettingsOffset(settings, RedirectSectionExcludedPrefixesV6, data, config->excludedPrefixesV6) &&
+		SetRedirectSettingsOffset(settings, RedirectSectionDnsPolicy, data, config->dnsPolicy);
+}
+
+//
+// Reads the callout configuration of the filter. Provider contexts of filters known to the
+// cache were validated when the filter was added, and their sections are found at the
+// offsets the cache holds.
+//
+bool GetRedirectConfig(const FWPS_FILTER* filter, REDIRECT_CONFIG* config)
+{
+	UINT64 settings = 0;
+	if (!RedirectCacheFind(filter->filterId, &settings))
 	{
-		return;
+		CountEvent(CalloutCounterRedirectCacheMiss);
+		return GetRedirectConfigFromProviderContext(filter->providerContext, config);
 	}
 
-	auto remoteAddr = RtlUlongByteSwap(inFixedValues->incomingValue[
-		FWPS_FIELD_ALE_CONNECT_REDIRECT_V4_IP_REMOTE_ADDRESS].value.uint32);
+	CountEvent(CalloutCounterRedirectCacheHit);
+	RtlZeroMemory(config, sizeof(REDIRECT_CONFIG));
 
-	if (isLocalNetwork(remoteAddr))
+	if ((settings & REDIRECT_SETTINGS_VALID) == 0)
 	{
-		return;
+		return false;
+	}
+
+	auto dataBuffer = filter->providerContext->dataBuffer;
+	if (dataBuffer->size == sizeof(CONNECT_REDIRECT_DATA))
+	{
+		config->localAddressV4 = &reinterpret_cast<CONNECT_REDIRECT_DATA*>(dataBuffer->data)->localAddress;
+		return true;
 	}
 
+	auto data = dataBuffer->data;
+	config->localAddressV4 = static_cast<const IN_ADDR*>(
+		GetRedirectSettingsValue(settings, RedirectSectionLocalAddressV4, data));
+	config->localAddressV6 = static_cast<const IN6_ADDR*>(
+		GetRedirectSettingsValue(settings, RedirectSectionLocalAddressV6, data));
+	config->excludedPrefixesV4 = static_cast<const PREFIX_TABLE*>(
+		GetRedirectSettingsValue(settings, RedirectSectionExcludedPrefixesV4, data));
+	config->excludedPrefixesV6 = static_cast<const PREFIX_TABLE*>(
+		GetRedirectSettingsValue(settings, RedirectSectionExcludedPrefixesV6, data));
+	config->dnsPolicy = static_cast<const PROVIDER_CONTEXT_DNS_POLICY_DATA*>(
+		GetRedirectSettingsValue(settings, RedirectSectionDnsPolicy, data));
+
+	return true;
+}
+
+//
+// Rewrites the local address of the connect or bind request being classified.
+//
+template <typename Request>
+bool RedirectLocalAddress(
+	const void* classifyContext,
+	const FWPS_FILTER* filter,
+	FWPS_CLASSIFY_OUT* classifyOut,
+	const UINT8* localAddress,
+	UINT32 addressLength)
+{
 	UINT64 classifyHandle{};
-	FWPS_CONNECT_REQUEST* connectReq{};
+	Request* request{};
+	bool redirected = false;
 
 	__try
 	{
 		auto status = FwpsAcquireClassifyHandle(const_cast<void*>(classifyContext), 0, &classifyHandle);
 		if (!NT_SUCCESS(status))
 		{
-			return;
+			CountEvent(CalloutCounterClassifyHandleFailed);
+			return false;
 		}
 
 		status = FwpsAcquireWritableLayerDataPointer(classifyHandle,
-			filter->filterId, 0, reinterpret_cast<PVOID*>(&connectReq), classifyOut);
+			filter->filterId, 0, reinterpret_cast<PVOID*>(&request), classifyOut);
 		if (!NT_SUCCESS(status))
 		{
-			return;
+			CountEvent(CalloutCounterClassifyHandleFailed);
+			return false;
 		}
 
-		SetSocketIPv4Addr(connectReq->localAddressAndPort, connectRedirectData->localAddress);
+		redirected = RedirectSetSocketAddress(reinterpret_cast<UINT8*>(&request->localAddressAndPort), localAddress, addressLength);
 	}
 	__finally
 	{
-		if (connectReq != nullptr)
+		if (request != nullptr)
 		{
-			FwpsApplyModifiedLayerData(classifyHandle, reinterpret_cast<PVOID>(connectReq), 0);
+			FwpsApplyModifiedLayerData(classifyHandle, reinterpret_cast<PVOID>(request), 0);
 		}
 
 		if (classifyHandle != 0)
@@ -134,9 +260,32 @@ void NTAPI RedirectConnection(
 			FwpsReleaseClassifyHandle(classifyHandle);
 		}
 	}
+
+	return redirected;
 }
 
-void NTAPI RedirectUDPFlow(
+bool CanRedirect(
+	const FWPS_INCOMING_VALUES* inFixedValues,
+	UINT16 layerId,
+	UINT32 flagsField,
+	const FWPS_CLASSIFY_OUT* classifyOut)
+{
+	if (inFixedValues == nullptr || inFixedValues->layerId != layerId)
+	{
+		return false;
+	}
+
+	if ((classifyOut->rights & FWPS_RIGHT_ACTION_WRITE) == 0)
+	{
+		return false;
+	}
+
+	auto flags = inFixedValues->incomingValue[flagsField].value.uint32;
+
+	return (flags & FWP_CONDITION_FLAG_IS_REAUTHORIZE) == 0;
+}
+
+void NTAPI RedirectConnection(
 	IN const FWPS_INCOMING_VALUES* inFixedValues,
 	IN const FWPS_INCOMING_METADATA_VALUES*,
 	IN OUT void*,
@@ -147,135 +296,192 @@ void NTAPI RedirectUDPFlow(
 )
 {
 	classifyOut->actionType = FWP_ACTION_PERMIT;
+	CountEvent(CalloutCounterConnectClassify);
 
-	if (inFixedValues == nullptr)
+	if (!CanRedirect(inFixedValues, FWPS_LAYER_ALE_CONNECT_REDIRECT_V4,
+		FWPS_FIELD_ALE_CONNECT_REDIRECT_V4_FLAGS, classifyOut))
 	{
 		return;
 	}
 
-	if (inFixedValues->layerId != FWPS_LAYER_ALE_BIND_REDIRECT_V4)
+	REDIRECT_CONFIG config{};
+	if (!GetRedirectConfig(filter, &config))
 	{
+		CountEvent(CalloutCounterProviderContextInvalid);
 		return;
 	}
 
-	if ((classifyOut->rights & FWPS_RIGHT_ACTION_WRITE) == 0)
+	if (config.localAddressV4 == nullptr)
 	{
 		return;
 	}
 
-	auto flags = inFixedValues->incomingValue[FWPS_FIELD_ALE_BIND_REDIRECT_V4_FLAGS].value.uint32;
-	if (flags & FWP_CONDITION_FLAG_IS_REAUTHORIZE)
+	auto remoteAddr = RtlUlongByteSwap(inFixedValues->incomingValue[
+		FWPS_FIELD_ALE_CONNECT_REDIRECT_V4_IP_REMOTE_ADDRESS].value.uint32);
+
+	if (!RedirectShouldRedirectConnection(config.excludedPrefixesV4,
+		reinterpret_cast<const UINT8*>(&remoteAddr), sizeof(IN_ADDR)))
 	{
+		CountEvent(CalloutCounterConnectNotRedirected);
 		return;
 	}
 
-	auto protocol = inFixedValues->incomingValue[FWPS_FIELD_ALE_BIND_REDIRECT_V4_IP_PROTOCOL].value.uint8;
-	if (protocol == TCP_PROTOCOL_ID)
+	if (RedirectLocalAddress<FWPS_CONNECT_REQUEST>(classifyContext, filter, classifyOut,
+		reinterpret_cast<const UINT8*>(config.localAddressV4), sizeof(IN_ADDR)))
 	{
-		return;
+		CountEvent(CalloutCounterConnectRedirected);
 	}
+}
+
+void NTAPI RedirectConnectionV6(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES*,
+	IN OUT void*,
+	IN const void* classifyContext,
+	IN const FWPS_FILTER* filter,
+	IN UINT64,
+	IN OUT FWPS_CLASSIFY_OUT* classifyOut
+)
+{
+	classifyOut->actionType = FWP_ACTION_PERMIT;
+	CountEvent(CalloutCounterConnectClassify);
 
-	auto connectRedirectData = GetConnectRedirectDataFromProviderContext(filter->providerContext);
-	if (connectRedirectData == nullptr)
+	if (!CanRedirect(inFixedValues, FWPS_LAYER_ALE_CONNECT_REDIRECT_V6,
+		FWPS_FIELD_ALE_CONNECT_REDIRECT_V6_FLAGS, classifyOut))
 	{
 		return;
 	}
 
-	UINT64 classifyHandle{};
-	FWPS_BIND_REQUEST* bindReq{};
+	REDIRECT_CONFIG config{};
+	if (!GetRedirectConfig(filter, &config))
+	{
+		CountEvent(CalloutCounterProviderContextInvalid);
+		return;
+	}
 
-	__try
+	if (config.localAddressV6 == nullptr)
 	{
-		auto status = FwpsAcquireClassifyHandle(const_cast<void*>(classifyContext), 0, &classifyHandle);
-		if (!NT_SUCCESS(status))
-		{
-			return;
-		}
+		return;
+	}
 
-		status = FwpsAcquireWritableLayerDataPointer(classifyHandle,
-			filter->filterId, 0, reinterpret_cast<PVOID*>(&bindReq), classifyOut);
-		if (!NT_SUCCESS(status))
-		{
-			return;
-		}
+	auto remoteAddr = inFixedValues->incomingValue[
+		FWPS_FIELD_ALE_CONNECT_REDIRECT_V6_IP_REMOTE_ADDRESS].value.byteArray16;
 
-		SetSocketIPv4Addr(bindReq->localAddressAndPort, connectRedirectData->localAddress);
-	}
-	__finally
+	if (remoteAddr == nullptr ||
+		!RedirectShouldRedirectConnection(config.excludedPrefixesV6, remoteAddr->byteArray16, sizeof(IN6_ADDR)))
 	{
-		if (bindReq != nullptr)
-		{
-			FwpsApplyModifiedLayerData(classifyHandle, reinterpret_cast<PVOID>(bindReq), 0);
-		}
+		CountEvent(CalloutCounterConnectNotRedirected);
+		return;
+	}
 
-		if (classifyHandle != 0)
-		{
-			FwpsReleaseClassifyHandle(classifyHandle);
-		}
+	if (RedirectLocalAddress<FWPS_CONNECT_REQUEST>(classifyContext, filter, classifyOut,
+		reinterpret_cast<const UINT8*>(config.localAddressV6), sizeof(IN6_ADDR)))
+	{
+		CountEvent(CalloutCounterConnectRedirected);
 	}
 }
 
-void FreeMemory(PVOID ptr)
+void NTAPI RedirectUDPFlow(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES*,
+	IN OUT void*,
+	IN const void* classifyContext,
+	IN const FWPS_FILTER* filter,
+	IN UINT64,
+	IN OUT FWPS_CLASSIFY_OUT* classifyOut
+)
 {
-    if (ptr != nullptr)
-    {
-        ExFreePoolWithTag(ptr, ProtonTAG);
-    }
-}
+	classifyOut->actionType = FWP_ACTION_PERMIT;
+	CountEvent(CalloutCounterBindClassify);
 
-PVOID AllocateMemory(size_t size)
-{
-    return ExAllocatePoolWithTag(NonPagedPoolNx, size, ProtonTAG);
-}
+	if (!CanRedirect(inFixedValues, FWPS_LAYER_ALE_BIND_REDIRECT_V4,
+		FWPS_FIELD_ALE_BIND_REDIRECT_V4_FLAGS, classifyOut))
+	{
+		return;
+	}
 
-void NTAPI CompleteBasicPacketInjection(VOID *data,
-	_Inout_ NET_BUFFER_LIST *bufferList,
-	_In_ BOOLEAN)
-{
-	PNET_BUFFER buffer = NET_BUFFER_LIST_FIRST_NB(bufferList);
-	PMDL mdl = NET_BUFFER_FIRST_MDL(buffer);
-	FreeMemory(data);
-	IoFreeMdl(mdl);
-	FwpsFreeNetBufferList0(bufferList);
-}
+	auto protocol = inFixedValues->incomingValue[FWPS_FIELD_ALE_BIND_REDIRECT_V4_IP_PROTOCOL].value.uint8;
+	if (protocol == TCP_PROTOCOL_ID)
+	{
+		return;
+	}
 
-void PacketDnsReplyInitv4(PDNSPACKETV4 packet)
-{
-	memset(packet, 0, sizeof(DNSPACKETV4));
-	packet->ip.Version = 4;
-	packet->ip.HdrLength = sizeof(IPHDR) / sizeof(UINT32);
-	packet->ip.Length = htons(sizeof(DNSPACKETV4));
-	packet->ip.Protocol = IPPROTO_UDP;
-	packet->ip.Id = 0;
-	packet->ip.TTL = 64;
-	packet->udp.Length = ntohs(sizeof(UDPHDR) + sizeof(DNSHEADER));
+	REDIRECT_CONFIG config{};
+	if (!GetRedirectConfig(filter, &config))
+	{
+		CountEvent(CalloutCounterProviderContextInvalid);
+		return;
+	}
+
+	if (config.localAddressV4 == nullptr)
+	{
+		return;
+	}
+
+	if (RedirectLocalAddress<FWPS_BIND_REQUEST>(classifyContext, filter, classifyOut,
+		reinterpret_cast<const UINT8*>(config.localAddressV4), sizeof(IN_ADDR)))
+	{
+		CountEvent(CalloutCounterBindRedirected);
+	}
 }
 
-UINT16 CalcChecksum(const PVOID data, UINT len)
+void NTAPI RedirectUDPFlowV6(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES*,
+	IN OUT void*,
+	IN const void* classifyContext,
+	IN const FWPS_FILTER* filter,
+	IN UINT64,
+	IN OUT FWPS_CLASSIFY_OUT* classifyOut
+)
 {
-	UINT32 sum = 0;
-	const auto* data16 = static_cast<const UINT16*>(data);
-	const size_t len16 = len >> 1;
+	classifyOut->actionType = FWP_ACTION_PERMIT;
+	CountEvent(CalloutCounterBindClassify);
+
+	if (!CanRedirect(inFixedValues, FWPS_LAYER_ALE_BIND_REDIRECT_V6,
+		FWPS_FIELD_ALE_BIND_REDIRECT_V6_FLAGS, classifyOut))
+	{
+		return;
+	}
 
-	for (size_t i = 0; i < len16; i++)
+	auto protocol = inFixedValues->incomingValue[FWPS_FIELD_ALE_BIND_REDIRECT_V6_IP_PROTOCOL].value.uint8;
+	if (protocol == TCP_PROTOCOL_ID)
+	{
+		return;
+	}
+
+	REDIRECT_CONFIG config{};
+	if (!GetRedirectConfig(filter, &config))
 	{
-		sum += static_cast<UINT32>(data16[i]);
+		CountEvent(CalloutCounterProviderContextInvalid);
+		return;
 	}
 
-	if (len & 0x1)
+	if (config.localAddressV6 == nullptr)
 	{
-		const auto* data8 = static_cast<const UINT8*>(data);
-		sum += static_cast<UINT16>(data8[len - 1]);
+		return;
 	}
 
-	sum = (sum & 0xFFFF) + (sum >> 16);
-	sum += (sum >> 16);
-	sum = ~sum;
+	if (RedirectLocalAddress<FWPS_BIND_REQUEST>(classifyContext, filter, classifyOut,
+		reinterpret_cast<const UINT8*>(config.localAddressV6), sizeof(IN6_ADDR)))
+	{
+		CountEvent(CalloutCounterBindRedirected);
+	}
+}
 
-	return static_cast<UINT16>(sum);
+void NTAPI CompleteBasicPacketInjection(VOID *data,
+	_Inout_ NET_BUFFER_LIST *bufferList,
+	_In_ BOOLEAN)
+{
+	FwpsFreeNetBufferList0(bufferList);
+	PacketPoolRelease(static_cast<PPACKET_POOL_ENTRY>(data));
 }
 
-bool BlockDnsPacket(PNET_BUFFER buffer, UINT32 interface_index, UINT32 subinterface_index)
+//
+// Returns true if the net buffer carries a DNS request. Only the headers are read,
+// into a stack buffer when they are not contiguous.
+//
+bool GetDnsRequest(PNET_BUFFER buffer, ADDRESS_FAMILY family, DNS_REQUEST* request)
 {
 	const UINT total_len = NET_BUFFER_DATA_LENGTH(buffer);
 	if (total_len < sizeof(IPHDR) || total_len > MAX_PACKET_SIZE)
@@ -283,137 +489,271 @@ bool BlockDnsPacket(PNET_BUFFER buffer, UINT32 interface_index, UINT32 subinterf
 		return false;
 	}
 
-	PVOID buffer_ptr = AllocateMemory(total_len);
-	if (buffer_ptr == nullptr)
-	{
-		return false;
-	}
+	UINT8 headers[DNS_PACKET_CLASSIFY_SIZE];
+	const UINT headers_len = min(total_len, static_cast<UINT>(sizeof(headers)));
 
-	auto* const buffer_data = static_cast<unsigned char*>(buffer_ptr);
-	auto *result = NdisGetDataBuffer(buffer, total_len, buffer_data, 1, 0);
-	if (result == nullptr)
+	auto* data = static_cast<const UINT8*>(NdisGetDataBuffer(buffer, headers_len, headers, 1, 0));
+	if (data == nullptr)
 	{
-		FreeMemory(buffer_ptr);
+		CountEvent(CalloutCounterDnsUnclassified);
 		return false;
 	}
 
-	auto* ip_header = reinterpret_cast<PIPHDR>(buffer_data);
-	if (ip_header == nullptr)
+	return family == AF_INET6 ?
+		DnsPacketParseRequestHeadersV6(data, headers_len, total_len, request) :
+		DnsPacketParseRequestHeadersV4(data, headers_len, total_len, request);
+}
+
+HANDLE GetInjectHandle(ADDRESS_FAMILY family)
+{
+	return family == AF_INET6 ? injectHandleV6 : injectHandle;
+}
+
+//
+// Returns true if the net buffer carries a DNS request and therefore must be blocked.
+// Packets that cannot be classified are permitted and counted. The fail reply is sent
+// on a best effort basis and does not affect the result.
+//
+bool BlockDnsPacket(
+	PNET_BUFFER buffer,
+	ADDRESS_FAMILY family,
+	UINT32 interface_index,
+	UINT32 subinterface_index,
+	bool send_reply)
+{
+	DNS_REQUEST request{};
+	if (!GetDnsRequest(buffer, family, &request))
 	{
-		FreeMemory(buffer_ptr);
 		return false;
 	}
 
-	const UINT ip_header_len = ip_header->HdrLength * sizeof(UINT32);
-	if (ip_header->Version != 4 ||
-		ntohs(ip_header->Length) != total_len ||
-		ip_header_len < sizeof(IPHDR) ||
-		ip_header->Protocol != IPPROTO_UDP ||
-		total_len < ip_header_len + sizeof(UDPHDR) + sizeof(DNSHEADER))
+	if (!send_reply)
 	{
-		FreeMemory(buffer_ptr);
-		return false;
+		return true;
 	}
 
-	auto* udp_header = reinterpret_cast<PUDPHDR>(buffer_data + ip_header_len);
-	if (ntohs(udp_header->DstPort) != 53)
+	auto* entry = PacketPoolAcquire();
+	if (entry == nullptr)
 	{
-		FreeMemory(buffer_ptr);
-		return false;
+		return true;
 	}
 
-	const UINT udp_header_len = sizeof(UDPHDR);
-	const UINT udp_payload_size = total_len - ip_header_len - udp_header_len;
-	auto* const dns_header_size = buffer_data + ip_header_len + udp_header_len;
-	auto* dns_header = reinterpret_cast<PDNSHEADER>(dns_header_size);
-	const UINT reply_size = sizeof(IPHDR) + sizeof(UDPHDR) + udp_payload_size;
-
-	PVOID reply_ptr = AllocateMemory(MAX_PACKET_SIZE);
-	if (reply_ptr == nullptr)
+	const UINT total_len = NET_BUFFER_DATA_LENGTH(buffer);
+	auto* packet = static_cast<const UINT8*>(NdisGetDataBuffer(buffer, total_len, entry->data, 1, 0));
+	if (packet == nullptr)
 	{
-		FreeMemory(buffer_ptr);
-		return false;
+		PacketPoolRelease(entry);
+		return true;
 	}
 
-	auto* const reply = static_cast<unsigned char*>(reply_ptr);
-	auto dns_packet = reinterpret_cast<DNSPACKETV4*>(reply);
-	PacketDnsReplyInitv4(dns_packet);
-
-	//28 = 20 bytes of IP header and 8 bytes of UDP header. So we skip those
-	RtlCopyMemory(reply + sizeof(IPHDR) + sizeof(UDPHDR), dns_header_size, udp_payload_size);
-	
-	dns_packet->dns.flags = htons(0x8002);
-	dns_packet->ip.SrcAddr = ip_header->DstAddr;
-	dns_packet->ip.DstAddr = ip_header->SrcAddr;
-	dns_packet->ip.Length = htons(static_cast<UINT16>(reply_size));
-	dns_packet->udp.SrcPort = udp_header->DstPort;
-	dns_packet->udp.DstPort = udp_header->SrcPort;
-	dns_packet->udp.Length = htons(udp_payload_size + sizeof(UDPHDR));
-	dns_packet->ip.Checksum = CalcChecksum(&dns_packet->ip, dns_packet->ip.HdrLength * sizeof(UINT32));
-	dns_packet->dns.transaction_id = dns_header->transaction_id;
-
-	auto* mdl_copy = IoAllocateMdl(reply_ptr, reply_size, FALSE, FALSE, nullptr);
-	if (mdl_copy == nullptr)
+	const UINT reply_size = family == AF_INET6 ?
+		DnsPacketBuildServerFailV6(packet, &request, entry->data, sizeof(entry->data)) :
+		DnsPacketBuildServerFailV4(packet, &request, entry->data, sizeof(entry->data));
+	if (reply_size == 0)
 	{
-		goto block_dns_failed;
+		PacketPoolRelease(entry);
+		return true;
 	}
 
-	MmBuildMdlForNonPagedPool(mdl_copy);
-
-	PNET_BUFFER_LIST cloned_net_buffer_list = nullptr;
+	PNET_BUFFER_LIST reply_net_buffer_list = nullptr;
 	auto status = FwpsAllocateNetBufferAndNetBufferList0(
 		nbl_pool_handle,
 		0,
 		0,
-		mdl_copy,
+		entry->mdl,
 		0,
 		reply_size,
-		&cloned_net_buffer_list);
+		&reply_net_buffer_list);
 
 	if (!NT_SUCCESS(status))
 	{
-		goto block_dns_failed;
+		CountEvent(CalloutCounterAllocationFailed);
+		PacketPoolRelease(entry);
+		return true;
 	}
 
 	status = FwpsInjectNetworkReceiveAsync0(
-		injectHandle,
+		GetInjectHandle(family),
 		nullptr,
 		0,
 		UNSPECIFIED_COMPARTMENT_ID,
 		interface_index,
 		subinterface_index,
-		cloned_net_buffer_list,
+		reply_net_buffer_list,
 		CompleteBasicPacketInjection,
-		reply_ptr);
+		entry);
+
+	if (!NT_SUCCESS(status))
+	{
+		CountEvent(CalloutCounterInjectionFailed);
+		FwpsFreeNetBufferList0(reply_net_buffer_list);
+		PacketPoolRelease(entry);
+		return true;
+	}
+
+	CountEvent(CalloutCounterDnsReplied);
+
+	return true;
+}
+
+void NTAPI CompleteCloneInjection(VOID*,
+	_Inout_ NET_BUFFER_LIST *bufferList,
+	_In_ BOOLEAN)
+{
+	FwpsFreeCloneNetBufferList0(bufferList, 0);
+}
+
+//
+// Sends a clone of an outbound net buffer list that was chained together with blocked DNS requests.
+// The clone shares the data and the offload information of the original list.
+//
+bool ReinjectNetBufferList(PNET_BUFFER_LIST list, ADDRESS_FAMILY family, COMPARTMENT_ID compartment_id)
+{
+	PNET_BUFFER_LIST clone = nullptr;
+	auto status = FwpsAllocateCloneNetBufferList0(list, nullptr, nullptr, 0, &clone);
+	if (!NT_SUCCESS(status))
+	{
+		CountEvent(CalloutCounterAllocationFailed);
+		return false;
+	}
+
+	status = FwpsInjectNetworkSendAsync0(
+		GetInjectHandle(family),
+		nullptr,
+		0,
+		compartment_id,
+		clone,
+		CompleteCloneInjection,
+		nullptr);
 
 	if (!NT_SUCCESS(status))
 	{
-		goto block_dns_failed;
+		CountEvent(CalloutCounterInjectionFailed);
+		FwpsFreeCloneNetBufferList0(clone, 0);
+		return false;
 	}
 
-	FreeMemory(buffer_ptr);
+	CountEvent(CalloutCounterDnsReinjected);
 
 	return true;
+}
+
+//
+// Number of net buffer list verdicts kept on the stack, longer chains allocate them.
+//
+const UINT32 DNS_CHAIN_STACK_VERDICTS = 32;
+
+//
+// Blocks every DNS request in the chain of net buffer lists. As the verdict applies to
+// the whole chain, other lists chained with DNS requests are cloned and sent again.
+// The buffers of a list belong to one flow, so a list holding a DNS request is blocked
+// as a whole. Buffers that could not be classified do not block their list.
+//
+void BlockDnsRequests(
+	ADDRESS_FAMILY family,
+	IF_INDEX interfaceIndex,
+	IF_INDEX subInterfaceIndex,
+	const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
+	void* packet,
+	const FWPS_FILTER* filter,
+	FWPS_CLASSIFY_OUT* result)
+{
+	auto* const buffers = static_cast<PNET_BUFFER_LIST>(packet);
+	CountEvent(CalloutCounterDnsClassify);
+
+	auto injectionState = FwpsQueryPacketInjectionState0(GetInjectHandle(family), buffers, nullptr);
+	if (injectionState == FWPS_PACKET_INJECTED_BY_SELF ||
+		injectionState == FWPS_PACKET_PREVIOUSLY_INJECTED_BY_SELF)
+	{
+		return;
+	}
+
+	REDIRECT_CONFIG config{};
+	auto sendReply = !GetRedirectConfig(filter, &config) ||
+		config.dnsPolicy == nullptr ||
+		(config.dnsPolicy->flags & PROVIDER_CONTEXT_DNS_SEND_SERVFAIL) != 0;
 
-block_dns_failed:
+	UINT32 listCount = 0;
+	for (auto* list = buffers; list != nullptr; list = NET_BUFFER_LIST_NEXT_NBL(list))
+	{
+		listCount++;
+	}
+
+	bool stackVerdicts[DNS_CHAIN_STACK_VERDICTS]{};
+	auto* blocked = stackVerdicts;
+	if (listCount > DNS_CHAIN_STACK_VERDICTS)
+	{
+		blocked = static_cast<bool*>(ExAllocatePoolWithTag(NonPagedPoolNx, listCount * sizeof(bool), ProtonTAG));
+		if (blocked == nullptr)
+		{
+			CountEvent(CalloutCounterAllocationFailed);
+		}
+	}
+
+	UINT32 dnsCount = 0;
+	UINT32 otherCount = 0;
+	UINT32 index = 0;
 
-	if (mdl_copy != nullptr)
+	for (auto* list = buffers; list != nullptr; list = NET_BUFFER_LIST_NEXT_NBL(list), index++)
 	{
-		IoFreeMdl(mdl_copy);
+		auto listBlocked = false;
+
+		for (auto* buffer = NET_BUFFER_LIST_FIRST_NB(list); buffer != nullptr; buffer = NET_BUFFER_NEXT_NB(buffer))
+		{
+			if (BlockDnsPacket(buffer, family, interfaceIndex, subInterfaceIndex, sendReply))
+			{
+				CountEvent(CalloutCounterDnsBlocked);
+				listBlocked = true;
+				dnsCount++;
+			}
+			else
+			{
+				otherCount++;
+			}
+		}
+
+		if (blocked != nullptr)
+		{
+			blocked[index] = listBlocked;
+		}
 	}
 
-	FreeMemory(buffer_ptr);
-	FreeMemory(reply_ptr);
+	if (dnsCount != 0)
+	{
+		// Without the verdicts the other packets are dropped along with the DNS requests.
+		if (otherCount != 0 && blocked != nullptr)
+		{
+			const auto compartmentId = FWPS_IS_METADATA_FIELD_PRESENT(inMetaValues, FWPS_METADATA_FIELD_COMPARTMENT_ID) ?
+				static_cast<COMPARTMENT_ID>(inMetaValues->compartmentId) :
+				UNSPECIFIED_COMPARTMENT_ID;
+
+			index = 0;
+			for (auto* list = buffers; list != nullptr; list = NET_BUFFER_LIST_NEXT_NBL(list), index++)
+			{
+				if (!blocked[index])
+				{
+					ReinjectNetBufferList(list, family, compartmentId);
+				}
+			}
+		}
+
+		result->actionType = FWP_ACTION_BLOCK;
+		result->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
+		result->rights &= ~FWPS_RIGHT_ACTION_WRITE;
+	}
 
-	return false;
+	if (blocked != nullptr && blocked != stackVerdicts)
+	{
+		ExFreePoolWithTag(blocked, ProtonTAG);
+	}
 }
 
 void NTAPI BlockDnsBySendingServerFailPacket(
 	IN const FWPS_INCOMING_VALUES* inFixedValues,
-	IN const FWPS_INCOMING_METADATA_VALUES*,
+	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
 	IN OUT void* packet,
 	IN const void*,
-	IN const FWPS_FILTER*,
+	IN const FWPS_FILTER* filter,
 	IN UINT64,
 	IN OUT FWPS_CLASSIFY_OUT* result)
 {
@@ -424,30 +764,32 @@ void NTAPI BlockDnsBySendingServerFailPacket(
 
 	result->actionType = FWP_ACTION_PERMIT;
 
-	auto* const buffers = static_cast<PNET_BUFFER_LIST>(packet);
+	const auto interfaceIndex = static_cast<IF_INDEX>(inFixedValues->incomingValue[FWPS_FIELD_OUTBOUND_IPPACKET_V4_INTERFACE_INDEX].value.uint32);
+	const auto subInterfaceIndex = static_cast<IF_INDEX>(inFixedValues->incomingValue[FWPS_FIELD_OUTBOUND_IPPACKET_V4_SUB_INTERFACE_INDEX].value.uint32);
+
+	BlockDnsRequests(AF_INET, interfaceIndex, subInterfaceIndex, inMetaValues, packet, filter, result);
+}
 
-	if (NET_BUFFER_LIST_NEXT_NBL(buffers) != nullptr)
+void NTAPI BlockDnsV6BySendingServerFailPacket(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
+	IN OUT void* packet,
+	IN const void*,
+	IN const FWPS_FILTER* filter,
+	IN UINT64,
+	IN OUT FWPS_CLASSIFY_OUT* result)
+{
+	if ((result->rights & FWPS_RIGHT_ACTION_WRITE) == 0 || packet == nullptr)
 	{
 		return;
 	}
 
-	const auto interfaceIndex = static_cast<IF_INDEX>(inFixedValues->incomingValue[FWPS_FIELD_OUTBOUND_IPPACKET_V4_INTERFACE_INDEX].value.uint32);
-	const auto subInterfaceIndex = static_cast<IF_INDEX>(inFixedValues->incomingValue[FWPS_FIELD_OUTBOUND_IPPACKET_V4_SUB_INTERFACE_INDEX].value.uint32);
-	auto blocked = false;
-	auto* buffer = NET_BUFFER_LIST_FIRST_NB(buffers);
+	result->actionType = FWP_ACTION_PERMIT;
 
-    while (buffer != nullptr)
-	{
-		blocked = BlockDnsPacket(buffer, interfaceIndex, subInterfaceIndex);
-		buffer = NET_BUFFER_NEXT_NB(buffer);
-	}
+	const auto interfaceIndex = static_cast<IF_INDEX>(inFixedValues->incomingValue[FWPS_FIELD_OUTBOUND_IPPACKET_V6_INTERFACE_INDEX].value.uint32);
+	const auto subInterfaceIndex = static_cast<IF_INDEX>(inFixedValues->incomingValue[FWPS_FIELD_OUTBOUND_IPPACKET_V6_SUB_INTERFACE_INDEX].value.uint32);
 
-	if (blocked)
-	{
-		result->actionType = FWP_ACTION_BLOCK;
-		result->flags |= FWPS_CLASSIFY_OUT_FLAG_ABSORB;
-		result->rights &= ~FWPS_RIGHT_ACTION_WRITE;
-	}
+	BlockDnsRequests(AF_INET6, interfaceIndex, subInterfaceIndex, inMetaValues, packet, filter, result);
 }
 
 NTSTATUS NTAPI NotifyFn(
@@ -456,9 +798,36 @@ NTSTATUS NTAPI NotifyFn(
 	IN const FWPS_FILTER* filter
 )
 {
-	UNREFERENCED_PARAMETER(notifyType);
 	UNREFERENCED_PARAMETER(filterKey);
-	UNREFERENCED_PARAMETER(filter);
+
+	if (filter == nullptr || filter->providerContext == nullptr)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	switch (notifyType)
+	{
+	case FWPS_CALLOUT_NOTIFY_ADD_FILTER:
+	{
+		REDIRECT_CONFIG config{};
+		UINT64 settings = REDIRECT_SETTINGS_INVALID;
+		if (GetRedirectConfigFromProviderContext(filter->providerContext, &config) &&
+			!GetRedirectConfigSettings(filter->providerContext, &config, &settings))
+		{
+			// Classifies of the filter read the provider context each time.
+			TraceEvents(TRACE_LEVEL_WARNING, TRACE_CALLOUT, "%!FUNC! Provider context of filter %llu is too large to cache", filter->filterId);
+			break;
+		}
+
+		RedirectCacheStore(filter->filterId, settings);
+		break;
+	}
+	case FWPS_CALLOUT_NOTIFY_DELETE_FILTER:
+		RedirectCacheRemove(filter->filterId);
+		break;
+	default:
+		break;
+	}
 
 	return STATUS_SUCCESS;
 }
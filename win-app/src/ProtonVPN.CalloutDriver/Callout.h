@@ -3,6 +3,9 @@
 #include <fwpsk.h>
 #include <fwpmtypes.h>
 
+#include "PrefixTable.h"
+#include "ProviderContext.h"
+
 typedef struct INJECTION_DATA_
 {
 	ADDRESS_FAMILY              addressFamily;
@@ -101,6 +104,19 @@ typedef struct
 	DNSANSWER additional;
 } DNSPACKETV4, * PDNSPACKETV4;
 
+//
+// Callout configuration read from the provider context of a filter.
+// Pointers refer to the provider context data and are null when the setting is absent.
+//
+typedef struct REDIRECT_CONFIG_
+{
+	const IN_ADDR* localAddressV4;
+	const IN6_ADDR* localAddressV6;
+	const PREFIX_TABLE* excludedPrefixesV4;
+	const PREFIX_TABLE* excludedPrefixesV6;
+	const PROVIDER_CONTEXT_DNS_POLICY_DATA* dnsPolicy;
+} REDIRECT_CONFIG, * PREDIRECT_CONFIG;
+
 NTSTATUS RegisterCallout(
 	_In_ PDEVICE_OBJECT deviceObject,
 	_In_ const GUID& key,
@@ -118,6 +134,16 @@ void NTAPI RedirectConnection(
 	IN OUT FWPS_CLASSIFY_OUT* classifyOut
 );
 
+void NTAPI RedirectConnectionV6(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
+	IN OUT VOID* layerData,
+	IN const void* classifyContext,
+	IN const FWPS_FILTER* filter,
+	IN UINT64 flowContext,
+	IN OUT FWPS_CLASSIFY_OUT* classifyOut
+);
+
 void NTAPI RedirectUDPFlow(
 	IN const FWPS_INCOMING_VALUES* inFixedValues,
 	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
@@ -128,6 +154,16 @@ void NTAPI RedirectUDPFlow(
 	IN OUT FWPS_CLASSIFY_OUT* classifyOut
 );
 
+void NTAPI RedirectUDPFlowV6(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
+	IN OUT VOID* layerData,
+	IN const void* classifyContext,
+	IN const FWPS_FILTER* filter,
+	IN UINT64 flowContext,
+	IN OUT FWPS_CLASSIFY_OUT* classifyOut
+);
+
 void NTAPI BlockDnsBySendingServerFailPacket(
 	IN const FWPS_INCOMING_VALUES* inFixedValues,
 	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
@@ -138,6 +174,16 @@ void NTAPI BlockDnsBySendingServerFailPacket(
 	IN OUT FWPS_CLASSIFY_OUT* classifyOut
 );
 
+void NTAPI BlockDnsV6BySendingServerFailPacket(
+	IN const FWPS_INCOMING_VALUES* inFixedValues,
+	IN const FWPS_INCOMING_METADATA_VALUES* inMetaValues,
+	IN OUT VOID* packet,
+	IN const void*,
+	IN const FWPS_FILTER*,
+	IN UINT64,
+	IN OUT FWPS_CLASSIFY_OUT* classifyOut
+);
+
 #define BYTESWAP16(x)                   \
     ((((x) >> 8) & 0x00FFu) | (((x) << 8) & 0xFF00u))
 #define ntohs(x)                        BYTESWAP16(x)
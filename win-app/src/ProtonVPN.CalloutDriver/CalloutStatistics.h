@@ -0,0 +1,146 @@
+/*++
+
+Module Name:
+
+    CalloutStatistics.h
+
+Abstract:
+
+    Callout counters shared by the driver and user applications.
+
+    The driver keeps one CALLOUT_COUNTER_BLOCK per processor. Each block spans whole
+    cache lines, so processors never write to the same line. Blocks are summed on demand
+    into CALLOUT_STATISTICS, which is returned by IOCTL_CALLOUT_GET_STATISTICS.
+
+    New counters are appended, readers use counterCount to know how many are valid.
+    Readers may pass any buffer holding at least the header, counterCount is then
+    limited to the counters that fit.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CALLOUT_STATISTICS_VERSION 1
+#define CALLOUT_STATISTICS_CACHE_LINE 64
+
+//
+// User mode path of the control device, and CTL_CODE(FILE_DEVICE_NETWORK, 0x800, METHOD_BUFFERED, FILE_READ_ACCESS).
+//
+#define CALLOUT_DEVICE_PATH L"\\\\.\\ProtonVPNCallout"
+#define IOCTL_CALLOUT_GET_STATISTICS 0x00126000u
+
+typedef enum CALLOUT_COUNTER
+{
+	CalloutCounterConnectClassify,
+	CalloutCounterConnectRedirected,
+	CalloutCounterConnectNotRedirected,
+	CalloutCounterBindClassify,
+	CalloutCounterBindRedirected,
+	CalloutCounterDnsClassify,
+	CalloutCounterDnsBlocked,
+	CalloutCounterDnsReplied,
+	CalloutCounterDnsReinjected,
+	CalloutCounterProviderContextInvalid,
+	CalloutCounterClassifyHandleFailed,
+	CalloutCounterPoolEntryAllocated,
+	CalloutCounterAllocationFailed,
+	CalloutCounterInjectionFailed,
+	CalloutCounterRedirectCacheHit,
+	CalloutCounterRedirectCacheMiss,
+	CalloutCounterDnsUnclassified,
+	CalloutCounterCount
+} CALLOUT_COUNTER;
+
+#define CALLOUT_COUNTER_SLOTS \
+	((CalloutCounterCount + CALLOUT_STATISTICS_CACHE_LINE / sizeof(uint64_t) - 1) & \
+	 ~(CALLOUT_STATISTICS_CACHE_LINE / sizeof(uint64_t) - 1))
+
+typedef struct CALLOUT_COUNTER_BLOCK
+{
+	uint64_t counters[CALLOUT_COUNTER_SLOTS];
+} CALLOUT_COUNTER_BLOCK;
+
+typedef struct CALLOUT_STATISTICS
+{
+	uint32_t version;
+	uint32_t counterCount;
+	uint64_t counters[CALLOUT_COUNTER_SLOTS];
+} CALLOUT_STATISTICS;
+
+static_assert(sizeof(CALLOUT_COUNTER_BLOCK) % CALLOUT_STATISTICS_CACHE_LINE == 0,
+	"CALLOUT_COUNTER_BLOCK must span whole cache lines");
+
+//
+// Returns the block of the processor within a buffer of blocks, aligned to a cache line.
+// The buffer must hold CalloutCounterBlocksSize(blockCount) bytes.
+//
+inline CALLOUT_COUNTER_BLOCK* CalloutCounterBlock(void* buffer, uint32_t processor)
+{
+	uintptr_t address = reinterpret_cast<uintptr_t>(buffer);
+	address = (address + CALLOUT_STATISTICS_CACHE_LINE - 1) & ~static_cast<uintptr_t>(CALLOUT_STATISTICS_CACHE_LINE - 1);
+
+	return reinterpret_cast<CALLOUT_COUNTER_BLOCK*>(address) + processor;
+}
+
+inline size_t CalloutCounterBlocksSize(uint32_t blockCount)
+{
+	return sizeof(CALLOUT_COUNTER_BLOCK) * blockCount + CALLOUT_STATISTICS_CACHE_LINE - 1;
+}
+
+//
+// Sums the counters of all blocks. Counters may be updated while they are read,
+// so the totals are a snapshot of each counter rather than of all of them at once.
+//
+inline void CalloutStatisticsAggregate(const void* buffer, uint32_t blockCount, CALLOUT_STATISTICS* statistics)
+{
+	statistics->version = CALLOUT_STATISTICS_VERSION;
+	statistics->counterCount = CalloutCounterCount;
+
+	for (uint32_t i = 0; i < CALLOUT_COUNTER_SLOTS; i++)
+	{
+		statistics->counters[i] = 0;
+	}
+
+	for (uint32_t processor = 0; processor < blockCount; processor++)
+	{
+		const volatile uint64_t* counters = CalloutCounterBlock(const_cast<void*>(buffer), processor)->counters;
+		for (uint32_t i = 0; i < CalloutCounterCount; i++)
+		{
+			statistics->counters[i] += counters[i];
+		}
+	}
+}
+
+//
+// Copies the statistics into a reader buffer of the given length and returns the number of bytes
+// written, or 0 if the buffer does not hold the header. Buffers of readers with fewer counters
+// receive the counters that fit, buffers of readers with more counters are filled partially.
+//
+inline size_t CalloutStatisticsCopy(const CALLOUT_STATISTICS* statistics, void* buffer, size_t length)
+{
+	const size_t headerSize = offsetof(CALLOUT_STATISTICS, counters);
+	if (length < headerSize)
+	{
+		return 0;
+	}
+
+	CALLOUT_STATISTICS copy = *statistics;
+	length = length < sizeof(copy) ? length : sizeof(copy);
+
+	const uint32_t copiedCount = static_cast<uint32_t>((length - headerSize) / sizeof(uint64_t));
+	if (copy.counterCount > copiedCount)
+	{
+		copy.counterCount = copiedCount;
+	}
+
+	memcpy(buffer, &copy, length);
+
+	return length;
+}
@@ -0,0 +1,273 @@
+/*++
+
+Module Name:
+
+    Checksum.h
+
+Abstract:
+
+    Internet checksum (RFC 1071) shared by the driver and user mode packet builders,
+    with incremental updates (RFC 1624) and UDP pseudo-header checksums.
+
+    Data is summed as 32-bit words into a 64-bit accumulator. On x64 the sum uses SSE2,
+    which every x64 processor has. User mode additionally uses AVX2 when the processor
+    and the operating system support it. Kernel mode never does, as it would need to
+    save the extended processor state around every call.
+
+    Partial sums and checksums are 16-bit values of the words in network byte order.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CHECKSUM_SSE2
+#include <emmintrin.h>
+#if !defined(_KERNEL_MODE)
+#define CHECKSUM_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CHECKSUM_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define CHECKSUM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+inline uint32_t ChecksumFold(uint64_t sum)
+{
+	sum = (sum & 0xFFFFFFFFull) + (sum >> 32);
+	sum = (sum & 0xFFFFFFFFull) + (sum >> 32);
+	uint32_t sum32 = static_cast<uint32_t>(sum);
+	sum32 = (sum32 & 0xFFFF) + (sum32 >> 16);
+	sum32 = (sum32 & 0xFFFF) + (sum32 >> 16);
+
+	return sum32;
+}
+
+//
+// Sums the data in native byte order, the result is only meaningful after folding.
+//
+inline uint64_t ChecksumSumScalar(const uint8_t* data, size_t length, uint64_t sum)
+{
+	while (length >= 4)
+	{
+		uint32_t word;
+		memcpy(&word, data, sizeof(word));
+		sum += word;
+		data += 4;
+		length -= 4;
+	}
+
+	if (length >= 2)
+	{
+		uint16_t word;
+		memcpy(&word, data, sizeof(word));
+		sum += word;
+		data += 2;
+		length -= 2;
+	}
+
+	if (length != 0)
+	{
+		uint16_t word = 0;
+		memcpy(&word, data, 1);
+		sum += word;
+	}
+
+	return sum;
+}
+
+#ifdef CHECKSUM_SSE2
+inline uint64_t ChecksumSumSse2(const uint8_t* data, size_t length, uint64_t sum)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i low = zero;
+	__m128i high = zero;
+
+	while (length >= 16)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		low = _mm_add_epi64(low, _mm_unpacklo_epi32(value, zero));
+		high = _mm_add_epi64(high, _mm_unpackhi_epi32(value, zero));
+		data += 16;
+		length -= 16;
+	}
+
+	// Each lane received at most length / 16 values below 2^32, so the lanes do not overflow
+	// for any buffer the callers handle and the sum is folded once at the end.
+	uint64_t lanes[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(low, high));
+	sum = ChecksumFold(sum) + ChecksumFold(lanes[0]) + ChecksumFold(lanes[1]);
+
+	return ChecksumSumScalar(data, length, sum);
+}
+#endif
+
+#ifdef CHECKSUM_AVX2
+CHECKSUM_TARGET_AVX2 inline uint64_t ChecksumSumAvx2(const uint8_t* data, size_t length, uint64_t sum)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i low = zero;
+	__m256i high = zero;
+
+	while (length >= 32)
+	{
+		__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+		low = _mm256_add_epi64(low, _mm256_unpacklo_epi32(value, zero));
+		high = _mm256_add_epi64(high, _mm256_unpackhi_epi32(value, zero));
+		data += 32;
+		length -= 32;
+	}
+
+	uint64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(low, high));
+	sum = ChecksumFold(sum) + ChecksumFold(lanes[0]) + ChecksumFold(lanes[1]) +
+		ChecksumFold(lanes[2]) + ChecksumFold(lanes[3]);
+
+	return ChecksumSumSse2(data, length, sum);
+}
+
+inline bool ChecksumHasAvx2()
+{
+	// 0 - not detected yet, 1 - unsupported, 2 - supported. Detection is idempotent, so racing callers are fine.
+	static volatile int support = 0;
+
+	if (support == 0)
+	{
+		bool result = false;
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			__cpuidex(info, 7, 0);
+			result = osxsave && (info[1] & (1 << 5)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+		}
+#else
+		unsigned int eax, ebx, ecx, edx;
+		if (__get_cpuid_max(0, nullptr) >= 7 && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) != 0)
+		{
+			unsigned int xcr0;
+			__asm__("xgetbv" : "=a"(xcr0) : "c"(0) : "edx");
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			result = (ebx & bit_AVX2) != 0 && (xcr0 & 0x6) == 0x6;
+		}
+#endif
+		support = result ? 2 : 1;
+	}
+
+	return support == 2;
+}
+#endif
+
+inline uint64_t ChecksumSum(const uint8_t* data, size_t length, uint64_t sum)
+{
+#if defined(CHECKSUM_AVX2)
+	if (length >= 256 && ChecksumHasAvx2())
+	{
+		return ChecksumSumAvx2(data, length, sum);
+	}
+#endif
+#if defined(CHECKSUM_SSE2)
+	if (length >= 32)
+	{
+		return ChecksumSumSse2(data, length, sum);
+	}
+#endif
+	return ChecksumSumScalar(data, length, sum);
+}
+
+//
+// Converts a folded native byte order sum to the value of the words in network byte order.
+//
+inline uint16_t ChecksumToNetworkOrder(uint32_t folded)
+{
+	const uint16_t probe = 1;
+	uint8_t first;
+	memcpy(&first, &probe, 1);
+
+	return first == 1 ?
+		static_cast<uint16_t>((folded >> 8) | (folded << 8)) :
+		static_cast<uint16_t>(folded);
+}
+
+//
+// Returns the partial sum of the data added to an initial partial sum.
+//
+inline uint16_t ChecksumPartial(const uint8_t* data, size_t length, uint16_t initial)
+{
+	uint32_t sum = ChecksumToNetworkOrder(ChecksumFold(ChecksumSum(data, length, 0))) + static_cast<uint32_t>(initial);
+
+	return static_cast<uint16_t>(ChecksumFold(sum));
+}
+
+inline uint16_t ChecksumFinish(uint16_t partial)
+{
+	return static_cast<uint16_t>(~partial);
+}
+
+inline uint16_t ChecksumCompute(const uint8_t* data, size_t length)
+{
+	return ChecksumFinish(ChecksumPartial(data, length, 0));
+}
+
+//
+// Updates a checksum after a 16-bit word of the covered data changed, RFC 1624 equation 3.
+//
+inline uint16_t ChecksumUpdate16(uint16_t checksum, uint16_t oldValue, uint16_t newValue)
+{
+	uint32_t sum = static_cast<uint16_t>(~checksum) + static_cast<uint32_t>(static_cast<uint16_t>(~oldValue)) + newValue;
+
+	return static_cast<uint16_t>(~ChecksumFold(sum));
+}
+
+//
+// Updates a checksum after an even sized, word aligned field of the covered data changed,
+// for example an address.
+//
+inline uint16_t ChecksumUpdate(uint16_t checksum, const uint8_t* oldValue, const uint8_t* newValue, size_t length)
+{
+	uint32_t sum = static_cast<uint16_t>(~checksum);
+
+	for (size_t i = 0; i + 1 < length; i += 2)
+	{
+		sum += static_cast<uint16_t>(~((oldValue[i] << 8) | oldValue[i + 1]));
+		sum += static_cast<uint32_t>((newValue[i] << 8) | newValue[i + 1]);
+	}
+
+	return static_cast<uint16_t>(~ChecksumFold(sum));
+}
+
+//
+// Returns the UDP checksum of a datagram, including the pseudo-header built from
+// the addresses (4 or 16 bytes each). The checksum field of the datagram must be zero.
+// A computed zero is transmitted as all ones, as zero means no checksum.
+//
+inline uint16_t ChecksumUdp(
+	const uint8_t* sourceAddress,
+	const uint8_t* destinationAddress,
+	size_t addressLength,
+	const uint8_t* datagram,
+	uint32_t length)
+{
+	const uint16_t udpProtocol = 17;
+	uint16_t partial = ChecksumPartial(sourceAddress, addressLength, 0);
+	partial = ChecksumPartial(destinationAddress, addressLength, partial);
+	partial = static_cast<uint16_t>(ChecksumFold(static_cast<uint32_t>(partial) + udpProtocol + (length >> 16) + (length & 0xFFFF)));
+
+	uint16_t checksum = ChecksumFinish(ChecksumPartial(datagram, length, partial));
+
+	return checksum == 0 ? 0xFFFF : checksum;
+}
@@ -0,0 +1,250 @@
+/*++
+
+Module Name:
+
+    DecisionTable.h
+
+Abstract:
+
+    Fixed capacity lock-free hash table from 64-bit keys to 64-bit values, used by the
+    callouts to remember decisions across classifies without taking locks.
+
+    Slots are probed linearly within a window of DECISION_TABLE_MAX_PROBES slots.
+    Removed slots become tombstones that later inserts reuse, slots never become empty
+    again, so a lookup stops at the first empty slot. A writer owns a slot by switching
+    its key to DECISION_TABLE_BUSY, only the owner changes the value and lookups skip
+    owned slots.
+
+    Concurrent inserts of the same key may each claim a slot, they are expected to
+    store the same value.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define DECISION_TABLE_EMPTY 0ull
+#define DECISION_TABLE_DELETED ~0ull
+#define DECISION_TABLE_BUSY (~0ull - 1)
+#define DECISION_TABLE_MAX_PROBES 16
+
+typedef struct DECISION_TABLE_SLOT
+{
+	volatile uint64_t key;
+	volatile uint64_t value;
+} DECISION_TABLE_SLOT;
+
+typedef struct DECISION_TABLE
+{
+	uint32_t capacity;
+	uint32_t reserved;
+	DECISION_TABLE_SLOT slots[1];
+} DECISION_TABLE;
+
+inline uint64_t DecisionTableCompareExchange(volatile uint64_t* target, uint64_t exchange, uint64_t comparand)
+{
+#if defined(_MSC_VER)
+	return static_cast<uint64_t>(_InterlockedCompareExchange64(
+		reinterpret_cast<volatile long long*>(target),
+		static_cast<long long>(exchange),
+		static_cast<long long>(comparand)));
+#else
+	__atomic_compare_exchange_n(target, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+#endif
+}
+
+inline uint64_t DecisionTableLoad(const volatile uint64_t* target)
+{
+#if defined(_MSC_VER) && defined(_M_IX86)
+	// 64-bit loads are not atomic on x86, a compare exchange that never changes the value is.
+	return DecisionTableCompareExchange(const_cast<volatile uint64_t*>(target), 0, 0);
+#elif defined(_MSC_VER)
+	// Volatile loads have acquire semantics on x64.
+	return *target;
+#else
+	return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void DecisionTableStore(volatile uint64_t* target, uint64_t value)
+{
+#if defined(_MSC_VER)
+	uint64_t current = DecisionTableLoad(target);
+	uint64_t previous;
+	while ((previous = DecisionTableCompareExchange(target, value, current)) != current)
+	{
+		current = previous;
+	}
+#else
+	__atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
+
+inline size_t DecisionTableSize(uint32_t capacity)
+{
+	return offsetof(DECISION_TABLE, slots) + sizeof(DECISION_TABLE_SLOT) * static_cast<size_t>(capacity);
+}
+
+//
+// Initializes an empty table in a buffer of DecisionTableSize(capacity) bytes.
+// Returns nullptr unless the capacity is a power of two of at least DECISION_TABLE_MAX_PROBES.
+//
+inline DECISION_TABLE* DecisionTableInitialize(void* buffer, uint32_t capacity)
+{
+	if (buffer == nullptr ||
+		capacity < DECISION_TABLE_MAX_PROBES ||
+		capacity > 0x80000000u ||
+		(capacity & (capacity - 1)) != 0)
+	{
+		return nullptr;
+	}
+
+	memset(buffer, 0, DecisionTableSize(capacity));
+
+	DECISION_TABLE* table = static_cast<DECISION_TABLE*>(buffer);
+	table->capacity = capacity;
+
+	return table;
+}
+
+inline uint32_t DecisionTableHome(const DECISION_TABLE* table, uint64_t key)
+{
+	return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (table->capacity - 1);
+}
+
+inline bool DecisionTableIsValidKey(uint64_t key)
+{
+	return key != DECISION_TABLE_EMPTY && key != DECISION_TABLE_DELETED && key != DECISION_TABLE_BUSY;
+}
+
+//
+// Takes ownership of the slot if its key is the expected one.
+//
+inline bool DecisionTableAcquireSlot(DECISION_TABLE_SLOT& slot, uint64_t expectedKey)
+{
+	return DecisionTableCompareExchange(&slot.key, DECISION_TABLE_BUSY, expectedKey) == expectedKey;
+}
+
+inline void DecisionTableReleaseSlot(DECISION_TABLE_SLOT& slot, uint64_t key, uint64_t value)
+{
+	DecisionTableStore(&slot.value, value);
+	DecisionTableStore(&slot.key, key);
+}
+
+//
+// Returns true and the value of the key if the table holds it.
+//
+inline bool DecisionTableLookup(const DECISION_TABLE* table, uint64_t key, uint64_t* value)
+{
+	if (!DecisionTableIsValidKey(key))
+	{
+		return false;
+	}
+
+	uint32_t index = DecisionTableHome(table, key);
+	for (uint32_t i = 0; i < DECISION_TABLE_MAX_PROBES; i++)
+	{
+		const DECISION_TABLE_SLOT& slot = table->slots[(index + i) & (table->capacity - 1)];
+		uint64_t slotKey = DecisionTableLoad(&slot.key);
+		if (slotKey == DECISION_TABLE_EMPTY)
+		{
+			return false;
+		}
+
+		if (slotKey == key)
+		{
+			// The key is read again, so a value written by a later owner of the slot is not returned.
+			uint64_t slotValue = DecisionTableLoad(&slot.value);
+			if (DecisionTableLoad(&slot.key) != key)
+			{
+				return false;
+			}
+
+			*value = slotValue;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// Stores the value of the key, replacing the previous one.
+// Returns false if the probe window of the key is full.
+//
+inline bool DecisionTableInsert(DECISION_TABLE* table, uint64_t key, uint64_t value)
+{
+	if (!DecisionTableIsValidKey(key))
+	{
+		return false;
+	}
+
+	uint32_t index = DecisionTableHome(table, key);
+	for (uint32_t i = 0; i < DECISION_TABLE_MAX_PROBES; i++)
+	{
+		DECISION_TABLE_SLOT& slot = table->slots[(index + i) & (table->capacity - 1)];
+		uint64_t slotKey = DecisionTableLoad(&slot.key);
+		if (slotKey == DECISION_TABLE_EMPTY)
+		{
+			break;
+		}
+
+		if (slotKey == key && DecisionTableAcquireSlot(slot, key))
+		{
+			DecisionTableReleaseSlot(slot, key, value);
+			return true;
+		}
+	}
+
+	for (uint32_t i = 0; i < DECISION_TABLE_MAX_PROBES; i++)
+	{
+		DECISION_TABLE_SLOT& slot = table->slots[(index + i) & (table->capacity - 1)];
+		uint64_t slotKey = DecisionTableLoad(&slot.key);
+		if ((slotKey == DECISION_TABLE_EMPTY || slotKey == DECISION_TABLE_DELETED) &&
+			DecisionTableAcquireSlot(slot, slotKey))
+		{
+			DecisionTableReleaseSlot(slot, key, value);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// Removes the key, the slot becomes a tombstone.
+//
+inline void DecisionTableRemove(DECISION_TABLE* table, uint64_t key)
+{
+	if (!DecisionTableIsValidKey(key))
+	{
+		return;
+	}
+
+	uint32_t index = DecisionTableHome(table, key);
+	for (uint32_t i = 0; i < DECISION_TABLE_MAX_PROBES; i++)
+	{
+		DECISION_TABLE_SLOT& slot = table->slots[(index + i) & (table->capacity - 1)];
+		uint64_t slotKey = DecisionTableLoad(&slot.key);
+		if (slotKey == DECISION_TABLE_EMPTY)
+		{
+			return;
+		}
+
+		if (slotKey == key && DecisionTableAcquireSlot(slot, key))
+		{
+			DecisionTableReleaseSlot(slot, DECISION_TABLE_DELETED, 0);
+		}
+	}
+}
@@ -4,6 +4,7 @@
 #include "Trace.h"
 #include "Device.h"
 #include "Device.tmh"
+#include "Statistics.h"
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (INIT, CreateDevice)
@@ -18,11 +19,13 @@ CreateDevice(
 {
     PWDFDEVICE_INIT deviceInit;
     NTSTATUS status;
+    DECLARE_CONST_UNICODE_STRING(deviceName, CALLOUT_DEVICE_NAME);
+    DECLARE_CONST_UNICODE_STRING(symbolicLinkName, CALLOUT_SYMBOLIC_LINK_NAME);
 
-    // Allocate a device initialization structure
+    // Allocate a device initialization structure, the device is opened by the service to read statistics
     deviceInit = WdfControlDeviceInitAllocate(
         Driver,
-        &SDDL_DEVOBJ_KERNEL_ONLY
+        &SDDL_DEVOBJ_SYS_ALL_ADM_ALL
     );
 
     if (deviceInit == NULL)
@@ -34,10 +37,18 @@ CreateDevice(
     // Set the device characteristics
     WdfDeviceInitSetCharacteristics(
         deviceInit,
-        FILE_DEVICE_SECURE_OPEN | FILE_AUTOGENERATED_DEVICE_NAME,
+        FILE_DEVICE_SECURE_OPEN,
         FALSE
     );
 
+    status = WdfDeviceInitAssignName(deviceInit, &deviceName);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "%!FUNC! WdfDeviceInitAssignName failed %!STATUS!", status);
+        WdfDeviceInitFree(deviceInit);
+        return status;
+    }
+
     // Create a framework device object
     status = WdfDeviceCreate(
         &deviceInit,
@@ -51,6 +62,26 @@ CreateDevice(
         return status;
     }
 
+    status = WdfDeviceCreateSymbolicLink(*Device, &symbolicLinkName);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "%!FUNC! WdfDeviceCreateSymbolicLink failed %!STATUS!", status);
+        WdfObjectDelete(*Device);
+        return status;
+    }
+
+    WDF_IO_QUEUE_CONFIG queueConfig;
+    WDF_IO_QUEUE_CONFIG_INIT_DEFAULT_QUEUE(&queueConfig, WdfIoQueueDispatchParallel);
+    queueConfig.EvtIoDeviceControl = EvtIoDeviceControl;
+
+    status = WdfIoQueueCreate(*Device, &queueConfig, WDF_NO_OBJECT_ATTRIBUTES, WDF_NO_HANDLE);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "%!FUNC! WdfIoQueueCreate failed %!STATUS!", status);
+        WdfObjectDelete(*Device);
+        return status;
+    }
+
     // Initialization of the framework device object is complete
     WdfControlFinishInitializing(*Device);
 
@@ -65,3 +96,38 @@ DeleteDevice(
 {
     WdfObjectDelete(Device);
 }
+
+VOID
+EvtIoDeviceControl(
+    _In_ WDFQUEUE Queue,
+    _In_ WDFREQUEST Request,
+    _In_ size_t OutputBufferLength,
+    _In_ size_t InputBufferLength,
+    _In_ ULONG IoControlCode
+)
+{
+    UNREFERENCED_PARAMETER(Queue);
+    UNREFERENCED_PARAMETER(InputBufferLength);
+
+    if (IoControlCode != IOCTL_CALLOUT_GET_STATISTICS)
+    {
+        WdfRequestComplete(Request, STATUS_INVALID_DEVICE_REQUEST);
+        return;
+    }
+
+    // Readers built with fewer counters pass smaller buffers and receive the counters that fit
+    PVOID buffer = nullptr;
+    auto status = WdfRequestRetrieveOutputBuffer(Request, offsetof(CALLOUT_STATISTICS, counters), &buffer, nullptr);
+    if (!NT_SUCCESS(status))
+    {
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    CALLOUT_STATISTICS statistics{};
+    StatisticsQuery(&statistics);
+
+    auto length = CalloutStatisticsCopy(&statistics, buffer, OutputBufferLength);
+
+    WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, length);
+}
@@ -2,6 +2,9 @@
 
 EXTERN_C_START
 
+#define CALLOUT_DEVICE_NAME L"\\Device\\ProtonVPNCallout"
+#define CALLOUT_SYMBOLIC_LINK_NAME L"\\DosDevices\\ProtonVPNCallout"
+
 //
 // The device context performs the same job as
 // a WDM device extension in the driver frameworks
@@ -27,6 +30,11 @@ CreateDevice(
     _In_ WDFDEVICE* Device
 );
 
+//
+// Handle IOCTL_CALLOUT_GET_STATISTICS
+//
+EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL EvtIoDeviceControl;
+
 //
 // Delete the device
 //
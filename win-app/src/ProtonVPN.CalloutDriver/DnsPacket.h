@@ -0,0 +1,293 @@
+/*++
+
+Module Name:
+
+    DnsPacket.h
+
+Abstract:
+
+    Parsing of outbound IPv4 and IPv6 DNS requests and building of SERVFAIL replies to them.
+    Works on raw packet bytes without kernel dependencies, so it can be checked in user mode.
+
+    Packets start with the IP header, multi-byte fields are in network byte order.
+    Requests can be recognized from the first DNS_PACKET_CLASSIFY_SIZE bytes of a packet,
+    so callers do not need to copy whole packets to classify them.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Checksum.h"
+
+#define DNS_PACKET_PORT 53
+#define DNS_PACKET_IPV4_HEADER_SIZE 20
+#define DNS_PACKET_IPV6_HEADER_SIZE 40
+#define DNS_PACKET_UDP_HEADER_SIZE 8
+#define DNS_PACKET_DNS_HEADER_SIZE 12
+#define DNS_PACKET_PROTOCOL_UDP 17
+#define DNS_PACKET_IPV6_HOP_BY_HOP 0
+#define DNS_PACKET_IPV6_ROUTING 43
+#define DNS_PACKET_IPV6_FRAGMENT 44
+#define DNS_PACKET_IPV6_AUTHENTICATION 51
+#define DNS_PACKET_IPV6_DESTINATION_OPTIONS 60
+#define DNS_PACKET_IPV6_MAX_EXTENSION_HEADERS 8
+#define DNS_PACKET_REPLY_TTL 64
+#define DNS_PACKET_SERVFAIL_FLAGS 0x8002
+
+//
+// Bytes holding the IP, UDP and DNS headers of a request, unless IPv6 extension headers
+// push the UDP header beyond them.
+//
+#define DNS_PACKET_CLASSIFY_SIZE 128
+
+//
+// Layout of a DNS request, the IP header length includes IPv6 extension headers.
+//
+typedef struct DNS_REQUEST
+{
+	uint32_t ipHeaderLength;
+	uint32_t payloadLength;
+} DNS_REQUEST;
+
+inline uint16_t DnsPacketReadUint16(const uint8_t* data)
+{
+	return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+inline void DnsPacketWriteUint16(uint8_t* data, uint16_t value)
+{
+	data[0] = static_cast<uint8_t>(value >> 8);
+	data[1] = static_cast<uint8_t>(value);
+}
+
+//
+// Checks the UDP header following the IP headers and fills in the request layout.
+// The packet holds the first available bytes of a packet of the given length.
+//
+inline bool DnsPacketParseUdpRequest(
+	const uint8_t* packet,
+	uint32_t available,
+	uint32_t length,
+	uint32_t ipHeaderLength,
+	DNS_REQUEST* request)
+{
+	if (length < ipHeaderLength + DNS_PACKET_UDP_HEADER_SIZE + DNS_PACKET_DNS_HEADER_SIZE ||
+		available < ipHeaderLength + DNS_PACKET_UDP_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	if (DnsPacketReadUint16(packet + ipHeaderLength + 2) != DNS_PACKET_PORT)
+	{
+		return false;
+	}
+
+	request->ipHeaderLength = ipHeaderLength;
+	request->payloadLength = length - ipHeaderLength - DNS_PACKET_UDP_HEADER_SIZE;
+
+	return true;
+}
+
+//
+// Returns true if the packet is a complete IPv4 UDP datagram to the DNS port
+// carrying at least a DNS header, and fills in the request layout.
+// Only the first available bytes of the packet of the given length are read.
+//
+inline bool DnsPacketParseRequestHeadersV4(const uint8_t* packet, uint32_t available, uint32_t length, DNS_REQUEST* request)
+{
+	if (length < DNS_PACKET_IPV4_HEADER_SIZE || available < DNS_PACKET_IPV4_HEADER_SIZE || available > length)
+	{
+		return false;
+	}
+
+	uint32_t ipHeaderLength = (packet[0] & 0x0F) * 4u;
+	if ((packet[0] >> 4) != 4 ||
+		DnsPacketReadUint16(packet + 2) != length ||
+		ipHeaderLength < DNS_PACKET_IPV4_HEADER_SIZE ||
+		ipHeaderLength > length ||
+		packet[9] != DNS_PACKET_PROTOCOL_UDP)
+	{
+		return false;
+	}
+
+	return DnsPacketParseUdpRequest(packet, available, length, ipHeaderLength, request);
+}
+
+inline bool DnsPacketParseRequestV4(const uint8_t* packet, uint32_t length, DNS_REQUEST* request)
+{
+	return DnsPacketParseRequestHeadersV4(packet, length, length, request);
+}
+
+//
+// Returns true if the packet is a complete, unfragmented IPv6 UDP datagram to the DNS port
+// carrying at least a DNS header, and fills in the request layout. Hop-by-hop, routing,
+// destination options and authentication extension headers are skipped.
+// Only the first available bytes of the packet of the given length are read.
+//
+inline bool DnsPacketParseRequestHeadersV6(const uint8_t* packet, uint32_t available, uint32_t length, DNS_REQUEST* request)
+{
+	if (length < DNS_PACKET_IPV6_HEADER_SIZE ||
+		available < DNS_PACKET_IPV6_HEADER_SIZE ||
+		available > length ||
+		(packet[0] >> 4) != 6 ||
+		static_cast<uint32_t>(DnsPacketReadUint16(packet + 4) + DNS_PACKET_IPV6_HEADER_SIZE) != length)
+	{
+		return false;
+	}
+
+	uint8_t nextHeader = packet[6];
+	uint32_t offset = DNS_PACKET_IPV6_HEADER_SIZE;
+
+	for (int i = 0; i < DNS_PACKET_IPV6_MAX_EXTENSION_HEADERS && nextHeader != DNS_PACKET_PROTOCOL_UDP; i++)
+	{
+		if (offset + 8 > available)
+		{
+			return false;
+		}
+
+		uint32_t headerLength;
+		switch (nextHeader)
+		{
+		case DNS_PACKET_IPV6_HOP_BY_HOP:
+		case DNS_PACKET_IPV6_ROUTING:
+		case DNS_PACKET_IPV6_DESTINATION_OPTIONS:
+			headerLength = (packet[offset + 1] + 1u) * 8;
+			break;
+		case DNS_PACKET_IPV6_AUTHENTICATION:
+			headerLength = (packet[offset + 1] + 2u) * 4;
+			break;
+		case DNS_PACKET_IPV6_FRAGMENT:
+			if ((DnsPacketReadUint16(packet + offset + 2) & 0xFFF9) != 0)
+			{
+				return false;
+			}
+			headerLength = 8;
+			break;
+		default:
+			return false;
+		}
+
+		nextHeader = packet[offset];
+		offset += headerLength;
+	}
+
+	if (nextHeader != DNS_PACKET_PROTOCOL_UDP)
+	{
+		return false;
+	}
+
+	return DnsPacketParseUdpRequest(packet, available, length, offset, request);
+}
+
+inline bool DnsPacketParseRequestV6(const uint8_t* packet, uint32_t length, DNS_REQUEST* request)
+{
+	return DnsPacketParseRequestHeadersV6(packet, length, length, request);
+}
+
+//
+// Writes a SERVFAIL reply to the request into the reply buffer and returns its size,
+// or 0 if the buffer is too small. The reply carries the request payload with the
+// response flags set, addresses and ports swapped, no IP options and a UDP checksum.
+// The reply buffer may be the request buffer itself.
+//
+inline uint32_t DnsPacketBuildServerFailV4(
+	const uint8_t* packet,
+	const DNS_REQUEST* request,
+	uint8_t* reply,
+	uint32_t capacity)
+{
+	const uint32_t headersLength = DNS_PACKET_IPV4_HEADER_SIZE + DNS_PACKET_UDP_HEADER_SIZE;
+	const uint32_t replyLength = headersLength + request->payloadLength;
+	if (replyLength > capacity || replyLength > 0xFFFF)
+	{
+		return 0;
+	}
+
+	uint8_t source[4];
+	uint8_t destination[4];
+	uint8_t ports[4];
+	const uint8_t* udp = packet + request->ipHeaderLength;
+
+	memcpy(source, packet + 12, sizeof(source));
+	memcpy(destination, packet + 16, sizeof(destination));
+	memcpy(ports, udp, sizeof(ports));
+
+	memmove(reply + headersLength, udp + DNS_PACKET_UDP_HEADER_SIZE, request->payloadLength);
+	memset(reply, 0, headersLength);
+
+	reply[0] = 0x45;
+	DnsPacketWriteUint16(reply + 2, static_cast<uint16_t>(replyLength));
+	reply[8] = DNS_PACKET_REPLY_TTL;
+	reply[9] = DNS_PACKET_PROTOCOL_UDP;
+	memcpy(reply + 12, destination, sizeof(destination));
+	memcpy(reply + 16, source, sizeof(source));
+	DnsPacketWriteUint16(reply + 10, ChecksumCompute(reply, DNS_PACKET_IPV4_HEADER_SIZE));
+
+	uint8_t* replyUdp = reply + DNS_PACKET_IPV4_HEADER_SIZE;
+	memcpy(replyUdp, ports + 2, 2);
+	memcpy(replyUdp + 2, ports, 2);
+	DnsPacketWriteUint16(replyUdp + 4, static_cast<uint16_t>(DNS_PACKET_UDP_HEADER_SIZE + request->payloadLength));
+
+	DnsPacketWriteUint16(replyUdp + DNS_PACKET_UDP_HEADER_SIZE + 2, DNS_PACKET_SERVFAIL_FLAGS);
+	DnsPacketWriteUint16(replyUdp + 6, ChecksumUdp(reply + 12, reply + 16, 4,
+		replyUdp, DNS_PACKET_UDP_HEADER_SIZE + request->payloadLength));
+
+	return replyLength;
+}
+
+//
+// Writes a SERVFAIL reply to the IPv6 request into the reply buffer and returns its size,
+// or 0 if the buffer is too small. The reply carries the request payload with the
+// response flags set, addresses and ports swapped, no extension headers and a UDP checksum.
+// The reply buffer may be the request buffer itself.
+//
+inline uint32_t DnsPacketBuildServerFailV6(
+	const uint8_t* packet,
+	const DNS_REQUEST* request,
+	uint8_t* reply,
+	uint32_t capacity)
+{
+	const uint32_t headersLength = DNS_PACKET_IPV6_HEADER_SIZE + DNS_PACKET_UDP_HEADER_SIZE;
+	const uint32_t replyLength = headersLength + request->payloadLength;
+	const uint32_t udpLength = DNS_PACKET_UDP_HEADER_SIZE + request->payloadLength;
+	if (replyLength > capacity || udpLength > 0xFFFF)
+	{
+		return 0;
+	}
+
+	uint8_t source[16];
+	uint8_t destination[16];
+	uint8_t ports[4];
+	const uint8_t* udp = packet + request->ipHeaderLength;
+
+	memcpy(source, packet + 8, sizeof(source));
+	memcpy(destination, packet + 24, sizeof(destination));
+	memcpy(ports, udp, sizeof(ports));
+
+	memmove(reply + headersLength, udp + DNS_PACKET_UDP_HEADER_SIZE, request->payloadLength);
+	memset(reply, 0, headersLength);
+
+	reply[0] = 0x60;
+	DnsPacketWriteUint16(reply + 4, static_cast<uint16_t>(udpLength));
+	reply[6] = DNS_PACKET_PROTOCOL_UDP;
+	reply[7] = DNS_PACKET_REPLY_TTL;
+	memcpy(reply + 8, destination, sizeof(destination));
+	memcpy(reply + 24, source, sizeof(source));
+
+	uint8_t* replyUdp = reply + DNS_PACKET_IPV6_HEADER_SIZE;
+	memcpy(replyUdp, ports + 2, 2);
+	memcpy(replyUdp + 2, ports, 2);
+	DnsPacketWriteUint16(replyUdp + 4, static_cast<uint16_t>(udpLength));
+
+	DnsPacketWriteUint16(replyUdp + DNS_PACKET_UDP_HEADER_SIZE + 2, DNS_PACKET_SERVFAIL_FLAGS);
+	DnsPacketWriteUint16(replyUdp + 6, ChecksumUdp(reply + 8, reply + 24, 16, replyUdp, udpLength));
+
+	return replyLength;
+}
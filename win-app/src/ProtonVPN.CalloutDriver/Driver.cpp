@@ -7,6 +7,9 @@
 
 #include "Device.h"
 #include "Callout.h"
+#include "PacketPool.h"
+#include "Statistics.h"
+#include "RedirectCache.h"
 #include "Public.h"
 
 #ifdef ALLOC_PRAGMA
@@ -16,6 +19,7 @@
 
 WDFDEVICE Device = NULL;
 HANDLE injectHandle = nullptr;
+HANDLE injectHandleV6 = nullptr;
 NDIS_HANDLE nbl_pool_handle = nullptr;
 
 NTSTATUS
@@ -59,6 +63,20 @@ DriverEntry(
         return status;
     }
 
+    status = StatisticsInitialize();
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
+    status = RedirectCacheInitialize();
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
     status = CreateDevice(driver, &Device);
 
     if (!NT_SUCCESS(status))
@@ -84,6 +102,20 @@ DriverEntry(
         return status;
     }
 
+    status = RegisterCallout(deviceObject, CONNECT_REDIRECT_V6_CALLOUT_KEY, RedirectConnectionV6);
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
+    status = RegisterCallout(deviceObject, REDIRECT_UDP_V6_CALLOUT_KEY, RedirectUDPFlowV6);
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
     status = FwpsInjectionHandleCreate(AF_INET, FWPS_INJECTION_TYPE_NETWORK, &injectHandle);
     if (!NT_SUCCESS(status))
     {
@@ -98,6 +130,20 @@ DriverEntry(
         return status;
     }
 
+    status = FwpsInjectionHandleCreate(AF_INET6, FWPS_INJECTION_TYPE_NETWORK, &injectHandleV6);
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
+    status = RegisterCallout(deviceObject, BLOCK_DNS_V6_CALLOUT_KEY, BlockDnsV6BySendingServerFailPacket);
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
     NET_BUFFER_LIST_POOL_PARAMETERS nbl_pool_params;
 
     RtlZeroMemory(&nbl_pool_params, sizeof(nbl_pool_params));
@@ -114,6 +160,13 @@ DriverEntry(
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
+    status = PacketPoolInitialize();
+    if (!NT_SUCCESS(status))
+    {
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "%!FUNC! Exit");
 
     return status;
@@ -131,18 +184,30 @@ DriverUnload(
 
     UnregisterCallout(CONNECT_REDIRECT_CALLOUT_KEY);
     UnregisterCallout(REDIRECT_UDP_CALLOUT_KEY);
+    UnregisterCallout(CONNECT_REDIRECT_V6_CALLOUT_KEY);
+    UnregisterCallout(REDIRECT_UDP_V6_CALLOUT_KEY);
     UnregisterCallout(BLOCK_DNS_CALLOUT_KEY);
+    UnregisterCallout(BLOCK_DNS_V6_CALLOUT_KEY);
 
     if (injectHandle != nullptr)
     {
         FwpsInjectionHandleDestroy0(injectHandle);
     }
 
+    if (injectHandleV6 != nullptr)
+    {
+        FwpsInjectionHandleDestroy0(injectHandleV6);
+    }
+
     if (nbl_pool_handle != nullptr)
     {
         NdisFreeNetBufferListPool(nbl_pool_handle);
     }
 
+    PacketPoolDestroy();
+    RedirectCacheDestroy();
+    StatisticsDestroy();
+
     // Stop WPP Tracing
     WPP_CLEANUP(WdfDriverWdmGetDriverObject(Driver));
 
@@ -0,0 +1,129 @@
+#include <fwpsk.h>
+
+#include "Trace.h"
+#include "Public.h"
+#include "PacketPool.h"
+#include "Statistics.h"
+#include "PacketPool.tmh"
+
+#define PACKET_POOL_ENTRIES_PER_PROCESSOR 16
+#define PACKET_POOL_NO_OWNER MAXULONG
+
+static PSLIST_HEADER freeLists = nullptr;
+static ULONG processorCount = 0;
+
+PPACKET_POOL_ENTRY AllocatePacketPoolEntry(ULONG owner)
+{
+	auto entry = static_cast<PPACKET_POOL_ENTRY>(
+		ExAllocatePoolWithTag(NonPagedPoolNx, sizeof(PACKET_POOL_ENTRY), ProtonTAG));
+	if (entry == nullptr)
+	{
+		return nullptr;
+	}
+
+	entry->owner = owner;
+	entry->mdl = IoAllocateMdl(entry->data, sizeof(entry->data), FALSE, FALSE, nullptr);
+	if (entry->mdl == nullptr)
+	{
+		ExFreePoolWithTag(entry, ProtonTAG);
+		return nullptr;
+	}
+
+	MmBuildMdlForNonPagedPool(entry->mdl);
+
+	return entry;
+}
+
+void FreePacketPoolEntry(PPACKET_POOL_ENTRY entry)
+{
+	IoFreeMdl(entry->mdl);
+	ExFreePoolWithTag(entry, ProtonTAG);
+}
+
+NTSTATUS PacketPoolInitialize()
+{
+	processorCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+	freeLists = static_cast<PSLIST_HEADER>(
+		ExAllocatePoolWithTag(NonPagedPoolNx, sizeof(SLIST_HEADER) * processorCount, ProtonTAG));
+	if (freeLists == nullptr)
+	{
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CALLOUT, "%!FUNC! Failed to allocate free lists");
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	for (ULONG processor = 0; processor < processorCount; processor++)
+	{
+		InitializeSListHead(&freeLists[processor]);
+	}
+
+	for (ULONG processor = 0; processor < processorCount; processor++)
+	{
+		for (ULONG i = 0; i < PACKET_POOL_ENTRIES_PER_PROCESSOR; i++)
+		{
+			auto entry = AllocatePacketPoolEntry(processor);
+			if (entry == nullptr)
+			{
+				TraceEvents(TRACE_LEVEL_ERROR, TRACE_CALLOUT, "%!FUNC! Failed to allocate entry");
+				PacketPoolDestroy();
+				return STATUS_INSUFFICIENT_RESOURCES;
+			}
+
+			InterlockedPushEntrySList(&freeLists[processor], &entry->link);
+		}
+	}
+
+	return STATUS_SUCCESS;
+}
+
+void PacketPoolDestroy()
+{
+	if (freeLists == nullptr)
+	{
+		return;
+	}
+
+	for (ULONG processor = 0; processor < processorCount; processor++)
+	{
+		PSLIST_ENTRY link;
+		while ((link = InterlockedPopEntrySList(&freeLists[processor])) != nullptr)
+		{
+			FreePacketPoolEntry(CONTAINING_RECORD(link, PACKET_POOL_ENTRY, link));
+		}
+	}
+
+	ExFreePoolWithTag(freeLists, ProtonTAG);
+	freeLists = nullptr;
+	processorCount = 0;
+}
+
+PPACKET_POOL_ENTRY PacketPoolAcquire()
+{
+	if (freeLists != nullptr)
+	{
+		auto processor = KeGetCurrentProcessorNumberEx(nullptr);
+		if (processor < processorCount)
+		{
+			auto link = InterlockedPopEntrySList(&freeLists[processor]);
+			if (link != nullptr)
+			{
+				return CONTAINING_RECORD(link, PACKET_POOL_ENTRY, link);
+			}
+		}
+	}
+
+	auto entry = AllocatePacketPoolEntry(PACKET_POOL_NO_OWNER);
+	CountEvent(entry != nullptr ? CalloutCounterPoolEntryAllocated : CalloutCounterAllocationFailed);
+
+	return entry;
+}
+
+void PacketPoolRelease(_In_ PPACKET_POOL_ENTRY entry)
+{
+	if (entry->owner == PACKET_POOL_NO_OWNER || freeLists == nullptr)
+	{
+		FreePacketPoolEntry(entry);
+		return;
+	}
+
+	InterlockedPushEntrySList(&freeLists[entry->owner], &entry->link);
+}
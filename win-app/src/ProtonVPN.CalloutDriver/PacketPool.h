@@ -0,0 +1,27 @@
+#pragma once
+
+#include <fwpsk.h>
+
+#include "Callout.h"
+
+//
+// Preallocated packet buffer with an MDL describing it.
+// Entries are kept in per-processor free lists, so acquiring one at DISPATCH_LEVEL
+// does not go to the pool allocator. When the list of the current processor is empty
+// a temporary entry is allocated and freed again on release.
+//
+typedef struct PACKET_POOL_ENTRY_
+{
+	SLIST_ENTRY link;
+	PMDL mdl;
+	ULONG owner;
+	UCHAR data[MAX_PACKET_SIZE];
+} PACKET_POOL_ENTRY, * PPACKET_POOL_ENTRY;
+
+NTSTATUS PacketPoolInitialize();
+
+void PacketPoolDestroy();
+
+PPACKET_POOL_ENTRY PacketPoolAcquire();
+
+void PacketPoolRelease(_In_ PPACKET_POOL_ENTRY entry);
@@ -0,0 +1,168 @@
+/*++
+
+Module Name:
+
+    PrefixTable.h
+
+Abstract:
+
+    Flat longest prefix match table shared by the driver and user applications.
+    The table is built in user mode and looked up in place, without copies or allocations.
+
+    Layout (little endian):
+        PREFIX_TABLE header
+        PREFIX_TABLE_NODE nodes[nodeCount]
+        uint8_t leaves[leafCount]
+
+    Every node consumes 6 bits of the address. A set bit in childMask means the slot continues
+    in a child node, other slots are leaves. Children of a node are stored contiguously starting
+    at childBase, consecutive leaves with the same value are stored once starting at leafBase
+    and their first slot is marked in leafMask.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PREFIX_TABLE_MAGIC 0x544D504Cu // 'LPMT'
+#define PREFIX_TABLE_VERSION 1
+#define PREFIX_TABLE_STRIDE 6
+
+typedef struct PREFIX_TABLE
+{
+	uint32_t magic;
+	uint16_t version;
+	uint8_t addressLength;
+	uint8_t reserved;
+	uint32_t nodeCount;
+	uint32_t leafCount;
+} PREFIX_TABLE;
+
+typedef struct PREFIX_TABLE_NODE
+{
+	uint64_t childMask;
+	uint64_t leafMask;
+	uint32_t leafBase;
+	uint32_t childBase;
+} PREFIX_TABLE_NODE;
+
+static_assert(sizeof(PREFIX_TABLE) == 16, "Unexpected PREFIX_TABLE size");
+static_assert(sizeof(PREFIX_TABLE_NODE) == 24, "Unexpected PREFIX_TABLE_NODE size");
+
+inline uint32_t PrefixTablePopCount(uint64_t value)
+{
+	value = value - ((value >> 1) & 0x5555555555555555ull);
+	value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+	value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+
+	return static_cast<uint32_t>((value * 0x0101010101010101ull) >> 56);
+}
+
+// Returns the 6 address bits starting at the bit offset, bits past the address end are zero.
+inline uint32_t PrefixTableSlot(const uint8_t* address, uint32_t addressLength, uint32_t offset)
+{
+	uint32_t byte = offset / 8;
+	uint32_t high = byte < addressLength ? address[byte] : 0;
+	uint32_t low = byte + 1 < addressLength ? address[byte + 1] : 0;
+
+	return (((high << 8) | low) >> (16 - PREFIX_TABLE_STRIDE - offset % 8)) & 0x3F;
+}
+
+inline const PREFIX_TABLE_NODE* PrefixTableNodes(const PREFIX_TABLE* table)
+{
+	return reinterpret_cast<const PREFIX_TABLE_NODE*>(table + 1);
+}
+
+inline const uint8_t* PrefixTableLeaves(const PREFIX_TABLE* table)
+{
+	return reinterpret_cast<const uint8_t*>(PrefixTableNodes(table) + table->nodeCount);
+}
+
+//
+// Validates the buffer and returns the table it contains, or nullptr if the buffer is malformed.
+// Lookups on a returned table never read outside of the buffer.
+//
+inline const PREFIX_TABLE* PrefixTableFromBuffer(const void* buffer, size_t size)
+{
+	if (buffer == nullptr || size < sizeof(PREFIX_TABLE) || (reinterpret_cast<uintptr_t>(buffer) & 7) != 0)
+	{
+		return nullptr;
+	}
+
+	const PREFIX_TABLE* table = static_cast<const PREFIX_TABLE*>(buffer);
+	if (table->magic != PREFIX_TABLE_MAGIC ||
+		table->version != PREFIX_TABLE_VERSION ||
+		(table->addressLength != 4 && table->addressLength != 16) ||
+		table->nodeCount == 0)
+	{
+		return nullptr;
+	}
+
+	uint64_t required = sizeof(PREFIX_TABLE) +
+		static_cast<uint64_t>(table->nodeCount) * sizeof(PREFIX_TABLE_NODE) +
+		table->leafCount;
+	if (required > size)
+	{
+		return nullptr;
+	}
+
+	const PREFIX_TABLE_NODE* nodes = PrefixTableNodes(table);
+	for (uint32_t i = 0; i < table->nodeCount; i++)
+	{
+		const PREFIX_TABLE_NODE& node = nodes[i];
+		uint64_t leafSlots = ~node.childMask;
+
+		if ((node.leafMask & node.childMask) != 0)
+		{
+			return nullptr;
+		}
+
+		if (node.childMask != 0 &&
+			(node.childBase <= i ||
+			 static_cast<uint64_t>(node.childBase) + PrefixTablePopCount(node.childMask) > table->nodeCount))
+		{
+			return nullptr;
+		}
+
+		if (leafSlots != 0 &&
+			((node.leafMask & (leafSlots & (0 - leafSlots))) == 0 ||
+			 static_cast<uint64_t>(node.leafBase) + PrefixTablePopCount(node.leafMask) > table->leafCount))
+		{
+			return nullptr;
+		}
+	}
+
+	return table;
+}
+
+//
+// Returns the value of the longest prefix containing the address, or 0 if there is none.
+// The address is in network byte order and has table->addressLength bytes.
+//
+inline uint8_t PrefixTableLookup(const PREFIX_TABLE* table, const uint8_t* address)
+{
+	const PREFIX_TABLE_NODE* nodes = PrefixTableNodes(table);
+	uint32_t bits = table->addressLength * 8u;
+	uint32_t index = 0;
+
+	for (uint32_t offset = 0; offset < bits; offset += PREFIX_TABLE_STRIDE)
+	{
+		const PREFIX_TABLE_NODE& node = nodes[index];
+		uint32_t slot = PrefixTableSlot(address, table->addressLength, offset);
+		uint64_t mask = (2ull << slot) - 1;
+
+		if ((node.childMask & (1ull << slot)) == 0)
+		{
+			return PrefixTableLeaves(table)[node.leafBase + PrefixTablePopCount(node.leafMask & mask) - 1];
+		}
+
+		index = node.childBase + PrefixTablePopCount(node.childMask & mask) - 1;
+	}
+
+	return 0;
+}
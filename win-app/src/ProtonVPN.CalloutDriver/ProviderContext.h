@@ -0,0 +1,159 @@
+/*++
+
+Module Name:
+
+    ProviderContext.h
+
+Abstract:
+
+    Versioned provider context format shared by the driver and user applications.
+    The context is written in user mode and read in place by the callouts.
+
+    Layout (little endian):
+        PROVIDER_CONTEXT header
+        sections, each a PROVIDER_CONTEXT_SECTION followed by its value,
+        padded to a multiple of 8 bytes
+
+    Readers skip section types they do not know, so new sections can be added
+    without changing the version. The version changes only when existing layouts do.
+
+    The buffer may have any alignment, headers are read with memcpy. Section values are
+    aligned to PROVIDER_CONTEXT_ALIGNMENT relative to the start of the buffer, so they are
+    only aligned in memory when the buffer is.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PROVIDER_CONTEXT_MAGIC 0x58435650u // 'PVCX'
+#define PROVIDER_CONTEXT_VERSION 1
+#define PROVIDER_CONTEXT_ALIGNMENT 8
+
+//
+// Section types.
+//
+#define PROVIDER_CONTEXT_BIND_ADDRESS_V4 1 // 4 bytes, network byte order
+#define PROVIDER_CONTEXT_BIND_ADDRESS_V6 2 // 16 bytes, network byte order
+#define PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V4 3 // PREFIX_TABLE, see PrefixTable.h
+#define PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V6 4 // PREFIX_TABLE, see PrefixTable.h
+#define PROVIDER_CONTEXT_DNS_POLICY 5 // PROVIDER_CONTEXT_DNS_POLICY_DATA
+
+//
+// Reply to blocked DNS requests with a SERVFAIL response instead of dropping them silently.
+//
+#define PROVIDER_CONTEXT_DNS_SEND_SERVFAIL 0x1u
+
+typedef struct PROVIDER_CONTEXT
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t size;
+	uint32_t sectionCount;
+} PROVIDER_CONTEXT;
+
+typedef struct PROVIDER_CONTEXT_SECTION
+{
+	uint16_t type;
+	uint16_t reserved;
+	uint32_t length;
+} PROVIDER_CONTEXT_SECTION;
+
+typedef struct PROVIDER_CONTEXT_DNS_POLICY_DATA
+{
+	uint32_t flags;
+} PROVIDER_CONTEXT_DNS_POLICY_DATA;
+
+static_assert(sizeof(PROVIDER_CONTEXT) == 16, "Unexpected PROVIDER_CONTEXT size");
+static_assert(sizeof(PROVIDER_CONTEXT_SECTION) == 8, "Unexpected PROVIDER_CONTEXT_SECTION size");
+
+inline uint64_t ProviderContextAlign(uint64_t length)
+{
+	return (length + PROVIDER_CONTEXT_ALIGNMENT - 1) & ~static_cast<uint64_t>(PROVIDER_CONTEXT_ALIGNMENT - 1);
+}
+
+inline PROVIDER_CONTEXT ProviderContextReadHeader(const void* buffer)
+{
+	PROVIDER_CONTEXT header;
+	memcpy(&header, buffer, sizeof(header));
+
+	return header;
+}
+
+inline PROVIDER_CONTEXT_SECTION ProviderContextReadSection(const void* buffer, uint64_t offset)
+{
+	PROVIDER_CONTEXT_SECTION section;
+	memcpy(&section, static_cast<const uint8_t*>(buffer) + offset, sizeof(section));
+
+	return section;
+}
+
+//
+// Validates the buffer and returns the context it contains, or nullptr if the buffer is malformed.
+// Every section of a returned context lies within the buffer.
+//
+inline const PROVIDER_CONTEXT* ProviderContextFromBuffer(const void* buffer, size_t size)
+{
+	if (buffer == nullptr || size < sizeof(PROVIDER_CONTEXT))
+	{
+		return nullptr;
+	}
+
+	const PROVIDER_CONTEXT header = ProviderContextReadHeader(buffer);
+	if (header.magic != PROVIDER_CONTEXT_MAGIC ||
+		header.version != PROVIDER_CONTEXT_VERSION ||
+		header.size < sizeof(PROVIDER_CONTEXT) ||
+		header.size > size)
+	{
+		return nullptr;
+	}
+
+	uint64_t offset = sizeof(PROVIDER_CONTEXT);
+	for (uint32_t i = 0; i < header.sectionCount; i++)
+	{
+		if (offset + sizeof(PROVIDER_CONTEXT_SECTION) > header.size)
+		{
+			return nullptr;
+		}
+
+		offset += sizeof(PROVIDER_CONTEXT_SECTION) + ProviderContextAlign(ProviderContextReadSection(buffer, offset).length);
+		if (offset > header.size)
+		{
+			return nullptr;
+		}
+	}
+
+	return static_cast<const PROVIDER_CONTEXT*>(buffer);
+}
+
+//
+// Returns the value of the first section of the given type, or nullptr if there is none.
+// The context must come from ProviderContextFromBuffer.
+//
+inline const void* ProviderContextFindSection(const PROVIDER_CONTEXT* context, uint16_t type, uint32_t* length)
+{
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(context);
+	const uint32_t sectionCount = ProviderContextReadHeader(context).sectionCount;
+	uint32_t offset = sizeof(PROVIDER_CONTEXT);
+
+	for (uint32_t i = 0; i < sectionCount; i++)
+	{
+		const PROVIDER_CONTEXT_SECTION section = ProviderContextReadSection(data, offset);
+		if (section.type == type)
+		{
+			*length = section.length;
+			return data + offset + sizeof(PROVIDER_CONTEXT_SECTION);
+		}
+
+		offset += sizeof(PROVIDER_CONTEXT_SECTION) + static_cast<uint32_t>(ProviderContextAlign(section.length));
+	}
+
+	return nullptr;
+}
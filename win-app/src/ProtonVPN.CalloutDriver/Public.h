@@ -33,6 +33,18 @@ DEFINE_GUID(REDIRECT_UDP_CALLOUT_KEY,
 DEFINE_GUID(BLOCK_DNS_CALLOUT_KEY,
     0x10636af3, 0x50d6, 0x4f53, 0xac, 0xb7, 0xd5, 0xaf, 0x33, 0x21, 0x7f, 0xcb);
 
+//{10636af3-50d6-4f53-acb7-d5af33217fcc}
+DEFINE_GUID(CONNECT_REDIRECT_V6_CALLOUT_KEY,
+    0x10636af3, 0x50d6, 0x4f53, 0xac, 0xb7, 0xd5, 0xaf, 0x33, 0x21, 0x7f, 0xcc);
+
+//{10636af3-50d6-4f53-acb7-d5af33217fcd}
+DEFINE_GUID(REDIRECT_UDP_V6_CALLOUT_KEY,
+    0x10636af3, 0x50d6, 0x4f53, 0xac, 0xb7, 0xd5, 0xaf, 0x33, 0x21, 0x7f, 0xcd);
+
+//{10636af3-50d6-4f53-acb7-d5af33217fce}
+DEFINE_GUID(BLOCK_DNS_V6_CALLOUT_KEY,
+    0x10636af3, 0x50d6, 0x4f53, 0xac, 0xb7, 0xd5, 0xaf, 0x33, 0x21, 0x7f, 0xce);
+
 #define ProtonTAG 'pvpn'
 
 //
@@ -45,4 +57,5 @@ typedef struct CONNECT_REDIRECT_DATA
 } CONNECT_REDIRECT_DATA;
 
 extern HANDLE injectHandle;
+extern HANDLE injectHandleV6;
 extern NDIS_HANDLE nbl_pool_handle;
\ No newline at end of file
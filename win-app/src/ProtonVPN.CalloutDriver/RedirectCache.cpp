@@ -0,0 +1,64 @@
+#include <ntddk.h>
+
+#include "Trace.h"
+#include "Public.h"
+#include "DecisionTable.h"
+#include "RedirectCache.h"
+#include "RedirectCache.tmh"
+
+// Every app with split tunnel rules has a filter on each redirect layer, well below this.
+const UINT32 REDIRECT_CACHE_CAPACITY = 1024;
+
+static DECISION_TABLE* filterSettings = nullptr;
+
+NTSTATUS RedirectCacheInitialize()
+{
+	auto buffer = ExAllocatePoolWithTag(NonPagedPoolNx, DecisionTableSize(REDIRECT_CACHE_CAPACITY), ProtonTAG);
+	if (buffer == nullptr)
+	{
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "%!FUNC! Failed to allocate the filter table");
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	filterSettings = DecisionTableInitialize(buffer, REDIRECT_CACHE_CAPACITY);
+
+	return STATUS_SUCCESS;
+}
+
+void RedirectCacheDestroy()
+{
+	if (filterSettings != nullptr)
+	{
+		ExFreePoolWithTag(filterSettings, ProtonTAG);
+		filterSettings = nullptr;
+	}
+}
+
+bool RedirectCacheFind(_In_ UINT64 filterId, _Out_ UINT64* settings)
+{
+	*settings = 0;
+
+	return filterSettings != nullptr && DecisionTableLookup(filterSettings, filterId, settings);
+}
+
+void RedirectCacheStore(_In_ UINT64 filterId, _In_ UINT64 settings)
+{
+	if (filterSettings == nullptr)
+	{
+		return;
+	}
+
+	if (!DecisionTableInsert(filterSettings, filterId, settings))
+	{
+		// The filter is still served, its classifies validate the provider context each time.
+		TraceEvents(TRACE_LEVEL_WARNING, TRACE_CALLOUT, "%!FUNC! No room for filter %llu", filterId);
+	}
+}
+
+void RedirectCacheRemove(_In_ UINT64 filterId)
+{
+	if (filterSettings != nullptr)
+	{
+		DecisionTableRemove(filterSettings, filterId);
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <ntddk.h>
+
+//
+// Provider context settings of the redirect filters, checked once when a filter is added.
+// Classifies look the filter up instead of validating its provider context again.
+// Entries are written only from the notify function, which WFP does not call concurrently
+// for the same filter, and live until the filter is deleted.
+//
+NTSTATUS RedirectCacheInitialize();
+
+void RedirectCacheDestroy();
+
+bool RedirectCacheFind(_In_ UINT64 filterId, _Out_ UINT64* settings);
+
+void RedirectCacheStore(_In_ UINT64 filterId, _In_ UINT64 settings);
+
+void RedirectCacheRemove(_In_ UINT64 filterId);
@@ -0,0 +1,137 @@
+/*++
+
+Module Name:
+
+    RedirectPolicy.h
+
+Abstract:
+
+    Address classification and rewrite rules of the split tunnel redirect callouts.
+    Kept free of kernel dependencies so that the rules can be checked in user mode.
+
+    Addresses are in network byte order, 4 bytes for IPv4 and 16 bytes for IPv6.
+
+Environment:
+
+    User and kernel.
+
+--*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "PrefixTable.h"
+
+//
+// Windows socket address layout, see SOCKADDR_IN and SOCKADDR_IN6.
+//
+#define REDIRECT_AF_INET 2
+#define REDIRECT_AF_INET6 23
+#define REDIRECT_SOCKADDR_IN_ADDRESS_OFFSET 4
+#define REDIRECT_SOCKADDR_IN6_ADDRESS_OFFSET 8
+#define REDIRECT_SOCKADDR_IN6_SCOPE_ID_OFFSET 24
+
+//
+// Returns true for addresses that never leave the local network:
+// 127/8, 169.254/16, 10/8, 172.16/12, 192.168/16, 224.0.0/24, 239.255/16 and 255.255.255.255.
+//
+inline bool RedirectIsLocalNetworkV4(const uint8_t* address)
+{
+	return address[0] == 127 ||
+		(address[0] == 169 && address[1] == 254) ||
+		address[0] == 10 ||
+		(address[0] == 172 && (address[1] & 0xF0) == 16) ||
+		(address[0] == 192 && address[1] == 168) ||
+		(address[0] == 224 && address[1] == 0 && address[2] == 0) ||
+		(address[0] == 239 && address[1] == 255) ||
+		(address[0] == 255 && address[1] == 255 && address[2] == 255 && address[3] == 255);
+}
+
+//
+// Returns true for addresses that never leave the local network:
+// ::, ::1, fe80::/10, fc00::/7, multicast scopes up to organization-local
+// and IPv4-mapped addresses of local IPv4 networks.
+//
+inline bool RedirectIsLocalNetworkV6(const uint8_t* address)
+{
+	static const uint8_t mappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+	if (memcmp(address, mappedPrefix, 10) == 0)
+	{
+		if (address[10] == 0 && address[11] == 0 && address[12] == 0 && address[13] == 0 && address[14] == 0)
+		{
+			return address[15] <= 1;
+		}
+
+		if (memcmp(address + 10, mappedPrefix + 10, 2) == 0)
+		{
+			return RedirectIsLocalNetworkV4(address + 12);
+		}
+	}
+
+	if (address[0] == 0xFE && (address[1] & 0xC0) == 0x80)
+	{
+		return true;
+	}
+
+	if ((address[0] & 0xFE) == 0xFC)
+	{
+		return true;
+	}
+
+	if (address[0] == 0xFF)
+	{
+		uint8_t scope = address[1] & 0x0F;
+		return scope >= 1 && scope <= 8;
+	}
+
+	return false;
+}
+
+//
+// Returns true if a connection to the remote address should be redirected,
+// that is unless it targets the local network or a prefix of the excluded table.
+// The table is optional, its address length must match.
+//
+inline bool RedirectShouldRedirectConnection(const PREFIX_TABLE* excluded, const uint8_t* remoteAddress, uint32_t addressLength)
+{
+	bool local = addressLength == 4 ?
+		RedirectIsLocalNetworkV4(remoteAddress) :
+		RedirectIsLocalNetworkV6(remoteAddress);
+	if (local)
+	{
+		return false;
+	}
+
+	return excluded == nullptr ||
+		excluded->addressLength != addressLength ||
+		PrefixTableLookup(excluded, remoteAddress) == 0;
+}
+
+//
+// Replaces the address of a socket address, keeping its port.
+// IPv6 scope id is cleared as it belongs to the replaced address.
+// Returns false if the family does not match the address length.
+//
+inline bool RedirectSetSocketAddress(uint8_t* socketAddress, const uint8_t* address, uint32_t addressLength)
+{
+	uint16_t family = 0;
+	memcpy(&family, socketAddress, sizeof(family));
+
+	if (family == REDIRECT_AF_INET && addressLength == 4)
+	{
+		memcpy(socketAddress + REDIRECT_SOCKADDR_IN_ADDRESS_OFFSET, address, 4);
+		return true;
+	}
+
+	if (family == REDIRECT_AF_INET6 && addressLength == 16)
+	{
+		memset(socketAddress + REDIRECT_SOCKADDR_IN6_SCOPE_ID_OFFSET, 0, sizeof(uint32_t));
+		memcpy(socketAddress + REDIRECT_SOCKADDR_IN6_ADDRESS_OFFSET, address, 16);
+		return true;
+	}
+
+	return false;
+}
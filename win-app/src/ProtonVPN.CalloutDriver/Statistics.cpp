@@ -0,0 +1,65 @@
+#include <ntddk.h>
+
+#include "Trace.h"
+#include "Public.h"
+#include "Statistics.h"
+#include "Statistics.tmh"
+
+static PVOID counterBlocks = nullptr;
+static ULONG processorCount = 0;
+
+NTSTATUS StatisticsInitialize()
+{
+	processorCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+	auto size = CalloutCounterBlocksSize(processorCount);
+	counterBlocks = ExAllocatePoolWithTag(NonPagedPoolNx, size, ProtonTAG);
+	if (counterBlocks == nullptr)
+	{
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "%!FUNC! Failed to allocate counters");
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	RtlZeroMemory(counterBlocks, size);
+
+	return STATUS_SUCCESS;
+}
+
+void StatisticsDestroy()
+{
+	if (counterBlocks != nullptr)
+	{
+		ExFreePoolWithTag(counterBlocks, ProtonTAG);
+		counterBlocks = nullptr;
+	}
+}
+
+void CountEvent(_In_ CALLOUT_COUNTER counter)
+{
+	if (counterBlocks == nullptr)
+	{
+		return;
+	}
+
+	auto processor = KeGetCurrentProcessorNumberEx(nullptr);
+	if (processor >= processorCount)
+	{
+		return;
+	}
+
+	// The thread may move to another processor below DISPATCH_LEVEL, so the increment stays interlocked.
+	// The line is owned by the current processor, which keeps it uncontended.
+	auto* counters = CalloutCounterBlock(counterBlocks, processor)->counters;
+	InterlockedIncrement64(reinterpret_cast<volatile LONG64*>(&counters[counter]));
+}
+
+void StatisticsQuery(_Out_ CALLOUT_STATISTICS* statistics)
+{
+	if (counterBlocks == nullptr)
+	{
+		CalloutStatisticsAggregate(nullptr, 0, statistics);
+		return;
+	}
+
+	CalloutStatisticsAggregate(counterBlocks, processorCount, statistics);
+}
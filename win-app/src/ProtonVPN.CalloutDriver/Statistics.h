@@ -0,0 +1,16 @@
+#pragma once
+
+#include <ntddk.h>
+
+#include "CalloutStatistics.h"
+
+NTSTATUS StatisticsInitialize();
+
+void StatisticsDestroy();
+
+//
+// Increments the counter in the block of the current processor.
+//
+void CountEvent(_In_ CALLOUT_COUNTER counter);
+
+void StatisticsQuery(_Out_ CALLOUT_STATISTICS* statistics);
@@ -0,0 +1,87 @@
+#include "app_id_cache.h"
+
+namespace ipfilter
+{
+    AppIdCache::AppIdCache(std::unique_ptr<AppIdResolver> resolver):
+        resolver(std::move(resolver))
+    {
+    }
+
+    AppId AppIdCache::get(const std::wstring& path)
+    {
+        FileIdentity identity{};
+        if (!this->resolver->identify(path, identity))
+        {
+            this->missCount++;
+            return std::make_shared<const std::vector<uint8_t>>(this->resolver->resolve(path));
+        }
+
+        auto key = normalizePath(path);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            auto it = this->entries.find(key);
+            if (it != this->entries.end() && it->second.identity == identity)
+            {
+                this->hitCount++;
+                return it->second.appId;
+            }
+        }
+
+        this->missCount++;
+
+        auto appId = std::make_shared<const std::vector<uint8_t>>(this->resolver->resolve(path));
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->entries[key] = {identity, appId};
+
+        return appId;
+    }
+
+    void AppIdCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->entries.clear();
+        this->hitCount = 0;
+        this->missCount = 0;
+    }
+
+    uint64_t AppIdCache::hits() const
+    {
+        return this->hitCount;
+    }
+
+    uint64_t AppIdCache::misses() const
+    {
+        return this->missCount;
+    }
+
+    std::wstring AppIdCache::normalizePath(const std::wstring& path)
+    {
+        std::wstring normalized{};
+        normalized.reserve(path.size());
+
+        for (auto c : path)
+        {
+            if (c == L'/')
+            {
+                c = L'\\';
+            }
+            else if (c >= L'A' && c <= L'Z')
+            {
+                c = c - L'A' + L'a';
+            }
+
+            if (c == L'\\' && !normalized.empty() && normalized.back() == L'\\' && normalized.size() > 1)
+            {
+                continue;
+            }
+
+            normalized.push_back(c);
+        }
+
+        return normalized;
+    }
+}
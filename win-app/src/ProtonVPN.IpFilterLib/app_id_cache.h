@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+namespace ipfilter
+{
+    // Identifies a file on disk. A changed identity means the file was replaced or modified.
+    struct FileIdentity
+    {
+        uint64_t volume{};
+        uint64_t fileIndex{};
+        uint64_t lastWriteTime{};
+
+        bool operator==(const FileIdentity& other) const
+        {
+            return volume == other.volume &&
+                fileIndex == other.fileIndex &&
+                lastWriteTime == other.lastWriteTime;
+        }
+    };
+
+    class AppIdResolver
+    {
+    public:
+        virtual ~AppIdResolver() = default;
+
+        // Returns false if the file identity cannot be determined, the result is not cached then.
+        virtual bool identify(const std::wstring& path, FileIdentity& identity) = 0;
+
+        // Returns the application id blob of the file, throws on failure.
+        virtual std::vector<uint8_t> resolve(const std::wstring& path) = 0;
+    };
+
+    typedef std::shared_ptr<const std::vector<uint8_t>> AppId;
+
+    // Caches application ids by normalized file path. Entries are revalidated against
+    // the file identity on every lookup, so replaced or updated executables are resolved again.
+    class AppIdCache
+    {
+    public:
+        AppIdCache(std::unique_ptr<AppIdResolver> resolver);
+
+        AppId get(const std::wstring& path);
+
+        void clear();
+
+        uint64_t hits() const;
+
+        uint64_t misses() const;
+
+        static std::wstring normalizePath(const std::wstring& path);
+
+    private:
+        struct Entry
+        {
+            FileIdentity identity;
+            AppId appId;
+        };
+
+        std::unique_ptr<AppIdResolver> resolver;
+        std::unordered_map<std::wstring, Entry> entries;
+        std::mutex mutex;
+        std::atomic<uint64_t> hitCount{0};
+        std::atomic<uint64_t> missCount{0};
+    };
+
+    // Process-wide cache backed by FwpmGetAppIdFromFileName.
+    AppIdCache& getAppIdCache();
+}
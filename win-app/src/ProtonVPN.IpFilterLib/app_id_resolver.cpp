@@ -0,0 +1,65 @@
+#include "pch.h"
+#include <fwpmu.h>
+#include <stdexcept>
+
+#include "app_id_resolver.h"
+
+namespace ipfilter
+{
+    bool FileAppIdResolver::identify(const std::wstring& path, FileIdentity& identity)
+    {
+        auto file = CreateFileW(
+            path.c_str(),
+            FILE_READ_ATTRIBUTES,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS,
+            nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        BY_HANDLE_FILE_INFORMATION info{};
+        auto result = GetFileInformationByHandle(file, &info);
+
+        CloseHandle(file);
+
+        if (!result)
+        {
+            return false;
+        }
+
+        identity.volume = info.dwVolumeSerialNumber;
+        identity.fileIndex = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+        identity.lastWriteTime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+            info.ftLastWriteTime.dwLowDateTime;
+
+        return true;
+    }
+
+    std::vector<uint8_t> FileAppIdResolver::resolve(const std::wstring& path)
+    {
+        FWP_BYTE_BLOB* byteBlob = nullptr;
+
+        auto result = FwpmGetAppIdFromFileName(path.c_str(), &byteBlob);
+        if (result != ERROR_SUCCESS)
+        {
+            throw std::runtime_error("Application id resolution failed");
+        }
+
+        std::vector<uint8_t> appId(byteBlob->data, byteBlob->data + byteBlob->size);
+
+        FwpmFreeMemory(reinterpret_cast<void **>(&byteBlob));
+
+        return appId;
+    }
+
+    AppIdCache& getAppIdCache()
+    {
+        static AppIdCache cache(std::unique_ptr<AppIdResolver>(new FileAppIdResolver()));
+
+        return cache;
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "app_id_cache.h"
+
+namespace ipfilter
+{
+    class FileAppIdResolver : public AppIdResolver
+    {
+    public:
+        bool identify(const std::wstring& path, FileIdentity& identity) override;
+
+        std::vector<uint8_t> resolve(const std::wstring& path) override;
+    };
+}
@@ -0,0 +1,176 @@
+#include "apply_queue.h"
+
+namespace ipfilter
+{
+    ApplyQueue::ApplyQueue(std::unique_ptr<ApplyTarget> target, size_t maxCoalescedBatches):
+        target(std::move(target)),
+        maxCoalescedBatches(maxCoalescedBatches > 0 ? maxCoalescedBatches : 1)
+    {
+        this->worker = std::thread(&ApplyQueue::run, this);
+    }
+
+    ApplyQueue::~ApplyQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+
+        this->submitted.notify_one();
+        this->worker.join();
+    }
+
+    void ApplyQueue::submit(ApplyBatch batch, ApplyCallback callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->pending.push_back({std::move(batch), std::move(callback)});
+        }
+
+        this->submitted.notify_one();
+    }
+
+    std::future<unsigned int> ApplyQueue::submit(ApplyBatch batch)
+    {
+        auto promise = std::make_shared<std::promise<unsigned int>>();
+        auto future = promise->get_future();
+
+        this->submit(std::move(batch), [promise](unsigned int result)
+        {
+            promise->set_value(result);
+        });
+
+        return future;
+    }
+
+    void ApplyQueue::flush()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        this->idle.wait(lock, [this]()
+        {
+            return this->pending.empty() && !this->busy;
+        });
+    }
+
+    uint64_t ApplyQueue::batches() const
+    {
+        return this->batchCount;
+    }
+
+    uint64_t ApplyQueue::transactions() const
+    {
+        return this->transactionCount;
+    }
+
+    void ApplyQueue::run()
+    {
+        for (;;)
+        {
+            std::vector<Entry> entries{};
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+
+                this->submitted.wait(lock, [this]()
+                {
+                    return this->stopping || !this->pending.empty();
+                });
+
+                if (this->pending.empty())
+                {
+                    return;
+                }
+
+                while (!this->pending.empty() && entries.size() < this->maxCoalescedBatches)
+                {
+                    entries.push_back(std::move(this->pending.front()));
+                    this->pending.pop_front();
+                }
+
+                this->busy = true;
+            }
+
+            this->apply(entries);
+
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->busy = false;
+            }
+
+            this->idle.notify_all();
+        }
+    }
+
+    void ApplyQueue::apply(std::vector<Entry>& entries)
+    {
+        std::vector<Entry*> all{};
+        for (auto& entry : entries)
+        {
+            all.push_back(&entry);
+        }
+
+        if (entries.size() > 1 && this->applyTransaction(all) == 0)
+        {
+            this->batchCount += entries.size();
+            for (auto& entry : entries)
+            {
+                this->complete(entry, 0);
+            }
+
+            return;
+        }
+
+        // A single batch, or one of the coalesced batches failed and rolled back the others.
+        for (auto& entry : entries)
+        {
+            auto result = this->applyTransaction({&entry});
+
+            this->batchCount++;
+            this->complete(entry, result);
+        }
+    }
+
+    void ApplyQueue::complete(Entry& entry, unsigned int result)
+    {
+        if (entry.callback)
+        {
+            entry.callback(result);
+        }
+    }
+
+    unsigned int ApplyQueue::applyTransaction(const std::vector<Entry*>& entries)
+    {
+        auto result = this->target->beginTransaction();
+        if (result != 0)
+        {
+            return result;
+        }
+
+        for (auto entry : entries)
+        {
+            try
+            {
+                result = entry->batch();
+            }
+            catch (...)
+            {
+                result = UnexpectedResult;
+            }
+
+            if (result != 0)
+            {
+                this->target->abortTransaction();
+                return result;
+            }
+        }
+
+        result = this->target->commitTransaction();
+        if (result == 0)
+        {
+            this->transactionCount++;
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <future>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+namespace ipfilter
+{
+    // Transaction boundaries of the session owned by the queue worker.
+    class ApplyTarget
+    {
+    public:
+        virtual ~ApplyTarget() = default;
+
+        virtual unsigned int beginTransaction() = 0;
+
+        virtual unsigned int commitTransaction() = 0;
+
+        virtual unsigned int abortTransaction() = 0;
+    };
+
+    // Applies its changes to the session of the target and returns the result,
+    // which is zero on success.
+    typedef std::function<unsigned int()> ApplyBatch;
+
+    typedef std::function<void(unsigned int result)> ApplyCallback;
+
+    // Applies submitted batches on a single worker thread. Batches queued while the worker
+    // is busy are coalesced into one transaction. When the transaction fails, each of its
+    // batches is applied again in a transaction of its own, so every batch is reported
+    // with its own result. Callbacks run on the worker thread.
+    class ApplyQueue
+    {
+    public:
+        // Reported for a batch that throws.
+        static const unsigned int UnexpectedResult = 0x8000FFFF;
+
+        ApplyQueue(std::unique_ptr<ApplyTarget> target, size_t maxCoalescedBatches);
+
+        // Applies the batches still queued before stopping the worker.
+        ~ApplyQueue();
+
+        ApplyQueue(const ApplyQueue&) = delete;
+
+        ApplyQueue& operator=(const ApplyQueue&) = delete;
+
+        void submit(ApplyBatch batch, ApplyCallback callback);
+
+        std::future<unsigned int> submit(ApplyBatch batch);
+
+        // Waits until all batches submitted so far have been applied.
+        void flush();
+
+        uint64_t batches() const;
+
+        uint64_t transactions() const;
+
+    private:
+        struct Entry
+        {
+            ApplyBatch batch;
+            ApplyCallback callback;
+        };
+
+        void run();
+
+        void apply(std::vector<Entry>& entries);
+
+        unsigned int applyTransaction(const std::vector<Entry*>& entries);
+
+        void complete(Entry& entry, unsigned int result);
+
+        std::unique_ptr<ApplyTarget> target;
+        size_t maxCoalescedBatches;
+        std::deque<Entry> pending;
+        bool busy{};
+        bool stopping{};
+        std::mutex mutex;
+        std::condition_variable submitted;
+        std::condition_variable idle;
+        std::atomic<uint64_t> batchCount{0};
+        std::atomic<uint64_t> transactionCount{0};
+        std::thread worker;
+    };
+}
@@ -0,0 +1,164 @@
+#include "pch.h"
+#include <fwptypes.h>
+#include <fwpmu.h>
+#include <vector>
+
+#include "ip_filter.h"
+#include "engine.h"
+#include "apply_queue.h"
+#include "ruleset_apply.h"
+
+namespace ipfilter
+{
+    class SessionApplyTarget : public ApplyTarget
+    {
+    public:
+        SessionApplyTarget(HANDLE sessionHandle): engine(sessionHandle)
+        {
+        }
+
+        unsigned int beginTransaction() override
+        {
+            return this->engine.beginTransaction();
+        }
+
+        unsigned int commitTransaction() override
+        {
+            return this->engine.commitTransaction();
+        }
+
+        unsigned int abortTransaction() override
+        {
+            return this->engine.abortTransaction();
+        }
+
+    private:
+        SessionEngine engine;
+    };
+
+    // The worker owns a session of its own, so calls made by the caller on its session
+    // never join a transaction of the worker.
+    struct SessionApplyQueue
+    {
+        ~SessionApplyQueue()
+        {
+            this->queue.reset();
+            FwpmEngineClose(this->sessionHandle);
+        }
+
+        HANDLE sessionHandle;
+        std::unique_ptr<ApplyQueue> queue;
+    };
+}
+
+unsigned int IPFilterCreateApplyQueue(
+    BOOL dynamicSession,
+    unsigned int maxCoalescedBatches,
+    IPFilterApplyQueueHandle* handle)
+{
+    // Filters added in a dynamic session are deleted when the queue is destroyed.
+    FWPM_SESSION session{};
+    session.flags = dynamicSession ? FWPM_SESSION_FLAG_DYNAMIC : 0;
+
+    HANDLE sessionHandle = nullptr;
+    auto status = FwpmEngineOpen(
+        nullptr,
+        RPC_C_AUTHN_WINNT,
+        nullptr,
+        &session,
+        &sessionHandle);
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    std::unique_ptr<ipfilter::ApplyTarget> target(new ipfilter::SessionApplyTarget(sessionHandle));
+
+    auto queue = new ipfilter::SessionApplyQueue{sessionHandle, nullptr};
+    queue->queue.reset(new ipfilter::ApplyQueue(std::move(target), maxCoalescedBatches));
+
+    *handle = queue;
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterDestroyApplyQueue(
+    IPFilterApplyQueueHandle handle)
+{
+    delete static_cast<ipfilter::SessionApplyQueue*>(handle);
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterSubmitFilters(
+    IPFilterApplyQueueHandle handle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    unsigned int filterCount,
+    const IPFilterDescriptor* filters,
+    BOOL persistent,
+    IPFilterApplyCallback callback,
+    void* context)
+{
+    // The descriptors belong to the caller, so the batch keeps its own copy of the rules.
+    auto queue = static_cast<ipfilter::SessionApplyQueue*>(handle);
+
+    std::vector<ipfilter::ruleset::Rule> rules{};
+    for (unsigned int i = 0; i < filterCount; i++)
+    {
+        rules.push_back(IPFilterMakeRule(filters[i]));
+    }
+
+    auto sessionHandle = queue->sessionHandle;
+    auto provider = *providerKey;
+    auto sublayer = *sublayerKey;
+
+    auto batch = [sessionHandle, provider, sublayer, rules, persistent]() mutable
+    {
+        ipfilter::SessionEngine engine(sessionHandle);
+
+        for (const auto& rule : rules)
+        {
+            GUID filterKey{};
+
+            auto status = IPFilterInstallRule(engine, &provider, &sublayer, rule, persistent, &filterKey);
+            if (status != ERROR_SUCCESS)
+            {
+                return status;
+            }
+        }
+
+        return static_cast<unsigned int>(ERROR_SUCCESS);
+    };
+
+    queue->queue->submit(batch, [callback, context](unsigned int result)
+    {
+        if (callback != nullptr)
+        {
+            callback(context, result);
+        }
+    });
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterFlushApplyQueue(
+    IPFilterApplyQueueHandle handle)
+{
+    static_cast<ipfilter::SessionApplyQueue*>(handle)->queue->flush();
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterGetApplyQueueStatistics(
+    IPFilterApplyQueueHandle handle,
+    unsigned long long* batches,
+    unsigned long long* transactions)
+{
+    auto& queue = *static_cast<ipfilter::SessionApplyQueue*>(handle)->queue;
+
+    *batches = queue.batches();
+    *transactions = queue.transactions();
+
+    return ERROR_SUCCESS;
+}
@@ -7,102 +7,94 @@ namespace ipfilter
     namespace condition
     {
         Condition::Condition(matcher::Matcher matcher, const GUID& identifier,
-                             const std::shared_ptr<value::Value>& value):
-            matcher(matcher), identifier(identifier), value(value)
+                             const value::Value& value):
+            matchType(matcher), identifier(identifier), value(value)
         {
         }
 
-        Condition::operator FWPM_FILTER_CONDITION()
+        FWP_MATCH_TYPE Condition::getMatchType() const
         {
-            FWPM_FILTER_CONDITION condition{};
+            return this->matchType;
+        }
 
-            condition.fieldKey = this->identifier;
-            condition.matchType = this->matcher;
-            condition.conditionValue = *this->value.get();
+        const GUID& Condition::getFieldKey() const
+        {
+            return this->identifier;
+        }
 
-            return condition;
+        const value::Value& Condition::getValue() const
+        {
+            return this->value;
         }
 
         Condition localIpV4Address(matcher::Matcher matcher,
                                    const value::IpAddressV4& addr)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_LOCAL_ADDRESS,
-                             std::make_shared<value::IpAddressV4>(addr));
+            return Condition(matcher, FWPM_CONDITION_IP_LOCAL_ADDRESS, addr);
         }
 
         Condition localIpV6AddressWithPrefix(matcher::Matcher matcher,
                                              const value::IpAddressV6WithPrefix& addr)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_LOCAL_ADDRESS,
-                             std::make_shared<value::IpAddressV6WithPrefix>(addr));
+            return Condition(matcher, FWPM_CONDITION_IP_LOCAL_ADDRESS, addr);
         }
 
         Condition remoteIpV4Address(matcher::Matcher matcher,
                                     const value::IpAddressV4& addr)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS,
-                             std::make_shared<value::IpAddressV4>(addr));
+            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS, addr);
         }
 
         Condition remoteIpNetworkAddressV4(matcher::Matcher matcher,
                                            const value::IpNetworkAddressV4& addr)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS,
-                             std::make_shared<value::IpNetworkAddressV4>(addr));
+            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS, addr);
         }
 
         Condition remoteIpV6Address(matcher::Matcher matcher,
                                     const value::IpAddressV6& addr)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS,
-                std::make_shared<value::IpAddressV6>(addr));
+            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS, addr);
         }
 
         Condition remoteIpV6AddressWithPrefix(matcher::Matcher matcher,
                                               const value::IpAddressV6WithPrefix& addr)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS,
-                std::make_shared<value::IpAddressV6WithPrefix>(addr));
+            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_ADDRESS, addr);
         }
 
         Condition remotePort(matcher::Matcher matcher, const value::Port& port)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_PORT,
-                             std::make_shared<value::Port>(port));
+            return Condition(matcher, FWPM_CONDITION_IP_REMOTE_PORT, port);
         }
 
         Condition localPort(matcher::Matcher matcher, const value::Port& port)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_LOCAL_PORT,
-                             std::make_shared<value::Port>(port));
+            return Condition(matcher, FWPM_CONDITION_IP_LOCAL_PORT, port);
         }
 
         Condition tcpProtocol(matcher::Matcher matcher, const value::TcpProtocol& protocol)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_PROTOCOL,
-                             std::make_shared<value::TcpProtocol>(protocol));
+            return Condition(matcher, FWPM_CONDITION_IP_PROTOCOL, protocol);
         }
 
         Condition loopback()
         {
             return Condition(matcher::Matcher(FWP_MATCH_FLAGS_ALL_SET),
-                             FWPM_CONDITION_FLAGS, std::make_shared<value::Flag>(
-                                 value::Flag::loopback()));
+                             FWPM_CONDITION_FLAGS, value::Flag::loopback());
         }
 
         Condition nonLoopback()
         {
             return Condition(matcher::Matcher(FWP_MATCH_FLAGS_NONE_SET),
-                             FWPM_CONDITION_FLAGS, std::make_shared<value::Flag>(
-                                 value::Flag::loopback()));
+                             FWPM_CONDITION_FLAGS, value::Flag::loopback());
         }
 
         Condition applicationId(
             matcher::Matcher matcher,
             const value::ApplicationId& appId)
         {
-            return Condition(matcher, FWPM_CONDITION_ALE_APP_ID,
-                             std::make_shared<value::ApplicationId>(appId));
+            return Condition(matcher, FWPM_CONDITION_ALE_APP_ID, appId);
         }
 
         Condition netInterface(matcher::Matcher matcher, const NetInterface& iface)
@@ -110,7 +102,7 @@ namespace ipfilter
             return Condition(
                 matcher,
                 FWPM_CONDITION_IP_LOCAL_INTERFACE,
-                std::make_shared<value::NetInterfaceId>(iface.getLocalId()));
+                value::NetInterfaceId(iface.getLocalId()));
         }
 
         Condition netInterfaceIndex(matcher::Matcher matcher, const NetInterface& iface)
@@ -118,22 +110,22 @@ namespace ipfilter
             return Condition(
                 matcher,
                 FWPM_CONDITION_INTERFACE_INDEX,
-                std::make_shared<value::NetInterfaceIndex>(iface.getIndex()));
+                value::NetInterfaceIndex(iface.getIndex()));
         }
 
         Condition icmpv6Protocol(matcher::Matcher matcher)
         {
-            return Condition(matcher, FWPM_CONDITION_IP_PROTOCOL, std::make_shared<value::IcmpProtocol>());
+            return Condition(matcher, FWPM_CONDITION_IP_PROTOCOL, value::IcmpProtocol());
         }
 
         Condition icmpType(matcher::Matcher matcher, UINT16 type)
         {
-            return Condition(matcher, FWPM_CONDITION_ICMP_TYPE, std::make_shared<value::IcmpType>(type));
+            return Condition(matcher, FWPM_CONDITION_ICMP_TYPE, value::IcmpType(type));
         }
 
         Condition icmpCode(matcher::Matcher matcher, UINT16 code)
         {
-            return Condition(matcher, FWPM_CONDITION_ICMP_CODE, std::make_shared<value::IcmpCode>(code));
+            return Condition(matcher, FWPM_CONDITION_ICMP_CODE, value::IcmpCode(code));
         }
     }
 }
@@ -2,8 +2,6 @@
 #include <fwptypes.h>
 #include <fwpmu.h>
 
-#include <memory>
-
 #include "value.h"
 #include "matcher.h"
 #include "net_interface.h"
@@ -16,14 +14,18 @@ namespace ipfilter
         {
         public:
             Condition(matcher::Matcher matcher, const GUID& identifier,
-                      const std::shared_ptr<value::Value>& value);
+                      const value::Value& value);
+
+            FWP_MATCH_TYPE getMatchType() const;
+
+            const GUID& getFieldKey() const;
 
-            virtual operator FWPM_FILTER_CONDITION();
+            const value::Value& getValue() const;
 
         private:
-            matcher::Matcher matcher;
+            FWP_MATCH_TYPE matchType;
             GUID identifier;
-            std::shared_ptr<value::Value> value;
+            value::Value value;
         };
 
         Condition localIpV4Address(matcher::Matcher matcher,
@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "condition_list.h"
+
+namespace ipfilter
+{
+    ConditionList::ConditionList(const std::vector<condition::Condition>& conditions):
+        conditions(conditions.size()),
+        payload(getPayloadSize(conditions))
+    {
+        for (size_t i = 0; i < conditions.size(); i++)
+        {
+            const auto& value = conditions[i].getValue();
+            const auto& source = value.getPayload();
+            auto& condition = this->conditions[i];
+
+            condition.fieldKey = conditions[i].getFieldKey();
+            condition.matchType = conditions[i].getMatchType();
+            condition.conditionValue.type = value.getType();
+
+            switch (value.getType())
+            {
+            case FWP_UINT8:
+                condition.conditionValue.uint8 = source.uint8;
+                break;
+            case FWP_UINT16:
+                condition.conditionValue.uint16 = source.uint16;
+                break;
+            case FWP_UINT32:
+                condition.conditionValue.uint32 = source.uint32;
+                break;
+            case FWP_UINT64:
+                condition.conditionValue.uint64 = this->payload.add(source.uint64);
+                break;
+            case FWP_V4_ADDR_MASK:
+                condition.conditionValue.v4AddrMask = this->payload.add(source.v4AddrMask);
+                break;
+            case FWP_BYTE_ARRAY16_TYPE:
+                condition.conditionValue.byteArray16 = this->payload.add(source.byteArray16);
+                break;
+            case FWP_V6_ADDR_MASK:
+                condition.conditionValue.v6AddrMask = this->payload.add(source.v6AddrMask);
+                break;
+            case FWP_BYTE_BLOB_TYPE:
+            {
+                const auto* blob = value.getBlob();
+                auto* byteBlob = this->payload.add(FWP_BYTE_BLOB{});
+                byteBlob->size = static_cast<UINT32>(blob->size());
+                byteBlob->data = this->payload.addBytes(blob->data(), blob->size());
+                condition.conditionValue.byteBlob = byteBlob;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    FWPM_FILTER_CONDITION0* ConditionList::data()
+    {
+        return this->conditions.data();
+    }
+
+    UINT32 ConditionList::size() const
+    {
+        return static_cast<UINT32>(this->conditions.size());
+    }
+
+    size_t ConditionList::getPayloadSize(const std::vector<condition::Condition>& conditions)
+    {
+        size_t size = 0;
+        for (const auto& condition : conditions)
+        {
+            size += getPayloadSize(condition.getValue());
+        }
+
+        return size;
+    }
+
+    size_t ConditionList::getPayloadSize(const value::Value& value)
+    {
+        switch (value.getType())
+        {
+        case FWP_UINT64:
+            return PayloadBuffer::alignedSize(sizeof(UINT64));
+        case FWP_V4_ADDR_MASK:
+            return PayloadBuffer::alignedSize(sizeof(FWP_V4_ADDR_AND_MASK));
+        case FWP_BYTE_ARRAY16_TYPE:
+            return PayloadBuffer::alignedSize(sizeof(FWP_BYTE_ARRAY16));
+        case FWP_V6_ADDR_MASK:
+            return PayloadBuffer::alignedSize(sizeof(FWP_V6_ADDR_AND_MASK));
+        case FWP_BYTE_BLOB_TYPE:
+            return PayloadBuffer::alignedSize(sizeof(FWP_BYTE_BLOB)) + PayloadBuffer::alignedSize(value.getBlob()->size());
+        default:
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <fwptypes.h>
+#include <fwpmtypes.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "condition.h"
+#include "payload_buffer.h"
+
+namespace ipfilter
+{
+    // FWPM filter conditions together with the memory their values point to. All payloads
+    // are laid out in a single buffer, which lives as long as the list.
+    class ConditionList
+    {
+    public:
+        ConditionList(const std::vector<condition::Condition>& conditions);
+
+        ConditionList(const ConditionList&) = delete;
+
+        ConditionList& operator=(const ConditionList&) = delete;
+
+        FWPM_FILTER_CONDITION0* data();
+
+        UINT32 size() const;
+
+    private:
+        static size_t getPayloadSize(const std::vector<condition::Condition>& conditions);
+
+        static size_t getPayloadSize(const value::Value& value);
+
+        std::vector<FWPM_FILTER_CONDITION0> conditions;
+
+        PayloadBuffer payload;
+    };
+}
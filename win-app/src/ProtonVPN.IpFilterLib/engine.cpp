@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "engine.h"
+
+static_assert(
+    ipfilter::TransactionInProgressResult == static_cast<unsigned int>(FWP_E_TXN_IN_PROGRESS),
+    "TransactionInProgressResult must match FWP_E_TXN_IN_PROGRESS");
+
+namespace ipfilter
+{
+    SessionEngine::SessionEngine(HANDLE sessionHandle): sessionHandle(sessionHandle)
+    {
+    }
+
+    unsigned int SessionEngine::beginTransaction()
+    {
+        return FwpmTransactionBegin(this->sessionHandle, 0);
+    }
+
+    unsigned int SessionEngine::commitTransaction()
+    {
+        return FwpmTransactionCommit(this->sessionHandle);
+    }
+
+    unsigned int SessionEngine::abortTransaction()
+    {
+        return FwpmTransactionAbort(this->sessionHandle);
+    }
+
+    unsigned int SessionEngine::addFilter(const FWPM_FILTER0& filter)
+    {
+        UINT64 id{};
+
+        return FwpmFilterAdd(
+            this->sessionHandle,
+            &filter,
+            nullptr,
+            &id);
+    }
+
+    unsigned int SessionEngine::deleteFilter(const GUID& filterKey)
+    {
+        return FwpmFilterDeleteByKey(this->sessionHandle, &filterKey);
+    }
+
+    unsigned int SessionEngine::getFilter(const GUID& filterKey, FWPM_FILTER0*& filter)
+    {
+        return FwpmFilterGetByKey(this->sessionHandle, &filterKey, &filter);
+    }
+
+    void SessionEngine::freeFilter(FWPM_FILTER0*& filter)
+    {
+        if (filter != nullptr)
+        {
+            FwpmFreeMemory(reinterpret_cast<void**>(&filter));
+        }
+    }
+
+    unsigned int SessionEngine::createFilterEnumHandle(
+        const FWPM_FILTER_ENUM_TEMPLATE0& enumTemplate,
+        HANDLE& enumHandle)
+    {
+        return FwpmFilterCreateEnumHandle(this->sessionHandle, &enumTemplate, &enumHandle);
+    }
+
+    unsigned int SessionEngine::enumFilters(
+        HANDLE enumHandle,
+        UINT32 pageSize,
+        FWPM_FILTER0**& filters,
+        UINT32& filterCount)
+    {
+        return FwpmFilterEnum(this->sessionHandle, enumHandle, pageSize, &filters, &filterCount);
+    }
+
+    void SessionEngine::freeFilters(FWPM_FILTER0**& filters)
+    {
+        if (filters != nullptr)
+        {
+            FwpmFreeMemory(reinterpret_cast<void**>(&filters));
+        }
+    }
+
+    unsigned int SessionEngine::destroyFilterEnumHandle(HANDLE enumHandle)
+    {
+        return FwpmFilterDestroyEnumHandle(this->sessionHandle, enumHandle);
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <fwptypes.h>
+#include <fwpmu.h>
+
+#include "transaction.h"
+
+namespace ipfilter
+{
+    class Engine : public TransactionEngine
+    {
+    public:
+        virtual unsigned int addFilter(const FWPM_FILTER0& filter) = 0;
+
+        virtual unsigned int deleteFilter(const GUID& filterKey) = 0;
+
+        virtual unsigned int getFilter(const GUID& filterKey, FWPM_FILTER0*& filter) = 0;
+
+        virtual void freeFilter(FWPM_FILTER0*& filter) = 0;
+
+        virtual unsigned int createFilterEnumHandle(
+            const FWPM_FILTER_ENUM_TEMPLATE0& enumTemplate,
+            HANDLE& enumHandle) = 0;
+
+        virtual unsigned int enumFilters(
+            HANDLE enumHandle,
+            UINT32 pageSize,
+            FWPM_FILTER0**& filters,
+            UINT32& filterCount) = 0;
+
+        virtual void freeFilters(FWPM_FILTER0**& filters) = 0;
+
+        virtual unsigned int destroyFilterEnumHandle(HANDLE enumHandle) = 0;
+    };
+
+    class SessionEngine : public Engine
+    {
+    public:
+        SessionEngine(HANDLE sessionHandle);
+
+        unsigned int beginTransaction() override;
+
+        unsigned int commitTransaction() override;
+
+        unsigned int abortTransaction() override;
+
+        unsigned int addFilter(const FWPM_FILTER0& filter) override;
+
+        unsigned int deleteFilter(const GUID& filterKey) override;
+
+        unsigned int getFilter(const GUID& filterKey, FWPM_FILTER0*& filter) override;
+
+        void freeFilter(FWPM_FILTER0*& filter) override;
+
+        unsigned int createFilterEnumHandle(
+            const FWPM_FILTER_ENUM_TEMPLATE0& enumTemplate,
+            HANDLE& enumHandle) override;
+
+        unsigned int enumFilters(
+            HANDLE enumHandle,
+            UINT32 pageSize,
+            FWPM_FILTER0**& filters,
+            UINT32& filterCount) override;
+
+        void freeFilters(FWPM_FILTER0**& filters) override;
+
+        unsigned int destroyFilterEnumHandle(HANDLE enumHandle) override;
+
+    private:
+        HANDLE sessionHandle;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace ipfilter
+{
+    // Enumeration of engine objects of one type, fetched a page at a time.
+    template <class Object>
+    class PagedEnum
+    {
+    public:
+        virtual ~PagedEnum() = default;
+
+        virtual unsigned int open() = 0;
+
+        // Fetches up to pageSize objects, none once the enumeration is exhausted. The page is
+        // released with freePage whether or not the call succeeds.
+        virtual unsigned int nextPage(uint32_t pageSize, Object**& objects, uint32_t& objectCount) = 0;
+
+        virtual void freePage(Object**& objects) = 0;
+
+        virtual void close() = 0;
+    };
+
+    // Visits every object of the enumeration, fetching pages until an empty one is returned.
+    // The enumeration is closed before returning, also when the callback throws, so objects
+    // can be deleted once their keys have been collected.
+    template <class Object>
+    unsigned int forEachPagedObject(
+        PagedEnum<Object>& enumeration,
+        uint32_t pageSize,
+        const std::function<void(const Object&)>& callback)
+    {
+        auto status = enumeration.open();
+        if (status != 0)
+        {
+            return status;
+        }
+
+        try
+        {
+            while (true)
+            {
+                Object** objects{};
+                uint32_t objectCount{};
+
+                status = enumeration.nextPage(pageSize, objects, objectCount);
+                if (status != 0 || objectCount == 0)
+                {
+                    enumeration.freePage(objects);
+                    break;
+                }
+
+                try
+                {
+                    for (uint32_t i = 0; i < objectCount; i++)
+                    {
+                        callback(*objects[i]);
+                    }
+                }
+                catch (...)
+                {
+                    enumeration.freePage(objects);
+                    throw;
+                }
+
+                enumeration.freePage(objects);
+            }
+        }
+        catch (...)
+        {
+            enumeration.close();
+            throw;
+        }
+
+        enumeration.close();
+
+        return status;
+    }
+}
@@ -7,7 +7,10 @@
 #include "ip_filter.h"
 #include "guid.h"
 #include "filter_specification.h"
+#include "condition_list.h"
 #include "net_interface.h"
+#include "engine.h"
+#include "prefix_set.h"
 
 void IPFilterGetLayerKey(
     GUID& spec,
@@ -36,9 +39,15 @@ void IPFilterGetLayerKey(
     case (unsigned int)IPFilterLayer::AppConnectRedirectV4:
         spec = FWPM_LAYER_ALE_CONNECT_REDIRECT_V4;
         break;
+    case (unsigned int)IPFilterLayer::AppConnectRedirectV6:
+        spec = FWPM_LAYER_ALE_CONNECT_REDIRECT_V6;
+        break;
     case (unsigned int)IPFilterLayer::OutboundIPPacketV4:
         spec = FWPM_LAYER_OUTBOUND_IPPACKET_V4;
         break;
+    case (unsigned int)IPFilterLayer::OutboundIPPacketV6:
+        spec = FWPM_LAYER_OUTBOUND_IPPACKET_V6;
+        break;
     case (unsigned int)IPFilterLayer::AppAuthRecvAcceptV6:
         spec = FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V6;
         break;
@@ -47,6 +56,36 @@ void IPFilterGetLayerKey(
     }
 }
 
+// Every layer IPFilterGetLayerKey maps, listed explicitly rather than as a range of values,
+// so enumerations do not depend on the order in which layers were added to IPFilterLayer.
+const IPFilterLayer IPFilterLayers[] = {
+    IPFilterLayer::AppFlowEstablishedV4,
+    IPFilterLayer::AppFlowEstablishedV6,
+    IPFilterLayer::AppAuthConnectV4,
+    IPFilterLayer::AppAuthConnectV6,
+    IPFilterLayer::AppAuthRecvAcceptV6,
+    IPFilterLayer::BindRedirectV4,
+    IPFilterLayer::BindRedirectV6,
+    IPFilterLayer::AppConnectRedirectV4,
+    IPFilterLayer::AppConnectRedirectV6,
+    IPFilterLayer::OutboundIPPacketV4,
+    IPFilterLayer::OutboundIPPacketV6,
+};
+
+std::vector<GUID> IPFilterGetLayerKeys()
+{
+    std::vector<GUID> keys{};
+
+    for (auto layer : IPFilterLayers)
+    {
+        GUID key{};
+        IPFilterGetLayerKey(key, (unsigned int)layer);
+        keys.push_back(key);
+    }
+
+    return keys;
+}
+
 void IPFilterSetFilterSpecificationAction(
     ipfilter::FilterSpecification& specification,
     unsigned int action,
@@ -102,8 +141,8 @@ void IPFilterCreateFilterSpecification(
     }
 }
 
-unsigned int IPFilterCreateFilter(
-    IPFilterSessionHandle sessionHandle,
+unsigned int IPFilterAddFilter(
+    ipfilter::Engine& engine,
     GUID* providerKey,
     GUID* sublayerKey,
     const IPFilterDisplayData* displayData,
@@ -113,6 +152,7 @@ unsigned int IPFilterCreateFilter(
     GUID* calloutKey,
     GUID* providerContextKey,
     const std::vector<ipfilter::condition::Condition>& conditions,
+    const std::vector<uint8_t>* providerData,
     bool persistent,
     GUID* filterKey)
 {
@@ -129,11 +169,7 @@ unsigned int IPFilterCreateFilter(
     GUID layerKey{};
     IPFilterGetLayerKey(layerKey, layer);
 
-    std::vector<FWPM_FILTER_CONDITION0> fwpmConditions{};
-    for (auto condition : spec.getConditions())
-    {
-        fwpmConditions.push_back(condition);
-    }
+    ipfilter::ConditionList fwpmConditions(spec.getConditions());
 
     FWPM_FILTER0 filter{};
     filter.filterKey = ipfilter::guid::makeGuid(filterKey);
@@ -149,15 +185,16 @@ unsigned int IPFilterCreateFilter(
     }
     filter.weight = spec.getWeight();
     filter.filterCondition = fwpmConditions.data();
-    filter.numFilterConditions = static_cast<UINT32>(fwpmConditions.size());
+    filter.numFilterConditions = fwpmConditions.size();
     filter.displayData.name = const_cast<wchar_t *>(displayData->name);
     filter.displayData.description = const_cast<wchar_t *>(displayData->description);
+    if (providerData != nullptr)
+    {
+        filter.providerData.size = static_cast<UINT32>(providerData->size());
+        filter.providerData.data = const_cast<UINT8*>(providerData->data());
+    }
 
-    auto result = FwpmFilterAdd(
-        sessionHandle,
-        &filter,
-        nullptr,
-        &filter.filterId);
+    auto result = engine.addFilter(filter);
 
     if (result == ERROR_SUCCESS)
     {
@@ -167,6 +204,38 @@ unsigned int IPFilterCreateFilter(
     return result;
 }
 
+unsigned int IPFilterCreateFilter(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    const IPFilterDisplayData* displayData,
+    unsigned int layer,
+    unsigned int action,
+    unsigned int weight,
+    GUID* calloutKey,
+    GUID* providerContextKey,
+    const std::vector<ipfilter::condition::Condition>& conditions,
+    bool persistent,
+    GUID* filterKey)
+{
+    ipfilter::SessionEngine engine(sessionHandle);
+
+    return IPFilterAddFilter(
+        engine,
+        providerKey,
+        sublayerKey,
+        displayData,
+        layer,
+        action,
+        weight,
+        calloutKey,
+        providerContextKey,
+        conditions,
+        nullptr,
+        persistent,
+        filterKey);
+}
+
 unsigned int IPFilterCreateLayerFilter(
     IPFilterSessionHandle sessionHandle,
     GUID* providerKey,
@@ -382,11 +451,16 @@ unsigned int IPFilterCreateRemoteNetworkIPFilter(
     BOOL persistent,
     GUID* filterKey)
 {
+    if (!IPFilterIsValidNetworkAddress(*addr))
+    {
+        return ERROR_INVALID_PARAMETER;
+    }
+
     std::vector<ipfilter::condition::Condition> conditions{};
 
     if (addr->isIpv6)
     {
-        auto address = ipfilter::ip::makeAddressV6(addr->address, addr->prefix);
+        auto address = ipfilter::ip::makeAddressV6(addr->address, static_cast<uint8_t>(addr->prefix));
         auto networkAddrCondition = ipfilter::condition::remoteIpV6AddressWithPrefix(
             ipfilter::matcher::equal(),
             ipfilter::value::IpAddressV6WithPrefix(address));
@@ -419,6 +493,164 @@ unsigned int IPFilterCreateRemoteNetworkIPFilter(
         filterKey);
 }
 
+ipfilter::condition::Condition IPFilterMakeRemoteNetworkCondition(
+    const ipfilter::ip::AddressV4& address,
+    const ipfilter::ip::AddressV4& mask)
+{
+    return ipfilter::condition::remoteIpNetworkAddressV4(
+        ipfilter::matcher::equal(),
+        ipfilter::value::IpNetworkAddressV4(address, mask));
+}
+
+ipfilter::condition::Condition IPFilterMakeRemoteNetworkCondition(
+    const ipfilter::ip::AddressV6& address)
+{
+    return ipfilter::condition::remoteIpV6AddressWithPrefix(
+        ipfilter::matcher::equal(),
+        ipfilter::value::IpAddressV6WithPrefix(address));
+}
+
+// IPv6 prefix lengths arrive as int and are rejected, rather than truncated, outside 0..128.
+bool IPFilterIsValidNetworkAddress(const IPFilterNetworkAddress& addr)
+{
+    return !addr.isIpv6 || (addr.prefix >= 0 && addr.prefix <= 128);
+}
+
+// Builds one condition per network address. When coalescing, overlapping and adjacent
+// networks are merged into the minimal list of prefixes covering the same addresses.
+// IPv4 networks with non-contiguous masks cannot be expressed as a prefix and are kept as is.
+std::vector<ipfilter::condition::Condition> IPFilterCreateRemoteNetworkConditions(
+    unsigned int addrCount,
+    const IPFilterNetworkAddress* addrs,
+    bool coalesce)
+{
+    std::vector<ipfilter::condition::Condition> conditions{};
+    ipfilter::ip::PrefixSetV4 prefixesV4{};
+    ipfilter::ip::PrefixSetV6 prefixesV6{};
+
+    for (unsigned int i = 0; i < addrCount; i++)
+    {
+        const auto& addr = addrs[i];
+
+        if (!IPFilterIsValidNetworkAddress(addr))
+        {
+            throw std::invalid_argument("Invalid IPv6 prefix length");
+        }
+
+        if (addr.isIpv6)
+        {
+            auto address = ipfilter::ip::makeAddressV6(addr.address, static_cast<uint8_t>(addr.prefix));
+            if (coalesce)
+            {
+                prefixesV6.add(ipfilter::ip::toUint128(address), address.prefix());
+            }
+            else
+            {
+                conditions.push_back(IPFilterMakeRemoteNetworkCondition(address));
+            }
+
+            continue;
+        }
+
+        auto address = ipfilter::ip::makeAddressV4(addr.address);
+        auto mask = ipfilter::ip::makeAddressV4(addr.mask);
+        auto maskLength = ipfilter::ip::maskLength(mask);
+        if (coalesce && maskLength >= 0)
+        {
+            prefixesV4.add(ipfilter::ip::toUint32(address), static_cast<uint8_t>(maskLength));
+        }
+        else
+        {
+            conditions.push_back(IPFilterMakeRemoteNetworkCondition(address, mask));
+        }
+    }
+
+    for (const auto& prefix : prefixesV4.compute())
+    {
+        auto mask = ~ipfilter::ip::PrefixSetV4::Traits::hostMask(prefix.length);
+
+        conditions.push_back(IPFilterMakeRemoteNetworkCondition(
+            ipfilter::ip::toAddressV4(prefix.address),
+            ipfilter::ip::toAddressV4(mask)));
+    }
+
+    for (const auto& prefix : prefixesV6.compute())
+    {
+        conditions.push_back(IPFilterMakeRemoteNetworkCondition(
+            ipfilter::ip::toAddressV6(prefix.address, prefix.length)));
+    }
+
+    return conditions;
+}
+
+unsigned int IPFilterCreateRemoteNetworkIPFilters(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    const IPFilterDisplayData* displayData,
+    unsigned int layer,
+    unsigned int action,
+    unsigned int weight,
+    GUID* calloutKey,
+    GUID* providerContextKey,
+    unsigned int addrCount,
+    const IPFilterNetworkAddress* addrs,
+    BOOL coalesce,
+    BOOL persistent,
+    GUID* filterKeys,
+    unsigned int* filterCount)
+{
+    for (unsigned int i = 0; i < addrCount; i++)
+    {
+        if (!IPFilterIsValidNetworkAddress(addrs[i]))
+        {
+            return ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    auto conditions = IPFilterCreateRemoteNetworkConditions(addrCount, addrs, coalesce != FALSE);
+
+    // On input *filterCount is the capacity of filterKeys, at most addrCount keys are needed.
+    if (*filterCount < conditions.size())
+    {
+        *filterCount = static_cast<unsigned int>(conditions.size());
+        return ERROR_INSUFFICIENT_BUFFER;
+    }
+
+    ipfilter::SessionEngine engine(sessionHandle);
+
+    auto result = ipfilter::transact(engine, [&]()
+    {
+        for (size_t i = 0; i < conditions.size(); i++)
+        {
+            auto result = IPFilterAddFilter(
+                engine,
+                providerKey,
+                sublayerKey,
+                displayData,
+                layer,
+                action,
+                weight,
+                calloutKey,
+                providerContextKey,
+                {conditions[i]},
+                nullptr,
+                persistent,
+                &filterKeys[i]);
+            if (result != ERROR_SUCCESS)
+            {
+                return result;
+            }
+        }
+
+        return static_cast<unsigned int>(ERROR_SUCCESS);
+    });
+
+    *filterCount = result == ERROR_SUCCESS ? static_cast<unsigned int>(conditions.size()) : 0;
+
+    return result;
+}
+
 unsigned int IPFilterCreateNetInterfaceFilter(
     IPFilterSessionHandle sessionHandle,
     GUID* providerKey,
@@ -433,19 +665,15 @@ unsigned int IPFilterCreateNetInterfaceFilter(
 {
     std::vector<ipfilter::condition::Condition> conditions{};
 
-    auto netInterfaces = ipfilter::getNetworkInterfaces();
-
-    auto netInterfaceIt = ipfilter::findNetworkInterfaceByIndex(
-        netInterfaces,
-        index);
-    if (netInterfaceIt == std::end(netInterfaces))
+    ipfilter::NetInterface netInterface{};
+    if (!ipfilter::findNetworkInterfaceByIndex(ipfilter::getNetworkInterfaces(), index, netInterface))
     {
         return E_ADAPTER_NOT_FOUND;
     }
 
     conditions.push_back(ipfilter::condition::netInterface(
         ipfilter::matcher::equal(),
-        *netInterfaceIt));
+        netInterface));
 
     return IPFilterCreateFilter(
         sessionHandle,
@@ -492,6 +720,185 @@ unsigned int IPFilterCreateLoopbackFilter(
         filterKey);
 }
 
+ipfilter::matcher::Matcher IPFilterGetMatcher(unsigned int match)
+{
+    switch (match)
+    {
+    case (unsigned int)IPFilterMatch::Equal:
+        return ipfilter::matcher::equal();
+    case (unsigned int)IPFilterMatch::NotEqual:
+        return ipfilter::matcher::notEqual();
+    default:
+        throw std::invalid_argument("Invalid match type");
+    }
+}
+
+unsigned int IPFilterCreateConditions(
+    const IPFilterDescriptor& descriptor,
+    ipfilter::NetInterfaceTable& netInterfaces,
+    std::vector<ipfilter::condition::Condition>& conditions)
+{
+    for (unsigned int i = 0; i < descriptor.conditionCount; i++)
+    {
+        const auto& condition = descriptor.conditions[i];
+        auto matcher = IPFilterGetMatcher(condition.match);
+
+        switch (condition.type)
+        {
+        case (unsigned int)IPFilterConditionType::RemoteIPv4Address:
+            conditions.push_back(ipfilter::condition::remoteIpV4Address(
+                matcher,
+                ipfilter::ip::makeAddressV4(condition.address)));
+            break;
+        case (unsigned int)IPFilterConditionType::RemoteNetworkAddress:
+            if (condition.networkAddress->isIpv6)
+            {
+                conditions.push_back(ipfilter::condition::remoteIpV6AddressWithPrefix(
+                    matcher,
+                    ipfilter::value::IpAddressV6WithPrefix(ipfilter::ip::makeAddressV6(
+                        condition.networkAddress->address,
+                        condition.networkAddress->prefix))));
+            }
+            else
+            {
+                conditions.push_back(ipfilter::condition::remoteIpNetworkAddressV4(
+                    matcher,
+                    ipfilter::value::IpNetworkAddressV4(
+                        ipfilter::ip::makeAddressV4(condition.networkAddress->address),
+                        ipfilter::ip::makeAddressV4(condition.networkAddress->mask))));
+            }
+            break;
+        case (unsigned int)IPFilterConditionType::ApplicationId:
+            conditions.push_back(ipfilter::condition::applicationId(
+                matcher,
+                ipfilter::value::ApplicationId::fromFilePath(condition.path)));
+            break;
+        case (unsigned int)IPFilterConditionType::TcpProtocol:
+            conditions.push_back(ipfilter::condition::tcpProtocol(
+                matcher,
+                ipfilter::value::TcpProtocol::tcp()));
+            break;
+        case (unsigned int)IPFilterConditionType::UdpProtocol:
+            conditions.push_back(ipfilter::condition::tcpProtocol(
+                matcher,
+                ipfilter::value::TcpProtocol::udp()));
+            break;
+        case (unsigned int)IPFilterConditionType::RemotePort:
+            conditions.push_back(ipfilter::condition::remotePort(
+                matcher,
+                static_cast<unsigned short>(condition.value)));
+            break;
+        case (unsigned int)IPFilterConditionType::LocalPort:
+            conditions.push_back(ipfilter::condition::localPort(
+                matcher,
+                static_cast<unsigned short>(condition.value)));
+            break;
+        case (unsigned int)IPFilterConditionType::Loopback:
+            conditions.push_back(ipfilter::condition::loopback());
+            break;
+        case (unsigned int)IPFilterConditionType::NetInterface:
+        case (unsigned int)IPFilterConditionType::NetInterfaceIndex:
+        {
+            if (netInterfaces.empty())
+            {
+                netInterfaces = ipfilter::getNetworkInterfaces();
+            }
+
+            ipfilter::NetInterface netInterface{};
+            if (!ipfilter::findNetworkInterfaceByIndex(netInterfaces, condition.value, netInterface))
+            {
+                return E_ADAPTER_NOT_FOUND;
+            }
+
+            if (condition.type == (unsigned int)IPFilterConditionType::NetInterface)
+            {
+                conditions.push_back(ipfilter::condition::netInterface(matcher, netInterface));
+            }
+            else
+            {
+                conditions.push_back(ipfilter::condition::netInterfaceIndex(matcher, netInterface));
+            }
+            break;
+        }
+        default:
+            throw std::invalid_argument("Invalid condition type");
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterAddFilters(
+    ipfilter::Engine& engine,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    unsigned int filterCount,
+    const IPFilterDescriptor* filters,
+    const std::vector<uint8_t>* providerData,
+    BOOL persistent,
+    GUID* filterKeys)
+{
+    ipfilter::NetInterfaceTable netInterfaces{};
+
+    for (unsigned int i = 0; i < filterCount; i++)
+    {
+        const auto& descriptor = filters[i];
+
+        std::vector<ipfilter::condition::Condition> conditions{};
+        auto result = IPFilterCreateConditions(descriptor, netInterfaces, conditions);
+        if (result != ERROR_SUCCESS)
+        {
+            return result;
+        }
+
+        result = IPFilterAddFilter(
+            engine,
+            providerKey,
+            sublayerKey,
+            descriptor.displayData,
+            descriptor.layer,
+            descriptor.action,
+            descriptor.weight,
+            descriptor.calloutKey,
+            descriptor.providerContextKey,
+            conditions,
+            providerData,
+            persistent,
+            &filterKeys[i]);
+        if (result != ERROR_SUCCESS)
+        {
+            return result;
+        }
+    }
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterCreateFiltersBatch(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    unsigned int filterCount,
+    const IPFilterDescriptor* filters,
+    BOOL persistent,
+    GUID* filterKeys)
+{
+    ipfilter::SessionEngine engine(sessionHandle);
+
+    return ipfilter::transact(engine, [&]()
+    {
+        return IPFilterAddFilters(
+            engine,
+            providerKey,
+            sublayerKey,
+            filterCount,
+            filters,
+            nullptr,
+            persistent,
+            filterKeys);
+    });
+}
+
 unsigned int BlockOutsideDns(
     IPFilterSessionHandle sessionHandle,
     GUID* providerKey,
@@ -507,16 +914,15 @@ unsigned int BlockOutsideDns(
 {
     std::vector<ipfilter::condition::Condition> conditions{};
 
-    auto netInterfaces = ipfilter::getNetworkInterfaces();
-    auto netInterfaceIt = findNetworkInterfaceByIndex(netInterfaces, index);
-    if (netInterfaceIt == std::end(netInterfaces))
+    ipfilter::NetInterface netInterface{};
+    if (!ipfilter::findNetworkInterfaceByIndex(ipfilter::getNetworkInterfaces(), index, netInterface))
     {
         return E_ADAPTER_NOT_FOUND;
     }
 
     conditions.push_back(ipfilter::condition::netInterfaceIndex(
         ipfilter::matcher::notEqual(),
-        *netInterfaceIt));
+        netInterface));
 
     return IPFilterCreateFilter(
         sessionHandle,
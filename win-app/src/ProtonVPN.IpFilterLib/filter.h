@@ -1,6 +1,23 @@
 #pragma once
 #include "pch.h"
+#include <vector>
+#include <cstdint>
+
+#include "ip_filter.h"
+#include "engine.h"
 
 void IPFilterGetLayerKey(
     GUID& spec,
     unsigned int layer);
+
+std::vector<GUID> IPFilterGetLayerKeys();
+
+unsigned int IPFilterAddFilters(
+    ipfilter::Engine& engine,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    unsigned int filterCount,
+    const IPFilterDescriptor* filters,
+    const std::vector<uint8_t>* providerData,
+    BOOL persistent,
+    GUID* filterKeys);
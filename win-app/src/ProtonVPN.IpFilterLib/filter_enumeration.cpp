@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "filter_enumeration.h"
+
+namespace ipfilter
+{
+    bool matchesQuery(const FWPM_FILTER0& filter, const FilterQuery& query)
+    {
+        if (query.providerKey != nullptr &&
+            (filter.providerKey == nullptr || *filter.providerKey != *query.providerKey))
+        {
+            return false;
+        }
+
+        if (query.sublayerKey != nullptr && filter.subLayerKey != *query.sublayerKey)
+        {
+            return false;
+        }
+
+        if (query.name != nullptr &&
+            (filter.displayData.name == nullptr || wcscmp(filter.displayData.name, query.name) != 0))
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    // Filters of one layer, scoped to the query provider by the engine.
+    class LayerFilterEnum : public PagedEnum<FWPM_FILTER0>
+    {
+    public:
+        LayerFilterEnum(Engine& engine, const GUID& layerKey, const FilterQuery& query): engine(engine)
+        {
+            this->enumTemplate.providerKey = const_cast<GUID*>(query.providerKey);
+            this->enumTemplate.layerKey = layerKey;
+            this->enumTemplate.enumType = FWP_FILTER_ENUM_OVERLAPPING;
+            this->enumTemplate.actionMask = 0xFFFFFFFF;
+        }
+
+        unsigned int open() override
+        {
+            return this->engine.createFilterEnumHandle(this->enumTemplate, this->enumHandle);
+        }
+
+        unsigned int nextPage(uint32_t pageSize, FWPM_FILTER0**& filters, uint32_t& filterCount) override
+        {
+            return this->engine.enumFilters(this->enumHandle, pageSize, filters, filterCount);
+        }
+
+        void freePage(FWPM_FILTER0**& filters) override
+        {
+            this->engine.freeFilters(filters);
+        }
+
+        void close() override
+        {
+            this->engine.destroyFilterEnumHandle(this->enumHandle);
+        }
+
+    private:
+        Engine& engine;
+        FWPM_FILTER_ENUM_TEMPLATE0 enumTemplate{};
+        HANDLE enumHandle{};
+    };
+
+    unsigned int enumLayerFilters(
+        Engine& engine,
+        const GUID& layerKey,
+        const FilterQuery& query,
+        const std::function<void(const FWPM_FILTER0&)>& callback)
+    {
+        LayerFilterEnum enumeration(engine, layerKey, query);
+
+        return forEachPagedObject<FWPM_FILTER0>(enumeration, EnumPageSize, [&](const FWPM_FILTER0& filter)
+        {
+            if (matchesQuery(filter, query))
+            {
+                callback(filter);
+            }
+        });
+    }
+
+    unsigned int forEachFilter(
+        Engine& engine,
+        const std::vector<GUID>& layerKeys,
+        const FilterQuery& query,
+        const std::function<void(const FWPM_FILTER0&)>& callback)
+    {
+        for (const auto& layerKey : layerKeys)
+        {
+            auto status = enumLayerFilters(engine, layerKey, query, callback);
+            if (status != ERROR_SUCCESS)
+            {
+                return status;
+            }
+        }
+
+        return ERROR_SUCCESS;
+    }
+
+    unsigned int collectFilterKeys(
+        Engine& engine,
+        const std::vector<GUID>& layerKeys,
+        const FilterQuery& query,
+        std::vector<GUID>& filterKeys)
+    {
+        return forEachFilter(engine, layerKeys, query, [&filterKeys](const FWPM_FILTER0& filter)
+        {
+            filterKeys.push_back(filter.filterKey);
+        });
+    }
+
+    unsigned int deleteFilters(Engine& engine, const std::vector<GUID>& filterKeys)
+    {
+        if (filterKeys.empty())
+        {
+            return ERROR_SUCCESS;
+        }
+
+        return transact(engine, [&]()
+        {
+            for (const auto& filterKey : filterKeys)
+            {
+                auto status = engine.deleteFilter(filterKey);
+                if (status != ERROR_SUCCESS && status != FWP_E_FILTER_NOT_FOUND)
+                {
+                    return status;
+                }
+            }
+
+            return static_cast<unsigned int>(ERROR_SUCCESS);
+        });
+    }
+}
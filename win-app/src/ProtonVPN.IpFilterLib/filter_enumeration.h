@@ -0,0 +1,43 @@
+#pragma once
+#include <fwptypes.h>
+#include <fwpmu.h>
+
+#include <vector>
+#include <functional>
+
+#include "engine.h"
+#include "enum_pager.h"
+
+namespace ipfilter
+{
+    const UINT32 EnumPageSize = 512;
+
+    struct FilterQuery
+    {
+        const GUID* providerKey;
+        const GUID* sublayerKey;
+        const wchar_t* name;
+    };
+
+    bool matchesQuery(const FWPM_FILTER0& filter, const FilterQuery& query);
+
+    // Visits every filter of the query provider on the given layers. Enumeration is
+    // scoped to the provider by the engine and fetched in pages of EnumPageSize,
+    // the remaining query fields are matched client side. Each layer's enumeration is
+    // closed before the next one starts, see forEachPagedObject.
+    unsigned int forEachFilter(
+        Engine& engine,
+        const std::vector<GUID>& layerKeys,
+        const FilterQuery& query,
+        const std::function<void(const FWPM_FILTER0&)>& callback);
+
+    unsigned int collectFilterKeys(
+        Engine& engine,
+        const std::vector<GUID>& layerKeys,
+        const FilterQuery& query,
+        std::vector<GUID>& filterKeys);
+
+    // Deletes filters collected with collectFilterKeys, whose enumerations are closed by then,
+    // so no filter is deleted while an enumeration handle is open.
+    unsigned int deleteFilters(Engine& engine, const std::vector<GUID>& filterKeys);
+}
@@ -72,7 +72,7 @@ namespace ipfilter
         this->conditions.push_back(condition);
     }
 
-    std::vector<condition::Condition> FilterSpecification::getConditions() const
+    const std::vector<condition::Condition>& FilterSpecification::getConditions() const
     {
         return this->conditions;
     }
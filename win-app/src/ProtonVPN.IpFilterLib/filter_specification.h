@@ -34,7 +34,7 @@ namespace ipfilter
 
         void addCondition(const condition::Condition& condition);
 
-        std::vector<condition::Condition> getConditions() const;
+        const std::vector<condition::Condition>& getConditions() const;
 
         FWP_VALUE0 getWeight() const;
 
@@ -1,7 +1,9 @@
 #include "pch.h"
 #include <cguid.h>
 #include "guid.h"
+#include "name_uuid.h"
 
+#include <cstring>
 #include <stdexcept>
 
 namespace ipfilter
@@ -30,5 +32,18 @@ namespace ipfilter
 
             return guid;
         }
+
+        GUID makeGuid(const GUID& namespaceKey, const std::vector<uint8_t>& name)
+        {
+            ruleset::Key key{};
+            std::memcpy(key.data(), &namespaceKey, key.size());
+
+            key = uuid::makeNameUuid(key, name.data(), name.size());
+
+            GUID guid{};
+            std::memcpy(&guid, key.data(), key.size());
+
+            return guid;
+        }
     }
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include <rpc.h>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace ipfilter
 {
@@ -9,5 +11,8 @@ namespace ipfilter
         GUID makeGuid(const GUID* value);
 
         GUID makeGuid();
+
+        // Name-based GUID, equal for equal names within the same namespace.
+        GUID makeGuid(const GUID& namespaceKey, const std::vector<uint8_t>& name);
     }
 }
@@ -1,8 +1,7 @@
-#include "pch.h"
-#include <ws2tcpip.h>
 #include <stdexcept>
 
 #include "ip.h"
+#include "ip_parser.h"
 
 namespace ipfilter
 {
@@ -58,19 +57,16 @@ namespace ipfilter
 
         AddressV4 makeAddressV4(const std::string& str)
         {
-            IN_ADDR addr{};
+            AddressV4 address{};
 
-            if (inet_pton(AF_INET, str.c_str(), &addr) != 1)
+            auto last = str.data() + str.size();
+            auto result = parseAddressV4(str.data(), last, address);
+            if (result.error != ParseError::None || result.ptr != last)
             {
                 throw std::invalid_argument("Invalid format");
             }
 
-            return AddressV4({
-                addr.S_un.S_un_b.s_b1,
-                addr.S_un.S_un_b.s_b2,
-                addr.S_un.S_un_b.s_b3,
-                addr.S_un.S_un_b.s_b4
-            });
+            return address;
         }
 
         AddressV6::AddressV6() :
@@ -160,22 +156,16 @@ namespace ipfilter
 
         AddressV6 makeAddressV6(const std::string& str, uint8_t prefix)
         {
-            struct in6_addr addr6 {};
-            int result = ::inet_pton(AF_INET6, str.c_str(), &addr6);
+            AddressV6 address{};
 
-            if (result == 0)
+            auto last = str.data() + str.size();
+            auto result = parseAddressV6(str.data(), last, address);
+            if (result.error != ParseError::None || result.ptr != last)
             {
                 throw std::invalid_argument("Invalid IPv6 string: " + str);
             }
-            else if (result < 0)
-            {
-                throw std::out_of_range("inet_pton(AF_INET6) failed");
-            }
-
-            AddressV6::BytesType bytes{};
-            std::copy(std::begin(addr6.s6_addr), std::end(addr6.s6_addr), bytes.begin());
 
-            return AddressV6(bytes, prefix);
+            return AddressV6(address.toBytes(), prefix);
         }
     }
 }
@@ -3,9 +3,18 @@
 #include "filter.h"
 #include "guid.h"
 #include "buffer.h"
+#include "engine.h"
+#include "filter_enumeration.h"
+#include "app_id_cache.h"
+#include "prefix_set.h"
+#include "prefix_table_builder.h"
+#include "provider_context_writer.h"
+#include "snapshot_capture.h"
+#include "../ProtonVPN.CalloutDriver/ProviderContext.h"
 
 #include <fwptypes.h>
 #include <fwpmu.h>
+#include <stdexcept>
 
 unsigned int IPFilterStartTransaction(IPFilterSessionHandle handle)
 {
@@ -165,6 +174,106 @@ unsigned int IPFilterCreateProviderContext(
     return result;
 }
 
+std::vector<uint8_t> IPFilterBuildRedirectContext(const IPFilterRedirectContext& redirectContext)
+{
+    ipfilter::ProviderContextWriter writer{};
+
+    if (redirectContext.bindAddressV4 != nullptr)
+    {
+        writer.addBindAddressV4(ipfilter::ip::makeAddressV4(redirectContext.bindAddressV4));
+    }
+
+    if (redirectContext.bindAddressV6 != nullptr)
+    {
+        writer.addBindAddressV6(ipfilter::ip::makeAddressV6(redirectContext.bindAddressV6, 128));
+    }
+
+    if (redirectContext.excludedNetworkCount > 0)
+    {
+        ipfilter::ip::PrefixTableBuilder excludedV4(4);
+        ipfilter::ip::PrefixTableBuilder excludedV6(16);
+        auto hasV4 = false;
+        auto hasV6 = false;
+
+        for (unsigned int i = 0; i < redirectContext.excludedNetworkCount; i++)
+        {
+            const auto& network = redirectContext.excludedNetworks[i];
+
+            if (network.isIpv6)
+            {
+                if (network.prefix < 0 || network.prefix > 128)
+                {
+                    throw std::invalid_argument("Invalid IPv6 prefix length");
+                }
+
+                excludedV6.add(ipfilter::ip::makeAddressV6(
+                    network.address,
+                    static_cast<uint8_t>(network.prefix)), 1);
+                hasV6 = true;
+                continue;
+            }
+
+            auto maskLength = ipfilter::ip::maskLength(ipfilter::ip::makeAddressV4(network.mask));
+            if (maskLength < 0)
+            {
+                throw std::invalid_argument("Network mask is not contiguous");
+            }
+
+            excludedV4.add(
+                ipfilter::ip::makeAddressV4(network.address),
+                static_cast<uint8_t>(maskLength),
+                1);
+            hasV4 = true;
+        }
+
+        if (hasV4)
+        {
+            writer.addExcludedPrefixesV4(excludedV4.build());
+        }
+
+        if (hasV6)
+        {
+            writer.addExcludedPrefixesV6(excludedV6.build());
+        }
+    }
+
+    switch (redirectContext.dnsPolicy)
+    {
+    case (unsigned int)IPFilterDnsPolicy::Unspecified:
+        break;
+    case (unsigned int)IPFilterDnsPolicy::SendServerFail:
+        writer.addDnsPolicy(PROVIDER_CONTEXT_DNS_SEND_SERVFAIL);
+        break;
+    case (unsigned int)IPFilterDnsPolicy::Drop:
+        writer.addDnsPolicy(0);
+        break;
+    default:
+        throw std::invalid_argument("Invalid DNS policy");
+    }
+
+    return writer.build();
+}
+
+unsigned int IPFilterCreateRedirectProviderContext(
+    IPFilterSessionHandle sessionHandle,
+    const IPFilterDisplayData* displayData,
+    GUID* providerKey,
+    const IPFilterRedirectContext* redirectContext,
+    BOOL persistent,
+    GUID* providerContextKey)
+{
+    auto data = IPFilterBuildRedirectContext(*redirectContext);
+
+    return IPFilterCreateProviderContext(
+        sessionHandle,
+        displayData,
+        providerKey,
+        static_cast<unsigned int>(data.size()),
+        data.data(),
+        persistent,
+        providerContextKey);
+}
+
 unsigned int IPFilterDestroyProviderContext(
     IPFilterSessionHandle sessionHandle,
     GUID* providerContextKey)
@@ -253,6 +362,23 @@ unsigned int IPFilterCreateSublayer(
     return result;
 }
 
+unsigned int IPFilterCreateNameGuid(
+    GUID* namespaceKey,
+    const wchar_t* name,
+    GUID* guid)
+{
+    std::vector<uint8_t> bytes{};
+    for (auto p = name; *p != L'\0'; p++)
+    {
+        bytes.push_back(static_cast<uint8_t>(*p));
+        bytes.push_back(static_cast<uint8_t>(*p >> 8));
+    }
+
+    *guid = ipfilter::guid::makeGuid(*namespaceKey, bytes);
+
+    return ERROR_SUCCESS;
+}
+
 unsigned int IPFilterDestroySublayer(
     IPFilterSessionHandle sessionHandle,
     GUID* subLayerKey)
@@ -279,49 +405,13 @@ unsigned int IPFilterGetSublayerFilterCount(
     GUID* sublayerKey,
     unsigned int* result)
 {
-    HANDLE enumHandle = nullptr;
-
-    auto status = FwpmFilterCreateEnumHandle(sessionHandle,
-        nullptr,
-        &enumHandle);
-    if (status != ERROR_SUCCESS)
-    {
-        return status;
-    }
+    ipfilter::SessionEngine engine(sessionHandle);
+    ipfilter::FilterQuery query{providerKey, sublayerKey, nullptr};
 
-    while (true)
+    return ipfilter::forEachFilter(engine, IPFilterGetLayerKeys(), query, [result](const FWPM_FILTER0&)
     {
-        FWPM_FILTER** filters{};
-        UINT32 filterCount{};
-
-        status = FwpmFilterEnum(sessionHandle, enumHandle, 1, &filters, &filterCount);
-        if (status != ERROR_SUCCESS || filterCount == 0)
-        {
-            break;
-        }
-
-        for (UINT32 i = 0; i < filterCount; i++)
-        {
-            FWPM_FILTER* filter = filters[i];
-            if (filter->providerKey == nullptr || *filter->providerKey != *providerKey)
-            {
-                continue;
-            }
-
-            if (filter->subLayerKey != *sublayerKey)
-            {
-                continue;
-            }
-
-            (*result)++;
-        }
-
-        FwpmFreeMemory(reinterpret_cast<void**>(&filters));
-    }
-
-    FwpmFilterDestroyEnumHandle(sessionHandle, enumHandle);
-
-    return status;
+        (*result)++;
+    });
 }
 
 unsigned int IPFilterDestroySublayerFilters(
@@ -329,53 +419,17 @@ unsigned int IPFilterDestroySublayerFilters(
     GUID* providerKey,
     GUID* sublayerKey)
 {
-    HANDLE enumHandle = nullptr;
-    
-    auto status = FwpmFilterCreateEnumHandle(sessionHandle,
-        nullptr,
-        &enumHandle);
+    ipfilter::SessionEngine engine(sessionHandle);
+    ipfilter::FilterQuery query{providerKey, sublayerKey, nullptr};
+
+    std::vector<GUID> filterKeys{};
+    auto status = ipfilter::collectFilterKeys(engine, IPFilterGetLayerKeys(), query, filterKeys);
     if (status != ERROR_SUCCESS)
     {
         return status;
     }
 
-    while (true)
-    {
-        FWPM_FILTER** filters{};
-        UINT32 filterCount{};
-
-        status = FwpmFilterEnum(sessionHandle, enumHandle, 1, &filters, &filterCount);
-        if (status != ERROR_SUCCESS || filterCount == 0)
-        {
-            break;
-        }
-
-        for (UINT32 i = 0; i < filterCount; i++)
-        {
-            FWPM_FILTER* filter = filters[i];
-            if (filter->providerKey == nullptr || *filter->providerKey != *providerKey)
-            {
-                continue;
-            }
-
-            if (filter->subLayerKey != *sublayerKey)
-            {
-                continue;
-            }
-
-            status = IPFilterDestroyFilter(sessionHandle, &filter->filterKey);
-            if (status != ERROR_SUCCESS)
-            {
-                break;
-            }
-        }
-
-        FwpmFreeMemory(reinterpret_cast<void**>(&filters));
-    }
-
-    FwpmFilterDestroyEnumHandle(sessionHandle, enumHandle);
-
-    return status;
+    return ipfilter::deleteFilters(engine, filterKeys);
 }
 
 unsigned int IPFilterDestroySublayerFiltersByName(
@@ -384,58 +438,17 @@ unsigned int IPFilterDestroySublayerFiltersByName(
     GUID* sublayerKey,
     const wchar_t* name)
 {
-    HANDLE enumHandle = nullptr;
+    ipfilter::SessionEngine engine(sessionHandle);
+    ipfilter::FilterQuery query{providerKey, sublayerKey, name};
 
-    auto status = FwpmFilterCreateEnumHandle(sessionHandle,
-        nullptr,
-        &enumHandle);
+    std::vector<GUID> filterKeys{};
+    auto status = ipfilter::collectFilterKeys(engine, IPFilterGetLayerKeys(), query, filterKeys);
     if (status != ERROR_SUCCESS)
     {
         return status;
     }
 
-    while (true)
-    {
-        FWPM_FILTER** filters{};
-        UINT32 filterCount{};
-
-        status = FwpmFilterEnum(sessionHandle, enumHandle, 1, &filters, &filterCount);
-        if (status != ERROR_SUCCESS || filterCount == 0)
-        {
-            break;
-        }
-
-        for (UINT32 i = 0; i < filterCount; i++)
-        {
-            FWPM_FILTER* filter = filters[i];
-            if (filter->providerKey == nullptr || *filter->providerKey != *providerKey)
-            {
-                continue;
-            }
-
-            if (filter->subLayerKey != *sublayerKey)
-            {
-                continue;
-            }
-
-            if (wcscmp(filter->displayData.name, name) != 0)
-            {
-                continue;
-            }
-
-            status = IPFilterDestroyFilter(sessionHandle, &filter->filterKey);
-            if (status != ERROR_SUCCESS)
-            {
-                break;
-            }
-        }
-
-        FwpmFreeMemory(reinterpret_cast<void**>(&filters));
-    }
-
-    FwpmFilterDestroyEnumHandle(sessionHandle, enumHandle);
-
-    return status;
+    return ipfilter::deleteFilters(engine, filterKeys);
 }
 
 unsigned int IPFilterDestroyCallouts(IPFilterSessionHandle sessionHandle, GUID* providerKey)
@@ -459,7 +472,7 @@ unsigned int IPFilterDestroyCallouts(IPFilterSessionHandle sessionHandle, GUID*
         FWPM_CALLOUT** callouts{};
         UINT32 calloutCount{};
 
-        status = FwpmCalloutEnum(sessionHandle, enumHandle, 1, &callouts, &calloutCount);
+        status = FwpmCalloutEnum(sessionHandle, enumHandle, ipfilter::EnumPageSize, &callouts, &calloutCount);
         if (status != ERROR_SUCCESS || calloutCount == 0)
         {
             break;
@@ -589,4 +602,70 @@ unsigned int IPFilterDoesCalloutExist(
     }
 
     return status;
+}
+
+// Each call captures the installed objects again. A size returned with ERROR_INSUFFICIENT_BUFFER
+// may be too small for the next call if objects are added in between, callers retry until
+// the snapshot fits.
+unsigned int IPFilterSnapshot(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    unsigned char* buffer,
+    unsigned int* size)
+{
+    ipfilter::snapshot::Snapshot snapshot{};
+
+    auto status = ipfilter::captureSnapshot(sessionHandle, *providerKey, snapshot);
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    auto data = ipfilter::snapshot::encode(snapshot);
+    if (buffer == nullptr || *size < data.size())
+    {
+        *size = static_cast<unsigned int>(data.size());
+        return ERROR_INSUFFICIENT_BUFFER;
+    }
+
+    memcpy(buffer, data.data(), data.size());
+    *size = static_cast<unsigned int>(data.size());
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterRestoreSnapshot(
+    IPFilterSessionHandle sessionHandle,
+    const unsigned char* buffer,
+    unsigned int size)
+{
+    try
+    {
+        auto snapshot = ipfilter::snapshot::decode(buffer, size);
+
+        return ipfilter::restoreSnapshot(sessionHandle, snapshot);
+    }
+    catch (const std::invalid_argument&)
+    {
+        return ERROR_INVALID_DATA;
+    }
+}
+
+unsigned int IPFilterGetAppIdCacheStatistics(
+    unsigned long long* hits,
+    unsigned long long* misses)
+{
+    auto& cache = ipfilter::getAppIdCache();
+
+    *hits = cache.hits();
+    *misses = cache.misses();
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterClearAppIdCache()
+{
+    ipfilter::getAppIdCache().clear();
+
+    return ERROR_SUCCESS;
 }
\ No newline at end of file
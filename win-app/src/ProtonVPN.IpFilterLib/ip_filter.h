@@ -6,6 +6,12 @@
 
 typedef void* IPFilterSessionHandle;
 
+typedef void* IPFilterRulesetHandle;
+
+typedef void* IPFilterApplyQueueHandle;
+
+typedef void (CALLBACK* IPFilterApplyCallback)(void* context, unsigned int result);
+
 #define CUSTOM_ERROR_CODE(x) (x <= 0 ? x : ((x & 0x0000FFFF) | (FACILITY_ITF << 16) | 0x80000000))
 
 const unsigned int E_ADAPTER_NOT_FOUND = CUSTOM_ERROR_CODE(0x0200);
@@ -21,6 +27,8 @@ enum class IPFilterLayer : unsigned int
     AppConnectRedirectV4 = 6,
     OutboundIPPacketV4 = 7,
     AppAuthRecvAcceptV6 = 8,
+    AppConnectRedirectV6 = 9,
+    OutboundIPPacketV6 = 10,
 };
 
 enum class IPFilterAction : unsigned int
@@ -46,6 +54,64 @@ struct IPFilterNetworkAddress
     bool isIpv6;
 };
 
+enum class IPFilterConditionType : unsigned int
+{
+    RemoteIPv4Address = 0,
+    RemoteNetworkAddress = 1,
+    ApplicationId = 2,
+    TcpProtocol = 3,
+    UdpProtocol = 4,
+    RemotePort = 5,
+    LocalPort = 6,
+    Loopback = 7,
+    NetInterface = 8,
+    NetInterfaceIndex = 9,
+};
+
+enum class IPFilterMatch : unsigned int
+{
+    Equal = 0,
+    NotEqual = 1,
+};
+
+struct IPFilterCondition
+{
+    unsigned int type;
+    unsigned int match;
+    const char* address;
+    const IPFilterNetworkAddress* networkAddress;
+    const wchar_t* path;
+    unsigned int value;
+};
+
+struct IPFilterDescriptor
+{
+    const IPFilterDisplayData* displayData;
+    unsigned int layer;
+    unsigned int action;
+    unsigned int weight;
+    GUID* calloutKey;
+    GUID* providerContextKey;
+    unsigned int conditionCount;
+    const IPFilterCondition* conditions;
+};
+
+enum class IPFilterDnsPolicy : unsigned int
+{
+    Unspecified = 0,
+    SendServerFail = 1,
+    Drop = 2,
+};
+
+struct IPFilterRedirectContext
+{
+    const char* bindAddressV4;
+    const char* bindAddressV6;
+    unsigned int excludedNetworkCount;
+    const IPFilterNetworkAddress* excludedNetworks;
+    unsigned int dnsPolicy;
+};
+
 unsigned int IPFilterCreateDynamicSession(
     IPFilterSessionHandle * handle);
 
@@ -88,6 +154,14 @@ unsigned int IPFilterCreateProviderContext(
     BOOL persistent,
     GUID * providerContextKey);
 
+unsigned int IPFilterCreateRedirectProviderContext(
+    IPFilterSessionHandle sessionHandle,
+    const IPFilterDisplayData * displayData,
+    GUID * providerKey,
+    const IPFilterRedirectContext * redirectContext,
+    BOOL persistent,
+    GUID * providerContextKey);
+
 unsigned int IPFilterDestroyProviderContext(
     IPFilterSessionHandle sessionHandle,
     GUID * providerContextKey);
@@ -108,6 +182,11 @@ unsigned int IPFilterCreateSublayer(
     BOOL persistent,
     GUID * sublayerKey);
 
+unsigned int IPFilterCreateNameGuid(
+    GUID * namespaceKey,
+    const wchar_t * name,
+    GUID * guid);
+
 unsigned int IPFilterDestroySublayer(
     IPFilterSessionHandle sessionHandle,
     GUID * subLayerKey);
@@ -240,6 +319,23 @@ unsigned int IPFilterCreateRemoteNetworkIPFilter(
     BOOL persistent,
     GUID * filterKey);
 
+unsigned int IPFilterCreateRemoteNetworkIPFilters(
+    IPFilterSessionHandle sessionHandle,
+    GUID * providerKey,
+    GUID * sublayerKey,
+    const IPFilterDisplayData * displayData,
+    unsigned int layer,
+    unsigned int action,
+    unsigned int weight,
+    GUID * calloutKey,
+    GUID * providerContextKey,
+    unsigned int addrCount,
+    const IPFilterNetworkAddress * addrs,
+    BOOL coalesce,
+    BOOL persistent,
+    GUID * filterKeys,
+    unsigned int * filterCount);
+
 unsigned int IPFilterCreateNetInterfaceFilter(
     IPFilterSessionHandle sessionHandle,
     GUID * providerKey,
@@ -263,6 +359,90 @@ unsigned int IPFilterCreateLoopbackFilter(
     BOOL persistent,
     GUID * filterKey);
 
+unsigned int IPFilterCreateFiltersBatch(
+    IPFilterSessionHandle sessionHandle,
+    GUID * providerKey,
+    GUID * sublayerKey,
+    unsigned int filterCount,
+    const IPFilterDescriptor * filters,
+    BOOL persistent,
+    GUID * filterKeys);
+
+unsigned int IPFilterGetRuleFilterKey(
+    GUID * sublayerKey,
+    const IPFilterDescriptor * rule,
+    GUID * filterKey);
+
+unsigned int IPFilterCreateRuleset(
+    IPFilterRulesetHandle * handle);
+
+unsigned int IPFilterDestroyRuleset(
+    IPFilterRulesetHandle handle);
+
+unsigned int IPFilterAddRulesetRule(
+    IPFilterRulesetHandle handle,
+    const IPFilterDescriptor * rule);
+
+unsigned int IPFilterClearRuleset(
+    IPFilterRulesetHandle handle);
+
+unsigned int IPFilterApplyRuleset(
+    IPFilterSessionHandle sessionHandle,
+    GUID * providerKey,
+    GUID * sublayerKey,
+    IPFilterRulesetHandle handle,
+    BOOL persistent);
+
+unsigned int IPFilterReconcileRuleset(
+    IPFilterSessionHandle sessionHandle,
+    GUID * providerKey,
+    GUID * sublayerKey,
+    IPFilterRulesetHandle handle,
+    BOOL persistent);
+
+unsigned int IPFilterCreateApplyQueue(
+    BOOL dynamicSession,
+    unsigned int maxCoalescedBatches,
+    IPFilterApplyQueueHandle * handle);
+
+unsigned int IPFilterDestroyApplyQueue(
+    IPFilterApplyQueueHandle handle);
+
+unsigned int IPFilterSubmitFilters(
+    IPFilterApplyQueueHandle handle,
+    GUID * providerKey,
+    GUID * sublayerKey,
+    unsigned int filterCount,
+    const IPFilterDescriptor * filters,
+    BOOL persistent,
+    IPFilterApplyCallback callback,
+    void * context);
+
+unsigned int IPFilterFlushApplyQueue(
+    IPFilterApplyQueueHandle handle);
+
+unsigned int IPFilterGetApplyQueueStatistics(
+    IPFilterApplyQueueHandle handle,
+    unsigned long long * batches,
+    unsigned long long * transactions);
+
+unsigned int IPFilterSnapshot(
+    IPFilterSessionHandle sessionHandle,
+    GUID * providerKey,
+    unsigned char * buffer,
+    unsigned int * size);
+
+unsigned int IPFilterRestoreSnapshot(
+    IPFilterSessionHandle sessionHandle,
+    const unsigned char * buffer,
+    unsigned int size);
+
+unsigned int IPFilterGetAppIdCacheStatistics(
+    unsigned long long * hits,
+    unsigned long long * misses);
+
+unsigned int IPFilterClearAppIdCache();
+
 unsigned int BlockOutsideDns(
     IPFilterSessionHandle sessionHandle,
     GUID * providerKey,
@@ -0,0 +1,447 @@
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IPFILTER_PARSER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "ip_parser.h"
+
+namespace ipfilter
+{
+    namespace ip
+    {
+        namespace
+        {
+            ParseResult failure(const char* first, ParseError error = ParseError::InvalidFormat)
+            {
+                return ParseResult{first, error};
+            }
+
+            bool isDigit(char c)
+            {
+                return c >= '0' && c <= '9';
+            }
+
+            int hexValue(char c)
+            {
+                if (c >= '0' && c <= '9')
+                {
+                    return c - '0';
+                }
+                if (c >= 'a' && c <= 'f')
+                {
+                    return c - 'a' + 10;
+                }
+                if (c >= 'A' && c <= 'F')
+                {
+                    return c - 'A' + 10;
+                }
+                return -1;
+            }
+
+            // Decimal number of up to three digits without leading zeros.
+            const char* parseDecimal(const char* first, const char* last, unsigned int max, unsigned int& value)
+            {
+                auto p = first;
+                value = 0;
+
+                while (p != last && isDigit(*p) && p - first < 3)
+                {
+                    value = value * 10 + (*p - '0');
+                    p++;
+                }
+
+                if (p == first || (p - first > 1 && *first == '0') || value > max)
+                {
+                    return nullptr;
+                }
+
+                if (p != last && isDigit(*p))
+                {
+                    return nullptr;
+                }
+
+                return p;
+            }
+
+            const char* parseBytesV4(const char* first, const char* last, unsigned char* bytes)
+            {
+                auto p = first;
+
+                for (int i = 0; i < 4; i++)
+                {
+                    if (i > 0)
+                    {
+                        if (p == last || *p != '.')
+                        {
+                            return nullptr;
+                        }
+                        p++;
+                    }
+
+                    unsigned int value = 0;
+                    p = parseDecimal(p, last, 255, value);
+                    if (p == nullptr)
+                    {
+                        return nullptr;
+                    }
+
+                    bytes[i] = static_cast<unsigned char>(value);
+                }
+
+                return p;
+            }
+
+            const char* parseBytesV6(const char* first, const char* last, unsigned char* bytes)
+            {
+                uint16_t groups[8]{};
+                int count = 0;
+                int compressed = -1;
+                auto p = first;
+
+                if (last - p >= 2 && p[0] == ':' && p[1] == ':')
+                {
+                    compressed = 0;
+                    p += 2;
+                }
+
+                auto expectGroup = compressed < 0;
+
+                while (count < 8)
+                {
+                    auto groupStart = p;
+                    unsigned int value = 0;
+                    int digits = 0;
+
+                    while (p != last && digits < 5 && hexValue(*p) >= 0)
+                    {
+                        value = (value << 4) | static_cast<unsigned int>(hexValue(*p));
+                        digits++;
+                        p++;
+                    }
+
+                    if (p != last && *p == '.' && count <= 6)
+                    {
+                        unsigned char tail[4]{};
+                        p = parseBytesV4(groupStart, last, tail);
+                        if (p == nullptr)
+                        {
+                            return nullptr;
+                        }
+
+                        groups[count++] = static_cast<uint16_t>((tail[0] << 8) | tail[1]);
+                        groups[count++] = static_cast<uint16_t>((tail[2] << 8) | tail[3]);
+                        expectGroup = false;
+                        break;
+                    }
+
+                    if (digits == 0)
+                    {
+                        if (expectGroup)
+                        {
+                            return nullptr;
+                        }
+                        break;
+                    }
+
+                    if (digits > 4)
+                    {
+                        return nullptr;
+                    }
+
+                    groups[count++] = static_cast<uint16_t>(value);
+                    expectGroup = false;
+
+                    if (p == last || *p != ':')
+                    {
+                        break;
+                    }
+
+                    if (last - p >= 2 && p[1] == ':')
+                    {
+                        if (compressed >= 0)
+                        {
+                            return nullptr;
+                        }
+
+                        compressed = count;
+                        p += 2;
+                        continue;
+                    }
+
+                    if (count == 8)
+                    {
+                        return nullptr;
+                    }
+
+                    p++;
+                    expectGroup = true;
+                }
+
+                if (expectGroup)
+                {
+                    return nullptr;
+                }
+
+                if (compressed < 0)
+                {
+                    if (count != 8)
+                    {
+                        return nullptr;
+                    }
+                }
+                else
+                {
+                    if (count == 8)
+                    {
+                        return nullptr;
+                    }
+
+                    auto moved = count - compressed;
+                    for (int i = 0; i < moved; i++)
+                    {
+                        groups[7 - i] = groups[count - 1 - i];
+                    }
+                    for (int i = compressed; i < 8 - moved; i++)
+                    {
+                        groups[i] = 0;
+                    }
+                }
+
+                for (int i = 0; i < 8; i++)
+                {
+                    bytes[i * 2] = static_cast<unsigned char>(groups[i] >> 8);
+                    bytes[i * 2 + 1] = static_cast<unsigned char>(groups[i]);
+                }
+
+                return p;
+            }
+
+            ParseResult parsePrefix(const char* first, const char* p, const char* last, unsigned int max, uint8_t& prefix)
+            {
+                prefix = static_cast<uint8_t>(max);
+
+                if (p == last || *p != '/')
+                {
+                    return ParseResult{p, ParseError::None};
+                }
+
+                unsigned int value = 0;
+                auto end = parseDecimal(p + 1, last, 999, value);
+                if (end == nullptr)
+                {
+                    return failure(first);
+                }
+
+                if (value > max)
+                {
+                    return failure(first, ParseError::PrefixOutOfRange);
+                }
+
+                prefix = static_cast<uint8_t>(value);
+
+                return ParseResult{end, ParseError::None};
+            }
+
+#ifdef IPFILTER_PARSER_SSE2
+            unsigned int lowestBit(unsigned int mask)
+            {
+#ifdef _MSC_VER
+                unsigned long index = 0;
+                _BitScanForward(&index, mask);
+                return static_cast<unsigned int>(index);
+#else
+                return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+            }
+
+            // Classifies all characters of a short address at once: every character must be
+            // a digit or a dot, and the dot positions give the boundaries of the four octets.
+            ParseError parseAddressV4Sse2(const char* str, size_t length, unsigned char* bytes)
+            {
+                alignas(16) char buffer[16]{};
+                std::memcpy(buffer, str, length);
+
+                auto chars = _mm_load_si128(reinterpret_cast<const __m128i*>(buffer));
+                auto digits = _mm_and_si128(
+                    _mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                    _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+                auto dots = _mm_cmpeq_epi8(chars, _mm_set1_epi8('.'));
+
+                auto lengthMask = (1u << length) - 1;
+                auto validMask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(digits, dots)));
+                auto dotMask = static_cast<unsigned int>(_mm_movemask_epi8(dots)) & lengthMask;
+
+                if ((validMask & lengthMask) != lengthMask)
+                {
+                    return ParseError::InvalidFormat;
+                }
+
+                unsigned int ends[4]{};
+                for (int i = 0; i < 3; i++)
+                {
+                    if (dotMask == 0)
+                    {
+                        return ParseError::InvalidFormat;
+                    }
+
+                    ends[i] = lowestBit(dotMask);
+                    dotMask &= dotMask - 1;
+                }
+
+                if (dotMask != 0)
+                {
+                    return ParseError::InvalidFormat;
+                }
+
+                ends[3] = static_cast<unsigned int>(length);
+
+                unsigned int start = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    auto end = ends[i];
+                    auto fieldLength = end - start;
+                    if (fieldLength - 1 > 2 || (fieldLength > 1 && buffer[start] == '0'))
+                    {
+                        return ParseError::InvalidFormat;
+                    }
+
+                    unsigned int ones = static_cast<unsigned int>(buffer[end - 1] - '0');
+                    unsigned int tens = fieldLength > 1 ? static_cast<unsigned int>(buffer[end - 2] - '0') : 0;
+                    unsigned int hundreds = fieldLength > 2 ? static_cast<unsigned int>(buffer[end - 3] - '0') : 0;
+                    auto value = hundreds * 100 + tens * 10 + ones;
+                    if (value > 255)
+                    {
+                        return ParseError::InvalidFormat;
+                    }
+
+                    bytes[i] = static_cast<unsigned char>(value);
+                    start = end + 1;
+                }
+
+                return ParseError::None;
+            }
+#endif
+        }
+
+        ParseResult parseAddressV4(const char* first, const char* last, AddressV4& address)
+        {
+            AddressV4::BytesType bytes{};
+
+            auto p = parseBytesV4(first, last, bytes.data());
+            if (p == nullptr)
+            {
+                return failure(first);
+            }
+
+            address = AddressV4(bytes);
+
+            return ParseResult{p, ParseError::None};
+        }
+
+        ParseResult parseAddressV6(const char* first, const char* last, AddressV6& address)
+        {
+            AddressV6::BytesType bytes{};
+
+            auto p = parseBytesV6(first, last, bytes.data());
+            if (p == nullptr)
+            {
+                return failure(first);
+            }
+
+            address = AddressV6(bytes);
+
+            return ParseResult{p, ParseError::None};
+        }
+
+        ParseResult parseNetworkV4(const char* first, const char* last, AddressV4& address, uint8_t& prefix)
+        {
+            AddressV4 parsed{};
+
+            auto result = parseAddressV4(first, last, parsed);
+            if (result.error != ParseError::None)
+            {
+                return result;
+            }
+
+            result = parsePrefix(first, result.ptr, last, 32, prefix);
+            if (result.error == ParseError::None)
+            {
+                address = parsed;
+            }
+
+            return result;
+        }
+
+        ParseResult parseNetworkV6(const char* first, const char* last, AddressV6& address)
+        {
+            AddressV6::BytesType bytes{};
+
+            auto p = parseBytesV6(first, last, bytes.data());
+            if (p == nullptr)
+            {
+                return failure(first);
+            }
+
+            uint8_t prefix = 0;
+            auto result = parsePrefix(first, p, last, 128, prefix);
+            if (result.error == ParseError::None)
+            {
+                address = AddressV6(bytes, prefix);
+            }
+
+            return result;
+        }
+
+        size_t parseAddressesV4(
+            const char* const* strings,
+            size_t count,
+            AddressV4* addresses,
+            ParseError* errors)
+        {
+            size_t parsed = 0;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                auto length = std::strlen(strings[i]);
+                auto error = ParseError::InvalidFormat;
+
+#ifdef IPFILTER_PARSER_SSE2
+                if (length >= 7 && length <= 15)
+                {
+                    AddressV4::BytesType bytes{};
+                    error = parseAddressV4Sse2(strings[i], length, bytes.data());
+                    if (error == ParseError::None)
+                    {
+                        addresses[i] = AddressV4(bytes);
+                    }
+                }
+#else
+                AddressV4 address{};
+                auto result = parseAddressV4(strings[i], strings[i] + length, address);
+                if (result.error == ParseError::None && result.ptr == strings[i] + length)
+                {
+                    addresses[i] = address;
+                    error = ParseError::None;
+                }
+#endif
+
+                if (error == ParseError::None)
+                {
+                    parsed++;
+                }
+
+                if (errors != nullptr)
+                {
+                    errors[i] = error;
+                }
+            }
+
+            return parsed;
+        }
+    }
+}
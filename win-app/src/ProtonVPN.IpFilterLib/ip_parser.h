@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "ip.h"
+
+namespace ipfilter
+{
+    namespace ip
+    {
+        enum class ParseError
+        {
+            None,
+            InvalidFormat,
+            PrefixOutOfRange
+        };
+
+        // Result of a parse in the style of std::from_chars. On success ptr points to the first
+        // character that is not part of the address, on failure it is equal to the input start.
+        struct ParseResult
+        {
+            const char* ptr;
+            ParseError error;
+        };
+
+        // Dotted decimal IPv4 address, e.g. "10.0.0.1". Leading zeros are rejected.
+        ParseResult parseAddressV4(const char* first, const char* last, AddressV4& address);
+
+        // IPv6 address in any RFC 4291 text form, including an embedded IPv4 suffix.
+        ParseResult parseAddressV6(const char* first, const char* last, AddressV6& address);
+
+        // IPv4 address with an optional "/prefix" suffix, the prefix defaults to 32.
+        ParseResult parseNetworkV4(const char* first, const char* last, AddressV4& address, uint8_t& prefix);
+
+        // IPv6 address with an optional "/prefix" suffix stored as the address prefix.
+        ParseResult parseNetworkV6(const char* first, const char* last, AddressV6& address);
+
+        // Parses an array of null terminated IPv4 address strings. Each string must contain
+        // nothing but the address. Returns the number of strings parsed successfully,
+        // errors receives the result of every string and may be null.
+        size_t parseAddressesV4(
+            const char* const* strings,
+            size_t count,
+            AddressV4* addresses,
+            ParseError* errors);
+    }
+}
@@ -0,0 +1,155 @@
+#include "name_uuid.h"
+
+#include <algorithm>
+
+namespace ipfilter
+{
+    namespace uuid
+    {
+        const uint8_t Version = 5;
+
+        uint32_t rotateLeft(uint32_t value, int bits)
+        {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        void sha1Block(uint32_t state[5], const uint8_t* block)
+        {
+            uint32_t w[80];
+            for (int i = 0; i < 16; i++)
+            {
+                w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) |
+                    (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+                    (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+                    static_cast<uint32_t>(block[i * 4 + 3]);
+            }
+            for (int i = 16; i < 80; i++)
+            {
+                w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            auto a = state[0];
+            auto b = state[1];
+            auto c = state[2];
+            auto d = state[3];
+            auto e = state[4];
+
+            for (int i = 0; i < 80; i++)
+            {
+                uint32_t f;
+                uint32_t k;
+                if (i < 20)
+                {
+                    f = (b & c) | (~b & d);
+                    k = 0x5a827999;
+                }
+                else if (i < 40)
+                {
+                    f = b ^ c ^ d;
+                    k = 0x6ed9eba1;
+                }
+                else if (i < 60)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8f1bbcdc;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    k = 0xca62c1d6;
+                }
+
+                auto temp = rotateLeft(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rotateLeft(b, 30);
+                b = a;
+                a = temp;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+
+        Sha1Digest sha1(const uint8_t* data, size_t size)
+        {
+            uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+            size_t offset = 0;
+            for (; size - offset >= 64; offset += 64)
+            {
+                sha1Block(state, data + offset);
+            }
+
+            // The last block holds the remaining bytes, a one bit and the message length in bits,
+            // spilling into a second block when the length does not fit.
+            uint8_t tail[128]{};
+            auto remaining = size - offset;
+            std::copy(data + offset, data + size, tail);
+            tail[remaining] = 0x80;
+
+            size_t tailSize = remaining < 56 ? 64 : 128;
+            auto bits = static_cast<uint64_t>(size) * 8;
+            for (int i = 0; i < 8; i++)
+            {
+                tail[tailSize - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+            }
+
+            for (size_t i = 0; i < tailSize; i += 64)
+            {
+                sha1Block(state, tail + i);
+            }
+
+            Sha1Digest digest{};
+            for (int i = 0; i < 5; i++)
+            {
+                digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+                digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+                digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+                digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+            }
+
+            return digest;
+        }
+
+        // Converts between the GUID memory layout and the network byte order of RFC 4122,
+        // which differ in the byte order of the first three fields. The conversion is its own inverse.
+        ruleset::Key swapFields(const ruleset::Key& key)
+        {
+            auto result = key;
+
+            std::reverse(result.begin(), result.begin() + 4);
+            std::reverse(result.begin() + 4, result.begin() + 6);
+            std::reverse(result.begin() + 6, result.begin() + 8);
+
+            return result;
+        }
+
+        ruleset::Key makeNameUuid(const ruleset::Key& namespaceKey, const uint8_t* name, size_t size)
+        {
+            auto namespaceBytes = swapFields(namespaceKey);
+
+            std::vector<uint8_t> input(namespaceBytes.begin(), namespaceBytes.end());
+            input.insert(input.end(), name, name + size);
+
+            auto digest = sha1(input.data(), input.size());
+
+            ruleset::Key result{};
+            std::copy(digest.begin(), digest.begin() + result.size(), result.begin());
+            result[6] = static_cast<uint8_t>((result[6] & 0x0f) | (Version << 4));
+            result[8] = static_cast<uint8_t>((result[8] & 0x3f) | 0x80);
+
+            return swapFields(result);
+        }
+
+        ruleset::Key makeRuleUuid(const ruleset::Key& namespaceKey, const ruleset::Rule& rule)
+        {
+            auto name = ruleset::encodeRule(rule);
+
+            return makeNameUuid(namespaceKey, name.data(), name.size());
+        }
+    }
+}
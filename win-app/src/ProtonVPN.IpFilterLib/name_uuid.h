@@ -0,0 +1,24 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "ruleset.h"
+
+namespace ipfilter
+{
+    namespace uuid
+    {
+        typedef std::array<uint8_t, 20> Sha1Digest;
+
+        Sha1Digest sha1(const uint8_t* data, size_t size);
+
+        // Name-based UUID version 5 as defined in RFC 4122. Keys are in the memory layout
+        // of a GUID, with the first three fields in little endian byte order.
+        ruleset::Key makeNameUuid(const ruleset::Key& namespaceKey, const uint8_t* name, size_t size);
+
+        // Identical rules in the same namespace map to the same key.
+        ruleset::Key makeRuleUuid(const ruleset::Key& namespaceKey, const ruleset::Rule& rule);
+    }
+}
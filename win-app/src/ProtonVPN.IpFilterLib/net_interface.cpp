@@ -1,11 +1,8 @@
 #include "pch.h"
-#include <winsock2.h>
-#include <iphlpapi.h>
-#include <algorithm>
 #include <stdexcept>
 
 #include "net_interface.h"
-#include "buffer.h"
+#include "SystemAdapterTable.h"
 
 namespace ipfilter
 {
@@ -29,48 +26,31 @@ namespace ipfilter
         return this->index;
     }
 
-    std::vector<NetInterface> getNetworkInterfaces()
+    NetInterfaceTable getNetworkInterfaces()
     {
-        ULONG family = AF_UNSPEC;
+        NetInterfaceTable interfaces{};
 
-        ULONG size = 0;
-        GetAdaptersAddresses(family, 0, nullptr, nullptr, &size);
-
-        Buffer buffer(size);
-
-        auto res = GetAdaptersAddresses(
-            family,
-            0,
-            nullptr,
-            buffer.as<IP_ADAPTER_ADDRESSES_LH>(),
-            &size);
-        if (res != ERROR_SUCCESS)
+        if (Proton::NetworkUtil::ReadAdapterTable(interfaces) != ERROR_SUCCESS)
         {
             throw std::runtime_error("Failed to get network interfaces");
         }
 
-        std::vector<NetInterface> ifaces;
+        return interfaces;
+    }
 
-        auto address = buffer.as<IP_ADAPTER_ADDRESSES_LH>();
-        while (address)
+    bool findNetworkInterfaceByIndex(
+        const NetInterfaceTable& interfaces,
+        ULONG index,
+        NetInterface& result)
+    {
+        auto adapter = interfaces.findByIndex(index);
+        if (adapter == nullptr)
         {
-            ifaces.push_back(NetInterface(address->AdapterName, address->Luid.Value, address->IfIndex));
-            address = address->Next;
+            return false;
         }
 
-        return ifaces;
-    }
+        result = NetInterface(adapter->name, adapter->luid, adapter->index);
 
-    std::vector<NetInterface>::iterator findNetworkInterfaceByIndex(
-        std::vector<NetInterface>& interfaces,
-        ULONG index)
-    {
-        return std::find_if(
-            interfaces.begin(),
-            interfaces.end(),
-            [&index](const auto& netInterface)
-            {
-                return netInterface.getIndex() == index;
-            });
+        return true;
     }
 }
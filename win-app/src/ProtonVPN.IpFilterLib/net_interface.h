@@ -3,11 +3,15 @@
 #include <vector>
 #include <cstdint>
 
+#include "AdapterTable.h"
+
 namespace ipfilter
 {
     class NetInterface
     {
     public:
+        NetInterface() = default;
+
         NetInterface(const std::string& name, uint64_t localId, ULONG index);
 
         std::string getName() const;
@@ -18,13 +22,18 @@ namespace ipfilter
 
     private:
         std::string name;
-        uint64_t localId;
-        ULONG index;
+        uint64_t localId{};
+        ULONG index{};
     };
 
-    std::vector<NetInterface> getNetworkInterfaces();
+    // Adapters indexed by interface index, read with a single GetAdaptersAddresses call.
+    typedef Proton::NetworkUtil::AdapterTable NetInterfaceTable;
+
+    NetInterfaceTable getNetworkInterfaces();
 
-    std::vector<NetInterface>::iterator findNetworkInterfaceByIndex(
-        std::vector<NetInterface>& interfaces,
-        ULONG index);
+    // Returns false if no interface has the index.
+    bool findNetworkInterfaceByIndex(
+        const NetInterfaceTable& interfaces,
+        ULONG index,
+        NetInterface& result);
 }
@@ -0,0 +1,57 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "payload_buffer.h"
+
+namespace ipfilter
+{
+    size_t PayloadBuffer::alignedSize(size_t size)
+    {
+        return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    }
+
+    PayloadBuffer::PayloadBuffer(size_t size):
+        storage(alignedSize(size) / sizeof(uint64_t)),
+        offset(0)
+    {
+    }
+
+    void* PayloadBuffer::allocate(size_t size)
+    {
+        if (alignedSize(size) > this->size() - this->offset)
+        {
+            throw std::length_error("Condition payload does not fit in its buffer");
+        }
+
+        auto* memory = reinterpret_cast<uint8_t*>(this->storage.data()) + this->offset;
+        this->offset += alignedSize(size);
+
+        return memory;
+    }
+
+    uint8_t* PayloadBuffer::addBytes(const uint8_t* data, size_t size)
+    {
+        auto* memory = static_cast<uint8_t*>(this->allocate(size));
+        if (size != 0)
+        {
+            std::memcpy(memory, data, size);
+        }
+
+        return memory;
+    }
+
+    const uint8_t* PayloadBuffer::data() const
+    {
+        return reinterpret_cast<const uint8_t*>(this->storage.data());
+    }
+
+    size_t PayloadBuffer::size() const
+    {
+        return this->storage.size() * sizeof(uint64_t);
+    }
+
+    size_t PayloadBuffer::used() const
+    {
+        return this->offset;
+    }
+}
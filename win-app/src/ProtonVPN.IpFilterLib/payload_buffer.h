@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ipfilter
+{
+    // Single buffer holding the payloads of filter condition values. Allocations are rounded
+    // up to 8 bytes, so every payload is suitably aligned. The buffer is sized up front and
+    // never grows, so pointers into it stay valid as long as the buffer lives.
+    class PayloadBuffer
+    {
+    public:
+        static size_t alignedSize(size_t size);
+
+        PayloadBuffer(size_t size);
+
+        PayloadBuffer(const PayloadBuffer&) = delete;
+
+        PayloadBuffer& operator=(const PayloadBuffer&) = delete;
+
+        // Throws std::length_error if the allocation does not fit in the buffer.
+        void* allocate(size_t size);
+
+        template <class T>
+        T* add(const T& value)
+        {
+            auto* memory = static_cast<T*>(this->allocate(sizeof(T)));
+            *memory = value;
+
+            return memory;
+        }
+
+        uint8_t* addBytes(const uint8_t* data, size_t size);
+
+        const uint8_t* data() const;
+
+        size_t size() const;
+
+        size_t used() const;
+
+    private:
+        // 8 byte units, so the start of the buffer is aligned.
+        std::vector<uint64_t> storage;
+        size_t offset;
+    };
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "ip.h"
+
+namespace ipfilter
+{
+    namespace ip
+    {
+        struct Uint128
+        {
+            uint64_t high;
+            uint64_t low;
+
+            bool operator==(const Uint128& other) const
+            {
+                return high == other.high && low == other.low;
+            }
+
+            bool operator!=(const Uint128& other) const
+            {
+                return !(*this == other);
+            }
+
+            bool operator<(const Uint128& other) const
+            {
+                return high < other.high || (high == other.high && low < other.low);
+            }
+
+            bool operator<=(const Uint128& other) const
+            {
+                return !(other < *this);
+            }
+
+            Uint128 operator~() const
+            {
+                return {~high, ~low};
+            }
+
+            Uint128 operator&(const Uint128& other) const
+            {
+                return {high & other.high, low & other.low};
+            }
+
+            Uint128 operator|(const Uint128& other) const
+            {
+                return {high | other.high, low | other.low};
+            }
+
+            Uint128 operator+(uint64_t value) const
+            {
+                Uint128 result{high, low + value};
+                if (result.low < low)
+                {
+                    result.high++;
+                }
+                return result;
+            }
+        };
+
+        namespace detail
+        {
+            template <class T>
+            struct PrefixTraits;
+
+            template <>
+            struct PrefixTraits<uint32_t>
+            {
+                static const uint8_t bits = 32;
+
+                static uint32_t max()
+                {
+                    return 0xFFFFFFFFu;
+                }
+
+                // Mask covering the host part of a prefix of the given length.
+                static uint32_t hostMask(uint8_t length)
+                {
+                    return length == 0 ? 0xFFFFFFFFu : (length >= 32 ? 0 : (1u << (32 - length)) - 1);
+                }
+
+                static uint8_t trailingZeros(uint32_t value)
+                {
+                    uint8_t count = 0;
+                    while (count < 32 && (value & (1u << count)) == 0)
+                    {
+                        count++;
+                    }
+                    return count;
+                }
+            };
+
+            template <>
+            struct PrefixTraits<Uint128>
+            {
+                static const uint8_t bits = 128;
+
+                static Uint128 max()
+                {
+                    return {~0ULL, ~0ULL};
+                }
+
+                static Uint128 hostMask(uint8_t length)
+                {
+                    if (length == 0)
+                    {
+                        return max();
+                    }
+                    if (length >= 128)
+                    {
+                        return {0, 0};
+                    }
+                    if (length <= 64)
+                    {
+                        return {length == 64 ? 0 : (~0ULL >> length), ~0ULL};
+                    }
+                    return {0, ~0ULL >> (length - 64)};
+                }
+
+                static uint8_t trailingZeros(const Uint128& value)
+                {
+                    uint8_t count = 0;
+                    while (count < 128)
+                    {
+                        auto word = count < 64 ? value.low : value.high;
+                        if ((word & (1ULL << (count % 64))) != 0)
+                        {
+                            break;
+                        }
+                        count++;
+                    }
+                    return count;
+                }
+            };
+        }
+
+        // Set of CIDR prefixes that can be reduced to the minimal list of prefixes covering
+        // exactly the same addresses. Addresses are unsigned integers in host byte order.
+        template <class T>
+        class BasicPrefixSet
+        {
+        public:
+            typedef detail::PrefixTraits<T> Traits;
+
+            struct Prefix
+            {
+                T address;
+                uint8_t length;
+            };
+
+            void add(const T& address, uint8_t length)
+            {
+                if (length > Traits::bits)
+                {
+                    length = Traits::bits;
+                }
+
+                auto hostMask = Traits::hostMask(length);
+                auto first = address & ~hostMask;
+                this->ranges.push_back({first, first | hostMask});
+            }
+
+            size_t size() const
+            {
+                return this->ranges.size();
+            }
+
+            void clear()
+            {
+                this->ranges.clear();
+            }
+
+            std::vector<Prefix> compute() const
+            {
+                std::vector<Prefix> prefixes{};
+
+                for (const auto& range : this->merge())
+                {
+                    appendRange(range.first, range.last, prefixes);
+                }
+
+                return prefixes;
+            }
+
+        private:
+            struct Range
+            {
+                T first;
+                T last;
+            };
+
+            std::vector<Range> merge() const
+            {
+                auto sorted = this->ranges;
+                std::sort(sorted.begin(), sorted.end(), [](const Range& a, const Range& b)
+                {
+                    return a.first < b.first;
+                });
+
+                std::vector<Range> merged{};
+                for (const auto& range : sorted)
+                {
+                    if (!merged.empty())
+                    {
+                        auto& current = merged.back();
+                        if (current.last == Traits::max() || range.first <= current.last + 1)
+                        {
+                            if (current.last < range.last)
+                            {
+                                current.last = range.last;
+                            }
+                            continue;
+                        }
+                    }
+
+                    merged.push_back(range);
+                }
+
+                return merged;
+            }
+
+            static void appendRange(T first, const T& last, std::vector<Prefix>& prefixes)
+            {
+                while (true)
+                {
+                    auto length = static_cast<uint8_t>(Traits::bits - Traits::trailingZeros(first));
+                    while ((first | Traits::hostMask(length)) != last &&
+                           last < (first | Traits::hostMask(length)))
+                    {
+                        length++;
+                    }
+
+                    prefixes.push_back({first, length});
+
+                    auto blockLast = first | Traits::hostMask(length);
+                    if (blockLast == last)
+                    {
+                        return;
+                    }
+
+                    first = blockLast + 1;
+                }
+            }
+
+            std::vector<Range> ranges;
+        };
+
+        typedef BasicPrefixSet<uint32_t> PrefixSetV4;
+
+        typedef BasicPrefixSet<Uint128> PrefixSetV6;
+
+        inline uint32_t toUint32(const AddressV4& address)
+        {
+            auto bytes = address.toBytes();
+
+            return (static_cast<uint32_t>(bytes[0]) << 24) |
+                (static_cast<uint32_t>(bytes[1]) << 16) |
+                (static_cast<uint32_t>(bytes[2]) << 8) |
+                static_cast<uint32_t>(bytes[3]);
+        }
+
+        inline AddressV4 toAddressV4(uint32_t value)
+        {
+            return AddressV4({
+                static_cast<unsigned char>(value >> 24),
+                static_cast<unsigned char>(value >> 16),
+                static_cast<unsigned char>(value >> 8),
+                static_cast<unsigned char>(value)
+            });
+        }
+
+        inline Uint128 toUint128(const AddressV6& address)
+        {
+            auto bytes = address.toBytes();
+            Uint128 value{0, 0};
+
+            for (int i = 0; i < 8; i++)
+            {
+                value.high = (value.high << 8) | bytes[i];
+                value.low = (value.low << 8) | bytes[i + 8];
+            }
+
+            return value;
+        }
+
+        inline AddressV6 toAddressV6(const Uint128& value, uint8_t prefix)
+        {
+            AddressV6::BytesType bytes{};
+
+            for (int i = 0; i < 8; i++)
+            {
+                bytes[i] = static_cast<unsigned char>(value.high >> (56 - i * 8));
+                bytes[i + 8] = static_cast<unsigned char>(value.low >> (56 - i * 8));
+            }
+
+            return AddressV6(bytes, prefix);
+        }
+
+        // Length of a contiguous IPv4 network mask, or -1 if the mask is not contiguous.
+        inline int maskLength(const AddressV4& mask)
+        {
+            auto value = toUint32(mask);
+            int length = 0;
+
+            while (length < 32 && (value & (0x80000000u >> length)) != 0)
+            {
+                length++;
+            }
+
+            if (length < 32 && (value & detail::PrefixTraits<uint32_t>::hostMask(static_cast<uint8_t>(length))) != 0)
+            {
+                return -1;
+            }
+
+            return length;
+        }
+    }
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "prefix_table_builder.h"
+#include "../ProtonVPN.CalloutDriver/PrefixTable.h"
+
+namespace ipfilter
+{
+    namespace ip
+    {
+        namespace
+        {
+            const uint32_t SlotCount = 1 << PREFIX_TABLE_STRIDE;
+
+            struct Slot
+            {
+                int32_t child{-1};
+                uint8_t value{};
+            };
+
+            typedef std::array<Slot, SlotCount> Node;
+
+            // Sets the value of the slot and of every slot below it. Prefixes are inserted from
+            // the shortest, so everything below the slot belongs to a shorter prefix.
+            void assign(std::vector<Node>& nodes, size_t nodeIndex, uint32_t slot, uint8_t value)
+            {
+                nodes[nodeIndex][slot].value = value;
+
+                auto child = nodes[nodeIndex][slot].child;
+                if (child >= 0)
+                {
+                    for (uint32_t i = 0; i < SlotCount; i++)
+                    {
+                        assign(nodes, static_cast<size_t>(child), i, value);
+                    }
+                }
+            }
+
+            void putUint16(std::vector<uint8_t>& buffer, uint16_t value)
+            {
+                buffer.push_back(static_cast<uint8_t>(value));
+                buffer.push_back(static_cast<uint8_t>(value >> 8));
+            }
+
+            void putUint32(std::vector<uint8_t>& buffer, uint32_t value)
+            {
+                putUint16(buffer, static_cast<uint16_t>(value));
+                putUint16(buffer, static_cast<uint16_t>(value >> 16));
+            }
+
+            void putUint64(std::vector<uint8_t>& buffer, uint64_t value)
+            {
+                putUint32(buffer, static_cast<uint32_t>(value));
+                putUint32(buffer, static_cast<uint32_t>(value >> 32));
+            }
+        }
+
+        PrefixTableBuilder::PrefixTableBuilder(uint8_t addressLength): addressLength(addressLength)
+        {
+            if (addressLength != 4 && addressLength != 16)
+            {
+                throw std::invalid_argument("Address length must be 4 or 16");
+            }
+        }
+
+        void PrefixTableBuilder::add(const uint8_t* address, uint8_t prefix, uint8_t value)
+        {
+            if (prefix > this->addressLength * 8)
+            {
+                throw std::out_of_range("Prefix is out of range");
+            }
+
+            this->prefixes.push_back({
+                std::vector<uint8_t>(address, address + this->addressLength),
+                prefix,
+                value
+            });
+        }
+
+        void PrefixTableBuilder::add(const AddressV4& address, uint8_t prefix, uint8_t value)
+        {
+            if (this->addressLength != 4)
+            {
+                throw std::invalid_argument("IPv4 address added to an IPv6 table");
+            }
+
+            auto bytes = address.toBytes();
+            this->add(bytes.data(), prefix, value);
+        }
+
+        void PrefixTableBuilder::add(const AddressV6& address, uint8_t value)
+        {
+            if (this->addressLength != 16)
+            {
+                throw std::invalid_argument("IPv6 address added to an IPv4 table");
+            }
+
+            auto bytes = address.toBytes();
+            this->add(bytes.data(), address.prefix(), value);
+        }
+
+        std::vector<uint8_t> PrefixTableBuilder::build() const
+        {
+            auto sorted = this->prefixes;
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Prefix& a, const Prefix& b)
+            {
+                return a.length < b.length;
+            });
+
+            std::vector<Node> nodes(1);
+
+            for (const auto& prefix : sorted)
+            {
+                size_t nodeIndex = 0;
+                uint32_t offset = 0;
+                uint32_t remaining = prefix.length;
+
+                while (remaining > PREFIX_TABLE_STRIDE)
+                {
+                    auto slot = PrefixTableSlot(prefix.address.data(), this->addressLength, offset);
+                    if (nodes[nodeIndex][slot].child < 0)
+                    {
+                        Node child{};
+                        for (auto& childSlot : child)
+                        {
+                            childSlot.value = nodes[nodeIndex][slot].value;
+                        }
+
+                        nodes.push_back(child);
+                        nodes[nodeIndex][slot].child = static_cast<int32_t>(nodes.size() - 1);
+                    }
+
+                    nodeIndex = static_cast<size_t>(nodes[nodeIndex][slot].child);
+                    offset += PREFIX_TABLE_STRIDE;
+                    remaining -= PREFIX_TABLE_STRIDE;
+                }
+
+                uint32_t span = 1u << (PREFIX_TABLE_STRIDE - remaining);
+                uint32_t first = PrefixTableSlot(prefix.address.data(), this->addressLength, offset) & ~(span - 1);
+                for (auto slot = first; slot < first + span; slot++)
+                {
+                    assign(nodes, nodeIndex, slot, prefix.value);
+                }
+            }
+
+            // Renumber nodes breadth first, so children of every node are stored contiguously.
+            std::vector<size_t> order{0};
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                for (const auto& slot : nodes[order[i]])
+                {
+                    if (slot.child >= 0)
+                    {
+                        order.push_back(static_cast<size_t>(slot.child));
+                    }
+                }
+            }
+
+            std::vector<uint8_t> nodeData{};
+            std::vector<uint8_t> leaves{};
+            uint32_t childBase = 1;
+
+            for (auto nodeIndex : order)
+            {
+                const auto& node = nodes[nodeIndex];
+                uint64_t childMask = 0;
+                uint64_t leafMask = 0;
+                auto leafBase = static_cast<uint32_t>(leaves.size());
+                auto hasLeaf = false;
+                uint8_t lastValue = 0;
+
+                for (uint32_t slot = 0; slot < SlotCount; slot++)
+                {
+                    if (node[slot].child >= 0)
+                    {
+                        childMask |= 1ull << slot;
+                        continue;
+                    }
+
+                    if (!hasLeaf || node[slot].value != lastValue)
+                    {
+                        leafMask |= 1ull << slot;
+                        leaves.push_back(node[slot].value);
+                        lastValue = node[slot].value;
+                        hasLeaf = true;
+                    }
+                }
+
+                putUint64(nodeData, childMask);
+                putUint64(nodeData, leafMask);
+                putUint32(nodeData, leafBase);
+                putUint32(nodeData, childMask != 0 ? childBase : 0);
+
+                childBase += PrefixTablePopCount(childMask);
+            }
+
+            std::vector<uint8_t> buffer{};
+            buffer.reserve(sizeof(PREFIX_TABLE) + nodeData.size() + leaves.size());
+
+            putUint32(buffer, PREFIX_TABLE_MAGIC);
+            putUint16(buffer, PREFIX_TABLE_VERSION);
+            buffer.push_back(this->addressLength);
+            buffer.push_back(0);
+            putUint32(buffer, static_cast<uint32_t>(order.size()));
+            putUint32(buffer, static_cast<uint32_t>(leaves.size()));
+
+            buffer.insert(buffer.end(), nodeData.begin(), nodeData.end());
+            buffer.insert(buffer.end(), leaves.begin(), leaves.end());
+
+            return buffer;
+        }
+    }
+}
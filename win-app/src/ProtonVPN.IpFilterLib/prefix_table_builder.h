@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "ip.h"
+
+namespace ipfilter
+{
+    namespace ip
+    {
+        // Builds the flat longest prefix match table described in PrefixTable.h of the callout driver.
+        // Values are user defined classes, 0 is returned by lookups for addresses outside of all prefixes.
+        class PrefixTableBuilder
+        {
+        public:
+            PrefixTableBuilder(uint8_t addressLength);
+
+            void add(const uint8_t* address, uint8_t prefix, uint8_t value);
+
+            void add(const AddressV4& address, uint8_t prefix, uint8_t value);
+
+            void add(const AddressV6& address, uint8_t value);
+
+            std::vector<uint8_t> build() const;
+
+        private:
+            struct Prefix
+            {
+                std::vector<uint8_t> address;
+                uint8_t length;
+                uint8_t value;
+            };
+
+            uint8_t addressLength;
+            std::vector<Prefix> prefixes;
+        };
+    }
+}
@@ -0,0 +1,84 @@
+#include <stdexcept>
+
+#include "provider_context_writer.h"
+#include "../ProtonVPN.CalloutDriver/ProviderContext.h"
+
+namespace ipfilter
+{
+    namespace
+    {
+        void putUint16(std::vector<uint8_t>& buffer, uint16_t value)
+        {
+            buffer.push_back(static_cast<uint8_t>(value));
+            buffer.push_back(static_cast<uint8_t>(value >> 8));
+        }
+
+        void putUint32(std::vector<uint8_t>& buffer, uint32_t value)
+        {
+            putUint16(buffer, static_cast<uint16_t>(value));
+            putUint16(buffer, static_cast<uint16_t>(value >> 16));
+        }
+    }
+
+    void ProviderContextWriter::addBindAddressV4(const ip::AddressV4& address)
+    {
+        auto bytes = address.toBytes();
+        this->addSection(PROVIDER_CONTEXT_BIND_ADDRESS_V4, bytes.data(), bytes.size());
+    }
+
+    void ProviderContextWriter::addBindAddressV6(const ip::AddressV6& address)
+    {
+        auto bytes = address.toBytes();
+        this->addSection(PROVIDER_CONTEXT_BIND_ADDRESS_V6, bytes.data(), bytes.size());
+    }
+
+    void ProviderContextWriter::addExcludedPrefixesV4(const std::vector<uint8_t>& table)
+    {
+        this->addSection(PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V4, table.data(), table.size());
+    }
+
+    void ProviderContextWriter::addExcludedPrefixesV6(const std::vector<uint8_t>& table)
+    {
+        this->addSection(PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V6, table.data(), table.size());
+    }
+
+    void ProviderContextWriter::addDnsPolicy(uint32_t flags)
+    {
+        std::vector<uint8_t> policy{};
+        putUint32(policy, flags);
+
+        this->addSection(PROVIDER_CONTEXT_DNS_POLICY, policy.data(), policy.size());
+    }
+
+    void ProviderContextWriter::addSection(uint16_t type, const uint8_t* data, size_t length)
+    {
+        if (length > UINT32_MAX - sizeof(PROVIDER_CONTEXT) - sizeof(PROVIDER_CONTEXT_SECTION) - this->sections.size())
+        {
+            throw std::length_error("Provider context is too large");
+        }
+
+        putUint16(this->sections, type);
+        putUint16(this->sections, 0);
+        putUint32(this->sections, static_cast<uint32_t>(length));
+
+        this->sections.insert(this->sections.end(), data, data + length);
+        this->sections.resize(static_cast<size_t>(ProviderContextAlign(this->sections.size())));
+        this->sectionCount++;
+    }
+
+    std::vector<uint8_t> ProviderContextWriter::build() const
+    {
+        std::vector<uint8_t> buffer{};
+        buffer.reserve(sizeof(PROVIDER_CONTEXT) + this->sections.size());
+
+        putUint32(buffer, PROVIDER_CONTEXT_MAGIC);
+        putUint16(buffer, PROVIDER_CONTEXT_VERSION);
+        putUint16(buffer, 0);
+        putUint32(buffer, static_cast<uint32_t>(sizeof(PROVIDER_CONTEXT) + this->sections.size()));
+        putUint32(buffer, this->sectionCount);
+
+        buffer.insert(buffer.end(), this->sections.begin(), this->sections.end());
+
+        return buffer;
+    }
+}
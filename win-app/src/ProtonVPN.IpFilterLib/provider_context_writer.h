@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "ip.h"
+
+namespace ipfilter
+{
+    // Writes the versioned provider context read by the callout driver, see ProviderContext.h.
+    class ProviderContextWriter
+    {
+    public:
+        void addBindAddressV4(const ip::AddressV4& address);
+
+        void addBindAddressV6(const ip::AddressV6& address);
+
+        // Prefix tables are built with ip::PrefixTableBuilder.
+        void addExcludedPrefixesV4(const std::vector<uint8_t>& table);
+
+        void addExcludedPrefixesV6(const std::vector<uint8_t>& table);
+
+        void addDnsPolicy(uint32_t flags);
+
+        void addSection(uint16_t type, const uint8_t* data, size_t length);
+
+        std::vector<uint8_t> build() const;
+
+    private:
+        std::vector<uint8_t> sections;
+        uint32_t sectionCount{};
+    };
+}
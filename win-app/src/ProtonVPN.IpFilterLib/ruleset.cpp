@@ -0,0 +1,259 @@
+#include "ruleset.h"
+
+#include <map>
+#include <algorithm>
+
+namespace ipfilter
+{
+    namespace ruleset
+    {
+        const uint64_t FnvOffsetBasis = 0xcbf29ce484222325ULL;
+        const uint64_t FnvPrime = 0x100000001b3ULL;
+        const uint32_t StampMagic = 0x48535250; // "PRSH"
+        const uint32_t StampVersion = 1;
+        const size_t StampSize = 16;
+
+        void writeUint32(std::vector<uint8_t>& out, uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+
+        void writeString(std::vector<uint8_t>& out, const std::string& value)
+        {
+            writeUint32(out, static_cast<uint32_t>(value.size()));
+            out.insert(out.end(), value.begin(), value.end());
+        }
+
+        void writeWideString(std::vector<uint8_t>& out, const std::wstring& value)
+        {
+            writeUint32(out, static_cast<uint32_t>(value.size()));
+            for (auto c : value)
+            {
+                // Encoded as UTF-16 code units regardless of the platform wchar_t size.
+                auto unit = static_cast<uint16_t>(c);
+                out.push_back(static_cast<uint8_t>(unit));
+                out.push_back(static_cast<uint8_t>(unit >> 8));
+            }
+        }
+
+        void writeKey(std::vector<uint8_t>& out, const Key& key)
+        {
+            out.insert(out.end(), key.begin(), key.end());
+        }
+
+        std::vector<uint8_t> encodeCondition(const Condition& condition)
+        {
+            std::vector<uint8_t> out{};
+
+            writeUint32(out, condition.type);
+            writeUint32(out, condition.match);
+            writeString(out, condition.address);
+            writeString(out, condition.mask);
+            writeUint32(out, static_cast<uint32_t>(condition.prefix));
+            out.push_back(condition.isIpv6 ? 1 : 0);
+            writeWideString(out, condition.path);
+            writeUint32(out, condition.value);
+
+            return out;
+        }
+
+        std::vector<uint8_t> encodeRule(const Rule& rule)
+        {
+            std::vector<uint8_t> out{};
+
+            writeWideString(out, rule.name);
+            writeWideString(out, rule.description);
+            writeUint32(out, rule.layer);
+            writeUint32(out, rule.action);
+            writeUint32(out, rule.weight);
+            writeKey(out, rule.calloutKey);
+            writeKey(out, rule.providerContextKey);
+
+            std::vector<std::vector<uint8_t>> conditions{};
+            for (const auto& condition : rule.conditions)
+            {
+                conditions.push_back(encodeCondition(condition));
+            }
+
+            std::sort(conditions.begin(), conditions.end());
+
+            writeUint32(out, static_cast<uint32_t>(conditions.size()));
+            for (const auto& condition : conditions)
+            {
+                writeUint32(out, static_cast<uint32_t>(condition.size()));
+                out.insert(out.end(), condition.begin(), condition.end());
+            }
+
+            return out;
+        }
+
+        Hash hashRule(const Rule& rule)
+        {
+            Hash hash = FnvOffsetBasis;
+
+            for (auto byte : encodeRule(rule))
+            {
+                hash ^= byte;
+                hash *= FnvPrime;
+            }
+
+            return hash;
+        }
+
+        bool Ruleset::add(const Rule& rule)
+        {
+            auto hash = hashRule(rule);
+
+            auto range = this->ruleHashes.equal_range(hash);
+            if (range.first != range.second)
+            {
+                auto encoded = encodeRule(rule);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (encodeRule(this->rules[it->second]) == encoded)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            this->ruleHashes.emplace(hash, this->rules.size());
+            this->rules.push_back(rule);
+
+            return true;
+        }
+
+        void Ruleset::clear()
+        {
+            this->rules.clear();
+            this->ruleHashes.clear();
+        }
+
+        const std::vector<Rule>& Ruleset::getRules() const
+        {
+            return this->rules;
+        }
+
+        const std::vector<InstalledRule>& Ruleset::getInstalled(const Key& providerKey, const Key& sublayerKey) const
+        {
+            static const std::vector<InstalledRule> none{};
+
+            auto it = this->installed.find({providerKey, sublayerKey});
+            if (it == this->installed.end())
+            {
+                return none;
+            }
+
+            return it->second;
+        }
+
+        void Ruleset::setInstalled(const Key& providerKey, const Key& sublayerKey, const std::vector<InstalledRule>& installed)
+        {
+            if (installed.empty())
+            {
+                this->installed.erase({providerKey, sublayerKey});
+                return;
+            }
+
+            this->installed[{providerKey, sublayerKey}] = installed;
+        }
+
+        Diff diff(const std::vector<InstalledRule>& installed, const std::vector<Rule>& desired, bool persistent)
+        {
+            std::map<Hash, std::vector<size_t>> pending{};
+            for (size_t i = 0; i < desired.size(); i++)
+            {
+                pending[hashRule(desired[i])].push_back(i);
+            }
+
+            Diff result{};
+
+            for (const auto& rule : installed)
+            {
+                auto it = pending.find(rule.hash);
+                if (it == pending.end() || it->second.empty() || rule.persistent != persistent)
+                {
+                    result.deletions.push_back(rule.filterKey);
+                    continue;
+                }
+
+                it->second.pop_back();
+                result.kept.push_back(rule);
+            }
+
+            for (const auto& entry : pending)
+            {
+                result.additions.insert(result.additions.end(), entry.second.begin(), entry.second.end());
+            }
+
+            std::sort(result.additions.begin(), result.additions.end());
+
+            return result;
+        }
+
+        std::vector<uint8_t> encodeStamp(Hash hash)
+        {
+            std::vector<uint8_t> out{};
+
+            writeUint32(out, StampMagic);
+            writeUint32(out, StampVersion);
+            writeUint32(out, static_cast<uint32_t>(hash));
+            writeUint32(out, static_cast<uint32_t>(hash >> 32));
+
+            return out;
+        }
+
+        uint32_t readUint32(const uint8_t* data)
+        {
+            uint32_t value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                value |= static_cast<uint32_t>(data[i]) << (i * 8);
+            }
+
+            return value;
+        }
+
+        bool decodeStamp(const uint8_t* data, size_t size, Hash& hash)
+        {
+            if (data == nullptr ||
+                size != StampSize ||
+                readUint32(data) != StampMagic ||
+                readUint32(data + 4) != StampVersion)
+            {
+                return false;
+            }
+
+            hash = readUint32(data + 8) | (static_cast<Hash>(readUint32(data + 12)) << 32);
+
+            return true;
+        }
+
+        Diff reconcile(const std::vector<StampedFilter>& filters, const std::vector<Rule>& desired, bool persistent)
+        {
+            std::vector<InstalledRule> installed{};
+            std::vector<Key> unstamped{};
+
+            for (const auto& filter : filters)
+            {
+                Hash hash{};
+                if (decodeStamp(filter.providerData.data(), filter.providerData.size(), hash))
+                {
+                    installed.push_back({filter.filterKey, hash, filter.persistent});
+                }
+                else
+                {
+                    unstamped.push_back(filter.filterKey);
+                }
+            }
+
+            auto result = diff(installed, desired, persistent);
+            result.deletions.insert(result.deletions.end(), unstamped.begin(), unstamped.end());
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+namespace ipfilter
+{
+    namespace ruleset
+    {
+        typedef std::array<uint8_t, 16> Key;
+
+        typedef uint64_t Hash;
+
+        // Portable counterpart of IPFilterCondition, see ip_filter.h for the meaning of the fields.
+        struct Condition
+        {
+            uint32_t type{};
+            uint32_t match{};
+            std::string address;
+            std::string mask;
+            int32_t prefix{};
+            bool isIpv6{};
+            std::wstring path;
+            uint32_t value{};
+        };
+
+        // Portable counterpart of IPFilterDescriptor.
+        struct Rule
+        {
+            std::wstring name;
+            std::wstring description;
+            uint32_t layer{};
+            uint32_t action{};
+            uint32_t weight{};
+            Key calloutKey{};
+            Key providerContextKey{};
+            std::vector<Condition> conditions;
+        };
+
+        // Canonical byte encoding of a rule. Conditions are encoded in sorted order,
+        // so rules that only differ in the order of their conditions are equal.
+        std::vector<uint8_t> encodeRule(const Rule& rule);
+
+        Hash hashRule(const Rule& rule);
+
+        struct InstalledRule
+        {
+            Key filterKey;
+            Hash hash;
+            bool persistent;
+        };
+
+        struct Diff
+        {
+            std::vector<InstalledRule> kept;
+            std::vector<Key> deletions;
+            std::vector<size_t> additions;
+        };
+
+        class Ruleset
+        {
+        public:
+            // Identical rules map to the same filter key, so each rule is kept once.
+            // Returns false if the ruleset already has the rule.
+            bool add(const Rule& rule);
+
+            void clear();
+
+            const std::vector<Rule>& getRules() const;
+
+            // Rules installed by the last apply under the provider and sublayer. A ruleset applied
+            // under several of them keeps the installed rules of each apart.
+            const std::vector<InstalledRule>& getInstalled(const Key& providerKey, const Key& sublayerKey) const;
+
+            // Setting no rules forgets the provider and sublayer.
+            void setInstalled(const Key& providerKey, const Key& sublayerKey, const std::vector<InstalledRule>& installed);
+
+        private:
+            typedef std::pair<Key, Key> InstallKey;
+
+            std::vector<Rule> rules;
+            std::unordered_multimap<Hash, size_t> ruleHashes;
+            std::map<InstallKey, std::vector<InstalledRule>> installed;
+        };
+
+        // Computes the minimal set of changes turning the installed rules into the desired ones.
+        // Additions are indices into the desired rules. Installed rules whose persistence differs
+        // from the desired one are stale, they are deleted and added again.
+        Diff diff(const std::vector<InstalledRule>& installed, const std::vector<Rule>& desired, bool persistent);
+
+        // Filters added from a ruleset carry the hash of their rule in their provider data,
+        // so the installed rules can be read back from the engine after a restart.
+        std::vector<uint8_t> encodeStamp(Hash hash);
+
+        bool decodeStamp(const uint8_t* data, size_t size, Hash& hash);
+
+        struct StampedFilter
+        {
+            Key filterKey;
+            std::vector<uint8_t> providerData;
+            bool persistent;
+        };
+
+        // Like diff, for filters read from the engine. Filters without a valid stamp
+        // were not added from a ruleset and are deleted.
+        Diff reconcile(const std::vector<StampedFilter>& filters, const std::vector<Rule>& desired, bool persistent);
+    }
+}
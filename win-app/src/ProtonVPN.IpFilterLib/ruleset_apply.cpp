@@ -0,0 +1,351 @@
+#include "pch.h"
+#include <fwptypes.h>
+#include <fwpmu.h>
+#include <cstring>
+
+#include "ip_filter.h"
+#include "filter.h"
+#include "engine.h"
+#include "ruleset.h"
+#include "ruleset_apply.h"
+#include "name_uuid.h"
+#include "filter_enumeration.h"
+
+ipfilter::ruleset::Key IPFilterMakeRulesetKey(const GUID* guid)
+{
+    ipfilter::ruleset::Key key{};
+    if (guid != nullptr)
+    {
+        std::memcpy(key.data(), guid, key.size());
+    }
+
+    return key;
+}
+
+GUID IPFilterMakeGuid(const ipfilter::ruleset::Key& key)
+{
+    GUID guid{};
+    std::memcpy(&guid, key.data(), key.size());
+
+    return guid;
+}
+
+ipfilter::ruleset::Rule IPFilterMakeRule(const IPFilterDescriptor& descriptor)
+{
+    ipfilter::ruleset::Rule rule{};
+
+    if (descriptor.displayData->name != nullptr)
+    {
+        rule.name = descriptor.displayData->name;
+    }
+    if (descriptor.displayData->description != nullptr)
+    {
+        rule.description = descriptor.displayData->description;
+    }
+    rule.layer = descriptor.layer;
+    rule.action = descriptor.action;
+    rule.weight = descriptor.weight;
+    rule.calloutKey = IPFilterMakeRulesetKey(descriptor.calloutKey);
+    rule.providerContextKey = IPFilterMakeRulesetKey(descriptor.providerContextKey);
+
+    for (unsigned int i = 0; i < descriptor.conditionCount; i++)
+    {
+        const auto& source = descriptor.conditions[i];
+        ipfilter::ruleset::Condition condition{};
+
+        condition.type = source.type;
+        condition.match = source.match;
+        condition.value = source.value;
+        if (source.address != nullptr)
+        {
+            condition.address = source.address;
+        }
+        if (source.networkAddress != nullptr)
+        {
+            condition.address = source.networkAddress->address;
+            condition.mask = source.networkAddress->mask != nullptr ? source.networkAddress->mask : "";
+            condition.prefix = source.networkAddress->prefix;
+            condition.isIpv6 = source.networkAddress->isIpv6;
+        }
+        if (source.path != nullptr)
+        {
+            condition.path = source.path;
+        }
+
+        rule.conditions.push_back(condition);
+    }
+
+    return rule;
+}
+
+unsigned int IPFilterAddRule(
+    ipfilter::Engine& engine,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    const ipfilter::ruleset::Rule& rule,
+    BOOL persistent,
+    GUID* filterKey)
+{
+    std::vector<IPFilterNetworkAddress> addresses(rule.conditions.size());
+    std::vector<IPFilterCondition> conditions(rule.conditions.size());
+
+    for (size_t i = 0; i < rule.conditions.size(); i++)
+    {
+        const auto& source = rule.conditions[i];
+
+        addresses[i].address = const_cast<char*>(source.address.c_str());
+        addresses[i].mask = const_cast<char*>(source.mask.c_str());
+        addresses[i].prefix = source.prefix;
+        addresses[i].isIpv6 = source.isIpv6;
+
+        conditions[i].type = source.type;
+        conditions[i].match = source.match;
+        conditions[i].address = source.address.c_str();
+        conditions[i].networkAddress = &addresses[i];
+        conditions[i].path = source.path.c_str();
+        conditions[i].value = source.value;
+    }
+
+    IPFilterDisplayData displayData{
+        const_cast<wchar_t*>(rule.name.c_str()),
+        const_cast<wchar_t*>(rule.description.c_str())
+    };
+    auto calloutKey = IPFilterMakeGuid(rule.calloutKey);
+    auto providerContextKey = IPFilterMakeGuid(rule.providerContextKey);
+
+    IPFilterDescriptor descriptor{};
+    descriptor.displayData = &displayData;
+    descriptor.layer = rule.layer;
+    descriptor.action = rule.action;
+    descriptor.weight = rule.weight;
+    descriptor.calloutKey = &calloutKey;
+    descriptor.providerContextKey = &providerContextKey;
+    descriptor.conditionCount = static_cast<unsigned int>(conditions.size());
+    descriptor.conditions = conditions.data();
+
+    auto stamp = ipfilter::ruleset::encodeStamp(ipfilter::ruleset::hashRule(rule));
+
+    *filterKey = IPFilterMakeGuid(ipfilter::uuid::makeRuleUuid(IPFilterMakeRulesetKey(sublayerKey), rule));
+
+    return IPFilterAddFilters(
+        engine,
+        providerKey,
+        sublayerKey,
+        1,
+        &descriptor,
+        &stamp,
+        persistent,
+        filterKey);
+}
+
+bool IPFilterIsSameKey(const GUID* key, const GUID* expected)
+{
+    return key == nullptr || expected == nullptr ? key == expected : *key == *expected;
+}
+
+unsigned int IPFilterInstallRule(
+    ipfilter::Engine& engine,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    const ipfilter::ruleset::Rule& rule,
+    BOOL persistent,
+    GUID* filterKey)
+{
+    auto status = IPFilterAddRule(engine, providerKey, sublayerKey, rule, persistent, filterKey);
+    if (status != FWP_E_ALREADY_EXISTS)
+    {
+        return status;
+    }
+
+    FWPM_FILTER0* existing = nullptr;
+    status = engine.getFilter(*filterKey, existing);
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    ipfilter::ruleset::Hash hash{};
+    auto sameRule = IPFilterIsSameKey(existing->providerKey, providerKey) &&
+        IPFilterIsSameKey(&existing->subLayerKey, sublayerKey) &&
+        ipfilter::ruleset::decodeStamp(existing->providerData.data, existing->providerData.size, hash) &&
+        hash == ipfilter::ruleset::hashRule(rule);
+    auto samePersistence = ((existing->flags & FWPM_FILTER_FLAG_PERSISTENT) != 0) == (persistent != FALSE);
+
+    engine.freeFilter(existing);
+
+    if (!sameRule)
+    {
+        return FWP_E_ALREADY_EXISTS;
+    }
+
+    if (samePersistence)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    status = engine.deleteFilter(*filterKey);
+    if (status != ERROR_SUCCESS)
+    {
+        return status;
+    }
+
+    return IPFilterAddRule(engine, providerKey, sublayerKey, rule, persistent, filterKey);
+}
+
+unsigned int IPFilterGetRuleFilterKey(
+    GUID* sublayerKey,
+    const IPFilterDescriptor* rule,
+    GUID* filterKey)
+{
+    auto key = ipfilter::uuid::makeRuleUuid(IPFilterMakeRulesetKey(sublayerKey), IPFilterMakeRule(*rule));
+    *filterKey = IPFilterMakeGuid(key);
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterCreateRuleset(
+    IPFilterRulesetHandle* handle)
+{
+    *handle = new ipfilter::ruleset::Ruleset();
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterDestroyRuleset(
+    IPFilterRulesetHandle handle)
+{
+    delete static_cast<ipfilter::ruleset::Ruleset*>(handle);
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterAddRulesetRule(
+    IPFilterRulesetHandle handle,
+    const IPFilterDescriptor* rule)
+{
+    static_cast<ipfilter::ruleset::Ruleset*>(handle)->add(IPFilterMakeRule(*rule));
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterClearRuleset(
+    IPFilterRulesetHandle handle)
+{
+    static_cast<ipfilter::ruleset::Ruleset*>(handle)->clear();
+
+    return ERROR_SUCCESS;
+}
+
+unsigned int IPFilterApplyRulesetDiff(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    ipfilter::ruleset::Ruleset& ruleset,
+    const ipfilter::ruleset::Diff& diff,
+    BOOL persistent)
+{
+    const auto& rules = ruleset.getRules();
+    auto providerRulesetKey = IPFilterMakeRulesetKey(providerKey);
+    auto sublayerRulesetKey = IPFilterMakeRulesetKey(sublayerKey);
+
+    if (diff.deletions.empty() && diff.additions.empty())
+    {
+        ruleset.setInstalled(providerRulesetKey, sublayerRulesetKey, diff.kept);
+        return ERROR_SUCCESS;
+    }
+
+    ipfilter::SessionEngine engine(sessionHandle);
+    auto installed = diff.kept;
+    bool ownsTransaction{};
+
+    auto result = ipfilter::transact(engine, [&]()
+    {
+        for (const auto& key : diff.deletions)
+        {
+            auto status = engine.deleteFilter(IPFilterMakeGuid(key));
+            if (status != ERROR_SUCCESS && status != FWP_E_FILTER_NOT_FOUND)
+            {
+                return status;
+            }
+        }
+
+        for (auto index : diff.additions)
+        {
+            GUID filterKey{};
+
+            auto status = IPFilterInstallRule(
+                engine,
+                providerKey,
+                sublayerKey,
+                rules[index],
+                persistent,
+                &filterKey);
+            if (status != ERROR_SUCCESS)
+            {
+                return status;
+            }
+
+            installed.push_back({IPFilterMakeRulesetKey(&filterKey), ipfilter::ruleset::hashRule(rules[index]), persistent != FALSE});
+        }
+
+        return static_cast<unsigned int>(ERROR_SUCCESS);
+    }, ownsTransaction);
+
+    // Changes made in a transaction of the caller may still be aborted. The installed rules are left
+    // as they were, the next apply deletes missing filters and adds existing ones without failing.
+    if (result == ERROR_SUCCESS && ownsTransaction)
+    {
+        ruleset.setInstalled(providerRulesetKey, sublayerRulesetKey, installed);
+    }
+
+    return result;
+}
+
+unsigned int IPFilterApplyRuleset(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    IPFilterRulesetHandle handle,
+    BOOL persistent)
+{
+    auto ruleset = static_cast<ipfilter::ruleset::Ruleset*>(handle);
+    auto installed = ruleset->getInstalled(IPFilterMakeRulesetKey(providerKey), IPFilterMakeRulesetKey(sublayerKey));
+    auto diff = ipfilter::ruleset::diff(installed, ruleset->getRules(), persistent != FALSE);
+
+    return IPFilterApplyRulesetDiff(sessionHandle, providerKey, sublayerKey, *ruleset, diff, persistent);
+}
+
+unsigned int IPFilterReconcileRuleset(
+    IPFilterSessionHandle sessionHandle,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    IPFilterRulesetHandle handle,
+    BOOL persistent)
+{
+    auto ruleset = static_cast<ipfilter::ruleset::Ruleset*>(handle);
+
+    ipfilter::SessionEngine engine(sessionHandle);
+    ipfilter::FilterQuery query{providerKey, sublayerKey, nullptr};
+    std::vector<ipfilter::ruleset::StampedFilter> filters{};
+
+    auto result = ipfilter::forEachFilter(engine, IPFilterGetLayerKeys(), query, [&filters](const FWPM_FILTER0& filter)
+    {
+        ipfilter::ruleset::StampedFilter stamped{};
+        stamped.filterKey = IPFilterMakeRulesetKey(&filter.filterKey);
+        stamped.persistent = (filter.flags & FWPM_FILTER_FLAG_PERSISTENT) != 0;
+        if (filter.providerData.data != nullptr)
+        {
+            stamped.providerData.assign(filter.providerData.data, filter.providerData.data + filter.providerData.size);
+        }
+
+        filters.push_back(stamped);
+    });
+    if (result != ERROR_SUCCESS)
+    {
+        return result;
+    }
+
+    auto diff = ipfilter::ruleset::reconcile(filters, ruleset->getRules(), persistent != FALSE);
+
+    return IPFilterApplyRulesetDiff(sessionHandle, providerKey, sublayerKey, *ruleset, diff, persistent);
+}
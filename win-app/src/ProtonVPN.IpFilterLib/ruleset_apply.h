@@ -0,0 +1,27 @@
+#pragma once
+#include "pch.h"
+
+#include "ip_filter.h"
+#include "engine.h"
+#include "ruleset.h"
+
+ipfilter::ruleset::Rule IPFilterMakeRule(const IPFilterDescriptor& descriptor);
+
+unsigned int IPFilterAddRule(
+    ipfilter::Engine& engine,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    const ipfilter::ruleset::Rule& rule,
+    BOOL persistent,
+    GUID* filterKey);
+
+// Like IPFilterAddRule, also accepts a filter that already exists under the key of the rule
+// when it was added from the same rule, provider and sublayer. A filter that only differs in
+// persistence is replaced, any other returns FWP_E_ALREADY_EXISTS.
+unsigned int IPFilterInstallRule(
+    ipfilter::Engine& engine,
+    GUID* providerKey,
+    GUID* sublayerKey,
+    const ipfilter::ruleset::Rule& rule,
+    BOOL persistent,
+    GUID* filterKey);
@@ -0,0 +1,542 @@
+#include "snapshot.h"
+
+#include <map>
+#include <set>
+#include <algorithm>
+#include <stdexcept>
+
+namespace ipfilter
+{
+    namespace snapshot
+    {
+        const uint32_t Magic = 0x53465049; // "IPFS"
+        const uint32_t Version = 1;
+
+        class Writer
+        {
+        public:
+            void writeUint16(uint16_t value)
+            {
+                this->out.push_back(static_cast<uint8_t>(value));
+                this->out.push_back(static_cast<uint8_t>(value >> 8));
+            }
+
+            void writeUint32(uint32_t value)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    this->out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+                }
+            }
+
+            void writeKey(const Key& key)
+            {
+                this->out.insert(this->out.end(), key.begin(), key.end());
+            }
+
+            void writeBytes(const std::vector<uint8_t>& value)
+            {
+                this->writeUint32(static_cast<uint32_t>(value.size()));
+                this->out.insert(this->out.end(), value.begin(), value.end());
+            }
+
+            void writeWideString(const std::wstring& value)
+            {
+                this->writeUint32(static_cast<uint32_t>(value.size()));
+                for (auto c : value)
+                {
+                    // Encoded as UTF-16 code units regardless of the platform wchar_t size.
+                    this->writeUint16(static_cast<uint16_t>(c));
+                }
+            }
+
+            void writeDisplayData(const DisplayData& displayData)
+            {
+                this->writeWideString(displayData.name);
+                this->writeWideString(displayData.description);
+            }
+
+            void writeValue(const Value& value)
+            {
+                this->writeUint32(value.type);
+                this->writeBytes(value.data);
+            }
+
+            // Writes the objects written by the callback prefixed with their total length.
+            template <typename Callback>
+            void writeRecord(Callback callback)
+            {
+                auto start = this->out.size();
+                this->writeUint32(0);
+
+                callback();
+
+                auto length = static_cast<uint32_t>(this->out.size() - start - 4);
+                for (int i = 0; i < 4; i++)
+                {
+                    this->out[start + i] = static_cast<uint8_t>(length >> (i * 8));
+                }
+            }
+
+            std::vector<uint8_t>& data()
+            {
+                return this->out;
+            }
+
+        private:
+            std::vector<uint8_t> out;
+        };
+
+        class Reader
+        {
+        public:
+            Reader(const uint8_t* data, size_t size): data(data), size(size)
+            {
+            }
+
+            uint16_t readUint16()
+            {
+                auto p = this->take(2);
+
+                return static_cast<uint16_t>(p[0] | (p[1] << 8));
+            }
+
+            uint32_t readUint32()
+            {
+                auto p = this->take(4);
+                uint32_t value = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    value |= static_cast<uint32_t>(p[i]) << (i * 8);
+                }
+
+                return value;
+            }
+
+            Key readKey()
+            {
+                Key key{};
+                auto p = this->take(key.size());
+                std::copy(p, p + key.size(), key.begin());
+
+                return key;
+            }
+
+            std::vector<uint8_t> readBytes()
+            {
+                auto length = this->readUint32();
+                auto p = this->take(length);
+
+                return std::vector<uint8_t>(p, p + length);
+            }
+
+            std::wstring readWideString()
+            {
+                auto length = this->readUint32();
+                if (length > this->remaining() / 2)
+                {
+                    throw std::invalid_argument("Snapshot is truncated");
+                }
+
+                std::wstring value{};
+                value.reserve(length);
+                for (uint32_t i = 0; i < length; i++)
+                {
+                    value.push_back(static_cast<wchar_t>(this->readUint16()));
+                }
+
+                return value;
+            }
+
+            DisplayData readDisplayData()
+            {
+                DisplayData displayData{};
+                displayData.name = this->readWideString();
+                displayData.description = this->readWideString();
+
+                return displayData;
+            }
+
+            Value readValue()
+            {
+                Value value{};
+                value.type = this->readUint32();
+                value.data = this->readBytes();
+
+                return value;
+            }
+
+            // Reads a record written by Writer::writeRecord, skipping fields the callback does not read.
+            template <typename Callback>
+            void readRecord(Callback callback)
+            {
+                auto length = this->readUint32();
+                auto p = this->take(length);
+
+                Reader record(p, length);
+                callback(record);
+            }
+
+            // Guards reserving memory for a count read from the data, as each element takes at least a byte.
+            uint32_t readCount()
+            {
+                auto count = this->readUint32();
+                if (count > this->remaining())
+                {
+                    throw std::invalid_argument("Snapshot is truncated");
+                }
+
+                return count;
+            }
+
+            size_t remaining() const
+            {
+                return this->size - this->offset;
+            }
+
+        private:
+            const uint8_t* take(size_t length)
+            {
+                if (length > this->remaining())
+                {
+                    throw std::invalid_argument("Snapshot is truncated");
+                }
+
+                auto p = this->data + this->offset;
+                this->offset += length;
+
+                return p;
+            }
+
+            const uint8_t* data;
+            size_t size;
+            size_t offset{};
+        };
+
+        template <typename T, typename Write>
+        void writeObjects(Writer& writer, const std::vector<T>& objects, Write write)
+        {
+            writer.writeUint32(static_cast<uint32_t>(objects.size()));
+            for (const auto& object : objects)
+            {
+                writer.writeRecord([&]()
+                {
+                    write(object);
+                });
+            }
+        }
+
+        template <typename T, typename Read>
+        std::vector<T> readObjects(Reader& reader, Read read)
+        {
+            auto count = reader.readCount();
+
+            std::vector<T> objects{};
+            objects.reserve(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                reader.readRecord([&](Reader& record)
+                {
+                    objects.push_back(read(record));
+                });
+            }
+
+            return objects;
+        }
+
+        void writeProvider(Writer& writer, const Provider& provider)
+        {
+            writer.writeKey(provider.key);
+            writer.writeDisplayData(provider.displayData);
+            writer.writeUint32(provider.flags);
+            writer.writeBytes(provider.providerData);
+            writer.writeWideString(provider.serviceName);
+        }
+
+        void writeSublayer(Writer& writer, const Sublayer& sublayer)
+        {
+            writer.writeKey(sublayer.key);
+            writer.writeDisplayData(sublayer.displayData);
+            writer.writeUint32(sublayer.flags);
+            writer.writeKey(sublayer.providerKey);
+            writer.writeBytes(sublayer.providerData);
+            writer.writeUint16(sublayer.weight);
+        }
+
+        void writeCallout(Writer& writer, const Callout& callout)
+        {
+            writer.writeKey(callout.key);
+            writer.writeDisplayData(callout.displayData);
+            writer.writeUint32(callout.flags);
+            writer.writeKey(callout.providerKey);
+            writer.writeBytes(callout.providerData);
+            writer.writeKey(callout.applicableLayer);
+        }
+
+        void writeProviderContext(Writer& writer, const ProviderContext& context)
+        {
+            writer.writeKey(context.key);
+            writer.writeDisplayData(context.displayData);
+            writer.writeUint32(context.flags);
+            writer.writeKey(context.providerKey);
+            writer.writeBytes(context.providerData);
+            writer.writeUint32(context.type);
+            writer.writeBytes(context.data);
+        }
+
+        void writeFilter(Writer& writer, const Filter& filter)
+        {
+            writer.writeKey(filter.key);
+            writer.writeDisplayData(filter.displayData);
+            writer.writeUint32(filter.flags);
+            writer.writeKey(filter.providerKey);
+            writer.writeBytes(filter.providerData);
+            writer.writeKey(filter.layerKey);
+            writer.writeKey(filter.sublayerKey);
+            writer.writeValue(filter.weight);
+            writer.writeUint32(static_cast<uint32_t>(filter.conditions.size()));
+            for (const auto& condition : filter.conditions)
+            {
+                writer.writeKey(condition.fieldKey);
+                writer.writeUint32(condition.matchType);
+                writer.writeValue(condition.value);
+            }
+            writer.writeUint32(filter.actionType);
+            writer.writeKey(filter.actionKey);
+            writer.writeKey(filter.context);
+        }
+
+        std::vector<uint8_t> encode(const Snapshot& snapshot)
+        {
+            Writer writer{};
+
+            writer.writeUint32(Magic);
+            writer.writeUint32(Version);
+
+            writeObjects(writer, snapshot.providers, [&](const Provider& provider)
+            {
+                writeProvider(writer, provider);
+            });
+
+            writeObjects(writer, snapshot.sublayers, [&](const Sublayer& sublayer)
+            {
+                writeSublayer(writer, sublayer);
+            });
+
+            writeObjects(writer, snapshot.callouts, [&](const Callout& callout)
+            {
+                writeCallout(writer, callout);
+            });
+
+            writeObjects(writer, snapshot.providerContexts, [&](const ProviderContext& context)
+            {
+                writeProviderContext(writer, context);
+            });
+
+            writeObjects(writer, snapshot.filters, [&](const Filter& filter)
+            {
+                writeFilter(writer, filter);
+            });
+
+            return std::move(writer.data());
+        }
+
+        Snapshot decode(const uint8_t* data, size_t size)
+        {
+            Reader reader(data, size);
+
+            if (reader.readUint32() != Magic)
+            {
+                throw std::invalid_argument("Data is not a snapshot");
+            }
+
+            if (reader.readUint32() != Version)
+            {
+                throw std::invalid_argument("Unsupported snapshot version");
+            }
+
+            Snapshot snapshot{};
+
+            snapshot.providers = readObjects<Provider>(reader, [](Reader& record)
+            {
+                Provider provider{};
+                provider.key = record.readKey();
+                provider.displayData = record.readDisplayData();
+                provider.flags = record.readUint32();
+                provider.providerData = record.readBytes();
+                provider.serviceName = record.readWideString();
+
+                return provider;
+            });
+
+            snapshot.sublayers = readObjects<Sublayer>(reader, [](Reader& record)
+            {
+                Sublayer sublayer{};
+                sublayer.key = record.readKey();
+                sublayer.displayData = record.readDisplayData();
+                sublayer.flags = record.readUint32();
+                sublayer.providerKey = record.readKey();
+                sublayer.providerData = record.readBytes();
+                sublayer.weight = record.readUint16();
+
+                return sublayer;
+            });
+
+            snapshot.callouts = readObjects<Callout>(reader, [](Reader& record)
+            {
+                Callout callout{};
+                callout.key = record.readKey();
+                callout.displayData = record.readDisplayData();
+                callout.flags = record.readUint32();
+                callout.providerKey = record.readKey();
+                callout.providerData = record.readBytes();
+                callout.applicableLayer = record.readKey();
+
+                return callout;
+            });
+
+            snapshot.providerContexts = readObjects<ProviderContext>(reader, [](Reader& record)
+            {
+                ProviderContext context{};
+                context.key = record.readKey();
+                context.displayData = record.readDisplayData();
+                context.flags = record.readUint32();
+                context.providerKey = record.readKey();
+                context.providerData = record.readBytes();
+                context.type = record.readUint32();
+                context.data = record.readBytes();
+
+                return context;
+            });
+
+            snapshot.filters = readObjects<Filter>(reader, [](Reader& record)
+            {
+                Filter filter{};
+                filter.key = record.readKey();
+                filter.displayData = record.readDisplayData();
+                filter.flags = record.readUint32();
+                filter.providerKey = record.readKey();
+                filter.providerData = record.readBytes();
+                filter.layerKey = record.readKey();
+                filter.sublayerKey = record.readKey();
+                filter.weight = record.readValue();
+
+                auto conditionCount = record.readCount();
+                filter.conditions.reserve(conditionCount);
+                for (uint32_t i = 0; i < conditionCount; i++)
+                {
+                    Condition condition{};
+                    condition.fieldKey = record.readKey();
+                    condition.matchType = record.readUint32();
+                    condition.value = record.readValue();
+                    filter.conditions.push_back(condition);
+                }
+
+                filter.actionType = record.readUint32();
+                filter.actionKey = record.readKey();
+                filter.context = record.readKey();
+
+                return filter;
+            });
+
+            return snapshot;
+        }
+
+        // Encoded content of the objects by key.
+        template <typename T, typename Write>
+        std::map<Key, std::vector<uint8_t>> encodeObjects(const std::vector<T>& objects, Write write)
+        {
+            std::map<Key, std::vector<uint8_t>> result{};
+            for (const auto& object : objects)
+            {
+                Writer writer{};
+                write(writer, object);
+                result[object.key] = std::move(writer.data());
+            }
+
+            return result;
+        }
+
+        // Deletes the installed objects that are not desired, differ from the desired ones or depend on
+        // a removed object, and adds the desired objects that are not installed or were removed.
+        template <typename T, typename Write, typename DependsOnRemoved>
+        void diffObjects(
+            const std::vector<T>& desired,
+            const std::vector<T>& installed,
+            Write write,
+            DependsOnRemoved dependsOnRemoved,
+            std::vector<T>& deletions,
+            std::vector<T>& additions,
+            std::set<Key>& removed)
+        {
+            auto desiredContent = encodeObjects(desired, write);
+            auto installedContent = encodeObjects(installed, write);
+
+            for (const auto& object : installed)
+            {
+                auto it = desiredContent.find(object.key);
+                if (it == desiredContent.end() || it->second != installedContent[object.key] || dependsOnRemoved(object))
+                {
+                    deletions.push_back(object);
+                    removed.insert(object.key);
+                }
+            }
+
+            for (const auto& object : desired)
+            {
+                if (installedContent.count(object.key) == 0 || removed.count(object.key) != 0)
+                {
+                    additions.push_back(object);
+                }
+            }
+        }
+
+        Changes changes(const Snapshot& desired, const Snapshot& installed)
+        {
+            Changes result{};
+            std::set<Key> providers{};
+            std::set<Key> sublayers{};
+            std::set<Key> callouts{};
+            std::set<Key> contexts{};
+            std::set<Key> filters{};
+
+            diffObjects(desired.providers, installed.providers, writeProvider,
+                [](const Provider&) { return false; },
+                result.deletions.providers, result.additions.providers, providers);
+
+            diffObjects(desired.sublayers, installed.sublayers, writeSublayer,
+                [&](const Sublayer& sublayer) { return providers.count(sublayer.providerKey) != 0; },
+                result.deletions.sublayers, result.additions.sublayers, sublayers);
+
+            diffObjects(desired.callouts, installed.callouts, writeCallout,
+                [&](const Callout& callout) { return providers.count(callout.providerKey) != 0; },
+                result.deletions.callouts, result.additions.callouts, callouts);
+
+            diffObjects(desired.providerContexts, installed.providerContexts, writeProviderContext,
+                [&](const ProviderContext& context) { return providers.count(context.providerKey) != 0; },
+                result.deletions.providerContexts, result.additions.providerContexts, contexts);
+
+            diffObjects(desired.filters, installed.filters, writeFilter,
+                [&](const Filter& filter)
+                {
+                    return providers.count(filter.providerKey) != 0 ||
+                        sublayers.count(filter.sublayerKey) != 0 ||
+                        callouts.count(filter.actionKey) != 0 ||
+                        contexts.count(filter.context) != 0;
+                },
+                result.deletions.filters, result.additions.filters, filters);
+
+            return result;
+        }
+
+        bool deletesFilterDependencies(const Changes& changes)
+        {
+            const auto& deletions = changes.deletions;
+
+            return !deletions.providers.empty() ||
+                !deletions.sublayers.empty() ||
+                !deletions.callouts.empty() ||
+                !deletions.providerContexts.empty();
+        }
+    }
+}
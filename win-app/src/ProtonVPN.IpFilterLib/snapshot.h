@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "ruleset.h"
+
+namespace ipfilter
+{
+    namespace snapshot
+    {
+        typedef ruleset::Key Key;
+
+        // Portable counterparts of the WFP objects, see fwpmtypes.h for the meaning of the fields.
+        // Optional keys are all zero when absent.
+        struct DisplayData
+        {
+            std::wstring name;
+            std::wstring description;
+        };
+
+        // FWP_VALUE0 or FWP_CONDITION_VALUE0 with its data in little endian byte order.
+        // A range holds its low and high values, each encoded as the type, length and data.
+        struct Value
+        {
+            uint32_t type{};
+            std::vector<uint8_t> data;
+        };
+
+        struct Provider
+        {
+            Key key{};
+            DisplayData displayData;
+            uint32_t flags{};
+            std::vector<uint8_t> providerData;
+            std::wstring serviceName;
+        };
+
+        struct Sublayer
+        {
+            Key key{};
+            DisplayData displayData;
+            uint32_t flags{};
+            Key providerKey{};
+            std::vector<uint8_t> providerData;
+            uint16_t weight{};
+        };
+
+        struct Callout
+        {
+            Key key{};
+            DisplayData displayData;
+            uint32_t flags{};
+            Key providerKey{};
+            std::vector<uint8_t> providerData;
+            Key applicableLayer{};
+        };
+
+        // Only general provider contexts, which carry a data buffer, are captured.
+        struct ProviderContext
+        {
+            Key key{};
+            DisplayData displayData;
+            uint32_t flags{};
+            Key providerKey{};
+            std::vector<uint8_t> providerData;
+            uint32_t type{};
+            std::vector<uint8_t> data;
+        };
+
+        struct Condition
+        {
+            Key fieldKey{};
+            uint32_t matchType{};
+            Value value;
+        };
+
+        struct Filter
+        {
+            Key key{};
+            DisplayData displayData;
+            uint32_t flags{};
+            Key providerKey{};
+            std::vector<uint8_t> providerData;
+            Key layerKey{};
+            Key sublayerKey{};
+            Value weight;
+            std::vector<Condition> conditions;
+            uint32_t actionType{};
+            // Filter type or callout key, depending on the action type.
+            Key actionKey{};
+            // Provider context key, or the raw context in the first 8 bytes.
+            Key context{};
+        };
+
+        // Objects are kept in the order they have to be added in.
+        struct Snapshot
+        {
+            std::vector<Provider> providers;
+            std::vector<Sublayer> sublayers;
+            std::vector<Callout> callouts;
+            std::vector<ProviderContext> providerContexts;
+            std::vector<Filter> filters;
+        };
+
+        // Each object is written with its length, so later versions can append fields
+        // that older readers skip.
+        std::vector<uint8_t> encode(const Snapshot& snapshot);
+
+        // Throws std::invalid_argument if the data is not a snapshot or is truncated.
+        Snapshot decode(const uint8_t* data, size_t size);
+
+        // Objects to delete, in reverse order, and to add so that the installed objects match the desired ones.
+        struct Changes
+        {
+            Snapshot deletions;
+            Snapshot additions;
+        };
+
+        // Objects whose content differs are replaced, along with the objects that depend on them:
+        // filters on their provider, sublayer, callout or provider context, and the other objects on their provider.
+        Changes changes(const Snapshot& desired, const Snapshot& installed);
+
+        // Whether the changes delete or replace an object filters depend on: a provider, sublayer,
+        // callout or provider context. Installed filters left out of a capture may still use it.
+        bool deletesFilterDependencies(const Changes& changes);
+    }
+}
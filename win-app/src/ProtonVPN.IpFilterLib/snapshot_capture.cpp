@@ -0,0 +1,830 @@
+#include "pch.h"
+#include "snapshot_capture.h"
+#include "engine.h"
+#include "filter.h"
+#include "filter_enumeration.h"
+
+#include <deque>
+#include <cstring>
+#include <stdexcept>
+
+namespace ipfilter
+{
+    snapshot::Key makeSnapshotKey(const GUID* guid)
+    {
+        snapshot::Key key{};
+        if (guid != nullptr)
+        {
+            std::memcpy(key.data(), guid, key.size());
+        }
+
+        return key;
+    }
+
+    GUID makeSnapshotGuid(const snapshot::Key& key)
+    {
+        GUID guid{};
+        std::memcpy(&guid, key.data(), key.size());
+
+        return guid;
+    }
+
+    std::wstring makeSnapshotString(const wchar_t* value)
+    {
+        return value != nullptr ? std::wstring(value) : std::wstring();
+    }
+
+    std::vector<uint8_t> makeSnapshotBytes(const void* data, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+
+        return size != 0 ? std::vector<uint8_t>(bytes, bytes + size) : std::vector<uint8_t>();
+    }
+
+    snapshot::DisplayData makeSnapshotDisplayData(const FWPM_DISPLAY_DATA0& displayData)
+    {
+        return {makeSnapshotString(displayData.name), makeSnapshotString(displayData.description)};
+    }
+
+    // Keeps the data that restored WFP objects point to alive until they are added.
+    class SnapshotStorage
+    {
+    public:
+        template <class T>
+        T* add(const T& value)
+        {
+            this->blocks.emplace_back(sizeof(T));
+            std::memcpy(this->blocks.back().data(), &value, sizeof(T));
+
+            return reinterpret_cast<T*>(this->blocks.back().data());
+        }
+
+        template <class T>
+        T* addArray(const std::vector<T>& values)
+        {
+            if (values.empty())
+            {
+                return nullptr;
+            }
+
+            this->blocks.emplace_back(sizeof(T) * values.size());
+            std::memcpy(this->blocks.back().data(), values.data(), sizeof(T) * values.size());
+
+            return reinterpret_cast<T*>(this->blocks.back().data());
+        }
+
+        uint8_t* addBytes(const std::vector<uint8_t>& data)
+        {
+            if (data.empty())
+            {
+                return nullptr;
+            }
+
+            this->blocks.push_back(data);
+
+            return this->blocks.back().data();
+        }
+
+        FWP_BYTE_BLOB makeBlob(const std::vector<uint8_t>& data)
+        {
+            return {static_cast<UINT32>(data.size()), this->addBytes(data)};
+        }
+
+        GUID* addKey(const snapshot::Key& key)
+        {
+            return key == snapshot::Key{} ? nullptr : this->add(makeSnapshotGuid(key));
+        }
+
+    private:
+        std::deque<std::vector<uint8_t>> blocks;
+    };
+
+    // Encodes the value types shared by FWP_VALUE0 and FWP_CONDITION_VALUE0.
+    // Returns false for types snapshots do not support.
+    template <class T>
+    bool encodeSnapshotValue(const T& value, snapshot::Value& result)
+    {
+        result.type = value.type;
+
+        switch (value.type)
+        {
+        case FWP_EMPTY:
+            result.data.clear();
+            return true;
+        case FWP_UINT8:
+            result.data = makeSnapshotBytes(&value.uint8, sizeof(value.uint8));
+            return true;
+        case FWP_UINT16:
+            result.data = makeSnapshotBytes(&value.uint16, sizeof(value.uint16));
+            return true;
+        case FWP_UINT32:
+            result.data = makeSnapshotBytes(&value.uint32, sizeof(value.uint32));
+            return true;
+        case FWP_UINT64:
+            result.data = makeSnapshotBytes(value.uint64, sizeof(*value.uint64));
+            return true;
+        case FWP_INT8:
+            result.data = makeSnapshotBytes(&value.int8, sizeof(value.int8));
+            return true;
+        case FWP_INT16:
+            result.data = makeSnapshotBytes(&value.int16, sizeof(value.int16));
+            return true;
+        case FWP_INT32:
+            result.data = makeSnapshotBytes(&value.int32, sizeof(value.int32));
+            return true;
+        case FWP_INT64:
+            result.data = makeSnapshotBytes(value.int64, sizeof(*value.int64));
+            return true;
+        case FWP_FLOAT:
+            result.data = makeSnapshotBytes(&value.float32, sizeof(value.float32));
+            return true;
+        case FWP_DOUBLE:
+            result.data = makeSnapshotBytes(value.double64, sizeof(*value.double64));
+            return true;
+        case FWP_BYTE_ARRAY16_TYPE:
+            result.data = makeSnapshotBytes(value.byteArray16, sizeof(*value.byteArray16));
+            return true;
+        case FWP_BYTE_ARRAY6_TYPE:
+            result.data = makeSnapshotBytes(value.byteArray6, sizeof(*value.byteArray6));
+            return true;
+        case FWP_BYTE_BLOB_TYPE:
+            result.data = makeSnapshotBytes(value.byteBlob->data, value.byteBlob->size);
+            return true;
+        case FWP_SECURITY_DESCRIPTOR_TYPE:
+            result.data = makeSnapshotBytes(value.sd->data, value.sd->size);
+            return true;
+        case FWP_TOKEN_ACCESS_INFORMATION_TYPE:
+            result.data = makeSnapshotBytes(value.tokenAccessInformation->data, value.tokenAccessInformation->size);
+            return true;
+        case FWP_SID:
+            result.data = makeSnapshotBytes(value.sid, GetLengthSid(value.sid));
+            return true;
+        case FWP_UNICODE_STRING_TYPE:
+            result.data = makeSnapshotBytes(value.unicodeString, (wcslen(value.unicodeString) + 1) * sizeof(wchar_t));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool encodeSnapshotConditionValue(const FWP_CONDITION_VALUE0& value, snapshot::Value& result)
+    {
+        switch (value.type)
+        {
+        case FWP_V4_ADDR_MASK:
+            result.type = value.type;
+            result.data = makeSnapshotBytes(value.v4AddrMask, sizeof(*value.v4AddrMask));
+            return true;
+        case FWP_V6_ADDR_MASK:
+            result.type = value.type;
+            result.data = makeSnapshotBytes(value.v6AddrMask, sizeof(*value.v6AddrMask));
+            return true;
+        case FWP_RANGE_TYPE:
+        {
+            snapshot::Value low{};
+            snapshot::Value high{};
+            if (!encodeSnapshotValue(value.rangeValue->valueLow, low) ||
+                !encodeSnapshotValue(value.rangeValue->valueHigh, high))
+            {
+                return false;
+            }
+
+            result.type = value.type;
+            result.data.clear();
+            for (const auto* bound : {&low, &high})
+            {
+                UINT32 header[2] = {bound->type, static_cast<UINT32>(bound->data.size())};
+                auto bytes = makeSnapshotBytes(header, sizeof(header));
+                result.data.insert(result.data.end(), bytes.begin(), bytes.end());
+                result.data.insert(result.data.end(), bound->data.begin(), bound->data.end());
+            }
+            return true;
+        }
+        default:
+            return encodeSnapshotValue(value, result);
+        }
+    }
+
+    template <class T>
+    T readSnapshotValue(const std::vector<uint8_t>& data)
+    {
+        if (data.size() != sizeof(T))
+        {
+            throw std::invalid_argument("Invalid snapshot value size");
+        }
+
+        T value{};
+        std::memcpy(&value, data.data(), sizeof(T));
+
+        return value;
+    }
+
+    template <class T>
+    void decodeSnapshotValue(const snapshot::Value& value, SnapshotStorage& storage, T& result)
+    {
+        result.type = static_cast<FWP_DATA_TYPE>(value.type);
+
+        switch (value.type)
+        {
+        case FWP_EMPTY:
+            break;
+        case FWP_UINT8:
+            result.uint8 = readSnapshotValue<UINT8>(value.data);
+            break;
+        case FWP_UINT16:
+            result.uint16 = readSnapshotValue<UINT16>(value.data);
+            break;
+        case FWP_UINT32:
+            result.uint32 = readSnapshotValue<UINT32>(value.data);
+            break;
+        case FWP_UINT64:
+            result.uint64 = storage.add(readSnapshotValue<UINT64>(value.data));
+            break;
+        case FWP_INT8:
+            result.int8 = readSnapshotValue<INT8>(value.data);
+            break;
+        case FWP_INT16:
+            result.int16 = readSnapshotValue<INT16>(value.data);
+            break;
+        case FWP_INT32:
+            result.int32 = readSnapshotValue<INT32>(value.data);
+            break;
+        case FWP_INT64:
+            result.int64 = storage.add(readSnapshotValue<INT64>(value.data));
+            break;
+        case FWP_FLOAT:
+            result.float32 = readSnapshotValue<float>(value.data);
+            break;
+        case FWP_DOUBLE:
+            result.double64 = storage.add(readSnapshotValue<double>(value.data));
+            break;
+        case FWP_BYTE_ARRAY16_TYPE:
+            result.byteArray16 = storage.add(readSnapshotValue<FWP_BYTE_ARRAY16>(value.data));
+            break;
+        case FWP_BYTE_ARRAY6_TYPE:
+            result.byteArray6 = storage.add(readSnapshotValue<FWP_BYTE_ARRAY6>(value.data));
+            break;
+        case FWP_BYTE_BLOB_TYPE:
+            result.byteBlob = storage.add(storage.makeBlob(value.data));
+            break;
+        case FWP_SECURITY_DESCRIPTOR_TYPE:
+            result.sd = storage.add(storage.makeBlob(value.data));
+            break;
+        case FWP_TOKEN_ACCESS_INFORMATION_TYPE:
+            result.tokenAccessInformation = storage.add(storage.makeBlob(value.data));
+            break;
+        case FWP_SID:
+            if (value.data.empty() || !IsValidSid(reinterpret_cast<PSID>(const_cast<uint8_t*>(value.data.data()))))
+            {
+                throw std::invalid_argument("Invalid snapshot SID");
+            }
+            result.sid = reinterpret_cast<SID*>(storage.addBytes(value.data));
+            break;
+        case FWP_UNICODE_STRING_TYPE:
+            if (value.data.size() < sizeof(wchar_t) ||
+                value.data.size() % sizeof(wchar_t) != 0 ||
+                value.data[value.data.size() - 1] != 0 ||
+                value.data[value.data.size() - 2] != 0)
+            {
+                throw std::invalid_argument("Invalid snapshot string");
+            }
+            result.unicodeString = reinterpret_cast<wchar_t*>(storage.addBytes(value.data));
+            break;
+        default:
+            throw std::invalid_argument("Unsupported snapshot value type");
+        }
+    }
+
+    void decodeSnapshotConditionValue(const snapshot::Value& value, SnapshotStorage& storage, FWP_CONDITION_VALUE0& result)
+    {
+        switch (value.type)
+        {
+        case FWP_V4_ADDR_MASK:
+            result.type = FWP_V4_ADDR_MASK;
+            result.v4AddrMask = storage.add(readSnapshotValue<FWP_V4_ADDR_AND_MASK>(value.data));
+            break;
+        case FWP_V6_ADDR_MASK:
+            result.type = FWP_V6_ADDR_MASK;
+            result.v6AddrMask = storage.add(readSnapshotValue<FWP_V6_ADDR_AND_MASK>(value.data));
+            break;
+        case FWP_RANGE_TYPE:
+        {
+            FWP_RANGE0 range{};
+            size_t offset = 0;
+
+            for (auto* bound : {&range.valueLow, &range.valueHigh})
+            {
+                UINT32 header[2] = {};
+                if (value.data.size() - offset < sizeof(header))
+                {
+                    throw std::invalid_argument("Invalid snapshot range");
+                }
+                std::memcpy(header, value.data.data() + offset, sizeof(header));
+                offset += sizeof(header);
+
+                if (value.data.size() - offset < header[1])
+                {
+                    throw std::invalid_argument("Invalid snapshot range");
+                }
+
+                snapshot::Value boundValue{};
+                boundValue.type = header[0];
+                boundValue.data = makeSnapshotBytes(value.data.data() + offset, header[1]);
+                offset += header[1];
+
+                decodeSnapshotValue(boundValue, storage, *bound);
+            }
+
+            result.type = FWP_RANGE_TYPE;
+            result.rangeValue = storage.add(range);
+            break;
+        }
+        default:
+            decodeSnapshotValue(value, storage, result);
+            break;
+        }
+    }
+
+    template <class Object, class Template, class Callback>
+    unsigned int enumSnapshotObjects(
+        HANDLE sessionHandle,
+        const Template& enumTemplate,
+        DWORD (WINAPI* createEnumHandle)(HANDLE, const Template*, HANDLE*),
+        DWORD (WINAPI* enumObjects)(HANDLE, HANDLE, UINT32, Object***, UINT32*),
+        DWORD (WINAPI* destroyEnumHandle)(HANDLE, HANDLE),
+        Callback callback)
+    {
+        HANDLE enumHandle = nullptr;
+
+        auto status = createEnumHandle(sessionHandle, &enumTemplate, &enumHandle);
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        while (true)
+        {
+            Object** objects{};
+            UINT32 objectCount{};
+
+            status = enumObjects(sessionHandle, enumHandle, EnumPageSize, &objects, &objectCount);
+            if (status == ERROR_SUCCESS)
+            {
+                for (UINT32 i = 0; i < objectCount; i++)
+                {
+                    callback(*objects[i]);
+                }
+            }
+
+            if (objects != nullptr)
+            {
+                FwpmFreeMemory0(reinterpret_cast<void**>(&objects));
+            }
+
+            if (status != ERROR_SUCCESS || objectCount == 0)
+            {
+                break;
+            }
+        }
+
+        destroyEnumHandle(sessionHandle, enumHandle);
+
+        return status;
+    }
+
+    bool isSnapshotProvider(const GUID* providerKey, const GUID& expected)
+    {
+        return providerKey != nullptr && *providerKey == expected;
+    }
+
+    unsigned int captureSnapshot(HANDLE sessionHandle, const GUID& providerKey, snapshot::Snapshot& result)
+    {
+        result = snapshot::Snapshot{};
+
+        FWPM_PROVIDER0* provider{};
+
+        auto status = FwpmProviderGetByKey0(sessionHandle, &providerKey, &provider);
+        if (status == FWP_E_PROVIDER_NOT_FOUND)
+        {
+            return ERROR_SUCCESS;
+        }
+
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        snapshot::Provider capturedProvider{};
+        capturedProvider.key = makeSnapshotKey(&provider->providerKey);
+        capturedProvider.displayData = makeSnapshotDisplayData(provider->displayData);
+        capturedProvider.flags = provider->flags;
+        capturedProvider.providerData = makeSnapshotBytes(provider->providerData.data, provider->providerData.size);
+        capturedProvider.serviceName = makeSnapshotString(provider->serviceName);
+        result.providers.push_back(capturedProvider);
+
+        FwpmFreeMemory0(reinterpret_cast<void**>(&provider));
+
+        FWPM_SUBLAYER_ENUM_TEMPLATE0 sublayerTemplate{};
+        sublayerTemplate.providerKey = const_cast<GUID*>(&providerKey);
+
+        status = enumSnapshotObjects(
+            sessionHandle,
+            sublayerTemplate,
+            FwpmSubLayerCreateEnumHandle0,
+            FwpmSubLayerEnum0,
+            FwpmSubLayerDestroyEnumHandle0,
+            [&](const FWPM_SUBLAYER0& sublayer)
+            {
+                if (!isSnapshotProvider(sublayer.providerKey, providerKey))
+                {
+                    return;
+                }
+
+                snapshot::Sublayer captured{};
+                captured.key = makeSnapshotKey(&sublayer.subLayerKey);
+                captured.displayData = makeSnapshotDisplayData(sublayer.displayData);
+                captured.flags = sublayer.flags;
+                captured.providerKey = makeSnapshotKey(sublayer.providerKey);
+                captured.providerData = makeSnapshotBytes(sublayer.providerData.data, sublayer.providerData.size);
+                captured.weight = sublayer.weight;
+                result.sublayers.push_back(captured);
+            });
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        FWPM_CALLOUT_ENUM_TEMPLATE0 calloutTemplate{};
+        calloutTemplate.providerKey = const_cast<GUID*>(&providerKey);
+
+        status = enumSnapshotObjects(
+            sessionHandle,
+            calloutTemplate,
+            FwpmCalloutCreateEnumHandle0,
+            FwpmCalloutEnum0,
+            FwpmCalloutDestroyEnumHandle0,
+            [&](const FWPM_CALLOUT0& callout)
+            {
+                if (!isSnapshotProvider(callout.providerKey, providerKey))
+                {
+                    return;
+                }
+
+                snapshot::Callout captured{};
+                captured.key = makeSnapshotKey(&callout.calloutKey);
+                captured.displayData = makeSnapshotDisplayData(callout.displayData);
+                captured.flags = callout.flags;
+                captured.providerKey = makeSnapshotKey(callout.providerKey);
+                captured.providerData = makeSnapshotBytes(callout.providerData.data, callout.providerData.size);
+                captured.applicableLayer = makeSnapshotKey(&callout.applicableLayer);
+                result.callouts.push_back(captured);
+            });
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        FWPM_PROVIDER_CONTEXT_ENUM_TEMPLATE0 contextTemplate{};
+        contextTemplate.providerKey = const_cast<GUID*>(&providerKey);
+        contextTemplate.providerContextType = FWPM_GENERAL_CONTEXT;
+
+        status = enumSnapshotObjects(
+            sessionHandle,
+            contextTemplate,
+            FwpmProviderContextCreateEnumHandle0,
+            FwpmProviderContextEnum0,
+            FwpmProviderContextDestroyEnumHandle0,
+            [&](const FWPM_PROVIDER_CONTEXT0& context)
+            {
+                if (!isSnapshotProvider(context.providerKey, providerKey) ||
+                    context.type != FWPM_GENERAL_CONTEXT ||
+                    context.dataBuffer == nullptr)
+                {
+                    return;
+                }
+
+                snapshot::ProviderContext captured{};
+                captured.key = makeSnapshotKey(&context.providerContextKey);
+                captured.displayData = makeSnapshotDisplayData(context.displayData);
+                captured.flags = context.flags;
+                captured.providerKey = makeSnapshotKey(context.providerKey);
+                captured.providerData = makeSnapshotBytes(context.providerData.data, context.providerData.size);
+                captured.type = context.type;
+                captured.data = makeSnapshotBytes(context.dataBuffer->data, context.dataBuffer->size);
+                result.providerContexts.push_back(captured);
+            });
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        // Filters with values snapshots cannot hold are left out and reported once enumeration ends.
+        auto unsupported = false;
+
+        SessionEngine engine(sessionHandle);
+        FilterQuery query{&providerKey, nullptr, nullptr};
+
+        status = forEachFilter(engine, IPFilterGetLayerKeys(), query, [&](const FWPM_FILTER0& filter)
+        {
+            snapshot::Filter captured{};
+            captured.key = makeSnapshotKey(&filter.filterKey);
+            captured.displayData = makeSnapshotDisplayData(filter.displayData);
+            captured.flags = filter.flags;
+            captured.providerKey = makeSnapshotKey(filter.providerKey);
+            captured.providerData = makeSnapshotBytes(filter.providerData.data, filter.providerData.size);
+            captured.layerKey = makeSnapshotKey(&filter.layerKey);
+            captured.sublayerKey = makeSnapshotKey(&filter.subLayerKey);
+            captured.actionType = filter.action.type;
+            captured.actionKey = makeSnapshotKey(&filter.action.calloutKey);
+            captured.context = makeSnapshotKey(&filter.providerContextKey);
+
+            auto supported = encodeSnapshotValue(filter.weight, captured.weight);
+            for (UINT32 i = 0; supported && i < filter.numFilterConditions; i++)
+            {
+                const auto& condition = filter.filterCondition[i];
+
+                snapshot::Condition capturedCondition{};
+                capturedCondition.fieldKey = makeSnapshotKey(&condition.fieldKey);
+                capturedCondition.matchType = condition.matchType;
+                supported = encodeSnapshotConditionValue(condition.conditionValue, capturedCondition.value);
+                captured.conditions.push_back(capturedCondition);
+            }
+
+            if (!supported)
+            {
+                unsupported = true;
+                return;
+            }
+
+            result.filters.push_back(captured);
+        });
+        if (status != ERROR_SUCCESS)
+        {
+            return status;
+        }
+
+        return unsupported ? ERROR_NOT_SUPPORTED : ERROR_SUCCESS;
+    }
+
+    template <class T>
+    void appendSnapshotObjects(std::vector<T>& target, const std::vector<T>& source)
+    {
+        target.insert(target.end(), source.begin(), source.end());
+    }
+
+    bool isSnapshotObjectAdded(unsigned int status)
+    {
+        return status == ERROR_SUCCESS || status == FWP_E_ALREADY_EXISTS;
+    }
+
+    bool isSnapshotObjectDeleted(unsigned int status, unsigned int notFound)
+    {
+        return status == ERROR_SUCCESS || status == notFound;
+    }
+
+    // Clears the flags the engine maintains itself, which are not restored and must not count as changes.
+    void clearSnapshotStateFlags(snapshot::Snapshot& snapshot)
+    {
+        for (auto& provider : snapshot.providers)
+        {
+            provider.flags &= ~FWPM_PROVIDER_FLAG_DISABLED;
+        }
+
+        for (auto& callout : snapshot.callouts)
+        {
+            callout.flags &= ~FWPM_CALLOUT_FLAG_REGISTERED;
+        }
+    }
+
+    unsigned int restoreSnapshot(HANDLE sessionHandle, const snapshot::Snapshot& snapshot)
+    {
+        auto desired = snapshot;
+        snapshot::Snapshot installed{};
+        auto partial = false;
+
+        for (const auto& provider : snapshot.providers)
+        {
+            snapshot::Snapshot current{};
+
+            // Filters left out of the capture are added again and already exist, which is tolerated below.
+            auto status = captureSnapshot(sessionHandle, makeSnapshotGuid(provider.key), current);
+            if (status != ERROR_SUCCESS && status != ERROR_NOT_SUPPORTED)
+            {
+                return status;
+            }
+
+            partial = partial || status == ERROR_NOT_SUPPORTED;
+
+            appendSnapshotObjects(installed.providers, current.providers);
+            appendSnapshotObjects(installed.sublayers, current.sublayers);
+            appendSnapshotObjects(installed.callouts, current.callouts);
+            appendSnapshotObjects(installed.providerContexts, current.providerContexts);
+            appendSnapshotObjects(installed.filters, current.filters);
+        }
+
+        clearSnapshotStateFlags(desired);
+        clearSnapshotStateFlags(installed);
+
+        auto changes = snapshot::changes(desired, installed);
+        const auto& pending = changes.additions;
+        const auto& extra = changes.deletions;
+
+        // Filters left out of the capture are not deleted and would keep their provider, sublayer,
+        // callout or provider context in use, so such changes are refused before touching the engine.
+        if (partial && snapshot::deletesFilterDependencies(changes))
+        {
+            return ERROR_NOT_SUPPORTED;
+        }
+
+        // Everything is converted before the transaction starts, so malformed values throw without touching the engine.
+        SnapshotStorage storage{};
+
+        std::vector<FWPM_PROVIDER0> providers{};
+        for (const auto& source : pending.providers)
+        {
+            FWPM_PROVIDER0 provider{};
+            provider.providerKey = makeSnapshotGuid(source.key);
+            provider.displayData.name = const_cast<wchar_t*>(source.displayData.name.c_str());
+            provider.displayData.description = const_cast<wchar_t*>(source.displayData.description.c_str());
+            provider.flags = source.flags;
+            provider.providerData = storage.makeBlob(source.providerData);
+            provider.serviceName = source.serviceName.empty() ? nullptr : const_cast<wchar_t*>(source.serviceName.c_str());
+            providers.push_back(provider);
+        }
+
+        std::vector<FWPM_SUBLAYER0> sublayers{};
+        for (const auto& source : pending.sublayers)
+        {
+            FWPM_SUBLAYER0 sublayer{};
+            sublayer.subLayerKey = makeSnapshotGuid(source.key);
+            sublayer.displayData.name = const_cast<wchar_t*>(source.displayData.name.c_str());
+            sublayer.displayData.description = const_cast<wchar_t*>(source.displayData.description.c_str());
+            sublayer.flags = source.flags;
+            sublayer.providerKey = storage.addKey(source.providerKey);
+            sublayer.providerData = storage.makeBlob(source.providerData);
+            sublayer.weight = source.weight;
+            sublayers.push_back(sublayer);
+        }
+
+        std::vector<FWPM_CALLOUT0> callouts{};
+        for (const auto& source : pending.callouts)
+        {
+            FWPM_CALLOUT0 callout{};
+            callout.calloutKey = makeSnapshotGuid(source.key);
+            callout.displayData.name = const_cast<wchar_t*>(source.displayData.name.c_str());
+            callout.displayData.description = const_cast<wchar_t*>(source.displayData.description.c_str());
+            callout.flags = source.flags;
+            callout.providerKey = storage.addKey(source.providerKey);
+            callout.providerData = storage.makeBlob(source.providerData);
+            callout.applicableLayer = makeSnapshotGuid(source.applicableLayer);
+            callouts.push_back(callout);
+        }
+
+        std::vector<FWPM_PROVIDER_CONTEXT0> contexts{};
+        for (const auto& source : pending.providerContexts)
+        {
+            FWPM_PROVIDER_CONTEXT0 context{};
+            context.providerContextKey = makeSnapshotGuid(source.key);
+            context.displayData.name = const_cast<wchar_t*>(source.displayData.name.c_str());
+            context.displayData.description = const_cast<wchar_t*>(source.displayData.description.c_str());
+            context.flags = source.flags;
+            context.providerKey = storage.addKey(source.providerKey);
+            context.providerData = storage.makeBlob(source.providerData);
+            context.type = static_cast<FWPM_PROVIDER_CONTEXT_TYPE>(source.type);
+            context.dataBuffer = storage.add(storage.makeBlob(source.data));
+            contexts.push_back(context);
+        }
+
+        std::vector<FWPM_FILTER0> filters{};
+        for (const auto& source : pending.filters)
+        {
+            FWPM_FILTER0 filter{};
+            filter.filterKey = makeSnapshotGuid(source.key);
+            filter.displayData.name = const_cast<wchar_t*>(source.displayData.name.c_str());
+            filter.displayData.description = const_cast<wchar_t*>(source.displayData.description.c_str());
+            filter.flags = source.flags;
+            filter.providerKey = storage.addKey(source.providerKey);
+            filter.providerData = storage.makeBlob(source.providerData);
+            filter.layerKey = makeSnapshotGuid(source.layerKey);
+            filter.subLayerKey = makeSnapshotGuid(source.sublayerKey);
+            decodeSnapshotValue(source.weight, storage, filter.weight);
+            filter.action.type = source.actionType;
+            filter.action.calloutKey = makeSnapshotGuid(source.actionKey);
+            filter.providerContextKey = makeSnapshotGuid(source.context);
+
+            std::vector<FWPM_FILTER_CONDITION0> conditions(source.conditions.size());
+            for (size_t i = 0; i < conditions.size(); i++)
+            {
+                conditions[i].fieldKey = makeSnapshotGuid(source.conditions[i].fieldKey);
+                conditions[i].matchType = static_cast<FWP_MATCH_TYPE>(source.conditions[i].matchType);
+                decodeSnapshotConditionValue(source.conditions[i].value, storage, conditions[i].conditionValue);
+            }
+
+            filter.numFilterConditions = static_cast<UINT32>(conditions.size());
+            filter.filterCondition = storage.addArray(conditions);
+
+            filters.push_back(filter);
+        }
+
+        SessionEngine engine(sessionHandle);
+
+        return transact(engine, [&]()
+        {
+            for (const auto& filter : extra.filters)
+            {
+                auto status = engine.deleteFilter(makeSnapshotGuid(filter.key));
+                if (!isSnapshotObjectDeleted(status, FWP_E_FILTER_NOT_FOUND))
+                {
+                    return status;
+                }
+            }
+
+            for (const auto& context : extra.providerContexts)
+            {
+                auto key = makeSnapshotGuid(context.key);
+                auto status = FwpmProviderContextDeleteByKey0(sessionHandle, &key);
+                if (!isSnapshotObjectDeleted(status, FWP_E_PROVIDER_CONTEXT_NOT_FOUND))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& callout : extra.callouts)
+            {
+                auto key = makeSnapshotGuid(callout.key);
+                auto status = FwpmCalloutDeleteByKey0(sessionHandle, &key);
+                if (!isSnapshotObjectDeleted(status, FWP_E_CALLOUT_NOT_FOUND))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& sublayer : extra.sublayers)
+            {
+                auto key = makeSnapshotGuid(sublayer.key);
+                auto status = FwpmSubLayerDeleteByKey0(sessionHandle, &key);
+                if (!isSnapshotObjectDeleted(status, FWP_E_SUBLAYER_NOT_FOUND))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& provider : extra.providers)
+            {
+                auto key = makeSnapshotGuid(provider.key);
+                auto status = FwpmProviderDeleteByKey0(sessionHandle, &key);
+                if (!isSnapshotObjectDeleted(status, FWP_E_PROVIDER_NOT_FOUND))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& provider : providers)
+            {
+                auto status = FwpmProviderAdd0(sessionHandle, &provider, nullptr);
+                if (!isSnapshotObjectAdded(status))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& sublayer : sublayers)
+            {
+                auto status = FwpmSubLayerAdd0(sessionHandle, &sublayer, nullptr);
+                if (!isSnapshotObjectAdded(status))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& callout : callouts)
+            {
+                auto status = FwpmCalloutAdd0(sessionHandle, &callout, nullptr, nullptr);
+                if (!isSnapshotObjectAdded(status))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& context : contexts)
+            {
+                auto status = FwpmProviderContextAdd0(sessionHandle, &context, nullptr, nullptr);
+                if (!isSnapshotObjectAdded(status))
+                {
+                    return static_cast<unsigned int>(status);
+                }
+            }
+
+            for (const auto& filter : filters)
+            {
+                auto status = engine.addFilter(filter);
+                if (!isSnapshotObjectAdded(status))
+                {
+                    return status;
+                }
+            }
+
+            return static_cast<unsigned int>(ERROR_SUCCESS);
+        });
+    }
+}
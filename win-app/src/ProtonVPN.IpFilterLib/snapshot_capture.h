@@ -0,0 +1,19 @@
+#pragma once
+#include <fwptypes.h>
+#include <fwpmu.h>
+
+#include "snapshot.h"
+
+namespace ipfilter
+{
+    // Reads the provider with its sublayers, callouts, general provider contexts and filters
+    // on the IPFilterLayer layers. Objects are enumerated in pages of EnumPageSize.
+    unsigned int captureSnapshot(HANDLE sessionHandle, const GUID& providerKey, snapshot::Snapshot& result);
+
+    // Makes the installed objects of the snapshot providers match the snapshot, in one transaction.
+    // Objects added since the snapshot are deleted, changed objects are replaced and missing ones added.
+    // Installed objects are found with one capture per provider of the snapshot. When a capture leaves
+    // out filters it cannot represent, ERROR_NOT_SUPPORTED is returned without changing anything
+    // if the restore would delete or replace a provider, sublayer, callout or provider context.
+    unsigned int restoreSnapshot(HANDLE sessionHandle, const snapshot::Snapshot& snapshot);
+}
@@ -0,0 +1,54 @@
+#include "transaction.h"
+
+namespace ipfilter
+{
+    unsigned int transact(TransactionEngine& engine, const std::function<unsigned int()>& action)
+    {
+        bool ownsTransaction{};
+
+        return transact(engine, action, ownsTransaction);
+    }
+
+    unsigned int transact(
+        TransactionEngine& engine,
+        const std::function<unsigned int()>& action,
+        bool& ownsTransaction)
+    {
+        ownsTransaction = false;
+
+        auto result = engine.beginTransaction();
+        if (result != 0 && result != TransactionInProgressResult)
+        {
+            return result;
+        }
+
+        ownsTransaction = result == 0;
+
+        try
+        {
+            result = action();
+        }
+        catch (...)
+        {
+            if (ownsTransaction)
+            {
+                engine.abortTransaction();
+            }
+
+            throw;
+        }
+
+        if (!ownsTransaction)
+        {
+            return result;
+        }
+
+        if (result != 0)
+        {
+            engine.abortTransaction();
+            return result;
+        }
+
+        return engine.commitTransaction();
+    }
+}
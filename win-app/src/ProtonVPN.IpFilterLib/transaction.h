@@ -0,0 +1,34 @@
+#pragma once
+#include <functional>
+
+namespace ipfilter
+{
+    // Transaction boundaries of a filter engine session. Engine adds the filter operations,
+    // the transaction logic only depends on this part and builds without the Windows SDK.
+    class TransactionEngine
+    {
+    public:
+        virtual ~TransactionEngine() = default;
+
+        virtual unsigned int beginTransaction() = 0;
+
+        virtual unsigned int commitTransaction() = 0;
+
+        virtual unsigned int abortTransaction() = 0;
+    };
+
+    // Returned by beginTransaction when the session already has a transaction open,
+    // the value of FWP_E_TXN_IN_PROGRESS.
+    const unsigned int TransactionInProgressResult = 0x8032000E;
+
+    // Runs the action inside a transaction. When the session already has a
+    // transaction open the action joins it and committing is left to its owner.
+    unsigned int transact(TransactionEngine& engine, const std::function<unsigned int()>& action);
+
+    // Like transact, also reports whether the action ran in a transaction of its own,
+    // in which case its changes are committed once it returns successfully.
+    unsigned int transact(
+        TransactionEngine& engine,
+        const std::function<unsigned int()>& action,
+        bool& ownsTransaction);
+}
@@ -1,9 +1,17 @@
 #include "pch.h"
 #include <fwpmu.h>
-#include <stdexcept>
-#include <winsock.h>
+#include <cstring>
 
 #include "value.h"
+#include "app_id_cache.h"
+
+#ifndef IPPROTO_TCP
+#define IPPROTO_TCP 6
+#endif
+
+#ifndef IPPROTO_UDP
+#define IPPROTO_UDP 17
+#endif
 
 #ifndef IPPROTO_ICMPV6
 #define IPPROTO_ICMPV6 58
@@ -13,146 +21,88 @@ namespace ipfilter
 {
     namespace value
     {
-        IpAddressV4::IpAddressV4(const ip::AddressV4& addr): addr(addr)
-        {
-        }
-
-        IpAddressV4::operator FWP_CONDITION_VALUE()
-        {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT32;
-            value.uint32 = htonl(this->addr.uint32());
-
-            return value;
-        }
-
-        IpNetworkAddressV4::IpNetworkAddressV4(
-            const ip::AddressV4& addr,
-            const ip::AddressV4& mask)
-        {
-            this->addr.addr = htonl(addr.uint32());
-            this->addr.mask = htonl(mask.uint32());
-        }
-
-        IpNetworkAddressV4::operator FWP_CONDITION_VALUE()
+        namespace
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_V4_ADDR_MASK;
-            value.v4AddrMask = &this->addr;
-
-            return value;
-        }
+            // FWP expects IPv4 addresses as numbers in host byte order.
+            UINT32 toUint32(const ip::AddressV4& addr)
+            {
+                auto bytes = addr.toBytes();
 
-        IpAddressV6::IpAddressV6(const ip::AddressV6& addr) : addr(addr)
-        {
+                return (static_cast<UINT32>(bytes[0]) << 24) |
+                    (static_cast<UINT32>(bytes[1]) << 16) |
+                    (static_cast<UINT32>(bytes[2]) << 8) |
+                    static_cast<UINT32>(bytes[3]);
+            }
         }
 
-        IpAddressV6::operator FWP_CONDITION_VALUE()
+        Value::Value(FWP_DATA_TYPE type): type(type), payload{}
         {
-            FWP_CONDITION_VALUE value{};
-            value.type = FWP_BYTE_ARRAY16_TYPE;
-
-            auto bytes = addr.toBytes();
-            auto* holder = new FWP_BYTE_ARRAY16{};
-
-            std::memcpy(holder->byteArray16, bytes.data(), 16);
-
-            value.byteArray16 = holder;
-
-            return value;
         }
 
-        IpAddressV6WithPrefix::IpAddressV6WithPrefix(const ip::AddressV6& addr) : addr(addr)
+        FWP_DATA_TYPE Value::getType() const
         {
+            return this->type;
         }
 
-        IpAddressV6WithPrefix::operator FWP_CONDITION_VALUE()
+        const Payload& Value::getPayload() const
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_V6_ADDR_MASK;
-            
-            auto* mask = new FWP_V6_ADDR_AND_MASK{};
-            auto bytes = addr.toBytes();
-            std::memcpy(mask->addr, bytes.data(), 16);
-            mask->prefixLength = addr.prefix();
-
-            value.v6AddrMask = mask;
-
-            return value;
+            return this->payload;
         }
 
-        Port::Port(unsigned short number): number(number)
+        const std::vector<uint8_t>* Value::getBlob() const
         {
+            return this->blob.get();
         }
 
-        Port::operator FWP_CONDITION_VALUE()
+        IpAddressV4::IpAddressV4(const ip::AddressV4& addr): Value(FWP_UINT32)
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT16;
-            value.uint16 = this->number;
-
-            return value;
+            this->payload.uint32 = toUint32(addr);
         }
 
-        IcmpCode::IcmpCode(unsigned short code) : code(code)
+        IpNetworkAddressV4::IpNetworkAddressV4(
+            const ip::AddressV4& addr,
+            const ip::AddressV4& mask): Value(FWP_V4_ADDR_MASK)
         {
+            this->payload.v4AddrMask.addr = toUint32(addr);
+            this->payload.v4AddrMask.mask = toUint32(mask);
         }
 
-        IcmpCode::operator FWP_CONDITION_VALUE()
+        IpAddressV6::IpAddressV6(const ip::AddressV6& addr): Value(FWP_BYTE_ARRAY16_TYPE)
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT16;
-            value.uint16 = this->code;
-
-            return value;
+            auto bytes = addr.toBytes();
+            std::memcpy(this->payload.byteArray16.byteArray16, bytes.data(), bytes.size());
         }
 
-        IcmpType::IcmpType(unsigned short type) : type(type)
+        IpAddressV6WithPrefix::IpAddressV6WithPrefix(const ip::AddressV6& addr): Value(FWP_V6_ADDR_MASK)
         {
+            auto bytes = addr.toBytes();
+            std::memcpy(this->payload.v6AddrMask.addr, bytes.data(), bytes.size());
+            this->payload.v6AddrMask.prefixLength = addr.prefix();
         }
 
-        IcmpType::operator FWP_CONDITION_VALUE()
+        Port::Port(unsigned short number): Value(FWP_UINT16)
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT16;
-            value.uint16 = this->type;
-
-            return value;
+            this->payload.uint16 = number;
         }
 
-        IcmpProtocol::IcmpProtocol()
+        IcmpCode::IcmpCode(unsigned short code): Value(FWP_UINT16)
         {
+            this->payload.uint16 = code;
         }
 
-        IcmpProtocol::operator FWP_CONDITION_VALUE()
+        IcmpType::IcmpType(unsigned short type): Value(FWP_UINT16)
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT8;
-            value.uint8 = IPPROTO_ICMPV6;
-
-            return value;
+            this->payload.uint16 = type;
         }
 
-        TcpProtocol::TcpProtocol(uint8_t protocol):
-            protocol(protocol)
+        IcmpProtocol::IcmpProtocol(): Value(FWP_UINT8)
         {
+            this->payload.uint8 = IPPROTO_ICMPV6;
         }
 
-        TcpProtocol::operator FWP_CONDITION_VALUE()
+        TcpProtocol::TcpProtocol(uint8_t protocol): Value(FWP_UINT8)
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT8;
-            value.uint16 = this->protocol;
-
-            return value;
+            this->payload.uint8 = protocol;
         }
 
         TcpProtocol TcpProtocol::udp()
@@ -165,18 +115,9 @@ namespace ipfilter
             return TcpProtocol(IPPROTO_TCP);
         }
 
-        Flag::Flag(uint32_t flag): flag(flag)
-        {
-        }
-
-        Flag::operator FWP_CONDITION_VALUE()
+        Flag::Flag(uint32_t flag): Value(FWP_UINT32)
         {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT32;
-            value.uint32 = this->flag;
-
-            return value;
+            this->payload.uint32 = flag;
         }
 
         Flag Flag::loopback()
@@ -184,83 +125,25 @@ namespace ipfilter
             return Flag(FWP_CONDITION_FLAG_IS_LOOPBACK);
         }
 
-        ApplicationId::operator FWP_CONDITION_VALUE()
-        {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_BYTE_BLOB_TYPE;
-            value.byteBlob = &this->blob;
-
-            return value;
-        }
-
         ApplicationId ApplicationId::fromFilePath(const std::wstring& path)
         {
-            FWP_BYTE_BLOB* byteBlob = nullptr;
-
-            auto result = FwpmGetAppIdFromFileName(path.c_str(), &byteBlob);
-            if (result != ERROR_SUCCESS)
-            {
-                throw std::runtime_error("Application id resolution failed");
-            }
-
-            ApplicationId id(*byteBlob);
-
-            FwpmFreeMemory(reinterpret_cast<void **>(&byteBlob));
-
-            return id;
-        }
-
-        ApplicationId::ApplicationId(const FWP_BYTE_BLOB& blob):
-            value(Buffer(blob.data, blob.size)),
-            blob({static_cast<UINT32>(this->value.size()), this->value.data()})
-        {
+            return ApplicationId(getAppIdCache().get(path));
         }
 
-        ApplicationId::ApplicationId(const ApplicationId& other):
-            value(other.value), blob({
-                static_cast<UINT32>(this->value.size()),
-                this->value.data()
-            })
+        ApplicationId::ApplicationId(const std::shared_ptr<const std::vector<uint8_t>>& appId):
+            Value(FWP_BYTE_BLOB_TYPE)
         {
+            this->blob = appId;
         }
 
-        ApplicationId::ApplicationId(ApplicationId&& other):
-            value(std::move(other.value)), blob({
-                static_cast<UINT32>(this->value.size()),
-                this->value.data()
-            })
+        NetInterfaceId::NetInterfaceId(uint64_t localId): Value(FWP_UINT64)
         {
-            other.blob.data = nullptr;
-            other.blob.size = 0;
+            this->payload.uint64 = localId;
         }
 
-        NetInterfaceId::NetInterfaceId(uint64_t localId): localId(localId)
+        NetInterfaceIndex::NetInterfaceIndex(ULONG index): Value(FWP_UINT32)
         {
-        }
-
-        NetInterfaceId::operator FWP_CONDITION_VALUE()
-        {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT64;
-            value.uint64 = &this->localId;
-
-            return value;
-        }
-
-        NetInterfaceIndex::NetInterfaceIndex(ULONG index): index(index)
-        {
-        }
-
-        NetInterfaceIndex::operator FWP_CONDITION_VALUE()
-        {
-            FWP_CONDITION_VALUE value{};
-
-            value.type = FWP_UINT32;
-            value.uint32 = this->index;
-
-            return value;
+            this->payload.uint32 = index;
         }
     }
 }
@@ -1,170 +1,134 @@
 #pragma once
 #include <fwptypes.h>
 
-#include "buffer.h"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
 #include "ip.h"
 
 namespace ipfilter
 {
     namespace value
     {
+        // Inline storage for every fixed size payload used in filter conditions.
+        union Payload
+        {
+            UINT8 uint8;
+            UINT16 uint16;
+            UINT32 uint32;
+            UINT64 uint64;
+            FWP_V4_ADDR_AND_MASK v4AddrMask;
+            FWP_BYTE_ARRAY16 byteArray16;
+            FWP_V6_ADDR_AND_MASK v6AddrMask;
+        };
+
+        // Condition value stored as a tagged union. Values are copied without heap allocations,
+        // byte blobs are immutable and shared between copies.
         class Value
         {
         public:
-            virtual operator FWP_CONDITION_VALUE() = 0;
+            FWP_DATA_TYPE getType() const;
+
+            const Payload& getPayload() const;
+
+            const std::vector<uint8_t>* getBlob() const;
+
+        protected:
+            Value(FWP_DATA_TYPE type);
+
+            FWP_DATA_TYPE type;
+            Payload payload;
+            std::shared_ptr<const std::vector<uint8_t>> blob;
         };
 
         class IpAddressV4 : public Value
         {
         public:
             IpAddressV4(const ip::AddressV4& addr);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            ip::AddressV4 addr;
         };
 
         class IpNetworkAddressV4 : public Value
         {
         public:
             IpNetworkAddressV4(const ip::AddressV4& addr, const ip::AddressV4& mask);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            FWP_V4_ADDR_AND_MASK addr;
         };
 
         class IpAddressV6 : public Value
         {
         public:
             IpAddressV6(const ip::AddressV6& addr);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            ip::AddressV6 addr;
         };
 
         class IpAddressV6WithPrefix : public Value
         {
         public:
             IpAddressV6WithPrefix(const ip::AddressV6& addr);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            ip::AddressV6 addr;
         };
 
         class Port : public Value
         {
         public:
             Port(unsigned short number);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            unsigned short number;
         };
 
         class IcmpCode : public Value
         {
         public:
             IcmpCode(unsigned short code);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            unsigned short code;
         };
 
         class IcmpType : public Value
         {
         public:
             IcmpType(unsigned short type);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            unsigned short type;
         };
 
         class IcmpProtocol : public Value
         {
         public:
             IcmpProtocol();
-
-            virtual operator FWP_CONDITION_VALUE();
         };
 
         class TcpProtocol : public Value
         {
         public:
-            virtual operator FWP_CONDITION_VALUE();
-
             static TcpProtocol udp();
 
             static TcpProtocol tcp();
 
         private:
             TcpProtocol(uint8_t protocol);
-
-            uint8_t protocol;
         };
 
         class Flag : public Value
         {
         public:
-            virtual operator FWP_CONDITION_VALUE();
-
             static Flag loopback();
 
         private:
             Flag(uint32_t flag);
-
-            uint32_t flag;
         };
 
         class ApplicationId : public Value
         {
         public:
-            virtual operator FWP_CONDITION_VALUE();
-
             static ApplicationId fromFilePath(const std::wstring& path);
 
-            ApplicationId(const ApplicationId& other);
-
-            ApplicationId(ApplicationId&& other);
-
         private:
-            ApplicationId(const FWP_BYTE_BLOB& blob);
-
-            Buffer value;
-            FWP_BYTE_BLOB blob;
+            ApplicationId(const std::shared_ptr<const std::vector<uint8_t>>& appId);
         };
 
         class NetInterfaceId : public Value
         {
         public:
             NetInterfaceId(uint64_t localId);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            uint64_t localId;
         };
 
         class NetInterfaceIndex : public Value
         {
         public:
             NetInterfaceIndex(ULONG index);
-
-            virtual operator FWP_CONDITION_VALUE();
-
-        private:
-            ULONG index;
         };
     }
 }
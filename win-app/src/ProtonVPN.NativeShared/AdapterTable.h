@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <unordered_map>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Fields of IP_ADAPTER_ADDRESSES used by the network utilities and the IP filter.
+        // The index is the IPv4 interface index, zero if IPv4 is not enabled on the adapter.
+        struct AdapterRecord
+        {
+            std::string name;
+            uint64_t luid{};
+            uint32_t index{};
+            uint32_t ipv4Metric{};
+            uint32_t ipv6Metric{};
+        };
+
+        // Adapters read with a single enumeration, indexed by interface index, LUID and name.
+        // Shared by ProtonVPN.NetworkUtil and ProtonVPN.IpFilterLib, so it is kept header only.
+        class AdapterTable
+        {
+        public:
+            AdapterTable() = default;
+
+            explicit AdapterTable(std::vector<AdapterRecord> adapters): adapters(std::move(adapters))
+            {
+                for (size_t i = 0; i < this->adapters.size(); i++)
+                {
+                    const auto& adapter = this->adapters[i];
+
+                    if (adapter.index != 0)
+                    {
+                        this->byIndex.emplace(adapter.index, i);
+                    }
+
+                    this->byLuid.emplace(adapter.luid, i);
+                    this->byName.emplace(adapter.name, i);
+                }
+            }
+
+            bool empty() const
+            {
+                return this->adapters.empty();
+            }
+
+            const std::vector<AdapterRecord>& records() const
+            {
+                return this->adapters;
+            }
+
+            const AdapterRecord* findByIndex(uint32_t index) const
+            {
+                auto it = this->byIndex.find(index);
+
+                return it != this->byIndex.end() ? &this->adapters[it->second] : nullptr;
+            }
+
+            const AdapterRecord* findByLuid(uint64_t luid) const
+            {
+                auto it = this->byLuid.find(luid);
+
+                return it != this->byLuid.end() ? &this->adapters[it->second] : nullptr;
+            }
+
+            const AdapterRecord* findByName(const std::string& name) const
+            {
+                auto it = this->byName.find(name);
+
+                return it != this->byName.end() ? &this->adapters[it->second] : nullptr;
+            }
+
+        private:
+            std::vector<AdapterRecord> adapters;
+            std::unordered_map<uint32_t, size_t> byIndex;
+            std::unordered_map<uint64_t, size_t> byLuid;
+            std::unordered_map<std::string, size_t> byName;
+        };
+    }
+}
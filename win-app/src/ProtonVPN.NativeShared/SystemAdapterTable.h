@@ -0,0 +1,71 @@
+#pragma once
+
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+
+#include "AdapterTable.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Reads the adapters of both address families with one GetAdaptersAddresses call, skipping
+        // the address lists and names that are not part of the table. Returns the Win32 error on failure.
+        inline DWORD ReadAdapterTable(AdapterTable& table)
+        {
+            const ULONG flags = GAA_FLAG_SKIP_UNICAST |
+                GAA_FLAG_SKIP_ANYCAST |
+                GAA_FLAG_SKIP_MULTICAST |
+                GAA_FLAG_SKIP_DNS_SERVER |
+                GAA_FLAG_SKIP_FRIENDLY_NAME;
+
+            // Large enough for most systems, so the size probe is usually not needed.
+            ULONG size = 16 * 1024;
+            std::vector<char> data{};
+            DWORD status{};
+
+            // The adapter list can grow between the calls.
+            do
+            {
+                data.resize(size);
+                status = GetAdaptersAddresses(
+                    AF_UNSPEC,
+                    flags,
+                    nullptr,
+                    reinterpret_cast<PIP_ADAPTER_ADDRESSES>(data.data()),
+                    &size);
+            } while (status == ERROR_BUFFER_OVERFLOW);
+
+            if (status == ERROR_NO_DATA)
+            {
+                table = AdapterTable();
+                return ERROR_SUCCESS;
+            }
+
+            if (status != ERROR_SUCCESS)
+            {
+                return status;
+            }
+
+            std::vector<AdapterRecord> records{};
+            for (auto adapter = reinterpret_cast<const IP_ADAPTER_ADDRESSES*>(data.data());
+                 adapter != nullptr;
+                 adapter = adapter->Next)
+            {
+                AdapterRecord record{};
+                record.name = adapter->AdapterName;
+                record.luid = adapter->Luid.Value;
+                record.index = adapter->IfIndex;
+                record.ipv4Metric = adapter->Ipv4Metric;
+                record.ipv6Metric = adapter->Ipv6Metric;
+
+                records.push_back(record);
+            }
+
+            table = AdapterTable(std::move(records));
+
+            return ERROR_SUCCESS;
+        }
+    }
+}
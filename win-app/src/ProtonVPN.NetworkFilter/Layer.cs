@@ -30,4 +30,6 @@ public enum Layer: uint
     AppConnectRedirectV4 = 6,
     OutboundIPPacketV4 = 7,
     AppAuthRecvAcceptV6 = 8,
+    AppConnectRedirectV6 = 9,
+    OutboundIPPacketV6 = 10,
 }
\ No newline at end of file
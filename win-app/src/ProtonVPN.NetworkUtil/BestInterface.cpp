@@ -1,88 +1,231 @@
 #include "StdAfx.h"
 #include "BestInterface.h"
+#include "RouteSelection.h"
+#include <ws2ipdef.h>
 #include <Iphlpapi.h>
-#include <ws2tcpip.h>
 
-bool IsIfaceExcluded(const std::vector<std::wstring>& guids, const std::wstring& ifaceGuid)
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstring>
+
+using namespace Proton::NetworkUtil;
+
+struct RouteTables
 {
-    auto it = std::find(guids.begin(), guids.end(), ifaceGuid);
+    RouteTable ipv4;
+    RouteTable ipv6;
+};
 
-    return it != guids.end();
+// A family without entries, or without an IP stack on this computer, has an empty table.
+bool IsEmptyTable(DWORD status)
+{
+    return status == ERROR_NOT_FOUND || status == ERROR_NOT_SUPPORTED;
 }
 
-IN_ADDR BestInterface::IpAddress(const std::vector<std::wstring>& excludedIfaceGuids)
+DWORD LoadRouteTable(ADDRESS_FAMILY family, RouteTable& table)
 {
-    PIP_ADAPTER_INFO pAdapterInfo;
-    PIP_ADAPTER_INFO pAdapter;
-    PIP_ADDR_STRING pIPAddrString, pIPGwString;
-    ULONG ulOutBufLen;
-    IN_ADDR ipBuff = {0};
+    table.ipv6 = family == AF_INET6;
+
+    PMIB_IPFORWARD_TABLE2 routes = nullptr;
+    auto status = GetIpForwardTable2(family, &routes);
+    if (IsEmptyTable(status))
+    {
+        return NO_ERROR;
+    }
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    for (ULONG i = 0; i < routes->NumEntries; i++)
+    {
+        const auto& row = routes->Table[i];
+        table.routes.push_back({row.InterfaceLuid.Value, row.DestinationPrefix.PrefixLength, row.Metric});
+    }
+
+    FreeMibTable(routes);
+
+    PMIB_IPINTERFACE_TABLE interfaces = nullptr;
+    status = GetIpInterfaceTable(family, &interfaces);
+    if (IsEmptyTable(status))
+    {
+        return NO_ERROR;
+    }
+
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
 
-    pAdapterInfo = static_cast<IP_ADAPTER_INFO*>(malloc(sizeof(IP_ADAPTER_INFO)));
-    if (!pAdapterInfo)
+    for (ULONG i = 0; i < interfaces->NumEntries; i++)
     {
-        return ipBuff;
+        const auto& row = interfaces->Table[i];
+
+        RouteInterface iface{};
+        iface.luid = row.InterfaceLuid.Value;
+        iface.metric = row.Metric;
+        iface.connected = row.Connected != FALSE;
+
+        table.interfaces[iface.luid] = iface;
+    }
+
+    FreeMibTable(interfaces);
+
+    PMIB_UNICASTIPADDRESS_TABLE addresses = nullptr;
+    status = GetUnicastIpAddressTable(family, &addresses);
+    if (IsEmptyTable(status))
+    {
+        return NO_ERROR;
     }
 
-    ulOutBufLen = sizeof(IP_ADAPTER_INFO);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
 
-    if (GetAdaptersInfo(pAdapterInfo, &ulOutBufLen) == ERROR_BUFFER_OVERFLOW)
+    for (ULONG i = 0; i < addresses->NumEntries; i++)
     {
-        free(pAdapterInfo);
-        pAdapterInfo = static_cast<IP_ADAPTER_INFO*>(malloc(ulOutBufLen));
-        if (!pAdapterInfo)
+        const auto& row = addresses->Table[i];
+
+        auto it = table.interfaces.find(row.InterfaceLuid.Value);
+        if (it == table.interfaces.end())
         {
-            return ipBuff;
+            continue;
         }
+
+        UnicastAddress address{};
+        address.preferred = row.DadState == IpDadStatePreferred;
+        if (family == AF_INET6)
+        {
+            std::memcpy(address.address.data(), &row.Address.Ipv6.sin6_addr, sizeof(IN6_ADDR));
+        }
+        else
+        {
+            std::memcpy(address.address.data(), &row.Address.Ipv4.sin_addr, sizeof(IN_ADDR));
+        }
+
+        it->second.addresses.push_back(address);
     }
 
-    if (GetAdaptersInfo(pAdapterInfo, &ulOutBufLen) == NO_ERROR)
+    FreeMibTable(addresses);
+
+    return NO_ERROR;
+}
+
+class RouteTableCache
+{
+public:
+    RouteTableCache()
     {
-        pAdapter = pAdapterInfo;
-        while (pAdapter)
+        if (NotifyRouteChange2(AF_UNSPEC, OnRouteChange, this, FALSE, &this->routeNotification) != NO_ERROR ||
+            NotifyIpInterfaceChange(AF_UNSPEC, OnIpInterfaceChange, this, FALSE, &this->interfaceNotification) != NO_ERROR ||
+            NotifyUnicastIpAddressChange(AF_UNSPEC, OnUnicastIpAddressChange, this, FALSE, &this->addressNotification) != NO_ERROR)
         {
-            std::string guid(pAdapter->AdapterName);
-            if (IsIfaceExcluded(excludedIfaceGuids, std::wstring(guid.begin(), guid.end())))
+            this->cancelNotifications();
+            this->notifying = false;
+        }
+    }
+
+    ~RouteTableCache()
+    {
+        this->cancelNotifications();
+    }
+
+    DWORD get(std::shared_ptr<const RouteTables>& tables)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        // A change reported while the tables are read clears the flag again, so they are read once more next time.
+        if (!this->valid.exchange(true) || !this->notifying || this->tables == nullptr)
+        {
+            auto loaded = std::make_shared<RouteTables>();
+            auto status = LoadRouteTable(AF_INET, loaded->ipv4);
+            if (status == NO_ERROR)
             {
-                pAdapter = pAdapter->Next;
-                continue;
+                status = LoadRouteTable(AF_INET6, loaded->ipv6);
             }
 
-            pIPAddrString = &pAdapter->IpAddressList;
-
-            pIPGwString = &pAdapter->GatewayList;
-            while (pIPAddrString)
+            if (status != NO_ERROR)
             {
-                IN_ADDR maskBuff = {0};
-                inet_pton(AF_INET, pIPAddrString->IpMask.String, &maskBuff);
+                // Tables that failed to load are not cached, so the next call reads them again.
+                this->valid = false;
+                return status;
+            }
 
-                if (maskBuff.S_un.S_addr == 0)
-                {
-                    pIPAddrString = pIPAddrString->Next;
-                    continue;
-                }
+            this->tables = loaded;
+        }
 
-                IN_ADDR gwBuff = {0};
-                inet_pton(AF_INET, pIPGwString->IpAddress.String, &gwBuff);
+        tables = this->tables;
 
-                // First adapter with a default gateway
-                if (gwBuff.S_un.S_addr != 0)
-                {
-                    inet_pton(AF_INET, pIPAddrString->IpAddress.String, &ipBuff);
+        return NO_ERROR;
+    }
 
-                    free(pAdapterInfo);
+private:
+    static VOID NETIOAPI_API_ OnRouteChange(PVOID context, PMIB_IPFORWARD_ROW2, MIB_NOTIFICATION_TYPE)
+    {
+        static_cast<RouteTableCache*>(context)->valid = false;
+    }
 
-                    return ipBuff;
-                }
+    static VOID NETIOAPI_API_ OnIpInterfaceChange(PVOID context, PMIB_IPINTERFACE_ROW, MIB_NOTIFICATION_TYPE)
+    {
+        static_cast<RouteTableCache*>(context)->valid = false;
+    }
 
-                pIPAddrString = pIPAddrString->Next;
-            }
+    static VOID NETIOAPI_API_ OnUnicastIpAddressChange(PVOID context, PMIB_UNICASTIPADDRESS_ROW, MIB_NOTIFICATION_TYPE)
+    {
+        static_cast<RouteTableCache*>(context)->valid = false;
+    }
 
-            pAdapter = pAdapter->Next;
+    void cancelNotifications()
+    {
+        for (auto notification : {&this->routeNotification, &this->interfaceNotification, &this->addressNotification})
+        {
+            if (*notification != nullptr)
+            {
+                CancelMibChangeNotify2(*notification);
+                *notification = nullptr;
+            }
         }
     }
 
-    free(pAdapterInfo);
+    std::mutex mutex;
+    std::atomic<bool> valid{false};
+    bool notifying{true};
+    std::shared_ptr<const RouteTables> tables;
+    HANDLE routeNotification{};
+    HANDLE interfaceNotification{};
+    HANDLE addressNotification{};
+};
+
+DWORD BestInterface::IpAddresses(const std::unordered_set<uint64_t>& excludedLuids, IN_ADDR& ipv4, IN6_ADDR& ipv6)
+{
+    static RouteTableCache cache{};
+
+    ipv4 = {};
+    ipv6 = {};
+
+    std::shared_ptr<const RouteTables> tables{};
+    auto status = cache.get(tables);
+    if (status != NO_ERROR)
+    {
+        return status;
+    }
+
+    RouteAddress address{};
+
+    auto iface = SelectBestInterface(tables->ipv4, excludedLuids);
+    if (iface != nullptr && SelectSourceAddress(*iface, false, address))
+    {
+        std::memcpy(&ipv4, address.data(), sizeof(IN_ADDR));
+    }
+
+    iface = SelectBestInterface(tables->ipv6, excludedLuids);
+    if (iface != nullptr && SelectSourceAddress(*iface, true, address))
+    {
+        std::memcpy(&ipv6, address.data(), sizeof(IN6_ADDR));
+    }
 
-    return ipBuff;
+    return NO_ERROR;
 }
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <Windows.h>
-#include <vector>
-#include <string>
+#include <in6addr.h>
+#include <unordered_set>
+#include <cstdint>
 
 class BestInterface
 {
 public:
-    static IN_ADDR IpAddress(const std::vector<std::wstring>& excludedIfaceGuids);
+    // Takes the source addresses from the interfaces of the best IPv4 and IPv6 default routes,
+    // skipping the excluded interfaces. Addresses of a family without a default route are zero.
+    // The route tables are cached until a route, IP interface or address changes.
+    // Returns the error of the IP Helper call when the tables cannot be read.
+    static DWORD IpAddresses(const std::unordered_set<uint64_t>& excludedLuids, IN_ADDR& ipv4, IN6_ADDR& ipv6);
 };
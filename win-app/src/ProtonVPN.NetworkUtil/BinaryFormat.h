@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Little endian encoding of the state the library persists across service restarts.
+        inline void WriteUint32(std::vector<uint8_t>& out, uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+
+        inline void WriteUint64(std::vector<uint8_t>& out, uint64_t value)
+        {
+            WriteUint32(out, static_cast<uint32_t>(value));
+            WriteUint32(out, static_cast<uint32_t>(value >> 32));
+        }
+
+        inline void WriteWideString(std::vector<uint8_t>& out, const std::wstring& value)
+        {
+            WriteUint32(out, static_cast<uint32_t>(value.size()));
+            for (auto c : value)
+            {
+                // Encoded as UTF-16 code units regardless of the platform wchar_t size.
+                auto unit = static_cast<uint16_t>(c);
+                out.push_back(static_cast<uint8_t>(unit));
+                out.push_back(static_cast<uint8_t>(unit >> 8));
+            }
+        }
+
+        // The readers return false when the data is truncated.
+        inline bool ReadUint32(const uint8_t* data, size_t size, size_t& offset, uint32_t& value)
+        {
+            if (size - offset < 4)
+            {
+                return false;
+            }
+
+            value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                value |= static_cast<uint32_t>(data[offset + i]) << (i * 8);
+            }
+            offset += 4;
+
+            return true;
+        }
+
+        inline bool ReadUint64(const uint8_t* data, size_t size, size_t& offset, uint64_t& value)
+        {
+            uint32_t low{};
+            uint32_t high{};
+            if (!ReadUint32(data, size, offset, low) || !ReadUint32(data, size, offset, high))
+            {
+                return false;
+            }
+
+            value = (static_cast<uint64_t>(high) << 32) | low;
+
+            return true;
+        }
+
+        inline bool ReadWideString(const uint8_t* data, size_t size, size_t& offset, std::wstring& value)
+        {
+            uint32_t length{};
+            if (!ReadUint32(data, size, offset, length) || (size - offset) / 2 < length)
+            {
+                return false;
+            }
+
+            value.clear();
+            value.reserve(length);
+            for (uint32_t i = 0; i < length; i++)
+            {
+                value.push_back(static_cast<wchar_t>(data[offset] | (data[offset + 1] << 8)));
+                offset += 2;
+            }
+
+            return true;
+        }
+    }
+}
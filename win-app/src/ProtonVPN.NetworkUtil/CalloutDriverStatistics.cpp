@@ -0,0 +1,48 @@
+#include "StdAfx.h"
+#include "CalloutDriverStatistics.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        namespace CalloutDriverStatistics
+        {
+            DWORD Read(CALLOUT_STATISTICS& statistics)
+            {
+                auto device = CreateFileW(
+                    CALLOUT_DEVICE_PATH,
+                    GENERIC_READ,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE,
+                    nullptr,
+                    OPEN_EXISTING,
+                    FILE_ATTRIBUTE_NORMAL,
+                    nullptr);
+                if (device == INVALID_HANDLE_VALUE)
+                {
+                    return GetLastError();
+                }
+
+                DWORD bytesReturned = 0;
+                auto result = DeviceIoControl(
+                    device,
+                    IOCTL_CALLOUT_GET_STATISTICS,
+                    nullptr,
+                    0,
+                    &statistics,
+                    sizeof(statistics),
+                    &bytesReturned,
+                    nullptr);
+                auto error = result ? ERROR_SUCCESS : GetLastError();
+
+                CloseHandle(device);
+
+                if (error == ERROR_SUCCESS && bytesReturned < offsetof(CALLOUT_STATISTICS, counters))
+                {
+                    return ERROR_INVALID_DATA;
+                }
+
+                return error;
+            }
+        }
+    }
+}
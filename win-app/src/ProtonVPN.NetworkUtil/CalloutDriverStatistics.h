@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "../ProtonVPN.CalloutDriver/CalloutStatistics.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        namespace CalloutDriverStatistics
+        {
+            // Reads the aggregated callout counters from the driver control device.
+            // Returns ERROR_SUCCESS or the Win32 error of opening or querying the device.
+            DWORD Read(CALLOUT_STATISTICS& statistics);
+        }
+    }
+}
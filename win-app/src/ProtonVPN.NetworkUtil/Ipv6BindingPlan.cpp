@@ -0,0 +1,106 @@
+#include "Ipv6BindingPlan.h"
+#include "BinaryFormat.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        const uint32_t JournalMagic = 0x4a365049; // "IP6J"
+        const uint32_t JournalVersion = 1;
+
+        BindingPlan PlanDisableIPv6(
+            const std::vector<BindingState>& adapters,
+            const std::set<std::wstring>& excludeIds,
+            const BindingJournal& journal)
+        {
+            BindingPlan plan{};
+            plan.journal = journal;
+
+            for (const auto& adapter : adapters)
+            {
+                if (!adapter.ipv6Enabled || excludeIds.count(adapter.id) > 0)
+                {
+                    continue;
+                }
+
+                plan.disable.push_back(adapter.bindName);
+                plan.journal.insert(adapter.bindName);
+            }
+
+            return plan;
+        }
+
+        BindingPlan PlanRestoreIPv6(
+            const std::vector<BindingState>& adapters,
+            const std::set<std::wstring>& excludeIds,
+            const BindingJournal& journal)
+        {
+            BindingPlan plan{};
+            plan.journal = journal;
+
+            for (const auto& adapter : adapters)
+            {
+                if (journal.count(adapter.bindName) == 0 || excludeIds.count(adapter.id) > 0)
+                {
+                    continue;
+                }
+
+                if (!adapter.ipv6Enabled)
+                {
+                    plan.enable.push_back(adapter.bindName);
+                }
+
+                plan.journal.erase(adapter.bindName);
+            }
+
+            return plan;
+        }
+
+        std::vector<uint8_t> EncodeBindingJournal(const BindingJournal& journal)
+        {
+            std::vector<uint8_t> out{};
+
+            WriteUint32(out, JournalMagic);
+            WriteUint32(out, JournalVersion);
+            WriteUint32(out, static_cast<uint32_t>(journal.size()));
+
+            for (const auto& bindName : journal)
+            {
+                WriteWideString(out, bindName);
+            }
+
+            return out;
+        }
+
+        bool DecodeBindingJournal(const uint8_t* data, size_t size, BindingJournal& journal)
+        {
+            size_t offset = 0;
+            uint32_t magic{};
+            uint32_t version{};
+            uint32_t count{};
+
+            if (!ReadUint32(data, size, offset, magic) || magic != JournalMagic ||
+                !ReadUint32(data, size, offset, version) || version != JournalVersion ||
+                !ReadUint32(data, size, offset, count))
+            {
+                return false;
+            }
+
+            BindingJournal result{};
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::wstring bindName{};
+                if (!ReadWideString(data, size, offset, bindName))
+                {
+                    return false;
+                }
+
+                result.insert(bindName);
+            }
+
+            journal.swap(result);
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        struct BindingState
+        {
+            std::wstring id;
+            std::wstring bindName;
+            bool ipv6Enabled{};
+        };
+
+        // Bind names of the adapters whose IPv6 binding was disabled by us and not restored yet.
+        typedef std::set<std::wstring> BindingJournal;
+
+        // Bind names to change, along with the journal to keep once the changes are applied.
+        struct BindingPlan
+        {
+            std::vector<std::wstring> enable;
+            std::vector<std::wstring> disable;
+            BindingJournal journal;
+        };
+
+        // Disables IPv6 on the adapters that are not excluded and have it enabled.
+        // Adapters that already have IPv6 disabled are left out of the journal.
+        BindingPlan PlanDisableIPv6(
+            const std::vector<BindingState>& adapters,
+            const std::set<std::wstring>& excludeIds,
+            const BindingJournal& journal);
+
+        // Enables IPv6 on the journaled adapters that are not excluded. Journal entries of
+        // excluded or absent adapters are kept for a later restore.
+        BindingPlan PlanRestoreIPv6(
+            const std::vector<BindingState>& adapters,
+            const std::set<std::wstring>& excludeIds,
+            const BindingJournal& journal);
+
+        std::vector<uint8_t> EncodeBindingJournal(const BindingJournal& journal);
+
+        // Returns false if the data is not a journal or is truncated.
+        bool DecodeBindingJournal(const uint8_t* data, size_t size, BindingJournal& journal);
+    }
+}
@@ -0,0 +1,237 @@
+#include "MetricManager.h"
+#include "BinaryFormat.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        const uint32_t MetricJournalMagic = 0x4a4d5049; // "IPMJ"
+        const uint32_t MetricJournalVersion = 1;
+
+        const MetricFamily MetricFamilies[] = {MetricFamily::Ipv4, MetricFamily::Ipv6};
+
+        bool SameSettings(const MetricSettings& a, const MetricSettings& b)
+        {
+            // The metric of an interface with automatic metric is computed from its link speed.
+            return a.automatic == b.automatic && (a.automatic || a.metric == b.metric);
+        }
+
+        MetricManager::MetricManager(std::unique_ptr<MetricBackend> backend, std::unique_ptr<MetricStore> store):
+            backend(std::move(backend)),
+            store(std::move(store))
+        {
+        }
+
+        bool MetricManager::apply(uint64_t luid, uint32_t metric)
+        {
+            struct Change
+            {
+                MetricKey key;
+                MetricSettings previous;
+            };
+
+            std::lock_guard<std::mutex> guard(this->mutex);
+            this->load();
+
+            const MetricSettings target{metric, false};
+            auto journal = this->current;
+            std::vector<Change> changes{};
+            bool found = false;
+
+            for (auto family : MetricFamilies)
+            {
+                MetricKey key{luid, family};
+                MetricSettings settings{};
+                auto lookup = this->backend->get(key, settings);
+                if (lookup == MetricLookup::Failed)
+                {
+                    return false;
+                }
+
+                if (lookup == MetricLookup::Absent)
+                {
+                    continue;
+                }
+
+                found = true;
+
+                // Settings journaled by an earlier apply are the original ones, ours are on the interface now.
+                journal.emplace(key, settings);
+
+                if (!SameSettings(settings, target))
+                {
+                    changes.push_back({key, settings});
+                }
+            }
+
+            if (!found)
+            {
+                return false;
+            }
+
+            auto journalChanged = journal.size() != this->current.size();
+            if (journalChanged && !this->save(journal))
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < changes.size(); i++)
+            {
+                if (this->backend->set(changes[i].key, target))
+                {
+                    continue;
+                }
+
+                for (size_t j = i; j > 0; j--)
+                {
+                    this->backend->set(changes[j - 1].key, changes[j - 1].previous);
+                }
+
+                if (journalChanged)
+                {
+                    this->save(this->current);
+                }
+
+                return false;
+            }
+
+            this->current.swap(journal);
+
+            return true;
+        }
+
+        bool MetricManager::restore(uint64_t luid)
+        {
+            std::lock_guard<std::mutex> guard(this->mutex);
+            this->load();
+
+            auto journal = this->current;
+            bool result = true;
+
+            for (auto family : MetricFamilies)
+            {
+                MetricKey key{luid, family};
+                auto it = journal.find(key);
+                if (it == journal.end())
+                {
+                    continue;
+                }
+
+                MetricSettings settings{};
+                auto lookup = this->backend->get(key, settings);
+                if (lookup == MetricLookup::Failed ||
+                    (lookup == MetricLookup::Found && !SameSettings(settings, it->second) &&
+                     !this->backend->set(key, it->second)))
+                {
+                    result = false;
+                    continue;
+                }
+
+                // Interfaces which no longer exist have nothing to restore.
+                journal.erase(it);
+            }
+
+            if (journal.size() != this->current.size())
+            {
+                result = this->save(journal) && result;
+                this->current.swap(journal);
+            }
+
+            return result;
+        }
+
+        MetricJournal MetricManager::journal()
+        {
+            std::lock_guard<std::mutex> guard(this->mutex);
+            this->load();
+
+            return this->current;
+        }
+
+        void MetricManager::load()
+        {
+            if (this->loaded)
+            {
+                return;
+            }
+
+            std::vector<uint8_t> data{};
+            if (this->store->read(data))
+            {
+                DecodeMetricJournal(data.data(), data.size(), this->current);
+            }
+
+            this->loaded = true;
+        }
+
+        bool MetricManager::save(const MetricJournal& journal)
+        {
+            if (journal.empty())
+            {
+                this->store->remove();
+                return true;
+            }
+
+            return this->store->write(EncodeMetricJournal(journal));
+        }
+
+        std::vector<uint8_t> EncodeMetricJournal(const MetricJournal& journal)
+        {
+            std::vector<uint8_t> out{};
+
+            WriteUint32(out, MetricJournalMagic);
+            WriteUint32(out, MetricJournalVersion);
+            WriteUint32(out, static_cast<uint32_t>(journal.size()));
+
+            for (const auto& entry : journal)
+            {
+                WriteUint64(out, entry.first.luid);
+                WriteUint32(out, static_cast<uint32_t>(entry.first.family));
+                WriteUint32(out, entry.second.metric);
+                WriteUint32(out, entry.second.automatic ? 1 : 0);
+            }
+
+            return out;
+        }
+
+        bool DecodeMetricJournal(const uint8_t* data, size_t size, MetricJournal& journal)
+        {
+            size_t offset = 0;
+            uint32_t magic{};
+            uint32_t version{};
+            uint32_t count{};
+
+            if (!ReadUint32(data, size, offset, magic) || magic != MetricJournalMagic ||
+                !ReadUint32(data, size, offset, version) || version != MetricJournalVersion ||
+                !ReadUint32(data, size, offset, count))
+            {
+                return false;
+            }
+
+            MetricJournal result{};
+            for (uint32_t i = 0; i < count; i++)
+            {
+                MetricKey key{};
+                MetricSettings settings{};
+                uint32_t family{};
+                uint32_t automatic{};
+
+                if (!ReadUint64(data, size, offset, key.luid) ||
+                    !ReadUint32(data, size, offset, family) || family > static_cast<uint32_t>(MetricFamily::Ipv6) ||
+                    !ReadUint32(data, size, offset, settings.metric) ||
+                    !ReadUint32(data, size, offset, automatic))
+                {
+                    return false;
+                }
+
+                key.family = static_cast<MetricFamily>(family);
+                settings.automatic = automatic != 0;
+                result[key] = settings;
+            }
+
+            journal.swap(result);
+
+            return true;
+        }
+    }
+}
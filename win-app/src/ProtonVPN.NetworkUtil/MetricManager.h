@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        enum class MetricFamily : uint32_t
+        {
+            Ipv4 = 0,
+            Ipv6 = 1,
+        };
+
+        struct MetricSettings
+        {
+            uint32_t metric{};
+            bool automatic{};
+        };
+
+        struct MetricKey
+        {
+            uint64_t luid{};
+            MetricFamily family{};
+
+            bool operator<(const MetricKey& other) const
+            {
+                return this->luid != other.luid ? this->luid < other.luid : this->family < other.family;
+            }
+        };
+
+        // Settings the interfaces had before we changed their metric, and which have not been restored yet.
+        typedef std::map<MetricKey, MetricSettings> MetricJournal;
+
+        enum class MetricLookup
+        {
+            Found,
+            // The interface has no IP interface of the family.
+            Absent,
+            Failed,
+        };
+
+        class MetricBackend
+        {
+        public:
+            virtual ~MetricBackend() = default;
+
+            virtual MetricLookup get(const MetricKey& key, MetricSettings& settings) = 0;
+
+            virtual bool set(const MetricKey& key, const MetricSettings& settings) = 0;
+        };
+
+        class MetricStore
+        {
+        public:
+            virtual ~MetricStore() = default;
+
+            // Returns false if nothing was stored.
+            virtual bool read(std::vector<uint8_t>& data) = 0;
+
+            virtual bool write(const std::vector<uint8_t>& data) = 0;
+
+            virtual void remove() = 0;
+        };
+
+        // Lowers the metric of an interface for both IP families and restores the settings it had before.
+        // The original settings are journaled in the store before they are changed, so that they survive
+        // repeated applies and service restarts and are restored exactly, automatic metric included.
+        class MetricManager
+        {
+        public:
+            MetricManager(std::unique_ptr<MetricBackend> backend, std::unique_ptr<MetricStore> store);
+
+            // Sets a fixed metric on every IP family of the interface. Either all families are changed
+            // or, on failure, the ones already changed are set back and the journal is left as it was.
+            // Fails without changes if the settings of a family cannot be read.
+            bool apply(uint64_t luid, uint32_t metric);
+
+            // Sets back the journaled settings of the interface. Settings that could not be read or
+            // restored stay in the journal for the next attempt. Only settings of IP interfaces that
+            // no longer exist are dropped.
+            bool restore(uint64_t luid);
+
+            MetricJournal journal();
+
+        private:
+            void load();
+
+            bool save(const MetricJournal& journal);
+
+            std::unique_ptr<MetricBackend> backend;
+            std::unique_ptr<MetricStore> store;
+            MetricJournal current;
+            bool loaded{};
+            std::mutex mutex;
+        };
+
+        std::vector<uint8_t> EncodeMetricJournal(const MetricJournal& journal);
+
+        // Returns false if the data is not a journal or is truncated.
+        bool DecodeMetricJournal(const uint8_t* data, size_t size, MetricJournal& journal);
+    }
+}
@@ -11,6 +11,8 @@ namespace Proton
 {
 	namespace NetworkUtil
 	{
+		const ULONG ComponentBatchSize = 16;
+
 		const std::vector<NetInterface> GetNetworkInterfaces(const CComPtr<INetCfg>& netCfg)
 		{
 			std::vector<NetInterface> ifaces{};
@@ -30,15 +32,22 @@ namespace Proton
 			while (true)
 			{
 				ULONG count{};
-				CComPtr<INetCfgComponent> component{};
+				INetCfgComponent* components[ComponentBatchSize]{};
+
+				// Returns S_FALSE along with the last, partially filled batch.
+				auto status = componentEnum->Next(ComponentBatchSize, components, &count);
+				for (ULONG i = 0; i < count; i++)
+				{
+					CComPtr<INetCfgComponent> component{};
+					component.Attach(components[i]);
+
+					ifaces.push_back(NetComponent(component));
+				}
 
-				auto status = componentEnum->Next(1, &component, &count);
 				if (status != S_OK)
 				{
 					break;
 				}
-
-				ifaces.push_back(NetComponent(component));
 			}
 
 			return ifaces;
@@ -77,15 +86,27 @@ namespace Proton
 			return this->netComponent.bindName();
 		}
 
-		bool NetInterface::isIPv6Enabled()
+		const std::vector<NetBindingPath> NetInterface::ipv6BindingPaths()
 		{
+			std::vector<NetBindingPath> results{};
+
 			for (auto bindingPath : this->netComponent.bindingPaths())
 			{
 				if (bindingPath.getOwner().id() == L"ms_tcpip6")
 				{
-					if (bindingPath.isEnabled()) {
-						return true;
-					}
+					results.push_back(bindingPath);
+				}
+			}
+
+			return results;
+		}
+
+		bool NetInterface::isIPv6Enabled()
+		{
+			for (auto bindingPath : this->ipv6BindingPaths())
+			{
+				if (bindingPath.isEnabled()) {
+					return true;
 				}
 			}
 
@@ -94,23 +115,17 @@ namespace Proton
 
 		void NetInterface::enableIPv6()
 		{
-			for (auto bindingPath : this->netComponent.bindingPaths())
+			for (auto bindingPath : this->ipv6BindingPaths())
 			{
-				if (bindingPath.getOwner().id() == L"ms_tcpip6")
-				{
-					bindingPath.enable();
-				}
+				bindingPath.enable();
 			}
 		}
 
 		void NetInterface::disableIPv6()
 		{
-			for (auto bindingPath : this->netComponent.bindingPaths())
+			for (auto bindingPath : this->ipv6BindingPaths())
 			{
-				if (bindingPath.getOwner().id() == L"ms_tcpip6")
-				{
-					bindingPath.disable();
-				}
+				bindingPath.disable();
 			}
 		}
 
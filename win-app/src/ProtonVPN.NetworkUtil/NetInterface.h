@@ -62,6 +62,9 @@ namespace Proton
 
 			const std::wstring bindName();
 
+			// Binding paths of the IPv6 protocol to the interface, enumerated once per call.
+			const std::vector<NetBindingPath> ipv6BindingPaths();
+
 			bool isIPv6Enabled();
 
 			void enableIPv6();
@@ -66,6 +66,11 @@ namespace Proton
             return NetworkIPv6Settings(this->config);
         }
 
+        const std::vector<NetInterface> NetworkConfiguration::getNetworkInterfaces()
+        {
+            return GetNetworkInterfaces(this->config);
+        }
+
         const std::vector<NetInterface> NetworkConfiguration::getNetworkInterfacesById(const std::wstring& id)
         {
             return GetNetworkInterfacesById(this->config, id);
@@ -32,6 +32,8 @@ namespace Proton
 
             NetworkIPv6Settings ipv6Settings();
 
+            const std::vector<NetInterface> getNetworkInterfaces();
+
             const std::vector<NetInterface> getNetworkInterfacesById(const std::wstring& id);
 
         protected:
@@ -1,8 +1,11 @@
 #include "StdAfx.h"
 #include "NetworkIPv6Settings.h"
 #include "NetInterface.h"
+#include "Ipv6BindingPlan.h"
+#include "RegistryState.h"
 #include <string>
 #include <set>
+#include <map>
 #include <devguid.h>
 
 #include "Assertion.h"
@@ -11,7 +14,31 @@ namespace Proton
 {
     namespace NetworkUtil
     {
-        std::set<std::wstring> interfacesAffected;
+        const wchar_t* JournalValueName = L"IPv6Bindings";
+
+        BindingJournal ReadJournal()
+        {
+            BindingJournal journal{};
+            std::vector<uint8_t> data{};
+
+            if (RegistryState::Read(JournalValueName, data))
+            {
+                DecodeBindingJournal(data.data(), data.size(), journal);
+            }
+
+            return journal;
+        }
+
+        void WriteJournal(const BindingJournal& journal)
+        {
+            if (journal.empty())
+            {
+                RegistryState::Delete(JournalValueName);
+                return;
+            }
+
+            RegistryState::Write(JournalValueName, EncodeBindingJournal(journal));
+        }
 
         NetworkIPv6Settings::NetworkIPv6Settings(CComPtr<INetCfg> networkConfiguration) :
             networkConfiguration(networkConfiguration)
@@ -29,40 +56,84 @@ namespace Proton
 
         void NetworkIPv6Settings::enableIPv6OnAllAdapters(bool enable, const std::set<std::wstring>& excludeIds)
         {
-            auto ifaces = GetNetworkInterfaces(this->networkConfiguration);
-
-            auto disable = !enable;
+            std::vector<BindingState> adapters{};
+            std::map<std::wstring, std::vector<NetBindingPath>> bindingPaths{};
 
-            if (disable)
+            for (auto iface : GetNetworkInterfaces(this->networkConfiguration))
             {
-                interfacesAffected.clear();
+                BindingState state{iface.id(), iface.bindName(), false};
+
+                auto paths = iface.ipv6BindingPaths();
+                for (auto path : paths)
+                {
+                    if (path.isEnabled())
+                    {
+                        state.ipv6Enabled = true;
+                        break;
+                    }
+                }
+
+                adapters.push_back(state);
+                bindingPaths[state.bindName] = paths;
             }
 
-            for (auto iface : ifaces)
+            auto journal = ReadJournal();
+            auto plan = enable
+                ? PlanRestoreIPv6(adapters, excludeIds, journal)
+                : PlanDisableIPv6(adapters, excludeIds, journal);
+
+            if (plan.enable.empty() && plan.disable.empty())
             {
-                if (excludeIds.find(iface.id()) != excludeIds.end())
+                if (plan.journal != journal)
                 {
-                    continue;
+                    WriteJournal(plan.journal);
                 }
 
-                if (disable)
+                return;
+            }
+
+            for (const auto& bindName : plan.enable)
+            {
+                for (auto path : bindingPaths[bindName])
                 {
-                    interfacesAffected.insert(iface.bindName());
-                    if (iface.isIPv6Enabled())
-                    {
-                        iface.disableIPv6();
-                    }
+                    path.enable();
                 }
-                else if (enable)
+            }
+
+            for (const auto& bindName : plan.disable)
+            {
+                for (auto path : bindingPaths[bindName])
                 {
-                    if (interfacesAffected.find(iface.bindName()) == interfacesAffected.end())
-                    {
-                        continue;
-                    }
+                    path.disable();
+                }
+            }
 
-                    iface.enableIPv6();
+            // Adapters are journaled before their IPv6 binding is disabled, and removed from the journal
+            // after it is enabled again, so a crash in between never loses an adapter to restore.
+            auto journalFirst = !plan.disable.empty();
+            if (journalFirst)
+            {
+                WriteJournal(plan.journal);
+            }
+
+            try
+            {
+                assertSuccess(this->networkConfiguration->Apply());
+            }
+            catch (...)
+            {
+                if (journalFirst)
+                {
+                    WriteJournal(journal);
                 }
+
+                throw;
+            }
+
+            if (!journalFirst)
+            {
+                WriteJournal(plan.journal);
             }
         }
     }
-}
+}
\ No newline at end of file
@@ -16,6 +16,10 @@ namespace Proton
         public:
             NetworkIPv6Settings(CComPtr<INetCfg> networkConfiguration);
 
+            // Computes the binding changes in one pass over the adapters and applies them with a single
+            // INetCfg Apply, which is skipped when no binding has to change. Adapters whose IPv6 binding
+            // gets disabled are journaled in the registry, so that enabling restores exactly those,
+            // even after a service restart.
             void enableIPv6OnAllAdapters(bool enable, const std::set<std::wstring>& excludeIds);
 
             void enableIPv6OnInterfacesWithId(const std::wstring& id);
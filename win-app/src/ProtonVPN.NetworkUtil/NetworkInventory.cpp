@@ -0,0 +1,185 @@
+#include "NetworkInventory.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        InventorySnapshot::InventorySnapshot(std::vector<Adapter> adapters):
+            items(std::move(adapters))
+        {
+            for (size_t i = 0; i < this->items.size(); i++)
+            {
+                const auto& adapter = this->items[i];
+
+                this->byBindName.emplace(adapter.bindName, i);
+                this->byId.emplace(adapter.id, i);
+
+                if (adapter.luid != 0)
+                {
+                    this->byLuid.emplace(adapter.luid, i);
+                }
+
+                if (adapter.index != 0)
+                {
+                    this->byIndex.emplace(adapter.index, i);
+                }
+            }
+        }
+
+        const std::vector<Adapter>& InventorySnapshot::adapters() const
+        {
+            return this->items;
+        }
+
+        const Adapter* InventorySnapshot::findByBindName(const std::wstring& bindName) const
+        {
+            auto it = this->byBindName.find(bindName);
+
+            return it != this->byBindName.end() ? &this->items[it->second] : nullptr;
+        }
+
+        const Adapter* InventorySnapshot::findByLuid(uint64_t luid) const
+        {
+            auto it = this->byLuid.find(luid);
+
+            return it != this->byLuid.end() ? &this->items[it->second] : nullptr;
+        }
+
+        const Adapter* InventorySnapshot::findByIndex(uint32_t index) const
+        {
+            auto it = this->byIndex.find(index);
+
+            return it != this->byIndex.end() ? &this->items[it->second] : nullptr;
+        }
+
+        std::vector<const Adapter*> InventorySnapshot::findById(const std::wstring& id) const
+        {
+            std::vector<const Adapter*> results{};
+
+            auto range = this->byId.equal_range(id);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                results.push_back(&this->items[it->second]);
+            }
+
+            return results;
+        }
+
+        NetworkInventory::NetworkInventory(std::unique_ptr<InventoryBackend> backend):
+            backend(std::move(backend))
+        {
+        }
+
+        std::shared_ptr<const InventorySnapshot> NetworkInventory::snapshot()
+        {
+            // Serializes the updates, while notifications only take the state lock.
+            std::lock_guard<std::mutex> update(this->updateMutex);
+
+            std::shared_ptr<const InventorySnapshot> current{};
+            std::set<uint64_t> changed{};
+            bool valid{};
+
+            {
+                std::lock_guard<std::mutex> lock(this->stateMutex);
+
+                current = this->current;
+                changed.swap(this->changed);
+                valid = this->valid;
+                this->valid = true;
+            }
+
+            if (valid && changed.empty())
+            {
+                return current;
+            }
+
+            std::vector<Adapter> adapters{};
+
+            try
+            {
+                if (!valid)
+                {
+                    adapters = this->backend->enumerate();
+                }
+                else
+                {
+                    for (const auto& adapter : current->adapters())
+                    {
+                        auto updated = adapter;
+                        if (adapter.luid != 0 && changed.count(adapter.luid) > 0 && !this->backend->refresh(updated))
+                        {
+                            updated.luid = 0;
+                            updated.index = 0;
+                        }
+
+                        adapters.push_back(updated);
+                    }
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(this->stateMutex);
+                this->valid = false;
+                throw;
+            }
+
+            auto next = std::make_shared<const InventorySnapshot>(std::move(adapters));
+
+            std::lock_guard<std::mutex> lock(this->stateMutex);
+
+            if (valid)
+            {
+                this->refreshCount++;
+            }
+            else
+            {
+                this->enumerationCount++;
+            }
+
+            this->current = next;
+
+            return next;
+        }
+
+        void NetworkInventory::interfaceChanged(uint64_t luid)
+        {
+            std::lock_guard<std::mutex> lock(this->stateMutex);
+
+            if (!this->valid)
+            {
+                return;
+            }
+
+            if (this->current == nullptr || this->current->findByLuid(luid) == nullptr)
+            {
+                this->valid = false;
+                this->changed.clear();
+                return;
+            }
+
+            this->changed.insert(luid);
+        }
+
+        void NetworkInventory::invalidate()
+        {
+            std::lock_guard<std::mutex> lock(this->stateMutex);
+
+            this->valid = false;
+            this->changed.clear();
+        }
+
+        uint64_t NetworkInventory::enumerations() const
+        {
+            std::lock_guard<std::mutex> lock(this->stateMutex);
+
+            return this->enumerationCount;
+        }
+
+        uint64_t NetworkInventory::refreshes() const
+        {
+            std::lock_guard<std::mutex> lock(this->stateMutex);
+
+            return this->refreshCount;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <set>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Network adapter as seen by both the network configuration and the IP stack.
+        // Adapters without an IP interface, such as disabled ones, have a zero LUID and index.
+        struct Adapter
+        {
+            std::wstring id;
+            std::wstring bindName;
+            uint64_t luid{};
+            uint32_t index{};
+            bool ipv6Enabled{};
+            uint32_t ipv4Metric{};
+            uint32_t ipv6Metric{};
+        };
+
+        // Immutable set of adapters indexed by bind name, LUID, interface index and id.
+        class InventorySnapshot
+        {
+        public:
+            explicit InventorySnapshot(std::vector<Adapter> adapters);
+
+            const std::vector<Adapter>& adapters() const;
+
+            const Adapter* findByBindName(const std::wstring& bindName) const;
+
+            const Adapter* findByLuid(uint64_t luid) const;
+
+            const Adapter* findByIndex(uint32_t index) const;
+
+            // Several adapters can share a hardware id.
+            std::vector<const Adapter*> findById(const std::wstring& id) const;
+
+        private:
+            std::vector<Adapter> items;
+            std::unordered_map<std::wstring, size_t> byBindName;
+            std::unordered_map<uint64_t, size_t> byLuid;
+            std::unordered_map<uint32_t, size_t> byIndex;
+            std::unordered_multimap<std::wstring, size_t> byId;
+        };
+
+        class InventoryBackend
+        {
+        public:
+            virtual ~InventoryBackend() = default;
+
+            // Reads all adapters, throws on failure.
+            virtual std::vector<Adapter> enumerate() = 0;
+
+            // Rereads the IP interface fields of the adapter. Returns false if the adapter
+            // has no IP interface any more.
+            virtual bool refresh(Adapter& adapter) = 0;
+        };
+
+        // Serves adapter lookups from a snapshot that is read once and then refreshed only for
+        // the interfaces reported as changed. Changes reported for unknown interfaces, and changes
+        // to bindings, cause the next snapshot to be read from scratch.
+        class NetworkInventory
+        {
+        public:
+            explicit NetworkInventory(std::unique_ptr<InventoryBackend> backend);
+
+            std::shared_ptr<const InventorySnapshot> snapshot();
+
+            // Safe to call from notification callbacks, the backend is only used by snapshot.
+            void interfaceChanged(uint64_t luid);
+
+            void invalidate();
+
+            uint64_t enumerations() const;
+
+            uint64_t refreshes() const;
+
+        private:
+            std::unique_ptr<InventoryBackend> backend;
+            std::shared_ptr<const InventorySnapshot> current;
+            std::set<uint64_t> changed;
+            bool valid{};
+            uint64_t enumerationCount{};
+            uint64_t refreshCount{};
+            std::mutex updateMutex;
+            mutable std::mutex stateMutex;
+        };
+    }
+}
@@ -0,0 +1,54 @@
+#include "StdAfx.h"
+#include "RegistryState.h"
+#include "Assertion.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        namespace RegistryState
+        {
+            const wchar_t* KeyPath = L"SOFTWARE\\Proton AG\\Proton VPN\\NetworkUtil";
+
+            bool Read(const wchar_t* name, std::vector<uint8_t>& data)
+            {
+                DWORD size = 0;
+
+                auto status = RegGetValueW(HKEY_LOCAL_MACHINE, KeyPath, name, RRF_RT_REG_BINARY, nullptr, nullptr, &size);
+                if (status != ERROR_SUCCESS)
+                {
+                    return false;
+                }
+
+                data.resize(size);
+                status = RegGetValueW(HKEY_LOCAL_MACHINE, KeyPath, name, RRF_RT_REG_BINARY, nullptr, data.data(), &size);
+                if (status != ERROR_SUCCESS)
+                {
+                    return false;
+                }
+
+                data.resize(size);
+
+                return true;
+            }
+
+            void Write(const wchar_t* name, const std::vector<uint8_t>& data)
+            {
+                auto status = RegSetKeyValueW(
+                    HKEY_LOCAL_MACHINE,
+                    KeyPath,
+                    name,
+                    REG_BINARY,
+                    data.data(),
+                    static_cast<DWORD>(data.size()));
+
+                assertSuccess(HRESULT_FROM_WIN32(status));
+            }
+
+            void Delete(const wchar_t* name)
+            {
+                RegDeleteKeyValueW(HKEY_LOCAL_MACHINE, KeyPath, name);
+            }
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        namespace RegistryState
+        {
+            // Binary values under HKLM\SOFTWARE\Proton AG\Proton VPN\NetworkUtil, which keep
+            // the state of changes made to the system across service restarts.
+            // Returns false if the value does not exist.
+            bool Read(const wchar_t* name, std::vector<uint8_t>& data);
+
+            // Throws _com_error on failure.
+            void Write(const wchar_t* name, const std::vector<uint8_t>& data);
+
+            void Delete(const wchar_t* name);
+        }
+    }
+}
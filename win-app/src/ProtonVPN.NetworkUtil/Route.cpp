@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include "Route.h"
+#include "SystemAdapterTable.h"
 
 namespace Proton
 {
@@ -12,40 +13,23 @@ namespace Proton
         {
             bool GetIfaceInfo(UINT index, IfaceInfo& info)
             {
-                ULONG adapterListSize = 0;
-
-                auto status = GetAdaptersAddresses(AF_INET, 0, nullptr, nullptr, &adapterListSize);
-                if (status != ERROR_BUFFER_OVERFLOW)
+                AdapterTable adapters{};
+                if (ReadAdapterTable(adapters) != NO_ERROR)
                 {
                     return false;
                 }
 
-                std::vector<char> adapterListData(adapterListSize);
-
-                status = GetAdaptersAddresses(AF_INET, 0, nullptr, reinterpret_cast<PIP_ADAPTER_ADDRESSES>(adapterListData.data()), &adapterListSize);
-                if (status != NO_ERROR)
+                auto adapter = adapters.findByIndex(index);
+                if (adapter == nullptr)
                 {
                     return false;
                 }
 
-                IP_ADAPTER_ADDRESSES* adapter = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(adapterListData.data());
-                while (adapter != nullptr)
-                {
-                    std::string adapterName = adapter->AdapterName;
-
-                    if (adapter->IfIndex == index)
-                    {
-                        info.Ipv4Metric = adapter->Ipv4Metric;
-                        info.Index = adapter->IfIndex;
-                        info.Luid = adapter->Luid;
-
-                        return true;
-                    }
-
-                    adapter = adapter->Next;
-                }
+                info.Ipv4Metric = adapter->ipv4Metric;
+                info.Index = adapter->index;
+                info.Luid.Value = adapter->luid;
 
-                return false;
+                return true;
             }
         }
     }
@@ -0,0 +1,84 @@
+#include "RouteSelection.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        const RouteInterface* SelectBestInterface(
+            const RouteTable& table,
+            const std::unordered_set<uint64_t>& excludedLuids)
+        {
+            const RouteInterface* best = nullptr;
+            uint64_t bestMetric = 0;
+
+            for (const auto& route : table.routes)
+            {
+                if (route.prefixLength != 0 || excludedLuids.count(route.luid) > 0)
+                {
+                    continue;
+                }
+
+                auto it = table.interfaces.find(route.luid);
+                if (it == table.interfaces.end() || !it->second.connected)
+                {
+                    continue;
+                }
+
+                auto metric = static_cast<uint64_t>(route.metric) + it->second.metric;
+                if (best == nullptr || metric < bestMetric || (metric == bestMetric && route.luid < best->luid))
+                {
+                    best = &it->second;
+                    bestMetric = metric;
+                }
+            }
+
+            return best;
+        }
+
+        bool IsLinkLocal(const RouteAddress& address, bool ipv6)
+        {
+            if (ipv6)
+            {
+                // fe80::/10
+                return address[0] == 0xfe && (address[1] & 0xc0) == 0x80;
+            }
+
+            // 169.254.0.0/16
+            return address[0] == 169 && address[1] == 254;
+        }
+
+        bool SelectSourceAddress(const RouteInterface& iface, bool ipv6, RouteAddress& address)
+        {
+            const UnicastAddress* linkLocal = nullptr;
+
+            for (const auto& candidate : iface.addresses)
+            {
+                if (!candidate.preferred)
+                {
+                    continue;
+                }
+
+                if (!IsLinkLocal(candidate.address, ipv6))
+                {
+                    address = candidate.address;
+                    return true;
+                }
+
+                if (linkLocal == nullptr)
+                {
+                    linkLocal = &candidate;
+                }
+            }
+
+            // An IPv6 link-local address is scoped to its link and cannot be the source of a default route.
+            if (linkLocal == nullptr || ipv6)
+            {
+                return false;
+            }
+
+            address = linkLocal->address;
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // IPv4 addresses take the first 4 bytes, in network byte order.
+        typedef std::array<uint8_t, 16> RouteAddress;
+
+        struct UnicastAddress
+        {
+            RouteAddress address{};
+            // Duplicate address detection completed and the address is not deprecated.
+            bool preferred{};
+        };
+
+        struct RouteInterface
+        {
+            uint64_t luid{};
+            uint32_t metric{};
+            bool connected{};
+            std::vector<UnicastAddress> addresses;
+        };
+
+        struct RouteEntry
+        {
+            uint64_t luid{};
+            uint8_t prefixLength{};
+            uint32_t metric{};
+        };
+
+        // Forwarding table of one address family with the IP interfaces it refers to.
+        struct RouteTable
+        {
+            bool ipv6{};
+            std::vector<RouteEntry> routes;
+            std::unordered_map<uint64_t, RouteInterface> interfaces;
+        };
+
+        // Returns the interface of the default route with the lowest sum of route and interface
+        // metric, as the IP stack orders them, skipping disconnected and excluded interfaces.
+        // Ties go to the lowest LUID, so the result does not depend on the table order.
+        // Returns nullptr if no interface has a default route.
+        const RouteInterface* SelectBestInterface(
+            const RouteTable& table,
+            const std::unordered_set<uint64_t>& excludedLuids);
+
+        // Picks a preferred address of the interface, avoiding link-local addresses when the
+        // interface has others. IPv6 link-local addresses are never picked. Returns false if
+        // the interface has no preferred address that can be picked.
+        bool SelectSourceAddress(const RouteInterface& iface, bool ipv6, RouteAddress& address);
+    }
+}
@@ -0,0 +1,107 @@
+#include "StdAfx.h"
+#include "SystemMetricManager.h"
+#include "RegistryState.h"
+
+#include <comdef.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        const wchar_t* MetricJournalValueName = L"InterfaceMetrics";
+
+        class IpHelperMetricBackend : public MetricBackend
+        {
+        public:
+            MetricLookup get(const MetricKey& key, MetricSettings& settings) override
+            {
+                MIB_IPINTERFACE_ROW iface;
+                auto status = this->getInterface(key, iface);
+                if (status == ERROR_NOT_FOUND || status == ERROR_FILE_NOT_FOUND)
+                {
+                    return MetricLookup::Absent;
+                }
+
+                if (status != NO_ERROR)
+                {
+                    return MetricLookup::Failed;
+                }
+
+                settings.metric = iface.Metric;
+                settings.automatic = iface.UseAutomaticMetric != FALSE;
+
+                return MetricLookup::Found;
+            }
+
+            bool set(const MetricKey& key, const MetricSettings& settings) override
+            {
+                MIB_IPINTERFACE_ROW iface;
+                if (this->getInterface(key, iface) != NO_ERROR)
+                {
+                    return false;
+                }
+
+                iface.Metric = settings.metric;
+                iface.UseAutomaticMetric = settings.automatic;
+                if (iface.Family == AF_INET)
+                {
+                    // Must be zero when setting an IPv4 interface.
+                    iface.SitePrefixLength = 0;
+                }
+
+                return SetIpInterfaceEntry(&iface) == NO_ERROR;
+            }
+
+        private:
+            // GetIpInterfaceEntry fails with ERROR_NOT_FOUND or ERROR_FILE_NOT_FOUND when the interface
+            // has no IP interface of the family.
+            DWORD getInterface(const MetricKey& key, MIB_IPINTERFACE_ROW& iface)
+            {
+                InitializeIpInterfaceEntry(&iface);
+                iface.InterfaceLuid.Value = key.luid;
+                iface.Family = key.family == MetricFamily::Ipv6 ? AF_INET6 : AF_INET;
+
+                return GetIpInterfaceEntry(&iface);
+            }
+        };
+
+        class RegistryMetricStore : public MetricStore
+        {
+        public:
+            bool read(std::vector<uint8_t>& data) override
+            {
+                return RegistryState::Read(MetricJournalValueName, data);
+            }
+
+            bool write(const std::vector<uint8_t>& data) override
+            {
+                try
+                {
+                    RegistryState::Write(MetricJournalValueName, data);
+                }
+                catch (const _com_error&)
+                {
+                    return false;
+                }
+
+                return true;
+            }
+
+            void remove() override
+            {
+                RegistryState::Delete(MetricJournalValueName);
+            }
+        };
+
+        MetricManager& GetMetricManager()
+        {
+            static MetricManager manager(
+                std::unique_ptr<MetricBackend>(new IpHelperMetricBackend()),
+                std::unique_ptr<MetricStore>(new RegistryMetricStore()));
+
+            return manager;
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "MetricManager.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Process-wide metric manager backed by the IP helper API, which journals the original
+        // interface settings in the registry.
+        MetricManager& GetMetricManager();
+    }
+}
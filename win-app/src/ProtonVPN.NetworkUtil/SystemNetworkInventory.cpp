@@ -0,0 +1,196 @@
+#include "StdAfx.h"
+#include "SystemNetworkInventory.h"
+#include "NetworkConfiguration.h"
+#include "NetInterface.h"
+#include "SystemAdapterTable.h"
+
+#include <comdef.h>
+#include <ws2ipdef.h>
+#include <iphlpapi.h>
+
+#include <cwctype>
+#include <algorithm>
+#include <unordered_map>
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Bind names and adapter names are GUID strings which may differ in case.
+        std::wstring NormalizeGuid(std::wstring guid)
+        {
+            std::transform(guid.begin(), guid.end(), guid.begin(), towupper);
+
+            return guid;
+        }
+
+        class SystemInventoryBackend : public InventoryBackend
+        {
+        public:
+            std::vector<Adapter> enumerate() override
+            {
+                std::vector<Adapter> adapters{};
+
+                {
+                    auto networkConfig = NetworkConfiguration::instance();
+                    networkConfig.initialize();
+
+                    for (auto iface : networkConfig.getNetworkInterfaces())
+                    {
+                        Adapter adapter{};
+                        adapter.id = iface.id();
+                        adapter.bindName = iface.bindName();
+                        adapter.ipv6Enabled = iface.isIPv6Enabled();
+
+                        adapters.push_back(adapter);
+                    }
+                }
+
+                AdapterTable ipAdapters{};
+                auto status = ReadAdapterTable(ipAdapters);
+                if (status != NO_ERROR)
+                {
+                    throw _com_error(HRESULT_FROM_WIN32(status));
+                }
+
+                std::unordered_map<std::wstring, const AdapterRecord*> byBindName{};
+                for (const auto& ipAdapter : ipAdapters.records())
+                {
+                    byBindName.emplace(NormalizeGuid(std::wstring(ipAdapter.name.begin(), ipAdapter.name.end())), &ipAdapter);
+                }
+
+                for (auto& adapter : adapters)
+                {
+                    auto it = byBindName.find(NormalizeGuid(adapter.bindName));
+                    if (it == byBindName.end())
+                    {
+                        continue;
+                    }
+
+                    auto ipAdapter = it->second;
+                    adapter.luid = ipAdapter->luid;
+                    adapter.index = ipAdapter->index;
+                    adapter.ipv4Metric = ipAdapter->ipv4Metric;
+                    adapter.ipv6Metric = ipAdapter->ipv6Metric;
+                }
+
+                return adapters;
+            }
+
+            bool refresh(Adapter& adapter) override
+            {
+                auto found = false;
+
+                for (auto family : {AF_INET, AF_INET6})
+                {
+                    MIB_IPINTERFACE_ROW row;
+                    InitializeIpInterfaceEntry(&row);
+                    row.InterfaceLuid.Value = adapter.luid;
+                    row.Family = static_cast<ADDRESS_FAMILY>(family);
+
+                    if (GetIpInterfaceEntry(&row) != NO_ERROR)
+                    {
+                        continue;
+                    }
+
+                    found = true;
+                    adapter.index = row.InterfaceIndex;
+                    if (family == AF_INET)
+                    {
+                        adapter.ipv4Metric = row.Metric;
+                    }
+                    else
+                    {
+                        adapter.ipv6Metric = row.Metric;
+                    }
+                }
+
+                return found;
+            }
+        };
+
+        VOID NETIOAPI_API_ OnIpInterfaceChange(PVOID context, PMIB_IPINTERFACE_ROW row, MIB_NOTIFICATION_TYPE type)
+        {
+            auto inventory = static_cast<NetworkInventory*>(context);
+
+            // Added and deleted IP interfaces can follow a change of the protocol bindings.
+            if (row == nullptr || type != MibParameterNotification)
+            {
+                inventory->invalidate();
+                return;
+            }
+
+            inventory->interfaceChanged(row->InterfaceLuid.Value);
+        }
+
+        VOID NETIOAPI_API_ OnUnicastIpAddressChange(PVOID context, PMIB_UNICASTIPADDRESS_ROW row, MIB_NOTIFICATION_TYPE type)
+        {
+            auto inventory = static_cast<NetworkInventory*>(context);
+
+            if (row == nullptr)
+            {
+                inventory->invalidate();
+                return;
+            }
+
+            inventory->interfaceChanged(row->InterfaceLuid.Value);
+        }
+
+        class SystemNetworkInventory
+        {
+        public:
+            SystemNetworkInventory():
+                inventory(std::unique_ptr<InventoryBackend>(new SystemInventoryBackend()))
+            {
+                // Without notifications every snapshot would be stale, so the inventory is read each time.
+                if (NotifyIpInterfaceChange(AF_UNSPEC, OnIpInterfaceChange, &this->inventory, FALSE, &this->interfaceNotification) != NO_ERROR ||
+                    NotifyUnicastIpAddressChange(AF_UNSPEC, OnUnicastIpAddressChange, &this->inventory, FALSE, &this->addressNotification) != NO_ERROR)
+                {
+                    this->cancelNotifications();
+                }
+            }
+
+            ~SystemNetworkInventory()
+            {
+                this->cancelNotifications();
+            }
+
+            NetworkInventory& get()
+            {
+                if (this->interfaceNotification == nullptr)
+                {
+                    this->inventory.invalidate();
+                }
+
+                return this->inventory;
+            }
+
+        private:
+            void cancelNotifications()
+            {
+                if (this->interfaceNotification != nullptr)
+                {
+                    CancelMibChangeNotify2(this->interfaceNotification);
+                    this->interfaceNotification = nullptr;
+                }
+
+                if (this->addressNotification != nullptr)
+                {
+                    CancelMibChangeNotify2(this->addressNotification);
+                    this->addressNotification = nullptr;
+                }
+            }
+
+            NetworkInventory inventory;
+            HANDLE interfaceNotification{};
+            HANDLE addressNotification{};
+        };
+
+        NetworkInventory& GetNetworkInventory()
+        {
+            static SystemNetworkInventory inventory{};
+
+            return inventory.get();
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "NetworkInventory.h"
+
+namespace Proton
+{
+    namespace NetworkUtil
+    {
+        // Process-wide inventory backed by the network configuration and the IP helper API.
+        // It is kept up to date by IP interface and unicast address change notifications.
+        NetworkInventory& GetNetworkInventory();
+    }
+}
@@ -5,15 +5,19 @@
 #include "BestInterface.h"
 #include "NetInterface.h"
 #include "Route.h"
-#include "InterfaceMetric.h"
+#include "SystemMetricManager.h"
+#include "CalloutDriverStatistics.h"
+#include "SystemNetworkInventory.h"
 
 #include <string>
 #include <set>
+#include <unordered_set>
 #include <algorithm>
 
 #define EXPORT __declspec(dllexport)
 
 const DWORD LockTimeoutMs = 5000;
+const ULONG TunnelInterfaceMetric = 4;
 
 extern "C" EXPORT long NetworkUtilEnableIPv6(const wchar_t* appName, const wchar_t* interfaceId)
 {
@@ -27,6 +31,8 @@ extern "C" EXPORT long NetworkUtilEnableIPv6(const wchar_t* appName, const wchar
         networkConfig.applyChanges();
 
         lock->ReleaseWriteLock();
+
+        Proton::NetworkUtil::GetNetworkInventory().invalidate();
     }
     catch (const _com_error& error)
     {
@@ -51,9 +57,10 @@ extern "C" EXPORT long NetworkUtilEnableIPv6OnAllAdapters(wchar_t* appName, cons
         networkConfig.initialize();
 
         networkConfig.ipv6Settings().enableIPv6OnAllAdapters(true, excludeIds);
-        networkConfig.applyChanges();
 
         lock->ReleaseWriteLock();
+
+        Proton::NetworkUtil::GetNetworkInventory().invalidate();
     }
     catch (const _com_error& error)
     {
@@ -78,9 +85,10 @@ extern "C" EXPORT long NetworkUtilDisableIPv6OnAllAdapters(wchar_t* appName, con
         networkConfig.initialize();
 
         networkConfig.ipv6Settings().enableIPv6OnAllAdapters(false, excludeIds);
-        networkConfig.applyChanges();
 
         lock->ReleaseWriteLock();
+
+        Proton::NetworkUtil::GetNetworkInventory().invalidate();
     }
     catch (const _com_error& error)
     {
@@ -90,19 +98,23 @@ extern "C" EXPORT long NetworkUtilDisableIPv6OnAllAdapters(wchar_t* appName, con
     return 0;
 }
 
-extern "C" EXPORT DWORD GetBestInterfaceIp(IN_ADDR* address, const wchar_t* excludedIfaceHwid)
+DWORD GetExcludedLuids(const wchar_t* excludedIfaceHwid, std::unordered_set<uint64_t>& excludedLuids)
 {
-    std::vector<std::wstring> excludedIfaceGuids{};
+    if (excludedIfaceHwid == nullptr)
+    {
+        return 0;
+    }
 
     try
     {
-        auto networkConfig = Proton::NetworkUtil::NetworkConfiguration::instance();
-
-        networkConfig.initialize();
+        auto inventory = Proton::NetworkUtil::GetNetworkInventory().snapshot();
 
-        for (auto iface : networkConfig.getNetworkInterfacesById(excludedIfaceHwid))
+        for (auto adapter : inventory->findById(excludedIfaceHwid))
         {
-            excludedIfaceGuids.push_back(iface.bindName());
+            if (adapter->luid != 0)
+            {
+                excludedLuids.insert(adapter->luid);
+            }
         }
     }
     catch (const _com_error& error)
@@ -110,20 +122,43 @@ extern "C" EXPORT DWORD GetBestInterfaceIp(IN_ADDR* address, const wchar_t* excl
         return error.Error();
     }
 
-    BestInterface bestInterface;
-    *address = bestInterface.IpAddress(excludedIfaceGuids);
-
     return 0;
 }
 
+extern "C" EXPORT DWORD GetBestInterfaceIp(IN_ADDR* address, const wchar_t* excludedIfaceHwid)
+{
+    std::unordered_set<uint64_t> excludedLuids{};
+    auto error = GetExcludedLuids(excludedIfaceHwid, excludedLuids);
+    if (error != 0)
+    {
+        return error;
+    }
+
+    IN6_ADDR ipv6Address{};
+
+    return BestInterface::IpAddresses(excludedLuids, *address, ipv6Address);
+}
+
+extern "C" EXPORT DWORD GetBestInterfaceIps(IN_ADDR* ipv4Address, IN6_ADDR* ipv6Address, const wchar_t* excludedIfaceHwid)
+{
+    std::unordered_set<uint64_t> excludedLuids{};
+    auto error = GetExcludedLuids(excludedIfaceHwid, excludedLuids);
+    if (error != 0)
+    {
+        return error;
+    }
+
+    return BestInterface::IpAddresses(excludedLuids, *ipv4Address, *ipv6Address);
+}
+
 extern "C" EXPORT long SetLowestTapMetric(UINT index)
 {
     Proton::NetworkUtil::Route::IfaceInfo info{};
     if (!GetIfaceInfo(index, info) ||
-        !Proton::NetworkUtil::InterfaceMetric::instance()->SetLowestMetric(info.Luid))
-	{
+        !Proton::NetworkUtil::GetMetricManager().apply(info.Luid.Value, TunnelInterfaceMetric))
+    {
         return 1;
-	}
+    }
 
     return 0;
 }
@@ -132,10 +167,32 @@ extern "C" EXPORT long RestoreDefaultTapMetric(UINT index)
 {
     Proton::NetworkUtil::Route::IfaceInfo info{};
     if (!GetIfaceInfo(index, info) ||
-        !Proton::NetworkUtil::InterfaceMetric::instance()->RestoreDefaultMetric(info.Luid))
+        !Proton::NetworkUtil::GetMetricManager().restore(info.Luid.Value))
     {
         return 1;
     }
 
+    return 0;
+}
+
+// Copies up to *count callout driver counters, indexed by CALLOUT_COUNTER, and sets *count
+// to the number of counters the driver reported.
+extern "C" EXPORT DWORD GetCalloutDriverStatistics(unsigned long long* counters, unsigned int* count)
+{
+    CALLOUT_STATISTICS statistics{};
+    auto error = Proton::NetworkUtil::CalloutDriverStatistics::Read(statistics);
+    if (error != ERROR_SUCCESS)
+    {
+        return error;
+    }
+
+    auto available = statistics.counterCount < CALLOUT_COUNTER_SLOTS ? statistics.counterCount : CALLOUT_COUNTER_SLOTS;
+    for (unsigned int i = 0; i < available && i < *count; i++)
+    {
+        counters[i] = statistics.counters[i];
+    }
+
+    *count = available;
+
     return 0;
 }
\ No newline at end of file
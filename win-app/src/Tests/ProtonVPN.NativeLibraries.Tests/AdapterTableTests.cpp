@@ -0,0 +1,27 @@
+#include "Check.h"
+#include "AdapterTable.h"
+
+using namespace Proton::NetworkUtil;
+
+TEST(AdapterTableIsIndexed)
+{
+    AdapterRecord ethernet{};
+    ethernet.name = "{A}";
+    ethernet.luid = 1;
+    ethernet.index = 10;
+
+    AdapterRecord ipv6Only{};
+    ipv6Only.name = "{B}";
+    ipv6Only.luid = 2;
+
+    AdapterTable table({ethernet, ipv6Only});
+
+    CHECK(!table.empty());
+    CHECK(table.findByIndex(10)->name == "{A}");
+    CHECK(table.findByLuid(2)->name == "{B}");
+    CHECK(table.findByName("{B}")->luid == 2);
+    // Adapters without IPv4 have no interface index.
+    CHECK(table.findByIndex(0) == nullptr);
+    CHECK(table.findByName("{C}") == nullptr);
+    CHECK(AdapterTable().empty());
+}
@@ -0,0 +1,175 @@
+#include "Check.h"
+#include "app_id_cache.h"
+
+#include <map>
+#include <stdexcept>
+
+using namespace ipfilter;
+
+namespace
+{
+    // Files known to the resolver. Resolving a file returns its path and the number of times
+    // it was resolved, so tests can tell fresh ids from cached ones.
+    struct FakeFiles
+    {
+        std::map<std::wstring, FileIdentity> identities;
+        std::map<std::wstring, int> resolveCounts;
+        bool failResolve{};
+    };
+
+    class FakeResolver : public AppIdResolver
+    {
+    public:
+        explicit FakeResolver(FakeFiles& files): files(files)
+        {
+        }
+
+        bool identify(const std::wstring& path, FileIdentity& identity) override
+        {
+            auto it = this->files.identities.find(path);
+            if (it == this->files.identities.end())
+            {
+                return false;
+            }
+
+            identity = it->second;
+            return true;
+        }
+
+        std::vector<uint8_t> resolve(const std::wstring& path) override
+        {
+            if (this->files.failResolve)
+            {
+                throw std::runtime_error("resolve failed");
+            }
+
+            auto count = ++this->files.resolveCounts[path];
+
+            std::vector<uint8_t> appId(path.begin(), path.end());
+            appId.push_back(static_cast<uint8_t>(count));
+
+            return appId;
+        }
+
+    private:
+        FakeFiles& files;
+    };
+
+    std::unique_ptr<AppIdResolver> makeResolver(FakeFiles& files)
+    {
+        return std::unique_ptr<AppIdResolver>(new FakeResolver(files));
+    }
+
+    const std::wstring AppPath = L"C:\\Program Files\\App\\app.exe";
+}
+
+TEST(RepeatedLookupsHitTheCache)
+{
+    FakeFiles files{};
+    files.identities[AppPath] = {1, 42, 1000};
+    AppIdCache cache(makeResolver(files));
+
+    auto first = cache.get(AppPath);
+    auto second = cache.get(AppPath);
+    auto third = cache.get(AppPath);
+
+    CHECK(first == second);
+    CHECK(second == third);
+    CHECK(files.resolveCounts[AppPath] == 1);
+    CHECK(cache.misses() == 1);
+    CHECK(cache.hits() == 2);
+}
+
+TEST(PathsDifferingInCaseAndSeparatorsShareAnEntry)
+{
+    FakeFiles files{};
+    files.identities[AppPath] = {1, 42, 1000};
+    files.identities[L"c:/program files//app/APP.EXE"] = {1, 42, 1000};
+    AppIdCache cache(makeResolver(files));
+
+    auto first = cache.get(AppPath);
+    auto second = cache.get(L"c:/program files//app/APP.EXE");
+
+    CHECK(first == second);
+    CHECK(cache.hits() == 1);
+    CHECK(cache.misses() == 1);
+}
+
+TEST(ChangedIdentityResolvesAgain)
+{
+    FakeFiles files{};
+    files.identities[AppPath] = {1, 42, 1000};
+    AppIdCache cache(makeResolver(files));
+
+    auto original = cache.get(AppPath);
+
+    // Updated in place.
+    files.identities[AppPath].lastWriteTime = 2000;
+    auto updated = cache.get(AppPath);
+    CHECK(updated != original);
+    CHECK(updated->back() == 2);
+
+    // Replaced by another file.
+    files.identities[AppPath].fileIndex = 43;
+    auto replaced = cache.get(AppPath);
+    CHECK(replaced->back() == 3);
+
+    // Moved to another volume.
+    files.identities[AppPath].volume = 2;
+    CHECK(cache.get(AppPath)->back() == 4);
+
+    CHECK(cache.get(AppPath)->back() == 4);
+    CHECK(cache.misses() == 4);
+    CHECK(cache.hits() == 1);
+}
+
+TEST(UnidentifiedFilesAreNotCached)
+{
+    FakeFiles files{};
+    AppIdCache cache(makeResolver(files));
+
+    CHECK(cache.get(AppPath)->back() == 1);
+    CHECK(cache.get(AppPath)->back() == 2);
+    CHECK(cache.misses() == 2);
+    CHECK(cache.hits() == 0);
+}
+
+TEST(FailedResolutionIsNotCached)
+{
+    FakeFiles files{};
+    files.identities[AppPath] = {1, 42, 1000};
+    files.failResolve = true;
+    AppIdCache cache(makeResolver(files));
+
+    CHECK_THROWS(cache.get(AppPath), std::runtime_error);
+
+    files.failResolve = false;
+    CHECK(cache.get(AppPath)->back() == 1);
+    CHECK(cache.get(AppPath)->back() == 1);
+    CHECK(cache.hits() == 1);
+}
+
+TEST(ClearDropsEntriesAndCounters)
+{
+    FakeFiles files{};
+    files.identities[AppPath] = {1, 42, 1000};
+    AppIdCache cache(makeResolver(files));
+
+    cache.get(AppPath);
+    cache.get(AppPath);
+    cache.clear();
+
+    CHECK(cache.hits() == 0);
+    CHECK(cache.misses() == 0);
+
+    CHECK(cache.get(AppPath)->back() == 2);
+    CHECK(cache.misses() == 1);
+    CHECK(cache.hits() == 0);
+}
+
+TEST(PathsAreNormalized)
+{
+    CHECK(AppIdCache::normalizePath(L"C:/Windows//System32\\\\CMD.exe") == L"c:\\windows\\system32\\cmd.exe");
+    CHECK(AppIdCache::normalizePath(L"\\\\server\\share\\App.exe") == L"\\\\server\\share\\app.exe");
+    CHECK(AppIdCache::normalizePath(L"") == L"");
+}
@@ -0,0 +1,244 @@
+#include "Check.h"
+#include "apply_queue.h"
+
+#include <set>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+using namespace ipfilter;
+
+namespace
+{
+    // Engine session of the worker. Batches stage their ids, which become visible when committed.
+    // Only the worker thread uses it while the queue runs.
+    struct FakeSession
+    {
+        std::set<int> staged;
+        std::set<int> committed;
+        int begins{};
+        int aborts{};
+        unsigned int beginResult{};
+        bool inTransaction{};
+    };
+
+    class FakeTarget : public ApplyTarget
+    {
+    public:
+        explicit FakeTarget(FakeSession& session): session(session)
+        {
+        }
+
+        unsigned int beginTransaction() override
+        {
+            CHECK(!this->session.inTransaction);
+            this->session.begins++;
+            if (this->session.beginResult != 0)
+            {
+                return this->session.beginResult;
+            }
+
+            this->session.inTransaction = true;
+            this->session.staged.clear();
+
+            return 0;
+        }
+
+        unsigned int commitTransaction() override
+        {
+            CHECK(this->session.inTransaction);
+            this->session.inTransaction = false;
+            this->session.committed.insert(this->session.staged.begin(), this->session.staged.end());
+
+            return 0;
+        }
+
+        unsigned int abortTransaction() override
+        {
+            CHECK(this->session.inTransaction);
+            this->session.inTransaction = false;
+            this->session.aborts++;
+
+            return 0;
+        }
+
+    private:
+        FakeSession& session;
+    };
+
+    std::unique_ptr<ApplyTarget> makeTarget(FakeSession& session)
+    {
+        return std::unique_ptr<ApplyTarget>(new FakeTarget(session));
+    }
+
+    ApplyBatch stage(FakeSession& session, int id)
+    {
+        return [&session, id]()
+        {
+            session.staged.insert(id);
+            return 0u;
+        };
+    }
+
+    // Keeps the worker busy until released, so that the batches submitted meanwhile are queued together.
+    class Gate
+    {
+    public:
+        ApplyBatch batch(FakeSession& session, int id)
+        {
+            auto started = this->started;
+            auto released = this->released;
+
+            return [&session, id, started, released]()
+            {
+                started->set_value();
+                released->wait();
+                session.staged.insert(id);
+                return 0u;
+            };
+        }
+
+        void waitStarted()
+        {
+            this->started->get_future().wait();
+        }
+
+        void release()
+        {
+            this->releasePromise.set_value();
+        }
+
+    private:
+        std::shared_ptr<std::promise<void>> started = std::make_shared<std::promise<void>>();
+        std::promise<void> releasePromise;
+        std::shared_ptr<std::shared_future<void>> released =
+            std::make_shared<std::shared_future<void>>(releasePromise.get_future().share());
+    };
+}
+
+TEST(QueuedBatchesShareATransaction)
+{
+    FakeSession session{};
+    ApplyQueue queue(makeTarget(session), 8);
+    Gate gate{};
+
+    auto first = queue.submit(gate.batch(session, 0));
+    gate.waitStarted();
+
+    std::vector<std::future<unsigned int>> results{};
+    for (int i = 1; i <= 5; i++)
+    {
+        results.push_back(queue.submit(stage(session, i)));
+    }
+
+    gate.release();
+    queue.flush();
+
+    CHECK(first.get() == 0);
+    for (auto& result : results)
+    {
+        CHECK(result.get() == 0);
+    }
+
+    CHECK(queue.batches() == 6);
+    CHECK(queue.transactions() == 2);
+    CHECK(session.begins == 2);
+    CHECK(session.committed.size() == 6);
+}
+
+TEST(CoalescedBatchesAreLimited)
+{
+    FakeSession session{};
+    ApplyQueue queue(makeTarget(session), 2);
+    Gate gate{};
+
+    queue.submit(gate.batch(session, 0));
+    gate.waitStarted();
+
+    for (int i = 1; i <= 5; i++)
+    {
+        queue.submit(stage(session, i));
+    }
+
+    gate.release();
+    queue.flush();
+
+    CHECK(queue.batches() == 6);
+    // The first batch alone, then two, two and one.
+    CHECK(queue.transactions() == 4);
+    CHECK(session.committed.size() == 6);
+}
+
+TEST(FailingBatchDoesNotFailTheOthers)
+{
+    FakeSession session{};
+    ApplyQueue queue(makeTarget(session), 8);
+    Gate gate{};
+
+    queue.submit(gate.batch(session, 0));
+    gate.waitStarted();
+
+    auto before = queue.submit(stage(session, 1));
+    auto failing = queue.submit([]()
+    {
+        return 5u;
+    });
+    auto after = queue.submit(stage(session, 3));
+
+    gate.release();
+    queue.flush();
+
+    CHECK(before.get() == 0);
+    CHECK(failing.get() == 5);
+    CHECK(after.get() == 0);
+    CHECK((session.committed == std::set<int>{0, 1, 3}));
+    // The coalesced transaction and the retry of the failing batch.
+    CHECK(session.aborts == 2);
+    CHECK(queue.batches() == 4);
+}
+
+TEST(ThrowingBatchIsReportedAsUnexpected)
+{
+    FakeSession session{};
+    ApplyQueue queue(makeTarget(session), 8);
+
+    auto result = queue.submit([]() -> unsigned int
+    {
+        throw std::runtime_error("batch failed");
+    });
+
+    CHECK(result.get() == ApplyQueue::UnexpectedResult);
+    CHECK(session.aborts == 1);
+}
+
+TEST(FailedBeginIsReported)
+{
+    FakeSession session{};
+    session.beginResult = 7;
+    ApplyQueue queue(makeTarget(session), 8);
+
+    CHECK(queue.submit(stage(session, 1)).get() == 7);
+    CHECK(session.committed.empty());
+    CHECK(queue.transactions() == 0);
+}
+
+TEST(QueuedBatchesAreAppliedBeforeDestruction)
+{
+    FakeSession session{};
+    int completed = 0;
+
+    {
+        ApplyQueue queue(makeTarget(session), 3);
+        for (int i = 0; i < 10; i++)
+        {
+            queue.submit(stage(session, i), [&completed](unsigned int result)
+            {
+                CHECK(result == 0);
+                completed++;
+            });
+        }
+    }
+
+    CHECK(completed == 10);
+    CHECK(session.committed.size() == 10);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+namespace tests
+{
+    // Keeps the compiler from dropping results that are not used otherwise.
+    template <typename T>
+    void keep(const T& value)
+    {
+        static volatile T sink{};
+        sink = value;
+        (void)sink;
+    }
+
+    // Calls the function repeatedly for about a fifth of a second and prints the time per call,
+    // and the throughput if the call processes bytes.
+    template <typename Function>
+    void measure(const char* name, size_t bytes, Function function)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const auto budget = std::chrono::milliseconds(200);
+        const auto start = Clock::now();
+        unsigned long long calls = 0;
+
+        do
+        {
+            for (int i = 0; i < 64; i++)
+            {
+                function();
+            }
+
+            calls += 64;
+        } while (Clock::now() - start < budget);
+
+        const double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+        if (bytes != 0)
+        {
+            std::printf("  %-40s %12.1f ns %10.2f GB/s\n", name, nanoseconds, bytes / nanoseconds);
+        }
+        else
+        {
+            std::printf("  %-40s %12.1f ns\n", name, nanoseconds);
+        }
+    }
+}
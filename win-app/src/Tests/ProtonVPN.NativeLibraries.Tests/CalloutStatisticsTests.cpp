@@ -0,0 +1,205 @@
+#include "Check.h"
+#include "../../ProtonVPN.CalloutDriver/CalloutStatistics.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Counter blocks of the given number of processors, in a buffer that is not cache line aligned
+    // itself, like a pool allocation.
+    class CounterBlocks
+    {
+    public:
+        explicit CounterBlocks(uint32_t processorCount):
+            storage(CalloutCounterBlocksSize(processorCount) + 1),
+            processorCount(processorCount)
+        {
+        }
+
+        void* buffer()
+        {
+            return this->storage.data() + 1;
+        }
+
+        uint64_t* counters(uint32_t processor)
+        {
+            return CalloutCounterBlock(this->buffer(), processor)->counters;
+        }
+
+        CALLOUT_STATISTICS aggregate()
+        {
+            CALLOUT_STATISTICS statistics;
+            std::memset(&statistics, 0xCC, sizeof(statistics));
+            CalloutStatisticsAggregate(this->buffer(), this->processorCount, &statistics);
+
+            return statistics;
+        }
+
+    private:
+        std::vector<uint8_t> storage;
+        uint32_t processorCount;
+    };
+
+    CALLOUT_STATISTICS numberedStatistics()
+    {
+        CALLOUT_STATISTICS statistics{};
+        statistics.version = CALLOUT_STATISTICS_VERSION;
+        statistics.counterCount = CalloutCounterCount;
+        for (uint32_t i = 0; i < CalloutCounterCount; i++)
+        {
+            statistics.counters[i] = 100 + i;
+        }
+
+        return statistics;
+    }
+
+    // Statistics as read by an application built with the given number of counter slots.
+    template <uint32_t Slots>
+    struct ReaderStatistics
+    {
+        uint32_t version;
+        uint32_t counterCount;
+        uint64_t counters[Slots];
+    };
+}
+
+TEST(BlocksAreCacheLineAlignedAndDisjoint)
+{
+    CounterBlocks blocks(4);
+    auto* end = static_cast<uint8_t*>(blocks.buffer()) + CalloutCounterBlocksSize(4);
+
+    for (uint32_t processor = 0; processor < 4; processor++)
+    {
+        auto* block = CalloutCounterBlock(blocks.buffer(), processor);
+        CHECK(reinterpret_cast<uintptr_t>(block) % CALLOUT_STATISTICS_CACHE_LINE == 0);
+        CHECK(reinterpret_cast<uint8_t*>(block) >= static_cast<uint8_t*>(blocks.buffer()));
+        CHECK(reinterpret_cast<uint8_t*>(block + 1) <= end);
+
+        if (processor > 0)
+        {
+            CHECK(block == CalloutCounterBlock(blocks.buffer(), processor - 1) + 1);
+        }
+    }
+}
+
+TEST(CountersAreSummedAcrossProcessors)
+{
+    const uint32_t processorCount = 5;
+    CounterBlocks blocks(processorCount);
+
+    for (uint32_t processor = 0; processor < processorCount; processor++)
+    {
+        for (uint32_t i = 0; i < CalloutCounterCount; i++)
+        {
+            blocks.counters(processor)[i] = (processor + 1) * 1000 + i;
+        }
+    }
+
+    auto statistics = blocks.aggregate();
+    CHECK(statistics.version == CALLOUT_STATISTICS_VERSION);
+    CHECK(statistics.counterCount == CalloutCounterCount);
+
+    for (uint32_t i = 0; i < CalloutCounterCount; i++)
+    {
+        CHECK(statistics.counters[i] == 15000 + processorCount * i);
+    }
+}
+
+TEST(PaddingSlotsAreNotReported)
+{
+    CounterBlocks blocks(2);
+
+    for (uint32_t i = CalloutCounterCount; i < CALLOUT_COUNTER_SLOTS; i++)
+    {
+        blocks.counters(0)[i] = 7;
+        blocks.counters(1)[i] = 7;
+    }
+
+    blocks.counters(1)[CalloutCounterDnsBlocked] = 3;
+
+    auto statistics = blocks.aggregate();
+    for (uint32_t i = 0; i < CALLOUT_COUNTER_SLOTS; i++)
+    {
+        CHECK(statistics.counters[i] == (i == CalloutCounterDnsBlocked ? 3u : 0u));
+    }
+}
+
+TEST(NoBlocksReportZeroes)
+{
+    CALLOUT_STATISTICS statistics;
+    std::memset(&statistics, 0xCC, sizeof(statistics));
+    CalloutStatisticsAggregate(nullptr, 0, &statistics);
+
+    CHECK(statistics.counterCount == CalloutCounterCount);
+    for (uint32_t i = 0; i < CALLOUT_COUNTER_SLOTS; i++)
+    {
+        CHECK(statistics.counters[i] == 0);
+    }
+}
+
+TEST(ReaderWithTheSameCountersReceivesAll)
+{
+    auto statistics = numberedStatistics();
+    CALLOUT_STATISTICS read{};
+
+    CHECK(CalloutStatisticsCopy(&statistics, &read, sizeof(read)) == sizeof(read));
+    CHECK(read.counterCount == CalloutCounterCount);
+    CHECK(std::memcmp(&read, &statistics, sizeof(read)) == 0);
+}
+
+TEST(ReaderWithFewerCountersReceivesThoseThatFit)
+{
+    auto statistics = numberedStatistics();
+    ReaderStatistics<4> read{};
+
+    CHECK(CalloutStatisticsCopy(&statistics, &read, sizeof(read)) == sizeof(read));
+    CHECK(read.version == CALLOUT_STATISTICS_VERSION);
+    CHECK(read.counterCount == 4);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        CHECK(read.counters[i] == 100 + i);
+    }
+
+    // A partial counter at the end of the buffer is not reported.
+    std::vector<uint8_t> buffer(offsetof(CALLOUT_STATISTICS, counters) + 2 * sizeof(uint64_t) + 3);
+    CHECK(CalloutStatisticsCopy(&statistics, buffer.data(), buffer.size()) == buffer.size());
+
+    uint32_t counterCount = 0;
+    std::memcpy(&counterCount, buffer.data() + offsetof(CALLOUT_STATISTICS, counterCount), sizeof(counterCount));
+    CHECK(counterCount == 2);
+}
+
+TEST(ReaderWithOnlyTheHeaderReceivesNoCounters)
+{
+    auto statistics = numberedStatistics();
+    std::vector<uint8_t> buffer(offsetof(CALLOUT_STATISTICS, counters));
+
+    CHECK(CalloutStatisticsCopy(&statistics, buffer.data(), buffer.size()) == buffer.size());
+
+    uint32_t counterCount = 1;
+    std::memcpy(&counterCount, buffer.data() + offsetof(CALLOUT_STATISTICS, counterCount), sizeof(counterCount));
+    CHECK(counterCount == 0);
+
+    CHECK(CalloutStatisticsCopy(&statistics, buffer.data(), buffer.size() - 1) == 0);
+}
+
+TEST(ReaderWithMoreCountersKeepsItsOwnSlots)
+{
+    auto statistics = numberedStatistics();
+    ReaderStatistics<CALLOUT_COUNTER_SLOTS + 8> read;
+    std::memset(&read, 0xEE, sizeof(read));
+
+    CHECK(CalloutStatisticsCopy(&statistics, &read, sizeof(read)) == sizeof(CALLOUT_STATISTICS));
+    CHECK(read.counterCount == CalloutCounterCount);
+    for (uint32_t i = 0; i < CalloutCounterCount; i++)
+    {
+        CHECK(read.counters[i] == 100 + i);
+    }
+
+    // Slots past the driver's statistics are not written, readers ignore them through counterCount.
+    for (uint32_t i = CALLOUT_COUNTER_SLOTS; i < CALLOUT_COUNTER_SLOTS + 8; i++)
+    {
+        CHECK(read.counters[i] == 0xEEEEEEEEEEEEEEEEull);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+namespace tests
+{
+    typedef void (*TestFunction)();
+
+    struct Test
+    {
+        const char* name;
+        TestFunction function;
+        bool benchmark;
+    };
+
+    inline std::vector<Test>& registeredTests()
+    {
+        static std::vector<Test> tests{};
+        return tests;
+    }
+
+    inline int& failureCount()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    struct Registration
+    {
+        Registration(const char* name, TestFunction function, bool benchmark = false)
+        {
+            registeredTests().push_back({name, function, benchmark});
+        }
+    };
+
+    inline void fail(const char* file, int line, const char* expression)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        failureCount()++;
+    }
+}
+
+#define TEST(name) \
+    static void name(); \
+    static const tests::Registration name##Registration(#name, name); \
+    static void name()
+
+// Benchmarks are skipped unless their name is selected explicitly, see TestMain.cpp and Benchmark.h.
+#define BENCHMARK(name) \
+    static void name(); \
+    static const tests::Registration name##Registration(#name, name, true); \
+    static void name()
+
+#define CHECK(expression) \
+    do \
+    { \
+        if (!(expression)) \
+        { \
+            tests::fail(__FILE__, __LINE__, #expression); \
+        } \
+    } while (false)
+
+#define CHECK_THROWS(expression, exception) \
+    do \
+    { \
+        bool thrown = false; \
+        try \
+        { \
+            (void)(expression); \
+        } \
+        catch (const exception&) \
+        { \
+            thrown = true; \
+        } \
+        if (!thrown) \
+        { \
+            tests::fail(__FILE__, __LINE__, #expression " throws " #exception); \
+        } \
+    } while (false)
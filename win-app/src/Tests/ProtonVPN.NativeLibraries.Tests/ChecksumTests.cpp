@@ -0,0 +1,244 @@
+#include "Check.h"
+#include "Benchmark.h"
+#include "../../ProtonVPN.CalloutDriver/Checksum.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // RFC 1071 checksum summed byte by byte in network order, independent of Checksum.h.
+    uint32_t referenceSum(const uint8_t* data, size_t length, uint32_t sum)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            sum += i % 2 == 0 ? data[i] << 8 : data[i];
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+
+        return sum;
+    }
+
+    uint16_t referenceChecksum(const uint8_t* data, size_t length)
+    {
+        return static_cast<uint16_t>(~referenceSum(data, length, 0));
+    }
+
+    std::vector<uint8_t> randomBytes(std::mt19937& random, size_t length)
+    {
+        std::vector<uint8_t> bytes(length);
+        for (auto& byte : bytes)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+
+        return bytes;
+    }
+
+    uint16_t readUint16(const uint8_t* data)
+    {
+        return static_cast<uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    void writeUint16(uint8_t* data, uint16_t value)
+    {
+        data[0] = static_cast<uint8_t>(value >> 8);
+        data[1] = static_cast<uint8_t>(value);
+    }
+}
+
+TEST(ComputeMatchesTheReference)
+{
+    std::mt19937 random(1071);
+    auto buffer = randomBytes(random, 4096 + 64);
+
+    for (int i = 0; i < 2000; i++)
+    {
+        size_t offset = random() % 64;
+        size_t length = random() % 4097;
+
+        CHECK(ChecksumCompute(buffer.data() + offset, length) == referenceChecksum(buffer.data() + offset, length));
+    }
+}
+
+TEST(KnownIpv4HeaderChecksum)
+{
+    uint8_t header[] = {
+        0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+        0x00, 0x00, 0xC0, 0xA8, 0x00, 0x01, 0xC0, 0xA8, 0x00, 0xC7,
+    };
+
+    CHECK(ChecksumCompute(header, sizeof(header)) == 0xB861);
+
+    writeUint16(header + 10, 0xB861);
+    CHECK(ChecksumCompute(header, sizeof(header)) == 0);
+}
+
+TEST(OddTailIsPaddedWithZero)
+{
+    const uint8_t odd[] = {0x12, 0x34, 0x56};
+    const uint8_t padded[] = {0x12, 0x34, 0x56, 0x00};
+
+    CHECK(ChecksumCompute(odd, sizeof(odd)) == ChecksumCompute(padded, sizeof(padded)));
+    CHECK(ChecksumCompute(odd, 1) == static_cast<uint16_t>(~0x1200));
+    CHECK(ChecksumCompute(odd, 0) == 0xFFFF);
+}
+
+TEST(VectorSumsMatchTheScalarSum)
+{
+    std::mt19937 random(1624);
+    auto buffer = randomBytes(random, 8192 + 64);
+
+    for (int i = 0; i < 2000; i++)
+    {
+        size_t offset = random() % 64;
+        size_t length = random() % 8193;
+        uint64_t initial = random() % 2 == 0 ? 0 : random();
+        const uint8_t* data = buffer.data() + offset;
+        uint32_t expected = ChecksumFold(ChecksumSumScalar(data, length, initial));
+
+        CHECK(ChecksumFold(ChecksumSum(data, length, initial)) == expected);
+#ifdef CHECKSUM_SSE2
+        CHECK(ChecksumFold(ChecksumSumSse2(data, length, initial)) == expected);
+#endif
+#ifdef CHECKSUM_AVX2
+        if (ChecksumHasAvx2())
+        {
+            CHECK(ChecksumFold(ChecksumSumAvx2(data, length, initial)) == expected);
+        }
+#endif
+    }
+}
+
+TEST(VectorSumsDoNotOverflowOnLargeBuffers)
+{
+    // All ones maximizes every lane.
+    std::vector<uint8_t> buffer(1 << 20, 0xFF);
+    uint32_t expected = ChecksumFold(ChecksumSumScalar(buffer.data(), buffer.size(), 0));
+
+    CHECK(ChecksumFold(ChecksumSum(buffer.data(), buffer.size(), 0)) == expected);
+#ifdef CHECKSUM_SSE2
+    CHECK(ChecksumFold(ChecksumSumSse2(buffer.data(), buffer.size(), 0)) == expected);
+#endif
+#ifdef CHECKSUM_AVX2
+    if (ChecksumHasAvx2())
+    {
+        CHECK(ChecksumFold(ChecksumSumAvx2(buffer.data(), buffer.size(), 0)) == expected);
+    }
+#endif
+}
+
+TEST(PartialSumsChain)
+{
+    std::mt19937 random(3);
+    auto buffer = randomBytes(random, 1500);
+
+    for (size_t split = 0; split <= buffer.size(); split += 2)
+    {
+        uint16_t partial = ChecksumPartial(buffer.data(), split, 0);
+        partial = ChecksumPartial(buffer.data() + split, buffer.size() - split, partial);
+
+        CHECK(ChecksumFinish(partial) == referenceChecksum(buffer.data(), buffer.size()));
+    }
+}
+
+TEST(Update16MatchesRfc1624Example)
+{
+    // RFC 1624 section 4: equation 3 yields 0x0000 where equation 2 would yield 0xFFFF.
+    CHECK(ChecksumUpdate16(0xDD2F, 0x5555, 0x3285) == 0x0000);
+}
+
+TEST(Update16MatchesRecomputation)
+{
+    std::mt19937 random(1141);
+
+    for (int i = 0; i < 2000; i++)
+    {
+        auto data = randomBytes(random, 2 * (1 + random() % 32));
+        uint16_t checksum = ChecksumCompute(data.data(), data.size());
+
+        size_t word = 2 * (random() % (data.size() / 2));
+        uint16_t oldValue = readUint16(data.data() + word);
+        uint16_t newValue = static_cast<uint16_t>(random());
+        writeUint16(data.data() + word, newValue);
+
+        CHECK(ChecksumUpdate16(checksum, oldValue, newValue) == ChecksumCompute(data.data(), data.size()));
+    }
+}
+
+TEST(UpdateOfAnAddressMatchesRecomputation)
+{
+    std::mt19937 random(624);
+
+    for (int i = 0; i < 500; i++)
+    {
+        auto header = randomBytes(random, 40);
+        uint16_t checksum = ChecksumCompute(header.data(), header.size());
+
+        auto address = randomBytes(random, 16);
+        std::vector<uint8_t> previous(header.begin() + 8, header.begin() + 24);
+        std::copy(address.begin(), address.end(), header.begin() + 8);
+
+        CHECK(ChecksumUpdate(checksum, previous.data(), address.data(), address.size()) ==
+            ChecksumCompute(header.data(), header.size()));
+    }
+}
+
+TEST(UdpChecksumCoversThePseudoHeader)
+{
+    std::mt19937 random(768);
+
+    for (size_t addressLength : {4, 16})
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            auto source = randomBytes(random, addressLength);
+            auto destination = randomBytes(random, addressLength);
+            auto datagram = randomBytes(random, 8 + random() % 600);
+            writeUint16(datagram.data() + 4, static_cast<uint16_t>(datagram.size()));
+            writeUint16(datagram.data() + 6, 0);
+
+            std::vector<uint8_t> pseudoHeader(source);
+            pseudoHeader.insert(pseudoHeader.end(), destination.begin(), destination.end());
+            pseudoHeader.insert(pseudoHeader.end(), {0, 17, 0, 0});
+            writeUint16(pseudoHeader.data() + pseudoHeader.size() - 2, static_cast<uint16_t>(datagram.size()));
+
+            uint16_t expected = static_cast<uint16_t>(~referenceSum(datagram.data(), datagram.size(),
+                referenceSum(pseudoHeader.data(), pseudoHeader.size(), 0)));
+            uint16_t checksum = ChecksumUdp(source.data(), destination.data(), addressLength,
+                datagram.data(), static_cast<uint32_t>(datagram.size()));
+
+            CHECK(checksum == (expected == 0 ? 0xFFFF : expected));
+
+            // A receiver summing the pseudo-header and the datagram with its checksum gets all ones.
+            writeUint16(datagram.data() + 6, checksum);
+            CHECK(referenceSum(datagram.data(), datagram.size(), referenceSum(pseudoHeader.data(), pseudoHeader.size(), 0)) == 0xFFFF);
+        }
+    }
+}
+
+BENCHMARK(BenchmarkChecksumSums)
+{
+    std::mt19937 random(5);
+    auto buffer = randomBytes(random, 65536 + 1);
+
+    for (size_t length : {20, 64, 512, 1500, 65536})
+    {
+        std::printf("%zu bytes\n", length);
+
+        // Odd offsets keep the loads unaligned, as packet data often is.
+        const uint8_t* data = buffer.data() + 1;
+        tests::measure("scalar", length, [&] { tests::keep(ChecksumSumScalar(data, length, 0)); });
+#ifdef CHECKSUM_SSE2
+        tests::measure("sse2", length, [&] { tests::keep(ChecksumSumSse2(data, length, 0)); });
+#endif
+#ifdef CHECKSUM_AVX2
+        if (ChecksumHasAvx2())
+        {
+            tests::measure("avx2", length, [&] { tests::keep(ChecksumSumAvx2(data, length, 0)); });
+        }
+#endif
+        tests::measure("dispatched", length, [&] { tests::keep(ChecksumSum(data, length, 0)); });
+    }
+}
@@ -0,0 +1,281 @@
+#include "Check.h"
+#include "../../ProtonVPN.CalloutDriver/DecisionTable.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    class Table
+    {
+    public:
+        explicit Table(uint32_t capacity):
+            storage((DecisionTableSize(capacity) + 7) / 8),
+            table(DecisionTableInitialize(this->storage.data(), capacity))
+        {
+        }
+
+        DECISION_TABLE* operator->() const
+        {
+            return this->table;
+        }
+
+        DECISION_TABLE* get() const
+        {
+            return this->table;
+        }
+
+    private:
+        std::vector<uint64_t> storage;
+        DECISION_TABLE* table;
+    };
+
+    // Returns keys above the given one that share its home slot.
+    std::vector<uint64_t> collidingKeys(const DECISION_TABLE* table, uint64_t key, size_t count)
+    {
+        std::vector<uint64_t> keys{};
+        for (uint64_t candidate = key + 1; keys.size() < count; candidate++)
+        {
+            if (DecisionTableHome(table, candidate) == DecisionTableHome(table, key))
+            {
+                keys.push_back(candidate);
+            }
+        }
+
+        return keys;
+    }
+
+    bool contains(const DECISION_TABLE* table, uint64_t key, uint64_t expectedValue)
+    {
+        uint64_t value = 0;
+        return DecisionTableLookup(table, key, &value) && value == expectedValue;
+    }
+}
+
+TEST(InitializeRejectsInvalidCapacities)
+{
+    std::vector<uint64_t> storage(DecisionTableSize(64) / 8 + 1);
+
+    CHECK(DecisionTableInitialize(storage.data(), 0) == nullptr);
+    CHECK(DecisionTableInitialize(storage.data(), DECISION_TABLE_MAX_PROBES / 2) == nullptr);
+    CHECK(DecisionTableInitialize(storage.data(), 48) == nullptr);
+    CHECK(DecisionTableInitialize(nullptr, 64) == nullptr);
+    CHECK(DecisionTableInitialize(storage.data(), 64) != nullptr);
+}
+
+TEST(InsertedKeysAreFound)
+{
+    Table table(64);
+
+    for (uint64_t key = 1; key <= 32; key++)
+    {
+        CHECK(DecisionTableInsert(table.get(), key, key * 10));
+    }
+
+    for (uint64_t key = 1; key <= 32; key++)
+    {
+        CHECK(contains(table.get(), key, key * 10));
+    }
+
+    uint64_t value = 1;
+    CHECK(!DecisionTableLookup(table.get(), 33, &value));
+    CHECK(value == 1);
+}
+
+TEST(InsertReplacesTheValue)
+{
+    Table table(64);
+
+    CHECK(DecisionTableInsert(table.get(), 7, 1));
+    CHECK(DecisionTableInsert(table.get(), 7, 2));
+    CHECK(contains(table.get(), 7, 2));
+
+    uint32_t slots = 0;
+    for (uint32_t i = 0; i < table->capacity; i++)
+    {
+        slots += table->slots[i].key == 7 ? 1 : 0;
+    }
+
+    CHECK(slots == 1);
+}
+
+TEST(RemovedKeysAreNotFound)
+{
+    Table table(64);
+
+    CHECK(DecisionTableInsert(table.get(), 7, 1));
+    CHECK(DecisionTableInsert(table.get(), 8, 2));
+    DecisionTableRemove(table.get(), 7);
+    DecisionTableRemove(table.get(), 9);
+
+    uint64_t value = 0;
+    CHECK(!DecisionTableLookup(table.get(), 7, &value));
+    CHECK(contains(table.get(), 8, 2));
+}
+
+TEST(ReservedKeysAreRejected)
+{
+    Table table(64);
+
+    CHECK(!DecisionTableInsert(table.get(), DECISION_TABLE_EMPTY, 1));
+    CHECK(!DecisionTableInsert(table.get(), DECISION_TABLE_DELETED, 1));
+    CHECK(!DecisionTableInsert(table.get(), DECISION_TABLE_BUSY, 1));
+
+    uint64_t value = 0;
+    CHECK(!DecisionTableLookup(table.get(), DECISION_TABLE_EMPTY, &value));
+    CHECK(!DecisionTableLookup(table.get(), DECISION_TABLE_DELETED, &value));
+}
+
+TEST(LookupSkipsTombstones)
+{
+    Table table(64);
+    auto keys = collidingKeys(table.get(), 1, 2);
+
+    CHECK(DecisionTableInsert(table.get(), 1, 1));
+    CHECK(DecisionTableInsert(table.get(), keys[0], 2));
+    CHECK(DecisionTableInsert(table.get(), keys[1], 3));
+    DecisionTableRemove(table.get(), keys[0]);
+
+    CHECK(contains(table.get(), 1, 1));
+    CHECK(contains(table.get(), keys[1], 3));
+}
+
+TEST(InsertReusesTombstones)
+{
+    Table table(64);
+    auto home = DecisionTableHome(table.get(), 1);
+    auto keys = collidingKeys(table.get(), 1, 2);
+
+    CHECK(DecisionTableInsert(table.get(), 1, 1));
+    CHECK(DecisionTableInsert(table.get(), keys[0], 2));
+    DecisionTableRemove(table.get(), 1);
+    CHECK(table->slots[home].key == DECISION_TABLE_DELETED);
+
+    CHECK(DecisionTableInsert(table.get(), keys[1], 3));
+    CHECK(table->slots[home].key == keys[1]);
+    CHECK(contains(table.get(), keys[0], 2));
+    CHECK(contains(table.get(), keys[1], 3));
+}
+
+TEST(InsertFailsWhenTheProbeWindowIsFull)
+{
+    Table table(64);
+    auto keys = collidingKeys(table.get(), 1, DECISION_TABLE_MAX_PROBES);
+
+    CHECK(DecisionTableInsert(table.get(), 1, 1));
+    for (size_t i = 0; i + 1 < keys.size(); i++)
+    {
+        CHECK(DecisionTableInsert(table.get(), keys[i], i));
+    }
+
+    CHECK(!DecisionTableInsert(table.get(), keys.back(), 0));
+    CHECK(DecisionTableInsert(table.get(), 1, 2));
+    CHECK(contains(table.get(), 1, 2));
+
+    DecisionTableRemove(table.get(), keys[3]);
+    CHECK(DecisionTableInsert(table.get(), keys.back(), 4));
+    CHECK(contains(table.get(), keys.back(), 4));
+}
+
+TEST(ProbesWrapAroundTheTable)
+{
+    Table table(DECISION_TABLE_MAX_PROBES);
+    auto keys = collidingKeys(table.get(), 1, DECISION_TABLE_MAX_PROBES - 1);
+
+    CHECK(DecisionTableInsert(table.get(), 1, 1));
+    for (auto key : keys)
+    {
+        CHECK(DecisionTableInsert(table.get(), key, key));
+    }
+
+    for (auto key : keys)
+    {
+        CHECK(contains(table.get(), key, key));
+    }
+
+    CHECK(!DecisionTableInsert(table.get(), keys.back() + 1, 0));
+}
+
+// Writers insert, replace and remove their own keys while readers look up every key. Values carry
+// their key in the upper bits, so a lookup returning a value of another key is detected.
+// Build with NATIVE_TESTS_THREAD_SANITIZE to check the accesses.
+TEST(ConcurrentInsertRemoveAndLookup)
+{
+    const uint32_t writerCount = 4;
+    const uint32_t readerCount = 2;
+    const uint64_t keysPerWriter = 64;
+    const int rounds = 500;
+
+    Table table(1024);
+    std::atomic<bool> stop{false};
+    std::atomic<int> mismatches{0};
+    std::atomic<int> failedInserts{0};
+    std::vector<std::thread> threads{};
+
+    for (uint32_t writer = 0; writer < writerCount; writer++)
+    {
+        threads.emplace_back([&, writer]
+        {
+            for (int round = 0; round < rounds; round++)
+            {
+                for (uint64_t i = 0; i < keysPerWriter; i++)
+                {
+                    uint64_t key = writer * keysPerWriter + i + 1;
+                    if (!DecisionTableInsert(table.get(), key, (key << 16) | static_cast<uint64_t>(round)))
+                    {
+                        failedInserts++;
+                    }
+
+                    uint64_t value = 0;
+                    if (!DecisionTableLookup(table.get(), key, &value) || value >> 16 != key)
+                    {
+                        mismatches++;
+                    }
+
+                    if (round % 3 == 0)
+                    {
+                        DecisionTableRemove(table.get(), key);
+                    }
+                }
+            }
+        });
+    }
+
+    for (uint32_t reader = 0; reader < readerCount; reader++)
+    {
+        threads.emplace_back([&]
+        {
+            while (!stop)
+            {
+                for (uint64_t key = 1; key <= writerCount * keysPerWriter; key++)
+                {
+                    uint64_t value = 0;
+                    if (DecisionTableLookup(table.get(), key, &value) && value >> 16 != key)
+                    {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < writerCount; i++)
+    {
+        threads[i].join();
+    }
+
+    stop = true;
+    for (uint32_t i = writerCount; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    CHECK(mismatches == 0);
+    CHECK(failedInserts == 0);
+
+    for (uint64_t key = 1; key <= writerCount * keysPerWriter; key++)
+    {
+        CHECK(contains(table.get(), key, (key << 16) | static_cast<uint64_t>(rounds - 1)));
+    }
+}
@@ -0,0 +1,356 @@
+#include "Check.h"
+#include "../../ProtonVPN.CalloutDriver/DnsPacket.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Query for example.com A, id 0x1234, recursion desired.
+    const std::vector<uint8_t> Query = {
+        0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+        0x00, 0x01, 0x00, 0x01,
+    };
+
+    const uint8_t SourceV4[] = {10, 2, 0, 2};
+    const uint8_t DestinationV4[] = {10, 2, 0, 1};
+    const uint8_t SourceV6[] = {0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2};
+    const uint8_t DestinationV6[] = {0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+
+    void append(std::vector<uint8_t>& packet, const uint8_t* data, size_t length)
+    {
+        packet.insert(packet.end(), data, data + length);
+    }
+
+    void appendUdp(std::vector<uint8_t>& packet, uint16_t destinationPort)
+    {
+        const size_t udp = packet.size();
+        packet.resize(udp + DNS_PACKET_UDP_HEADER_SIZE);
+        DnsPacketWriteUint16(packet.data() + udp, 51000);
+        DnsPacketWriteUint16(packet.data() + udp + 2, destinationPort);
+        DnsPacketWriteUint16(packet.data() + udp + 4, static_cast<uint16_t>(DNS_PACKET_UDP_HEADER_SIZE + Query.size()));
+        packet.insert(packet.end(), Query.begin(), Query.end());
+    }
+
+    std::vector<uint8_t> requestV4(uint32_t optionWords = 0, uint8_t protocol = DNS_PACKET_PROTOCOL_UDP, uint16_t port = DNS_PACKET_PORT)
+    {
+        std::vector<uint8_t> packet(DNS_PACKET_IPV4_HEADER_SIZE + optionWords * 4);
+        packet[0] = static_cast<uint8_t>(0x45 + optionWords);
+        packet[8] = 128;
+        packet[9] = protocol;
+        std::memcpy(packet.data() + 12, SourceV4, 4);
+        std::memcpy(packet.data() + 16, DestinationV4, 4);
+        appendUdp(packet, port);
+        DnsPacketWriteUint16(packet.data() + 2, static_cast<uint16_t>(packet.size()));
+
+        return packet;
+    }
+
+    // Extension headers are given as raw bytes, their first byte is set to the next header.
+    struct ExtensionHeader
+    {
+        uint8_t type;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::vector<uint8_t> requestV6(const std::vector<ExtensionHeader>& extensions = {}, uint16_t port = DNS_PACKET_PORT)
+    {
+        std::vector<uint8_t> packet(DNS_PACKET_IPV6_HEADER_SIZE);
+        packet[0] = 0x60;
+        packet[6] = extensions.empty() ? DNS_PACKET_PROTOCOL_UDP : extensions[0].type;
+        packet[7] = 64;
+        std::memcpy(packet.data() + 8, SourceV6, 16);
+        std::memcpy(packet.data() + 24, DestinationV6, 16);
+
+        for (size_t i = 0; i < extensions.size(); i++)
+        {
+            const size_t offset = packet.size();
+            append(packet, extensions[i].bytes.data(), extensions[i].bytes.size());
+            packet[offset] = i + 1 < extensions.size() ? extensions[i + 1].type : DNS_PACKET_PROTOCOL_UDP;
+        }
+
+        appendUdp(packet, port);
+        DnsPacketWriteUint16(packet.data() + 4, static_cast<uint16_t>(packet.size() - DNS_PACKET_IPV6_HEADER_SIZE));
+
+        return packet;
+    }
+
+    ExtensionHeader options(uint8_t type, uint8_t units)
+    {
+        ExtensionHeader header{type, std::vector<uint8_t>((units + 1u) * 8)};
+        header.bytes[1] = units;
+
+        return header;
+    }
+
+    ExtensionHeader fragment(uint16_t offsetAndFlags)
+    {
+        ExtensionHeader header{DNS_PACKET_IPV6_FRAGMENT, std::vector<uint8_t>(8)};
+        DnsPacketWriteUint16(header.bytes.data() + 2, offsetAndFlags);
+
+        return header;
+    }
+
+    bool parseV4(const std::vector<uint8_t>& packet, DNS_REQUEST* request)
+    {
+        return DnsPacketParseRequestV4(packet.data(), static_cast<uint32_t>(packet.size()), request);
+    }
+
+    bool parseV6(const std::vector<uint8_t>& packet, DNS_REQUEST* request)
+    {
+        return DnsPacketParseRequestV6(packet.data(), static_cast<uint32_t>(packet.size()), request);
+    }
+
+    // Sums the pseudo-header and the datagram including its checksum, a valid datagram sums to all ones.
+    uint16_t udpSum(const uint8_t* source, const uint8_t* destination, size_t addressLength, const uint8_t* udp)
+    {
+        const uint16_t length = DnsPacketReadUint16(udp + 4);
+        uint16_t partial = ChecksumPartial(source, addressLength, 0);
+        partial = ChecksumPartial(destination, addressLength, partial);
+        partial = static_cast<uint16_t>(ChecksumFold(static_cast<uint32_t>(partial) + DNS_PACKET_PROTOCOL_UDP + length));
+
+        return ChecksumPartial(udp, length, partial);
+    }
+}
+
+TEST(Ipv4RequestIsParsed)
+{
+    DNS_REQUEST request{};
+    CHECK(parseV4(requestV4(), &request));
+    CHECK(request.ipHeaderLength == DNS_PACKET_IPV4_HEADER_SIZE);
+    CHECK(request.payloadLength == Query.size());
+
+    CHECK(parseV4(requestV4(2), &request));
+    CHECK(request.ipHeaderLength == DNS_PACKET_IPV4_HEADER_SIZE + 8);
+    CHECK(request.payloadLength == Query.size());
+}
+
+TEST(OtherIpv4PacketsAreRejected)
+{
+    DNS_REQUEST request{};
+    CHECK(!parseV4(requestV4(0, 6), &request));
+    CHECK(!parseV4(requestV4(0, DNS_PACKET_PROTOCOL_UDP, 443), &request));
+    CHECK(!parseV4(requestV6(), &request));
+
+    auto longerThanStated = requestV4();
+    longerThanStated.push_back(0);
+    CHECK(!parseV4(longerThanStated, &request));
+
+    auto shortHeaderLength = requestV4();
+    shortHeaderLength[0] = 0x44;
+    CHECK(!parseV4(shortHeaderLength, &request));
+}
+
+TEST(TruncatedIpv4RequestsAreRejected)
+{
+    const auto packet = requestV4(1);
+
+    for (size_t size = 0; size < packet.size() - Query.size() + DNS_PACKET_DNS_HEADER_SIZE; size++)
+    {
+        // The exact size makes the sanitizers catch reads past the end.
+        std::vector<uint8_t> truncated(packet.begin(), packet.begin() + size);
+        if (size >= 4)
+        {
+            DnsPacketWriteUint16(truncated.data() + 2, static_cast<uint16_t>(size));
+        }
+
+        DNS_REQUEST request{};
+        CHECK(!parseV4(truncated, &request));
+    }
+}
+
+TEST(Ipv6RequestIsParsed)
+{
+    DNS_REQUEST request{};
+    CHECK(parseV6(requestV6(), &request));
+    CHECK(request.ipHeaderLength == DNS_PACKET_IPV6_HEADER_SIZE);
+    CHECK(request.payloadLength == Query.size());
+
+    CHECK(!parseV6(requestV6({}, 443), &request));
+    CHECK(!parseV6(requestV4(), &request));
+}
+
+TEST(Ipv6ExtensionHeadersAreSkipped)
+{
+    auto authentication = ExtensionHeader{DNS_PACKET_IPV6_AUTHENTICATION, std::vector<uint8_t>(16)};
+    authentication.bytes[1] = 2;
+
+    auto packet = requestV6({
+        options(DNS_PACKET_IPV6_HOP_BY_HOP, 0),
+        options(DNS_PACKET_IPV6_DESTINATION_OPTIONS, 1),
+        options(DNS_PACKET_IPV6_ROUTING, 2),
+        authentication,
+    });
+
+    DNS_REQUEST request{};
+    CHECK(parseV6(packet, &request));
+    CHECK(request.ipHeaderLength == DNS_PACKET_IPV6_HEADER_SIZE + 8 + 16 + 24 + 16);
+    CHECK(request.payloadLength == Query.size());
+}
+
+TEST(Ipv6ExtensionHeadersAreLimited)
+{
+    std::vector<ExtensionHeader> extensions(DNS_PACKET_IPV6_MAX_EXTENSION_HEADERS, options(DNS_PACKET_IPV6_DESTINATION_OPTIONS, 0));
+
+    DNS_REQUEST request{};
+    CHECK(parseV6(requestV6(extensions), &request));
+
+    extensions.push_back(options(DNS_PACKET_IPV6_DESTINATION_OPTIONS, 0));
+    CHECK(!parseV6(requestV6(extensions), &request));
+}
+
+TEST(UnknownIpv6ExtensionHeaderIsRejected)
+{
+    DNS_REQUEST request{};
+    CHECK(!parseV6(requestV6({options(59, 0)}), &request));
+    CHECK(!parseV6(requestV6({options(6, 0)}), &request));
+}
+
+TEST(OnlyAtomicIpv6FragmentsAreAccepted)
+{
+    DNS_REQUEST request{};
+    CHECK(parseV6(requestV6({fragment(0)}), &request));
+    CHECK(request.ipHeaderLength == DNS_PACKET_IPV6_HEADER_SIZE + 8);
+
+    // Reserved bits do not make a fragment.
+    CHECK(parseV6(requestV6({fragment(0x0006)}), &request));
+
+    CHECK(!parseV6(requestV6({fragment(0x0001)}), &request));
+    CHECK(!parseV6(requestV6({fragment(0x0008)}), &request));
+    CHECK(!parseV6(requestV6({fragment(0x0009)}), &request));
+}
+
+TEST(TruncatedIpv6RequestsAreRejected)
+{
+    const auto packet = requestV6({options(DNS_PACKET_IPV6_HOP_BY_HOP, 1), fragment(0)});
+
+    for (size_t size = 0; size < packet.size() - Query.size() + DNS_PACKET_DNS_HEADER_SIZE; size++)
+    {
+        std::vector<uint8_t> truncated(packet.begin(), packet.begin() + size);
+        if (size >= DNS_PACKET_IPV6_HEADER_SIZE)
+        {
+            DnsPacketWriteUint16(truncated.data() + 4, static_cast<uint16_t>(size - DNS_PACKET_IPV6_HEADER_SIZE));
+        }
+
+        DNS_REQUEST request{};
+        CHECK(!parseV6(truncated, &request));
+    }
+}
+
+TEST(RequestsAreRecognizedFromTheirHeaders)
+{
+    const std::vector<std::vector<uint8_t>> packets = {
+        requestV4(),
+        requestV4(10),
+        requestV6(),
+        requestV6({options(DNS_PACKET_IPV6_HOP_BY_HOP, 0), fragment(0)}),
+        requestV6({options(DNS_PACKET_IPV6_ROUTING, 20)}),
+        requestV4(0, DNS_PACKET_PROTOCOL_UDP, 443),
+        requestV6({}, 443),
+    };
+
+    for (const auto& packet : packets)
+    {
+        const uint32_t length = static_cast<uint32_t>(packet.size());
+        const bool v6 = (packet[0] >> 4) == 6;
+
+        DNS_REQUEST full{};
+        const bool isRequest = v6 ? parseV6(packet, &full) : parseV4(packet, &full);
+
+        for (uint32_t available = 0; available <= length && available <= DNS_PACKET_CLASSIFY_SIZE; available++)
+        {
+            std::vector<uint8_t> headers(packet.begin(), packet.begin() + available);
+
+            DNS_REQUEST request{};
+            const bool parsed = v6 ?
+                DnsPacketParseRequestHeadersV6(headers.data(), available, length, &request) :
+                DnsPacketParseRequestHeadersV4(headers.data(), available, length, &request);
+
+            // Headers that do not reach past the UDP header cannot show a request.
+            if (parsed)
+            {
+                CHECK(isRequest);
+                CHECK(request.ipHeaderLength == full.ipHeaderLength);
+                CHECK(request.payloadLength == full.payloadLength);
+                CHECK(available >= request.ipHeaderLength + DNS_PACKET_UDP_HEADER_SIZE);
+            }
+            else if (isRequest)
+            {
+                CHECK(available < full.ipHeaderLength + DNS_PACKET_UDP_HEADER_SIZE);
+            }
+        }
+    }
+}
+
+TEST(Ipv4ServerFailReplyIsValid)
+{
+    const auto packet = requestV4(2);
+    DNS_REQUEST request{};
+    CHECK(parseV4(packet, &request));
+
+    std::vector<uint8_t> reply(2048);
+    const uint32_t size = DnsPacketBuildServerFailV4(packet.data(), &request, reply.data(), static_cast<uint32_t>(reply.size()));
+    CHECK(size == DNS_PACKET_IPV4_HEADER_SIZE + DNS_PACKET_UDP_HEADER_SIZE + Query.size());
+    reply.resize(size);
+
+    CHECK(reply[0] == 0x45);
+    CHECK(DnsPacketReadUint16(reply.data() + 2) == size);
+    CHECK(reply[9] == DNS_PACKET_PROTOCOL_UDP);
+    CHECK(std::memcmp(reply.data() + 12, DestinationV4, 4) == 0);
+    CHECK(std::memcmp(reply.data() + 16, SourceV4, 4) == 0);
+    CHECK(ChecksumCompute(reply.data(), DNS_PACKET_IPV4_HEADER_SIZE) == 0);
+
+    const uint8_t* udp = reply.data() + DNS_PACKET_IPV4_HEADER_SIZE;
+    CHECK(DnsPacketReadUint16(udp) == DNS_PACKET_PORT);
+    CHECK(DnsPacketReadUint16(udp + 2) == 51000);
+    CHECK(DnsPacketReadUint16(udp + 8) == 0x1234);
+    CHECK(DnsPacketReadUint16(udp + 10) == DNS_PACKET_SERVFAIL_FLAGS);
+    CHECK(std::memcmp(udp + 12, Query.data() + 4, Query.size() - 4) == 0);
+    CHECK(udpSum(reply.data() + 12, reply.data() + 16, 4, udp) == 0xFFFF);
+}
+
+TEST(Ipv6ServerFailReplyIsValid)
+{
+    auto packet = requestV6({options(DNS_PACKET_IPV6_HOP_BY_HOP, 0), fragment(0)});
+    DNS_REQUEST request{};
+    CHECK(parseV6(packet, &request));
+
+    // The reply is built in place, as the driver does in its pool entries.
+    const uint32_t size = DnsPacketBuildServerFailV6(packet.data(), &request, packet.data(), static_cast<uint32_t>(packet.size()));
+    CHECK(size == DNS_PACKET_IPV6_HEADER_SIZE + DNS_PACKET_UDP_HEADER_SIZE + Query.size());
+    packet.resize(size);
+
+    CHECK(packet[0] == 0x60);
+    CHECK(DnsPacketReadUint16(packet.data() + 4) == DNS_PACKET_UDP_HEADER_SIZE + Query.size());
+    CHECK(packet[6] == DNS_PACKET_PROTOCOL_UDP);
+    CHECK(std::memcmp(packet.data() + 8, DestinationV6, 16) == 0);
+    CHECK(std::memcmp(packet.data() + 24, SourceV6, 16) == 0);
+
+    const uint8_t* udp = packet.data() + DNS_PACKET_IPV6_HEADER_SIZE;
+    CHECK(DnsPacketReadUint16(udp) == DNS_PACKET_PORT);
+    CHECK(DnsPacketReadUint16(udp + 2) == 51000);
+    CHECK(DnsPacketReadUint16(udp + 4) == DNS_PACKET_UDP_HEADER_SIZE + Query.size());
+    CHECK(DnsPacketReadUint16(udp + 6) != 0);
+    CHECK(DnsPacketReadUint16(udp + 8) == 0x1234);
+    CHECK(DnsPacketReadUint16(udp + 10) == DNS_PACKET_SERVFAIL_FLAGS);
+    CHECK(udpSum(packet.data() + 8, packet.data() + 24, 16, udp) == 0xFFFF);
+
+    // The reply parses as a datagram from the DNS port, which is not a request.
+    CHECK(!parseV6(packet, &request));
+}
+
+TEST(ServerFailReplyNeedsRoom)
+{
+    const auto v4 = requestV4();
+    const auto v6 = requestV6();
+    DNS_REQUEST requestV4Layout{};
+    DNS_REQUEST requestV6Layout{};
+    CHECK(parseV4(v4, &requestV4Layout));
+    CHECK(parseV6(v6, &requestV6Layout));
+
+    std::vector<uint8_t> reply(v6.size());
+    CHECK(DnsPacketBuildServerFailV4(v4.data(), &requestV4Layout, reply.data(), static_cast<uint32_t>(v4.size() - 1)) == 0);
+    CHECK(DnsPacketBuildServerFailV6(v6.data(), &requestV6Layout, reply.data(), static_cast<uint32_t>(v6.size() - 1)) == 0);
+    CHECK(DnsPacketBuildServerFailV6(v6.data(), &requestV6Layout, reply.data(), static_cast<uint32_t>(v6.size())) == v6.size());
+}
@@ -0,0 +1,281 @@
+#include "Check.h"
+#include "enum_pager.h"
+
+#include <map>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace ipfilter;
+
+namespace
+{
+    const unsigned int EnumFailed = 0x80320008;
+    const uint32_t PageSize = 512;
+
+    struct FakeObject
+    {
+        int key;
+        int provider;
+    };
+
+    // Objects of an engine session by layer, with the bookkeeping of its enumerations.
+    struct FakeStore
+    {
+        std::map<int, std::vector<FakeObject>> layers;
+        int openEnums{};
+        int opens{};
+        int closes{};
+        int pagesFetched{};
+        int pagesFreed{};
+        int deletesWhileOpen{};
+        unsigned int openResult{};
+        int failOnPage{-1};
+
+        void add(int layer, int count, int provider)
+        {
+            auto& objects = this->layers[layer];
+            for (int i = 0; i < count; i++)
+            {
+                objects.push_back({layer * 10000 + static_cast<int>(objects.size()), provider});
+            }
+        }
+
+        void remove(int key)
+        {
+            if (this->openEnums > 0)
+            {
+                this->deletesWhileOpen++;
+            }
+
+            for (auto& layer : this->layers)
+            {
+                auto& objects = layer.second;
+                objects.erase(std::remove_if(objects.begin(), objects.end(), [key](const FakeObject& object)
+                {
+                    return object.key == key;
+                }), objects.end());
+            }
+        }
+
+        size_t size() const
+        {
+            size_t size = 0;
+            for (const auto& layer : this->layers)
+            {
+                size += layer.second.size();
+            }
+
+            return size;
+        }
+    };
+
+    // Enumerates the objects of one layer as they were when it was opened, like the engine.
+    class FakeEnum : public PagedEnum<FakeObject>
+    {
+    public:
+        FakeEnum(FakeStore& store, int layer): store(store), layer(layer)
+        {
+        }
+
+        unsigned int open() override
+        {
+            this->store.opens++;
+            if (this->store.openResult != 0)
+            {
+                return this->store.openResult;
+            }
+
+            this->store.openEnums++;
+            this->objects = this->store.layers[this->layer];
+            this->position = 0;
+
+            return 0;
+        }
+
+        unsigned int nextPage(uint32_t pageSize, FakeObject**& page, uint32_t& objectCount) override
+        {
+            auto pageIndex = this->store.pagesFetched++;
+            page = new FakeObject*[pageSize];
+            objectCount = 0;
+
+            if (pageIndex == this->store.failOnPage)
+            {
+                return EnumFailed;
+            }
+
+            while (objectCount < pageSize && this->position < this->objects.size())
+            {
+                page[objectCount++] = &this->objects[this->position++];
+            }
+
+            return 0;
+        }
+
+        void freePage(FakeObject**& page) override
+        {
+            if (page != nullptr)
+            {
+                this->store.pagesFreed++;
+                delete[] page;
+                page = nullptr;
+            }
+        }
+
+        void close() override
+        {
+            this->store.closes++;
+            this->store.openEnums--;
+        }
+
+    private:
+        FakeStore& store;
+        int layer;
+        std::vector<FakeObject> objects;
+        size_t position{};
+    };
+
+    unsigned int collectKeys(FakeStore& store, int layer, int provider, std::vector<int>& keys)
+    {
+        FakeEnum enumeration(store, layer);
+
+        return forEachPagedObject<FakeObject>(enumeration, PageSize, [&](const FakeObject& object)
+        {
+            if (object.provider == provider)
+            {
+                keys.push_back(object.key);
+            }
+        });
+    }
+}
+
+TEST(EmptyLayerFetchesOneEmptyPage)
+{
+    FakeStore store{};
+    std::vector<int> keys{};
+
+    CHECK(collectKeys(store, 1, 1, keys) == 0);
+
+    CHECK(keys.empty());
+    CHECK(store.pagesFetched == 1);
+    CHECK(store.pagesFreed == 1);
+    CHECK(store.opens == 1);
+    CHECK(store.closes == 1);
+    CHECK(store.openEnums == 0);
+}
+
+TEST(PagesAreFetchedUntilAnEmptyOne)
+{
+    for (int count : {1, 511, 512, 513, 1024, 1500})
+    {
+        FakeStore store{};
+        store.add(1, count, 1);
+        std::vector<int> keys{};
+
+        CHECK(collectKeys(store, 1, 1, keys) == 0);
+
+        CHECK(keys.size() == static_cast<size_t>(count));
+        CHECK(std::is_sorted(keys.begin(), keys.end()));
+        CHECK(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+
+        // Full pages and the partial one, then the empty page that ends the enumeration.
+        CHECK(store.pagesFetched == (count + static_cast<int>(PageSize) - 1) / static_cast<int>(PageSize) + 1);
+        CHECK(store.pagesFreed == store.pagesFetched);
+        CHECK(store.openEnums == 0);
+    }
+}
+
+TEST(FailedOpenIsReportedWithoutClosing)
+{
+    FakeStore store{};
+    store.add(1, 10, 1);
+    store.openResult = EnumFailed;
+    std::vector<int> keys{};
+
+    CHECK(collectKeys(store, 1, 1, keys) == EnumFailed);
+    CHECK(keys.empty());
+    CHECK(store.pagesFetched == 0);
+    CHECK(store.closes == 0);
+}
+
+TEST(FailedPageIsFreedAndTheEnumerationClosed)
+{
+    FakeStore store{};
+    store.add(1, 1200, 1);
+    store.failOnPage = 1;
+    std::vector<int> keys{};
+
+    CHECK(collectKeys(store, 1, 1, keys) == EnumFailed);
+
+    CHECK(keys.size() == PageSize);
+    CHECK(store.pagesFetched == 2);
+    CHECK(store.pagesFreed == 2);
+    CHECK(store.closes == 1);
+    CHECK(store.openEnums == 0);
+}
+
+TEST(ThrowingCallbackFreesThePageAndClosesTheEnumeration)
+{
+    FakeStore store{};
+    store.add(1, 700, 1);
+    FakeEnum enumeration(store, 1);
+    int visited = 0;
+
+    CHECK_THROWS(forEachPagedObject<FakeObject>(enumeration, PageSize, [&](const FakeObject&)
+    {
+        if (++visited == 600)
+        {
+            throw std::runtime_error("callback failed");
+        }
+    }), std::runtime_error);
+
+    CHECK(store.pagesFetched == 2);
+    CHECK(store.pagesFreed == 2);
+    CHECK(store.closes == 1);
+    CHECK(store.openEnums == 0);
+}
+
+TEST(ObjectsAreDeletedAfterTheirKeysAreCollected)
+{
+    // Filters of two providers across layers, one of them empty.
+    FakeStore store{};
+    store.add(1, 512, 1);
+    store.add(1, 40, 2);
+    store.add(2, 0, 1);
+    store.add(3, 1030, 1);
+    store.add(3, 3, 2);
+
+    std::vector<int> keys{};
+    for (int layer : {1, 2, 3})
+    {
+        CHECK(collectKeys(store, layer, 1, keys) == 0);
+    }
+
+    CHECK(keys.size() == 512 + 1030);
+
+    for (auto key : keys)
+    {
+        store.remove(key);
+    }
+
+    CHECK(store.deletesWhileOpen == 0);
+    CHECK(store.size() == 43);
+    for (const auto& layer : store.layers)
+    {
+        for (const auto& object : layer.second)
+        {
+            CHECK(object.provider == 2);
+        }
+    }
+
+    // Nothing of the provider is left to collect.
+    keys.clear();
+    for (int layer : {1, 2, 3})
+    {
+        CHECK(collectKeys(store, layer, 1, keys) == 0);
+    }
+
+    CHECK(keys.empty());
+    CHECK(store.pagesFreed == store.pagesFetched);
+    CHECK(store.opens == store.closes);
+}
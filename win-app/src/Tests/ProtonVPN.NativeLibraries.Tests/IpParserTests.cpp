@@ -0,0 +1,216 @@
+#include "Check.h"
+#include "ip.h"
+#include "ip_parser.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ipfilter::ip;
+
+namespace
+{
+    bool parseV4(const std::string& text, AddressV4::BytesType& bytes)
+    {
+        AddressV4 address{};
+        auto last = text.data() + text.size();
+        auto result = parseAddressV4(text.data(), last, address);
+        if (result.error != ParseError::None || result.ptr != last)
+        {
+            return false;
+        }
+
+        bytes = address.toBytes();
+
+        return true;
+    }
+
+    bool parseV6(const std::string& text, AddressV6::BytesType& bytes)
+    {
+        AddressV6 address{};
+        auto last = text.data() + text.size();
+        auto result = parseAddressV6(text.data(), last, address);
+        if (result.error != ParseError::None || result.ptr != last)
+        {
+            return false;
+        }
+
+        bytes = address.toBytes();
+
+        return true;
+    }
+
+    bool isValidV4(const std::string& text)
+    {
+        AddressV4::BytesType bytes{};
+
+        return parseV4(text, bytes);
+    }
+
+    bool isValidV6(const std::string& text)
+    {
+        AddressV6::BytesType bytes{};
+
+        return parseV6(text, bytes);
+    }
+}
+
+TEST(Ipv4AddressesAreParsed)
+{
+    AddressV4::BytesType bytes{};
+
+    CHECK(parseV4("10.0.0.1", bytes));
+    CHECK((bytes == AddressV4::BytesType{10, 0, 0, 1}));
+    CHECK(parseV4("255.255.255.255", bytes));
+    CHECK((bytes == AddressV4::BytesType{255, 255, 255, 255}));
+    CHECK(parseV4("0.0.0.0", bytes));
+    CHECK((bytes == AddressV4::BytesType{0, 0, 0, 0}));
+}
+
+TEST(MalformedIpv4AddressesAreRejected)
+{
+    for (auto text : {"", "1.2.3", "1.2.3.4.", "1..2.3", " 1.2.3.4", "256.0.0.1", "01.0.0.1", "1.2.3.04", "a.b.c.d", "1.2.3.-4"})
+    {
+        CHECK(!isValidV4(text));
+    }
+}
+
+TEST(ParseStopsAfterTheAddress)
+{
+    const std::string text = "1.2.3.4/24";
+    AddressV4 address{};
+
+    auto result = parseAddressV4(text.data(), text.data() + text.size(), address);
+
+    CHECK(result.error == ParseError::None);
+    CHECK(result.ptr == text.data() + 7);
+}
+
+TEST(FailedParseReturnsTheStart)
+{
+    const std::string text = "1.2.3";
+    AddressV4 address{};
+
+    auto result = parseAddressV4(text.data(), text.data() + text.size(), address);
+
+    CHECK(result.error == ParseError::InvalidFormat);
+    CHECK(result.ptr == text.data());
+}
+
+TEST(Ipv6AddressesAreParsed)
+{
+    AddressV6::BytesType bytes{};
+
+    CHECK(parseV6("::", bytes));
+    CHECK(bytes == AddressV6::BytesType{});
+
+    CHECK(parseV6("::1", bytes));
+    CHECK((bytes == AddressV6::BytesType{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}));
+
+    CHECK(parseV6("2001:DB8::8:800:200c:417a", bytes));
+    CHECK((bytes == AddressV6::BytesType{0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 8, 8, 0, 0x20, 0x0c, 0x41, 0x7a}));
+
+    CHECK(parseV6("::ffff:1.2.3.4", bytes));
+    CHECK((bytes == AddressV6::BytesType{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 1, 2, 3, 4}));
+
+    CHECK(parseV6("1:2:3:4:5:6:7:8", bytes));
+    CHECK((bytes == AddressV6::BytesType{0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 7, 0, 8}));
+}
+
+TEST(MalformedIpv6AddressesAreRejected)
+{
+    for (auto text : {"", ":", ":::", "1::2::3", "1:2:3:4:5:6:7:8:9", "1:2:3:4:5:6:7", "12345::", "::1.2.3", "g::", "::ffff:1.2.3.4:1"})
+    {
+        CHECK(!isValidV6(text));
+    }
+}
+
+TEST(NetworkPrefixesAreParsed)
+{
+    const std::string v4 = "10.0.0.0/8";
+    AddressV4 address{};
+    uint8_t prefix{};
+
+    auto result = parseNetworkV4(v4.data(), v4.data() + v4.size(), address, prefix);
+    CHECK(result.error == ParseError::None);
+    CHECK(prefix == 8);
+
+    const std::string host = "10.0.0.1";
+    parseNetworkV4(host.data(), host.data() + host.size(), address, prefix);
+    CHECK(prefix == 32);
+
+    const std::string v6 = "fe80::/10";
+    AddressV6 network{};
+    result = parseNetworkV6(v6.data(), v6.data() + v6.size(), network);
+    CHECK(result.error == ParseError::None);
+    CHECK(network.prefix() == 10);
+}
+
+TEST(PrefixesOutOfRangeAreRejected)
+{
+    const std::string v4 = "10.0.0.0/33";
+    AddressV4 address{};
+    uint8_t prefix{};
+    CHECK(parseNetworkV4(v4.data(), v4.data() + v4.size(), address, prefix).error == ParseError::PrefixOutOfRange);
+
+    const std::string v6 = "::/129";
+    AddressV6 network{};
+    CHECK(parseNetworkV6(v6.data(), v6.data() + v6.size(), network).error == ParseError::PrefixOutOfRange);
+}
+
+// The batch parser has a vectorized path, it must agree with the scalar parser on any input.
+// The seed is fixed, so failures reproduce.
+TEST(BatchParseAgreesWithSingleParse)
+{
+    const char alphabet[] = "0123456789.x";
+    std::mt19937 random(0x1b4);
+
+    for (int i = 0; i < 20000; i++)
+    {
+        std::string text{};
+        if (i % 3 == 0)
+        {
+            text = std::to_string(random() % 300) + "." + std::to_string(random() % 256) + "." +
+                std::to_string(random() % 256) + "." + std::to_string(random() % 260);
+        }
+        else
+        {
+            auto length = random() % 18;
+            for (unsigned int j = 0; j < length; j++)
+            {
+                text += alphabet[random() % (sizeof(alphabet) - 1)];
+            }
+        }
+
+        AddressV4::BytesType expected{};
+        auto valid = parseV4(text, expected);
+
+        auto string = text.c_str();
+        AddressV4 address{};
+        ParseError error{};
+        auto parsed = parseAddressesV4(&string, 1, &address, &error);
+
+        CHECK(parsed == (valid ? 1u : 0u));
+        CHECK((error == ParseError::None) == valid);
+        if (valid)
+        {
+            CHECK(address.toBytes() == expected);
+        }
+    }
+}
+
+TEST(BatchParseReportsEveryString)
+{
+    std::vector<const char*> strings{"1.2.3.4", "1.2.3", "192.168.100.200", "300.1.1.1"};
+    std::vector<AddressV4> addresses(strings.size());
+    std::vector<ParseError> errors(strings.size());
+
+    auto parsed = parseAddressesV4(strings.data(), strings.size(), addresses.data(), errors.data());
+
+    CHECK(parsed == 2);
+    CHECK(errors[0] == ParseError::None);
+    CHECK(errors[1] != ParseError::None);
+    CHECK(errors[2] == ParseError::None);
+    CHECK(errors[3] != ParseError::None);
+    CHECK((addresses[2].toBytes() == AddressV4::BytesType{192, 168, 100, 200}));
+}
@@ -0,0 +1,88 @@
+#include "Check.h"
+#include "Ipv6BindingPlan.h"
+
+using namespace Proton::NetworkUtil;
+
+namespace
+{
+    std::vector<BindingState> makeAdapters()
+    {
+        return {
+            {L"pci\\ethernet", L"{A}", true},
+            {L"tap0901", L"{B}", true},
+            {L"pci\\ethernet", L"{C}", false},
+            {L"usb", L"{D}", true},
+        };
+    }
+}
+
+TEST(DisableJournalsTheAdaptersItChanges)
+{
+    auto plan = PlanDisableIPv6(makeAdapters(), {L"tap0901"}, {L"{Z}"});
+
+    CHECK((plan.disable == std::vector<std::wstring>{L"{A}", L"{D}"}));
+    CHECK(plan.enable.empty());
+    // Adapters that had IPv6 disabled already are not journaled, earlier entries are kept.
+    CHECK((plan.journal == BindingJournal{L"{A}", L"{D}", L"{Z}"}));
+}
+
+TEST(RepeatedDisableKeepsTheJournal)
+{
+    auto adapters = makeAdapters();
+    auto plan = PlanDisableIPv6(adapters, {L"tap0901"}, {});
+
+    adapters[0].ipv6Enabled = false;
+    adapters[3].ipv6Enabled = false;
+    auto repeated = PlanDisableIPv6(adapters, {L"tap0901"}, plan.journal);
+
+    CHECK(repeated.disable.empty());
+    CHECK(repeated.journal == plan.journal);
+}
+
+TEST(RestoreEnablesJournaledAdaptersOnly)
+{
+    auto adapters = makeAdapters();
+    adapters[0].ipv6Enabled = false;
+    adapters[3].ipv6Enabled = false;
+
+    auto plan = PlanRestoreIPv6(adapters, {L"usb"}, {L"{A}", L"{D}", L"{Z}"});
+
+    CHECK(plan.enable == std::vector<std::wstring>{L"{A}"});
+    CHECK(plan.disable.empty());
+    // Excluded and absent adapters stay journaled for a later restore.
+    CHECK((plan.journal == BindingJournal{L"{D}", L"{Z}"}));
+}
+
+TEST(RestoreForgetsAdaptersEnabledMeanwhile)
+{
+    auto plan = PlanRestoreIPv6(makeAdapters(), {}, {L"{A}"});
+
+    CHECK(plan.journal.empty());
+}
+
+TEST(JournalRoundTrips)
+{
+    BindingJournal journal{L"{A}", L"{D}", L""};
+    auto data = EncodeBindingJournal(journal);
+
+    BindingJournal decoded{};
+    CHECK(DecodeBindingJournal(data.data(), data.size(), decoded));
+    CHECK(decoded == journal);
+
+    auto empty = EncodeBindingJournal({});
+    decoded = {L"stale"};
+    CHECK(DecodeBindingJournal(empty.data(), empty.size(), decoded));
+    CHECK(decoded.empty());
+}
+
+TEST(TruncatedJournalIsRejectedAndLeavesTheOutputAlone)
+{
+    auto data = EncodeBindingJournal({L"{A}", L"{D}"});
+
+    for (size_t size = 0; size < data.size(); size++)
+    {
+        BindingJournal journal{L"keep"};
+        CHECK(!DecodeBindingJournal(data.data(), size, journal));
+        CHECK(journal == BindingJournal{L"keep"});
+    }
+}
@@ -0,0 +1,320 @@
+#include "Check.h"
+#include "MetricManager.h"
+
+#include <thread>
+
+using namespace Proton::NetworkUtil;
+
+namespace
+{
+    const MetricKey Ipv4Key{7, MetricFamily::Ipv4};
+    const MetricKey Ipv6Key{7, MetricFamily::Ipv6};
+
+    // IP interfaces and registry of the operating system, shared with the backend and store
+    // owned by the manager.
+    struct FakeSystem
+    {
+        std::map<MetricKey, MetricSettings> interfaces;
+        std::vector<uint8_t> stored;
+        bool hasStored{};
+        bool failGet{};
+        bool failWrite{};
+        // Number of sets that succeed before one fails, negative for none.
+        int setsBeforeFailure{-1};
+        std::mutex mutex;
+    };
+
+    class FakeBackend : public MetricBackend
+    {
+    public:
+        explicit FakeBackend(FakeSystem& system): system(system)
+        {
+        }
+
+        MetricLookup get(const MetricKey& key, MetricSettings& settings) override
+        {
+            std::lock_guard<std::mutex> guard(this->system.mutex);
+            if (this->system.failGet)
+            {
+                return MetricLookup::Failed;
+            }
+
+            auto it = this->system.interfaces.find(key);
+            if (it == this->system.interfaces.end())
+            {
+                return MetricLookup::Absent;
+            }
+
+            settings = it->second;
+
+            return MetricLookup::Found;
+        }
+
+        bool set(const MetricKey& key, const MetricSettings& settings) override
+        {
+            std::lock_guard<std::mutex> guard(this->system.mutex);
+            if (this->system.setsBeforeFailure == 0)
+            {
+                this->system.setsBeforeFailure = -1;
+                return false;
+            }
+
+            if (this->system.setsBeforeFailure > 0)
+            {
+                this->system.setsBeforeFailure--;
+            }
+
+            auto it = this->system.interfaces.find(key);
+            if (it == this->system.interfaces.end())
+            {
+                return false;
+            }
+
+            it->second = settings;
+
+            return true;
+        }
+
+    private:
+        FakeSystem& system;
+    };
+
+    class FakeStore : public MetricStore
+    {
+    public:
+        explicit FakeStore(FakeSystem& system): system(system)
+        {
+        }
+
+        bool read(std::vector<uint8_t>& data) override
+        {
+            if (!this->system.hasStored)
+            {
+                return false;
+            }
+
+            data = this->system.stored;
+
+            return true;
+        }
+
+        bool write(const std::vector<uint8_t>& data) override
+        {
+            if (this->system.failWrite)
+            {
+                return false;
+            }
+
+            this->system.stored = data;
+            this->system.hasStored = true;
+
+            return true;
+        }
+
+        void remove() override
+        {
+            this->system.stored.clear();
+            this->system.hasStored = false;
+        }
+
+    private:
+        FakeSystem& system;
+    };
+
+    std::unique_ptr<MetricManager> makeManager(FakeSystem& system)
+    {
+        return std::unique_ptr<MetricManager>(new MetricManager(
+            std::unique_ptr<MetricBackend>(new FakeBackend(system)),
+            std::unique_ptr<MetricStore>(new FakeStore(system))));
+    }
+
+    void makeInterfaces(FakeSystem& system)
+    {
+        system.interfaces[Ipv4Key] = {25, true};
+        system.interfaces[Ipv6Key] = {30, false};
+    }
+
+    bool isOriginal(FakeSystem& system)
+    {
+        return system.interfaces[Ipv4Key].automatic &&
+            system.interfaces[Ipv6Key].metric == 30 && !system.interfaces[Ipv6Key].automatic;
+    }
+}
+
+TEST(ApplySetsAFixedMetricOnBothFamilies)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+
+    CHECK(manager->apply(7, 4));
+
+    CHECK(system.interfaces[Ipv4Key].metric == 4 && !system.interfaces[Ipv4Key].automatic);
+    CHECK(system.interfaces[Ipv6Key].metric == 4);
+    CHECK(manager->journal().size() == 2);
+    CHECK(system.hasStored);
+}
+
+TEST(OriginalSettingsSurviveRepeatedApplyAndRestart)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+
+    auto manager = makeManager(system);
+    CHECK(manager->apply(7, 4));
+    CHECK(manager->apply(7, 4));
+    CHECK(manager->apply(7, 3));
+    manager.reset();
+
+    manager = makeManager(system);
+    CHECK(manager->journal().size() == 2);
+    CHECK(manager->restore(7));
+
+    CHECK(isOriginal(system));
+    CHECK(manager->journal().empty());
+    CHECK(!system.hasStored);
+}
+
+TEST(FailedApplyRollsBack)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+
+    system.setsBeforeFailure = 1;
+    CHECK(!manager->apply(7, 4));
+
+    CHECK(isOriginal(system));
+    CHECK(manager->journal().empty());
+    CHECK(!system.hasStored);
+}
+
+TEST(ApplyFailsWhenTheJournalCannotBeWritten)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+
+    system.failWrite = true;
+    CHECK(!manager->apply(7, 4));
+
+    CHECK(isOriginal(system));
+}
+
+TEST(ApplyFailsWhenTheInterfaceCannotBeRead)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+
+    system.failGet = true;
+    CHECK(!manager->apply(7, 4));
+
+    CHECK(isOriginal(system));
+    CHECK(manager->journal().empty());
+}
+
+TEST(ApplyFailsForUnknownInterface)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+
+    CHECK(!manager->apply(99, 4));
+    CHECK(manager->journal().empty());
+}
+
+TEST(RestoreKeepsTheJournalOnTransientFailure)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+    CHECK(manager->apply(7, 4));
+
+    system.failGet = true;
+    CHECK(!manager->restore(7));
+    CHECK(manager->journal().size() == 2);
+
+    system.setsBeforeFailure = 0;
+    system.failGet = false;
+    CHECK(!manager->restore(7));
+    CHECK(manager->journal().size() == 1);
+
+    CHECK(manager->restore(7));
+    CHECK(isOriginal(system));
+    CHECK(manager->journal().empty());
+}
+
+TEST(RestoreForgetsRemovedInterfaces)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+    CHECK(manager->apply(7, 4));
+
+    system.interfaces.erase(Ipv6Key);
+    CHECK(manager->restore(7));
+
+    CHECK(system.interfaces[Ipv4Key].automatic);
+    CHECK(manager->journal().empty());
+}
+
+TEST(ConcurrentApplyAndRestoreEndRestored)
+{
+    FakeSystem system{};
+    makeInterfaces(system);
+    auto manager = makeManager(system);
+
+    std::vector<std::thread> threads{};
+    for (int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&manager]()
+        {
+            for (int j = 0; j < 200; j++)
+            {
+                manager->apply(7, 4);
+                manager->restore(7);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    manager->restore(7);
+    CHECK(isOriginal(system));
+}
+
+TEST(JournalRoundTrips)
+{
+    MetricJournal journal{};
+    journal[MetricKey{1, MetricFamily::Ipv6}] = {5, true};
+    journal[MetricKey{2, MetricFamily::Ipv4}] = {40, false};
+    auto data = EncodeMetricJournal(journal);
+
+    MetricJournal decoded{};
+    CHECK(DecodeMetricJournal(data.data(), data.size(), decoded));
+    CHECK(decoded.size() == 2);
+    CHECK((decoded[MetricKey{1, MetricFamily::Ipv6}].automatic));
+    CHECK((decoded[MetricKey{2, MetricFamily::Ipv4}].metric == 40));
+}
+
+TEST(MalformedJournalIsRejected)
+{
+    MetricJournal journal{};
+    journal[MetricKey{1, MetricFamily::Ipv4}] = {5, false};
+    auto data = EncodeMetricJournal(journal);
+
+    for (size_t size = 0; size < data.size(); size++)
+    {
+        MetricJournal decoded{};
+        CHECK(!DecodeMetricJournal(data.data(), size, decoded));
+    }
+
+    // Family of the only entry.
+    data[20] = 2;
+    MetricJournal decoded{};
+    CHECK(!DecodeMetricJournal(data.data(), data.size(), decoded));
+}
@@ -0,0 +1,221 @@
+#include "Check.h"
+#include "NetworkInventory.h"
+
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+
+using namespace Proton::NetworkUtil;
+
+namespace
+{
+    // Adapters of the operating system, shared with the backend owned by the inventory.
+    struct FakeSystem
+    {
+        std::vector<Adapter> adapters;
+        int enumerations{};
+        int refreshes{};
+        bool failEnumeration{};
+    };
+
+    class FakeBackend : public InventoryBackend
+    {
+    public:
+        explicit FakeBackend(FakeSystem& system): system(system)
+        {
+        }
+
+        std::vector<Adapter> enumerate() override
+        {
+            this->system.enumerations++;
+            if (this->system.failEnumeration)
+            {
+                throw std::runtime_error("enumeration failed");
+            }
+
+            return this->system.adapters;
+        }
+
+        bool refresh(Adapter& adapter) override
+        {
+            this->system.refreshes++;
+            for (const auto& current : this->system.adapters)
+            {
+                if (current.luid == adapter.luid)
+                {
+                    adapter.index = current.index;
+                    adapter.ipv4Metric = current.ipv4Metric;
+                    adapter.ipv6Metric = current.ipv6Metric;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+        FakeSystem& system;
+    };
+
+    Adapter makeAdapter(const wchar_t* id, const wchar_t* bindName, uint64_t luid, uint32_t index, uint32_t metric)
+    {
+        Adapter adapter{};
+        adapter.id = id;
+        adapter.bindName = bindName;
+        adapter.luid = luid;
+        adapter.index = index;
+        adapter.ipv6Enabled = true;
+        adapter.ipv4Metric = metric;
+        adapter.ipv6Metric = metric;
+
+        return adapter;
+    }
+
+    FakeSystem makeSystem()
+    {
+        FakeSystem system{};
+        system.adapters = {
+            makeAdapter(L"pci\\ethernet", L"{A}", 1, 10, 25),
+            makeAdapter(L"tap0901", L"{B}", 2, 11, 5),
+            makeAdapter(L"pci\\ethernet", L"{C}", 3, 12, 35),
+            // Disabled, it has no IP interface.
+            makeAdapter(L"wintun", L"{D}", 0, 0, 0),
+        };
+
+        return system;
+    }
+
+    std::unique_ptr<InventoryBackend> makeBackend(FakeSystem& system)
+    {
+        return std::unique_ptr<InventoryBackend>(new FakeBackend(system));
+    }
+}
+
+TEST(SnapshotIsIndexed)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+
+    auto snapshot = inventory.snapshot();
+
+    CHECK(snapshot->adapters().size() == 4);
+    CHECK(snapshot->findById(L"pci\\ethernet").size() == 2);
+    CHECK(snapshot->findByLuid(2)->bindName == L"{B}");
+    CHECK(snapshot->findByIndex(12)->luid == 3);
+    CHECK(snapshot->findByBindName(L"{D}") != nullptr);
+    CHECK(snapshot->findByLuid(0) == nullptr);
+    CHECK(snapshot->findByIndex(0) == nullptr);
+    CHECK(snapshot->findById(L"missing").empty());
+}
+
+TEST(SnapshotIsReadOnce)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+
+    auto first = inventory.snapshot();
+    auto second = inventory.snapshot();
+
+    CHECK(first == second);
+    CHECK(system.enumerations == 1);
+    CHECK(inventory.enumerations() == 1);
+}
+
+TEST(ChangedInterfaceIsRefreshedAlone)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+    auto before = inventory.snapshot();
+
+    system.adapters[1].ipv4Metric = 1;
+    inventory.interfaceChanged(2);
+    auto after = inventory.snapshot();
+
+    CHECK(system.enumerations == 1);
+    CHECK(system.refreshes == 1);
+    CHECK(after->findByLuid(2)->ipv4Metric == 1);
+    // Snapshots already handed out do not change.
+    CHECK(before->findByLuid(2)->ipv4Metric == 5);
+    CHECK(inventory.refreshes() == 1);
+}
+
+TEST(RemovedInterfaceLosesItsLuid)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+    inventory.snapshot();
+
+    system.adapters.erase(system.adapters.begin());
+    inventory.interfaceChanged(1);
+    auto snapshot = inventory.snapshot();
+
+    CHECK(snapshot->findByLuid(1) == nullptr);
+    CHECK(snapshot->findByIndex(10) == nullptr);
+    CHECK(snapshot->findByBindName(L"{A}") != nullptr);
+}
+
+TEST(UnknownInterfaceRereadsEverything)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+    inventory.snapshot();
+
+    system.adapters.push_back(makeAdapter(L"usb", L"{E}", 5, 14, 40));
+    inventory.interfaceChanged(5);
+    auto snapshot = inventory.snapshot();
+
+    CHECK(system.enumerations == 2);
+    CHECK(snapshot->findByLuid(5) != nullptr);
+}
+
+TEST(InvalidateRereadsEverything)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+    inventory.snapshot();
+
+    inventory.invalidate();
+    inventory.snapshot();
+
+    CHECK(system.enumerations == 2);
+}
+
+TEST(FailedEnumerationIsRetried)
+{
+    auto system = makeSystem();
+    system.failEnumeration = true;
+    NetworkInventory inventory(makeBackend(system));
+
+    CHECK_THROWS(inventory.snapshot(), std::runtime_error);
+
+    system.failEnumeration = false;
+    auto snapshot = inventory.snapshot();
+
+    CHECK(system.enumerations == 2);
+    CHECK(snapshot->adapters().size() == 4);
+}
+
+TEST(NotificationsRaceWithSnapshots)
+{
+    auto system = makeSystem();
+    NetworkInventory inventory(makeBackend(system));
+    inventory.snapshot();
+
+    std::atomic<bool> stop{false};
+    std::thread notifications([&]()
+    {
+        while (!stop)
+        {
+            inventory.interfaceChanged(2);
+            inventory.interfaceChanged(3);
+        }
+    });
+
+    for (int i = 0; i < 2000; i++)
+    {
+        CHECK(inventory.snapshot()->findByLuid(2) != nullptr);
+    }
+
+    stop = true;
+    notifications.join();
+}
@@ -0,0 +1,129 @@
+#include "Check.h"
+#include "payload_buffer.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace ipfilter;
+
+namespace
+{
+    // Stand-ins with the layouts of the FWP payload types ConditionList stores.
+    struct V4AddrAndMask
+    {
+        uint32_t addr;
+        uint32_t mask;
+    };
+
+    struct ByteArray16
+    {
+        uint8_t bytes[16];
+    };
+
+    struct V6AddrAndMask
+    {
+        uint8_t addr[16];
+        uint8_t prefixLength;
+    };
+
+    struct ByteBlob
+    {
+        uint32_t size;
+        uint8_t* data;
+    };
+
+    bool isAligned(const void* pointer)
+    {
+        return reinterpret_cast<uintptr_t>(pointer) % sizeof(uint64_t) == 0;
+    }
+
+    bool isWithin(const PayloadBuffer& buffer, const void* pointer, size_t size)
+    {
+        auto* bytes = static_cast<const uint8_t*>(pointer);
+        return bytes >= buffer.data() && bytes + size <= buffer.data() + buffer.size();
+    }
+}
+
+TEST(SizesAreRoundedToWords)
+{
+    CHECK(PayloadBuffer::alignedSize(0) == 0);
+    CHECK(PayloadBuffer::alignedSize(1) == 8);
+    CHECK(PayloadBuffer::alignedSize(8) == 8);
+    CHECK(PayloadBuffer::alignedSize(17) == 24);
+    CHECK(PayloadBuffer::alignedSize(sizeof(V6AddrAndMask)) == 24);
+}
+
+TEST(PayloadsOfAConditionListShareOneBuffer)
+{
+    const std::vector<uint8_t> appId(37, 0x5A);
+    const size_t size =
+        PayloadBuffer::alignedSize(sizeof(uint64_t)) +
+        PayloadBuffer::alignedSize(sizeof(V4AddrAndMask)) +
+        PayloadBuffer::alignedSize(sizeof(ByteArray16)) +
+        PayloadBuffer::alignedSize(sizeof(V6AddrAndMask)) +
+        PayloadBuffer::alignedSize(sizeof(ByteBlob)) + PayloadBuffer::alignedSize(appId.size());
+
+    PayloadBuffer buffer(size);
+    CHECK(buffer.size() == size);
+
+    V6AddrAndMask v6{};
+    v6.addr[0] = 0xfd;
+    v6.prefixLength = 64;
+
+    auto* interfaceId = buffer.add(uint64_t{0x0006000001000000ull});
+    auto* v4 = buffer.add(V4AddrAndMask{0x0A000000u, 0xFF000000u});
+    auto* array16 = buffer.add(ByteArray16{{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16}});
+    auto* v6Copy = buffer.add(v6);
+    auto* blob = buffer.add(ByteBlob{});
+    blob->size = static_cast<uint32_t>(appId.size());
+    blob->data = buffer.addBytes(appId.data(), appId.size());
+
+    CHECK(buffer.used() == size);
+
+    const void* pointers[] = {interfaceId, v4, array16, v6Copy, blob, blob->data};
+    const size_t sizes[] = {sizeof(uint64_t), sizeof(V4AddrAndMask), sizeof(ByteArray16), sizeof(V6AddrAndMask), sizeof(ByteBlob), appId.size()};
+    for (size_t i = 0; i < 6; i++)
+    {
+        CHECK(isAligned(pointers[i]));
+        CHECK(isWithin(buffer, pointers[i], sizes[i]));
+
+        // Payloads follow each other in order without overlapping.
+        if (i > 0)
+        {
+            CHECK(static_cast<const uint8_t*>(pointers[i]) >= static_cast<const uint8_t*>(pointers[i - 1]) + sizes[i - 1]);
+        }
+    }
+
+    CHECK(*interfaceId == 0x0006000001000000ull);
+    CHECK(v4->mask == 0xFF000000u);
+    CHECK(array16->bytes[15] == 16);
+    CHECK(v6Copy->addr[0] == 0xfd);
+    CHECK(v6Copy->prefixLength == 64);
+    CHECK(std::memcmp(blob->data, appId.data(), appId.size()) == 0);
+}
+
+TEST(AllocationsPastTheSizeThrow)
+{
+    PayloadBuffer buffer(16);
+
+    CHECK(buffer.allocate(3) != nullptr);
+    CHECK(buffer.used() == 8);
+    CHECK(buffer.allocate(8) != nullptr);
+    CHECK_THROWS(buffer.allocate(1), std::length_error);
+    CHECK(buffer.used() == 16);
+
+    PayloadBuffer small(12);
+    CHECK(small.size() == 16);
+    CHECK_THROWS(small.allocate(17), std::length_error);
+}
+
+TEST(EmptyBufferHoldsEmptyPayloads)
+{
+    PayloadBuffer buffer(0);
+
+    CHECK(buffer.size() == 0);
+    buffer.addBytes(nullptr, 0);
+    CHECK(buffer.used() == 0);
+    CHECK_THROWS(buffer.add(uint64_t{1}), std::length_error);
+}
@@ -0,0 +1,244 @@
+#include "Benchmark.h"
+#include "Check.h"
+#include "prefix_set.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ipfilter::ip;
+
+namespace
+{
+    typedef PrefixSetV4::Prefix PrefixV4;
+    typedef PrefixSetV6::Prefix PrefixV6;
+
+    uint32_t v4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        return (static_cast<uint32_t>(a) << 24) | (static_cast<uint32_t>(b) << 16) |
+            (static_cast<uint32_t>(c) << 8) | d;
+    }
+
+    bool equal(const std::vector<PrefixV4>& prefixes, const std::vector<PrefixV4>& expected)
+    {
+        if (prefixes.size() != expected.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < prefixes.size(); i++)
+        {
+            if (prefixes[i].address != expected[i].address || prefixes[i].length != expected[i].length)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool covers(const std::vector<PrefixV4>& prefixes, uint32_t address)
+    {
+        for (const auto& prefix : prefixes)
+        {
+            if ((address & ~PrefixSetV4::Traits::hostMask(prefix.length)) == prefix.address)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+TEST(EmptySetHasNoPrefixes)
+{
+    PrefixSetV4 set{};
+
+    CHECK(set.compute().empty());
+    CHECK(PrefixSetV6{}.compute().empty());
+}
+
+TEST(AdjacentPrefixesAreMerged)
+{
+    PrefixSetV4 set{};
+    set.add(v4(10, 0, 0, 0), 25);
+    set.add(v4(10, 0, 0, 128), 25);
+
+    CHECK(equal(set.compute(), {{v4(10, 0, 0, 0), 24}}));
+
+    // Adjacent blocks that are not siblings cannot become one prefix.
+    set.clear();
+    set.add(v4(10, 0, 1, 0), 24);
+    set.add(v4(10, 0, 2, 0), 24);
+
+    CHECK(equal(set.compute(), {{v4(10, 0, 1, 0), 24}, {v4(10, 0, 2, 0), 24}}));
+}
+
+TEST(OverlappingPrefixesAreMerged)
+{
+    PrefixSetV4 set{};
+    set.add(v4(192, 168, 1, 0), 24);
+    set.add(v4(192, 168, 0, 0), 16);
+    set.add(v4(192, 168, 200, 7), 32);
+    set.add(v4(192, 168, 0, 0), 16);
+
+    CHECK(equal(set.compute(), {{v4(192, 168, 0, 0), 16}}));
+}
+
+TEST(HostBitsAreIgnored)
+{
+    PrefixSetV4 set{};
+    set.add(v4(10, 1, 2, 3), 8);
+
+    CHECK(equal(set.compute(), {{v4(10, 0, 0, 0), 8}}));
+}
+
+TEST(RangesAreSplitIntoAlignedPrefixes)
+{
+    // 10.0.0.1 - 10.0.0.6
+    PrefixSetV4 set{};
+    for (uint8_t i = 1; i <= 6; i++)
+    {
+        set.add(v4(10, 0, 0, i), 32);
+    }
+
+    CHECK(equal(set.compute(), {
+        {v4(10, 0, 0, 1), 32},
+        {v4(10, 0, 0, 2), 31},
+        {v4(10, 0, 0, 4), 31},
+        {v4(10, 0, 0, 6), 32}}));
+}
+
+TEST(Ipv4EdgesAreKept)
+{
+    PrefixSetV4 set{};
+    set.add(v4(0, 0, 0, 0), 32);
+    set.add(v4(255, 255, 255, 255), 32);
+
+    CHECK(equal(set.compute(), {{v4(0, 0, 0, 0), 32}, {v4(255, 255, 255, 255), 32}}));
+
+    // The whole space, also when the last address is merged into it.
+    set.add(v4(1, 2, 3, 4), 0);
+    CHECK(equal(set.compute(), {{0, 0}}));
+
+    set.clear();
+    set.add(v4(0, 0, 0, 0), 1);
+    set.add(v4(128, 0, 0, 0), 1);
+    CHECK(equal(set.compute(), {{0, 0}}));
+
+    // Lengths past the address size are host addresses.
+    set.clear();
+    set.add(v4(10, 0, 0, 1), 40);
+    CHECK(equal(set.compute(), {{v4(10, 0, 0, 1), 32}}));
+}
+
+TEST(Ipv6EdgesAreKept)
+{
+    const Uint128 zero{0, 0};
+    const Uint128 max{~0ULL, ~0ULL};
+
+    PrefixSetV6 set{};
+    set.add(zero, 128);
+    set.add(max, 128);
+
+    auto prefixes = set.compute();
+    CHECK(prefixes.size() == 2);
+    CHECK(prefixes[0].address == zero);
+    CHECK(prefixes[0].length == 128);
+    CHECK(prefixes[1].address == max);
+    CHECK(prefixes[1].length == 128);
+
+    set.add({0x20010db800000000ULL, 1}, 0);
+    prefixes = set.compute();
+    CHECK(prefixes.size() == 1);
+    CHECK(prefixes[0].address == zero);
+    CHECK(prefixes[0].length == 0);
+}
+
+TEST(Ipv6PrefixesAreMergedAcrossTheWordBoundary)
+{
+    PrefixSetV6 set{};
+    set.add({0x20010db800000000ULL, 0}, 65);
+    set.add({0x20010db800000000ULL, 0x8000000000000000ULL}, 65);
+    set.add({0x20010db800000001ULL, 0}, 64);
+
+    auto prefixes = set.compute();
+    CHECK(prefixes.size() == 1);
+    CHECK((prefixes[0].address == Uint128{0x20010db800000000ULL, 0}));
+    CHECK(prefixes[0].length == 63);
+
+    // A carry out of the low word makes the next range adjacent.
+    set.clear();
+    set.add({0x20010db800000000ULL, ~0ULL}, 128);
+    set.add({0x20010db800000001ULL, 0}, 128);
+
+    prefixes = set.compute();
+    CHECK(prefixes.size() == 2);
+    CHECK((prefixes[0].address == Uint128{0x20010db800000000ULL, ~0ULL}));
+    CHECK((prefixes[1].address == Uint128{0x20010db800000001ULL, 0}));
+}
+
+TEST(RandomSetsKeepTheirAddressesWithMinimalPrefixes)
+{
+    std::mt19937 random(4);
+
+    for (int round = 0; round < 50; round++)
+    {
+        // Prefixes within 10.0.0.0/20, so every address can be checked.
+        PrefixSetV4 set{};
+        std::vector<PrefixV4> added{};
+        auto count = random() % 20 + 1;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto length = static_cast<uint8_t>(20 + random() % 13);
+            auto address = v4(10, 0, 0, 0) | static_cast<uint32_t>(random() & 0xFFF);
+            set.add(address, length);
+            added.push_back({address & ~PrefixSetV4::Traits::hostMask(length), length});
+        }
+
+        auto prefixes = set.compute();
+        for (uint32_t address = v4(10, 0, 0, 0); address <= v4(10, 0, 15, 255); address++)
+        {
+            CHECK(covers(prefixes, address) == covers(added, address));
+        }
+
+        for (size_t i = 0; i < prefixes.size(); i++)
+        {
+            auto hostMask = PrefixSetV4::Traits::hostMask(prefixes[i].length);
+            CHECK((prefixes[i].address & hostMask) == 0);
+
+            if (i == 0)
+            {
+                continue;
+            }
+
+            // Sorted, disjoint, and no two neighbours are siblings that form a shorter prefix.
+            auto previousLast = prefixes[i - 1].address | PrefixSetV4::Traits::hostMask(prefixes[i - 1].length);
+            CHECK(previousLast < prefixes[i].address);
+            CHECK(!(prefixes[i - 1].length == prefixes[i].length &&
+                previousLast + 1 == prefixes[i].address &&
+                (prefixes[i - 1].address & PrefixSetV4::Traits::hostMask(prefixes[i].length - 1)) == 0));
+        }
+    }
+}
+
+BENCHMARK(BenchmarkPrefixSetCompute)
+{
+    const size_t count = 100000;
+    std::mt19937 random(8);
+
+    PrefixSetV4 setV4{};
+    PrefixSetV6 setV6{};
+    for (size_t i = 0; i < count; i++)
+    {
+        setV4.add(static_cast<uint32_t>(random()), static_cast<uint8_t>(16 + random() % 17));
+
+        Uint128 address{(static_cast<uint64_t>(random()) << 32) | random(), 0};
+        setV6.add(address, static_cast<uint8_t>(32 + random() % 33));
+    }
+
+    std::printf("%zu prefixes, %zu and %zu after merging\n", count, setV4.compute().size(), setV6.compute().size());
+    tests::measure("ipv4", 0, [&] { tests::keep(setV4.compute().size()); });
+    tests::measure("ipv6", 0, [&] { tests::keep(setV6.compute().size()); });
+}
@@ -0,0 +1,222 @@
+#include "Check.h"
+#include "ip.h"
+#include "prefix_table_builder.h"
+#include "../../ProtonVPN.CalloutDriver/PrefixTable.h"
+
+#include <random>
+#include <vector>
+#include <cstring>
+
+using namespace ipfilter::ip;
+
+namespace
+{
+    struct Prefix
+    {
+        uint8_t address[16];
+        uint8_t length;
+        uint8_t value;
+    };
+
+    // Tables are looked up in place and must be 8 byte aligned, as they are in the driver.
+    class AlignedTable
+    {
+    public:
+        AlignedTable(const std::vector<uint8_t>& data, size_t size):
+            storage((size + 7) / 8 + 1),
+            size(size)
+        {
+            std::memcpy(this->storage.data(), data.data(), size);
+        }
+
+        const PREFIX_TABLE* table() const
+        {
+            return PrefixTableFromBuffer(this->storage.data(), this->size);
+        }
+
+    private:
+        std::vector<uint64_t> storage;
+        size_t size;
+    };
+
+    bool contains(const Prefix& prefix, const uint8_t* address)
+    {
+        for (int i = 0; i < prefix.length; i++)
+        {
+            auto shift = 7 - i % 8;
+            if (((prefix.address[i / 8] >> shift) & 1) != ((address[i / 8] >> shift) & 1))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Longest prefix match by a linear scan. Of prefixes with the same length, the last added wins.
+    uint8_t lookup(const std::vector<Prefix>& prefixes, const uint8_t* address)
+    {
+        int best = -1;
+        uint8_t value = 0;
+        for (const auto& prefix : prefixes)
+        {
+            if (prefix.length >= best && contains(prefix, address))
+            {
+                best = prefix.length;
+                value = prefix.value;
+            }
+        }
+
+        return value;
+    }
+
+    void randomAddress(std::mt19937& random, uint8_t length, uint8_t* address)
+    {
+        // Few distinct leading bytes, so that prefixes overlap.
+        for (uint8_t i = 0; i < length; i++)
+        {
+            address[i] = static_cast<uint8_t>(i < 2 ? random() % 4 : random());
+        }
+    }
+}
+
+TEST(LongestIpv4PrefixWins)
+{
+    PrefixTableBuilder builder(4);
+    builder.add(AddressV4({10, 0, 0, 0}), 8, 1);
+    builder.add(AddressV4({10, 1, 0, 0}), 16, 2);
+    builder.add(AddressV4({10, 1, 2, 3}), 32, 3);
+    auto data = builder.build();
+
+    AlignedTable aligned(data, data.size());
+    auto table = aligned.table();
+    CHECK(table != nullptr);
+
+    const uint8_t inside8[] = {10, 2, 0, 1};
+    const uint8_t inside16[] = {10, 1, 200, 1};
+    const uint8_t host[] = {10, 1, 2, 3};
+    const uint8_t outside[] = {11, 0, 0, 0};
+
+    CHECK(PrefixTableLookup(table, inside8) == 1);
+    CHECK(PrefixTableLookup(table, inside16) == 2);
+    CHECK(PrefixTableLookup(table, host) == 3);
+    CHECK(PrefixTableLookup(table, outside) == 0);
+}
+
+TEST(Ipv6DefaultRouteMatchesEverything)
+{
+    AddressV6::BytesType any{};
+    AddressV6::BytesType linkLocal{0xfe, 0x80};
+
+    PrefixTableBuilder builder(16);
+    builder.add(AddressV6(any, 0), 1);
+    builder.add(AddressV6(linkLocal, 10), 2);
+    auto data = builder.build();
+
+    AlignedTable aligned(data, data.size());
+    auto table = aligned.table();
+    CHECK(table != nullptr);
+
+    const uint8_t global[16] = {0x20, 0x01, 0x0d, 0xb8};
+    const uint8_t local[16] = {0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+
+    CHECK(PrefixTableLookup(table, global) == 1);
+    CHECK(PrefixTableLookup(table, local) == 2);
+}
+
+// The seed is fixed, so failures reproduce.
+TEST(LookupsMatchLinearScan)
+{
+    std::mt19937 random(7);
+
+    for (uint8_t length : {4, 16})
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            PrefixTableBuilder builder(length);
+            std::vector<Prefix> prefixes{};
+
+            auto count = random() % 60;
+            for (unsigned int j = 0; j < count; j++)
+            {
+                Prefix prefix{};
+                randomAddress(random, length, prefix.address);
+                prefix.length = static_cast<uint8_t>(random() % (length * 8 + 1));
+                prefix.value = static_cast<uint8_t>(1 + random() % 5);
+
+                prefixes.push_back(prefix);
+                builder.add(prefix.address, prefix.length, prefix.value);
+            }
+
+            auto data = builder.build();
+            AlignedTable aligned(data, data.size());
+            auto table = aligned.table();
+            CHECK(table != nullptr);
+            if (table == nullptr)
+            {
+                continue;
+            }
+
+            for (int j = 0; j < 500; j++)
+            {
+                uint8_t address[16]{};
+                randomAddress(random, length, address);
+                if (!prefixes.empty() && j % 2 != 0)
+                {
+                    // Addresses next to a prefix boundary.
+                    std::memcpy(address, prefixes[random() % prefixes.size()].address, length);
+                    address[length - 1] ^= static_cast<uint8_t>(random() % 4);
+                }
+
+                CHECK(PrefixTableLookup(table, address) == lookup(prefixes, address));
+            }
+        }
+    }
+}
+
+TEST(TruncatedTablesAreRejected)
+{
+    PrefixTableBuilder builder(4);
+    builder.add(AddressV4({10, 0, 0, 0}), 8, 1);
+    builder.add(AddressV4({192, 168, 1, 0}), 24, 2);
+    auto data = builder.build();
+
+    for (size_t size = 0; size < data.size(); size++)
+    {
+        AlignedTable aligned(data, size);
+        CHECK(aligned.table() == nullptr);
+    }
+}
+
+// Corrupted tables are either rejected or looked up without reading outside of the buffer,
+// which the sanitizer build checks.
+TEST(CorruptedTablesAreRejectedOrSafe)
+{
+    std::mt19937 random(11);
+
+    PrefixTableBuilder builder(16);
+    for (int i = 0; i < 40; i++)
+    {
+        uint8_t address[16]{};
+        randomAddress(random, 16, address);
+        builder.add(address, static_cast<uint8_t>(random() % 129), static_cast<uint8_t>(1 + random() % 5));
+    }
+
+    auto data = builder.build();
+
+    for (int i = 0; i < 5000; i++)
+    {
+        auto corrupted = data;
+        auto offset = sizeof(PREFIX_TABLE) + random() % (corrupted.size() - sizeof(PREFIX_TABLE));
+        corrupted[offset] ^= static_cast<uint8_t>(1 << (random() % 8));
+
+        AlignedTable aligned(corrupted, corrupted.size());
+        auto table = aligned.table();
+        if (table != nullptr)
+        {
+            uint8_t address[16]{};
+            randomAddress(random, 16, address);
+            PrefixTableLookup(table, address);
+        }
+    }
+}
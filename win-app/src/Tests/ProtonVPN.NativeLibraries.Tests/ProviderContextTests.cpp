@@ -0,0 +1,214 @@
+#include "Check.h"
+#include "ip.h"
+#include "provider_context_writer.h"
+#include "../../ProtonVPN.CalloutDriver/ProviderContext.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace ipfilter;
+
+namespace
+{
+    const uint16_t UnknownSection = 99;
+
+    std::vector<uint8_t> makeContext()
+    {
+        ProviderContextWriter writer{};
+        writer.addBindAddressV4(ip::AddressV4({10, 2, 0, 2}));
+        writer.addSection(UnknownSection, reinterpret_cast<const uint8_t*>("hello"), 5);
+        writer.addBindAddressV6(ip::AddressV6({0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2}));
+        writer.addExcludedPrefixesV4(std::vector<uint8_t>(40, 0xAB));
+        writer.addDnsPolicy(PROVIDER_CONTEXT_DNS_SEND_SERVFAIL);
+
+        return writer.build();
+    }
+
+    std::vector<uint8_t> findSection(const PROVIDER_CONTEXT* context, uint16_t type)
+    {
+        uint32_t length = 0;
+        auto value = static_cast<const uint8_t*>(ProviderContextFindSection(context, type, &length));
+        if (value == nullptr)
+        {
+            return {};
+        }
+
+        return std::vector<uint8_t>(value, value + length);
+    }
+}
+
+TEST(WrittenContextReadsBack)
+{
+    auto data = makeContext();
+    auto context = ProviderContextFromBuffer(data.data(), data.size());
+    CHECK(context != nullptr);
+    if (context == nullptr)
+    {
+        return;
+    }
+
+    CHECK((findSection(context, PROVIDER_CONTEXT_BIND_ADDRESS_V4) == std::vector<uint8_t>{10, 2, 0, 2}));
+    CHECK(findSection(context, PROVIDER_CONTEXT_BIND_ADDRESS_V6).size() == 16);
+    CHECK(findSection(context, PROVIDER_CONTEXT_BIND_ADDRESS_V6)[0] == 0xfd);
+    CHECK(findSection(context, PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V4) == std::vector<uint8_t>(40, 0xAB));
+    CHECK((findSection(context, UnknownSection) == std::vector<uint8_t>{'h', 'e', 'l', 'l', 'o'}));
+    CHECK((findSection(context, PROVIDER_CONTEXT_DNS_POLICY) == std::vector<uint8_t>{1, 0, 0, 0}));
+
+    uint32_t length = 7;
+    CHECK(ProviderContextFindSection(context, PROVIDER_CONTEXT_EXCLUDED_PREFIXES_V6, &length) == nullptr);
+    CHECK(length == 7);
+}
+
+TEST(SectionValuesAreAligned)
+{
+    auto data = makeContext();
+    auto context = ProviderContextFromBuffer(data.data(), data.size());
+    CHECK(context != nullptr);
+    CHECK(data.size() % PROVIDER_CONTEXT_ALIGNMENT == 0);
+
+    for (uint16_t type : {PROVIDER_CONTEXT_BIND_ADDRESS_V4, PROVIDER_CONTEXT_BIND_ADDRESS_V6, PROVIDER_CONTEXT_DNS_POLICY})
+    {
+        uint32_t length = 0;
+        auto value = static_cast<const uint8_t*>(ProviderContextFindSection(context, type, &length));
+        CHECK((value - data.data()) % PROVIDER_CONTEXT_ALIGNMENT == 0);
+    }
+}
+
+TEST(EmptyContextHasNoSections)
+{
+    auto data = ProviderContextWriter{}.build();
+    auto context = ProviderContextFromBuffer(data.data(), data.size());
+
+    CHECK(data.size() == sizeof(PROVIDER_CONTEXT));
+    CHECK(context != nullptr);
+    CHECK(findSection(context, PROVIDER_CONTEXT_BIND_ADDRESS_V4).empty());
+}
+
+TEST(UnalignedBuffersAreRead)
+{
+    auto data = makeContext();
+
+    for (size_t shift = 1; shift < PROVIDER_CONTEXT_ALIGNMENT; shift++)
+    {
+        std::vector<uint8_t> storage(data.size() + shift);
+        std::memcpy(storage.data() + shift, data.data(), data.size());
+
+        auto context = ProviderContextFromBuffer(storage.data() + shift, data.size());
+        CHECK(context != nullptr);
+        if (context != nullptr)
+        {
+            CHECK((findSection(context, PROVIDER_CONTEXT_BIND_ADDRESS_V4) == std::vector<uint8_t>{10, 2, 0, 2}));
+            CHECK((findSection(context, PROVIDER_CONTEXT_DNS_POLICY) == std::vector<uint8_t>{1, 0, 0, 0}));
+        }
+    }
+}
+
+TEST(EveryTruncationIsRejected)
+{
+    auto data = makeContext();
+
+    for (size_t size = 0; size < data.size(); size++)
+    {
+        std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+        CHECK(ProviderContextFromBuffer(truncated.data(), truncated.size()) == nullptr);
+    }
+
+    CHECK(ProviderContextFromBuffer(nullptr, data.size()) == nullptr);
+}
+
+TEST(TrailingBytesAreIgnored)
+{
+    auto data = makeContext();
+    data.resize(data.size() + 13, 0xEE);
+
+    auto context = ProviderContextFromBuffer(data.data(), data.size());
+    CHECK(context != nullptr);
+    CHECK(findSection(context, PROVIDER_CONTEXT_DNS_POLICY).size() == 4);
+}
+
+TEST(OtherMagicOrVersionIsRejected)
+{
+    auto data = makeContext();
+
+    auto otherMagic = data;
+    otherMagic[0] ^= 1;
+    CHECK(ProviderContextFromBuffer(otherMagic.data(), otherMagic.size()) == nullptr);
+
+    auto otherVersion = data;
+    otherVersion[4] = PROVIDER_CONTEXT_VERSION + 1;
+    CHECK(ProviderContextFromBuffer(otherVersion.data(), otherVersion.size()) == nullptr);
+}
+
+TEST(SectionsBeyondTheContextAreRejected)
+{
+    auto data = makeContext();
+
+    // One more section than the context holds.
+    auto extraSection = data;
+    extraSection[12]++;
+    CHECK(ProviderContextFromBuffer(extraSection.data(), extraSection.size()) == nullptr);
+
+    // The first section claims more than the rest of the context.
+    auto longSection = data;
+    longSection[sizeof(PROVIDER_CONTEXT) + 4] = 0xFF;
+    longSection[sizeof(PROVIDER_CONTEXT) + 5] = 0xFF;
+    CHECK(ProviderContextFromBuffer(longSection.data(), longSection.size()) == nullptr);
+
+    // A length that wraps when it is aligned.
+    auto wrappingSection = data;
+    std::memset(wrappingSection.data() + sizeof(PROVIDER_CONTEXT) + 4, 0xFF, 4);
+    CHECK(ProviderContextFromBuffer(wrappingSection.data(), wrappingSection.size()) == nullptr);
+}
+
+TEST(MutatedContextsAreReadWithinTheBuffer)
+{
+    auto data = makeContext();
+    std::mt19937 random(0x5eed);
+
+    for (int i = 0; i < 20000; i++)
+    {
+        auto mutated = data;
+        auto mutations = 1 + random() % 4;
+        for (unsigned int j = 0; j < mutations; j++)
+        {
+            auto offset = random() % mutated.size();
+            switch (random() % 3)
+            {
+            case 0:
+                mutated[offset] = static_cast<uint8_t>(random());
+                break;
+            case 1:
+                mutated[offset] ^= static_cast<uint8_t>(1 << (random() % 8));
+                break;
+            default:
+                mutated.resize(offset);
+                break;
+            }
+
+            if (mutated.empty())
+            {
+                break;
+            }
+        }
+
+        // The copy has the exact size, so the sanitizers catch reads past the end.
+        std::vector<uint8_t> buffer(mutated);
+        auto context = ProviderContextFromBuffer(buffer.data(), buffer.size());
+        if (context == nullptr)
+        {
+            continue;
+        }
+
+        for (uint16_t type = 0; type < 8; type++)
+        {
+            uint32_t length = 0;
+            auto value = static_cast<const uint8_t*>(ProviderContextFindSection(context, type, &length));
+            if (value != nullptr)
+            {
+                CHECK(value >= buffer.data() + sizeof(PROVIDER_CONTEXT) + sizeof(PROVIDER_CONTEXT_SECTION));
+                CHECK(static_cast<size_t>(value - buffer.data()) + length <= buffer.size());
+            }
+        }
+    }
+}
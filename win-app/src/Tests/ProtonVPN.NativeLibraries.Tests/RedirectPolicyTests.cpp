@@ -0,0 +1,241 @@
+#include "Check.h"
+#include "ip.h"
+#include "prefix_table_builder.h"
+#include "../../ProtonVPN.CalloutDriver/RedirectPolicy.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+using namespace ipfilter::ip;
+
+namespace
+{
+    typedef std::array<uint8_t, 4> V4;
+    typedef std::array<uint8_t, 16> V6;
+
+    bool isLocal(const V4& address)
+    {
+        return RedirectIsLocalNetworkV4(address.data());
+    }
+
+    bool isLocal(const V6& address)
+    {
+        return RedirectIsLocalNetworkV6(address.data());
+    }
+
+    V6 mapped(const V4& address)
+    {
+        return V6{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, address[0], address[1], address[2], address[3]};
+    }
+
+    V6 multicast(uint8_t scope)
+    {
+        return V6{0xFF, scope, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    }
+
+    // Tables are looked up in place and must be 8 byte aligned, as they are in the driver.
+    class AlignedTable
+    {
+    public:
+        explicit AlignedTable(const std::vector<uint8_t>& data):
+            storage(data.size() / 8 + 1)
+        {
+            std::memcpy(this->storage.data(), data.data(), data.size());
+            this->table = PrefixTableFromBuffer(this->storage.data(), data.size());
+        }
+
+        const PREFIX_TABLE* get() const
+        {
+            return this->table;
+        }
+
+    private:
+        std::vector<uint64_t> storage;
+        const PREFIX_TABLE* table;
+    };
+
+    // Socket addresses in the SOCKADDR_IN6 layout, large enough for SOCKADDR_IN as well.
+    std::array<uint8_t, 28> socketAddress(uint16_t family, uint16_t port)
+    {
+        std::array<uint8_t, 28> address{};
+        address.fill(0xAA);
+        std::memcpy(address.data(), &family, sizeof(family));
+        address[2] = static_cast<uint8_t>(port >> 8);
+        address[3] = static_cast<uint8_t>(port);
+
+        return address;
+    }
+}
+
+TEST(LocalIpv4NetworksAreRecognized)
+{
+    CHECK(isLocal(V4{127, 0, 0, 1}));
+    CHECK(isLocal(V4{127, 255, 255, 254}));
+    CHECK(isLocal(V4{169, 254, 1, 1}));
+    CHECK(isLocal(V4{10, 0, 0, 1}));
+    CHECK(isLocal(V4{172, 16, 0, 1}));
+    CHECK(isLocal(V4{172, 31, 255, 255}));
+    CHECK(isLocal(V4{192, 168, 1, 1}));
+    CHECK(isLocal(V4{224, 0, 0, 251}));
+    CHECK(isLocal(V4{239, 255, 255, 250}));
+    CHECK(isLocal(V4{255, 255, 255, 255}));
+}
+
+TEST(PublicIpv4AddressesAreNotLocal)
+{
+    CHECK(!isLocal(V4{8, 8, 8, 8}));
+    CHECK(!isLocal(V4{172, 15, 255, 255}));
+    CHECK(!isLocal(V4{172, 32, 0, 0}));
+    CHECK(!isLocal(V4{169, 253, 1, 1}));
+    CHECK(!isLocal(V4{192, 169, 0, 1}));
+    CHECK(!isLocal(V4{224, 0, 1, 1}));
+    CHECK(!isLocal(V4{239, 254, 0, 1}));
+    CHECK(!isLocal(V4{255, 255, 255, 254}));
+    CHECK(!isLocal(V4{11, 0, 0, 1}));
+}
+
+TEST(LocalIpv6NetworksAreRecognized)
+{
+    CHECK(isLocal(V6{}));
+    CHECK(isLocal(V6{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}));
+    CHECK(isLocal(V6{0xFE, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}));
+    CHECK(isLocal(V6{0xFE, 0xBF, 0xFF}));
+    CHECK(isLocal(V6{0xFC, 0}));
+    CHECK(isLocal(V6{0xFD, 0x12, 0x34}));
+}
+
+TEST(PublicIpv6AddressesAreNotLocal)
+{
+    CHECK(!isLocal(V6{0x20, 0x01, 0x48, 0x60, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x88, 0x88}));
+    CHECK(!isLocal(V6{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2}));
+    CHECK(!isLocal(V6{0xFE, 0xC0}));
+    CHECK(!isLocal(V6{0xFB, 0xFF}));
+    CHECK(!isLocal(V6{0xFE, 0x7F}));
+}
+
+TEST(Ipv6MulticastScopesUpToOrganizationAreLocal)
+{
+    for (uint8_t scope = 0; scope < 16; scope++)
+    {
+        bool local = scope >= 1 && scope <= 8;
+        CHECK(isLocal(multicast(scope)) == local);
+
+        // Flags in the upper bits do not change the scope.
+        CHECK(isLocal(multicast(static_cast<uint8_t>(0x30 | scope))) == local);
+    }
+}
+
+TEST(Ipv4MappedAddressesFollowIpv4Rules)
+{
+    CHECK(isLocal(mapped(V4{192, 168, 0, 1})));
+    CHECK(isLocal(mapped(V4{127, 0, 0, 1})));
+    CHECK(isLocal(mapped(V4{255, 255, 255, 255})));
+    CHECK(!isLocal(mapped(V4{8, 8, 8, 8})));
+    CHECK(!isLocal(mapped(V4{0, 0, 0, 1})));
+
+    // Only ::ffff:0:0/96 is mapped.
+    V6 other = mapped(V4{192, 168, 0, 1});
+    other[10] = 0xFE;
+    CHECK(!isLocal(other));
+}
+
+TEST(ConnectionsOutsideLocalNetworksAreRedirected)
+{
+    const V4 publicV4{8, 8, 4, 4};
+    const V4 localV4{192, 168, 1, 1};
+    const V6 publicV6{0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    const V6 localV6{0xFE, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+
+    CHECK(RedirectShouldRedirectConnection(nullptr, publicV4.data(), 4));
+    CHECK(!RedirectShouldRedirectConnection(nullptr, localV4.data(), 4));
+    CHECK(RedirectShouldRedirectConnection(nullptr, publicV6.data(), 16));
+    CHECK(!RedirectShouldRedirectConnection(nullptr, localV6.data(), 16));
+}
+
+TEST(ExcludedPrefixesAreNotRedirected)
+{
+    PrefixTableBuilder builderV4(4);
+    builderV4.add(AddressV4({8, 8, 0, 0}), 16, 1);
+    AlignedTable tableV4(builderV4.build());
+    CHECK(tableV4.get() != nullptr);
+
+    const V4 excluded{8, 8, 4, 4};
+    const V4 included{8, 9, 4, 4};
+    const V4 local{10, 0, 0, 1};
+    CHECK(!RedirectShouldRedirectConnection(tableV4.get(), excluded.data(), 4));
+    CHECK(RedirectShouldRedirectConnection(tableV4.get(), included.data(), 4));
+    CHECK(!RedirectShouldRedirectConnection(tableV4.get(), local.data(), 4));
+
+    PrefixTableBuilder builderV6(16);
+    builderV6.add(AddressV6({0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 32), 1);
+    AlignedTable tableV6(builderV6.build());
+    CHECK(tableV6.get() != nullptr);
+
+    const V6 excludedV6{0x20, 0x01, 0x0d, 0xb8, 0xFF, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    const V6 includedV6{0x20, 0x01, 0x0d, 0xb9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    CHECK(!RedirectShouldRedirectConnection(tableV6.get(), excludedV6.data(), 16));
+    CHECK(RedirectShouldRedirectConnection(tableV6.get(), includedV6.data(), 16));
+}
+
+TEST(ExcludedTableOfTheOtherFamilyIsIgnored)
+{
+    PrefixTableBuilder builderV4(4);
+    builderV4.add(AddressV4({32, 1, 0, 0}), 8, 1);
+    AlignedTable tableV4(builderV4.build());
+
+    // Starts with the bytes of the IPv4 prefix, yet is not looked up in the IPv4 table.
+    const V6 address{32, 1, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    CHECK(RedirectShouldRedirectConnection(tableV4.get(), address.data(), 16));
+}
+
+TEST(Ipv4SocketAddressIsReplacedKeepingThePort)
+{
+    auto address = socketAddress(REDIRECT_AF_INET, 5353);
+    auto original = address;
+    const V4 local{10, 2, 0, 2};
+
+    CHECK(RedirectSetSocketAddress(address.data(), local.data(), 4));
+    CHECK(std::memcmp(address.data() + REDIRECT_SOCKADDR_IN_ADDRESS_OFFSET, local.data(), 4) == 0);
+    CHECK(std::memcmp(address.data(), original.data(), REDIRECT_SOCKADDR_IN_ADDRESS_OFFSET) == 0);
+    CHECK(std::memcmp(address.data() + 8, original.data() + 8, address.size() - 8) == 0);
+}
+
+TEST(Ipv6SocketAddressIsReplacedAndItsScopeCleared)
+{
+    auto address = socketAddress(REDIRECT_AF_INET6, 443);
+    auto original = address;
+    const V6 local{0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2};
+
+    CHECK(RedirectSetSocketAddress(address.data(), local.data(), 16));
+    CHECK(std::memcmp(address.data() + REDIRECT_SOCKADDR_IN6_ADDRESS_OFFSET, local.data(), 16) == 0);
+
+    uint32_t scopeId = 1;
+    std::memcpy(&scopeId, address.data() + REDIRECT_SOCKADDR_IN6_SCOPE_ID_OFFSET, sizeof(scopeId));
+    CHECK(scopeId == 0);
+
+    // Family, port and flow info are kept.
+    CHECK(std::memcmp(address.data(), original.data(), REDIRECT_SOCKADDR_IN6_ADDRESS_OFFSET) == 0);
+}
+
+TEST(MismatchedFamilyAndLengthLeaveTheSocketAddress)
+{
+    const V4 addressV4{10, 2, 0, 2};
+    const V6 addressV6{0xfd, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2};
+
+    auto inet = socketAddress(REDIRECT_AF_INET, 53);
+    auto inetOriginal = inet;
+    CHECK(!RedirectSetSocketAddress(inet.data(), addressV6.data(), 16));
+    CHECK(inet == inetOriginal);
+
+    auto inet6 = socketAddress(REDIRECT_AF_INET6, 53);
+    auto inet6Original = inet6;
+    CHECK(!RedirectSetSocketAddress(inet6.data(), addressV4.data(), 4));
+    CHECK(inet6 == inet6Original);
+
+    auto other = socketAddress(1, 53);
+    auto otherOriginal = other;
+    CHECK(!RedirectSetSocketAddress(other.data(), addressV4.data(), 4));
+    CHECK(!RedirectSetSocketAddress(other.data(), addressV6.data(), 16));
+    CHECK(other == otherOriginal);
+}
@@ -0,0 +1,136 @@
+#include "Check.h"
+#include "RouteSelection.h"
+
+using namespace Proton::NetworkUtil;
+
+namespace
+{
+    RouteAddress makeIpv4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        RouteAddress address{};
+        address[0] = a;
+        address[1] = b;
+        address[2] = c;
+        address[3] = d;
+
+        return address;
+    }
+
+    RouteAddress makeIpv6(uint8_t first, uint8_t second, uint8_t last)
+    {
+        RouteAddress address{};
+        address[0] = first;
+        address[1] = second;
+        address[15] = last;
+
+        return address;
+    }
+
+    RouteInterface makeInterface(uint64_t luid, uint32_t metric, std::vector<UnicastAddress> addresses)
+    {
+        RouteInterface iface{};
+        iface.luid = luid;
+        iface.metric = metric;
+        iface.connected = true;
+        iface.addresses = std::move(addresses);
+
+        return iface;
+    }
+
+    RouteTable makeTable()
+    {
+        RouteTable table{};
+        table.interfaces[1] = makeInterface(1, 25, {{makeIpv4(192, 168, 1, 10), true}});
+        table.interfaces[2] = makeInterface(2, 5, {{makeIpv4(10, 8, 0, 2), true}});
+        table.interfaces[3] = makeInterface(3, 50, {{makeIpv4(172, 16, 0, 3), true}});
+        table.routes = {
+            {1, 0, 10},
+            {2, 0, 100},
+            {3, 0, 0},
+            // Not a default route.
+            {2, 8, 0},
+        };
+
+        return table;
+    }
+}
+
+TEST(LowestRouteAndInterfaceMetricWins)
+{
+    auto table = makeTable();
+
+    auto best = SelectBestInterface(table, {});
+
+    // 10 + 25 beats 100 + 5 and 0 + 50.
+    CHECK(best != nullptr && best->luid == 1);
+}
+
+TEST(ExcludedAndDisconnectedInterfacesAreSkipped)
+{
+    auto table = makeTable();
+
+    auto best = SelectBestInterface(table, {1});
+    CHECK(best != nullptr && best->luid == 3);
+
+    table.interfaces[3].connected = false;
+    best = SelectBestInterface(table, {1});
+    CHECK(best != nullptr && best->luid == 2);
+}
+
+TEST(TiesGoToTheLowestLuid)
+{
+    RouteTable table{};
+    table.interfaces[7] = makeInterface(7, 10, {});
+    table.interfaces[4] = makeInterface(4, 10, {});
+    table.routes = {{7, 0, 5}, {4, 0, 5}};
+
+    auto best = SelectBestInterface(table, {});
+
+    CHECK(best != nullptr && best->luid == 4);
+}
+
+TEST(NoDefaultRouteSelectsNothing)
+{
+    auto table = makeTable();
+    table.routes = {{2, 8, 0}, {9, 0, 0}};
+
+    CHECK(SelectBestInterface(table, {}) == nullptr);
+}
+
+TEST(LinkLocalAddressesAreAvoided)
+{
+    auto iface = makeInterface(1, 0, {
+        {makeIpv6(0xfe, 0x80, 1), true},
+        {makeIpv6(0x20, 0x01, 2), false},
+        {makeIpv6(0x20, 0x01, 3), true},
+    });
+
+    RouteAddress address{};
+    CHECK(SelectSourceAddress(iface, true, address));
+    CHECK(address == makeIpv6(0x20, 0x01, 3));
+}
+
+TEST(Ipv4LinkLocalAddressIsTheLastResort)
+{
+    auto iface = makeInterface(1, 0, {{makeIpv4(169, 254, 3, 4), true}});
+
+    RouteAddress address{};
+    CHECK(SelectSourceAddress(iface, false, address));
+    CHECK(address == makeIpv4(169, 254, 3, 4));
+}
+
+TEST(Ipv6LinkLocalAddressIsNeverSelected)
+{
+    auto iface = makeInterface(1, 0, {{makeIpv6(0xfe, 0x80, 1), true}, {makeIpv6(0xfe, 0xbf, 2), true}});
+
+    RouteAddress address{};
+    CHECK(!SelectSourceAddress(iface, true, address));
+}
+
+TEST(AddressesNotPreferredAreNeverSelected)
+{
+    auto iface = makeInterface(1, 0, {{makeIpv4(10, 0, 0, 1), false}});
+
+    RouteAddress address{};
+    CHECK(!SelectSourceAddress(iface, false, address));
+}
@@ -0,0 +1,276 @@
+#include "Check.h"
+#include "ruleset.h"
+#include "name_uuid.h"
+
+#include <string>
+#include <cstring>
+
+using namespace ipfilter;
+using namespace ipfilter::ruleset;
+
+namespace
+{
+    Key makeKey(uint8_t value)
+    {
+        Key key{};
+        key.fill(value);
+
+        return key;
+    }
+
+    Rule makeRule(uint32_t port)
+    {
+        Condition address{};
+        address.type = 1;
+        address.address = "10.0.0.1";
+        address.mask = "255.255.255.255";
+
+        Condition remotePort{};
+        remotePort.type = 2;
+        remotePort.value = port;
+
+        Rule rule{};
+        rule.name = L"Rule";
+        rule.layer = 3;
+        rule.action = 1;
+        rule.weight = 10;
+        rule.conditions = {address, remotePort};
+
+        return rule;
+    }
+
+    std::string toHex(const uint8_t* data, size_t size)
+    {
+        const char digits[] = "0123456789abcdef";
+        std::string result{};
+        for (size_t i = 0; i < size; i++)
+        {
+            result += digits[data[i] >> 4];
+            result += digits[data[i] & 0xf];
+        }
+
+        return result;
+    }
+
+    std::string sha1Hex(const std::string& text)
+    {
+        auto digest = uuid::sha1(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+
+        return toHex(digest.data(), digest.size());
+    }
+
+    std::vector<StampedFilter> stampAll(const std::vector<Rule>& rules, bool persistent)
+    {
+        std::vector<StampedFilter> filters{};
+        for (size_t i = 0; i < rules.size(); i++)
+        {
+            filters.push_back({makeKey(static_cast<uint8_t>(i + 1)), encodeStamp(hashRule(rules[i])), persistent});
+        }
+
+        return filters;
+    }
+}
+
+TEST(ConditionOrderDoesNotChangeTheEncoding)
+{
+    auto rule = makeRule(53);
+    auto reordered = rule;
+    std::swap(reordered.conditions[0], reordered.conditions[1]);
+
+    CHECK(encodeRule(rule) == encodeRule(reordered));
+    CHECK(hashRule(rule) == hashRule(reordered));
+    CHECK(encodeRule(rule) != encodeRule(makeRule(54)));
+}
+
+TEST(IdenticalRulesAreKeptOnce)
+{
+    Ruleset ruleset{};
+    auto reordered = makeRule(53);
+    std::swap(reordered.conditions[0], reordered.conditions[1]);
+
+    CHECK(ruleset.add(makeRule(53)));
+    CHECK(!ruleset.add(reordered));
+    CHECK(ruleset.add(makeRule(54)));
+    CHECK(ruleset.getRules().size() == 2);
+
+    ruleset.clear();
+
+    CHECK(ruleset.add(makeRule(53)));
+    CHECK(ruleset.getRules().size() == 1);
+}
+
+TEST(InstalledRulesBelongToTheirProviderAndSublayer)
+{
+    Ruleset ruleset{};
+    std::vector<InstalledRule> installed{{makeKey(1), 1, false}};
+
+    ruleset.setInstalled(makeKey(0x10), makeKey(0x20), installed);
+
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x20)).size() == 1);
+    CHECK(ruleset.getInstalled(makeKey(0x11), makeKey(0x20)).empty());
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x21)).empty());
+}
+
+TEST(InstalledRulesAreKeptPerProviderAndSublayer)
+{
+    Ruleset ruleset{};
+    ruleset.add(makeRule(53));
+    ruleset.add(makeRule(443));
+
+    std::vector<InstalledRule> first{
+        {makeKey(1), hashRule(makeRule(53)), false},
+        {makeKey(2), hashRule(makeRule(443)), false}};
+    std::vector<InstalledRule> second{{makeKey(3), hashRule(makeRule(53)), false}};
+    std::vector<InstalledRule> third{{makeKey(4), hashRule(makeRule(443)), true}};
+
+    ruleset.setInstalled(makeKey(0x10), makeKey(0x20), first);
+    ruleset.setInstalled(makeKey(0x10), makeKey(0x21), second);
+    ruleset.setInstalled(makeKey(0x11), makeKey(0x20), third);
+
+    // Applying under another provider or sublayer does not replace the rules installed before.
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x20)).size() == 2);
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x21)).size() == 1);
+    CHECK(ruleset.getInstalled(makeKey(0x11), makeKey(0x20))[0].filterKey == makeKey(4));
+    CHECK(ruleset.getInstalled(makeKey(0x11), makeKey(0x21)).empty());
+
+    auto unchanged = diff(ruleset.getInstalled(makeKey(0x10), makeKey(0x20)), ruleset.getRules(), false);
+    CHECK(unchanged.kept.size() == 2);
+    CHECK(unchanged.deletions.empty());
+    CHECK(unchanged.additions.empty());
+
+    auto missing = diff(ruleset.getInstalled(makeKey(0x10), makeKey(0x21)), ruleset.getRules(), false);
+    CHECK(missing.kept.size() == 1);
+    CHECK(missing.additions.size() == 1);
+
+    // Replacing or forgetting one entry leaves the others.
+    ruleset.setInstalled(makeKey(0x10), makeKey(0x21), first);
+    ruleset.setInstalled(makeKey(0x11), makeKey(0x20), {});
+
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x21)).size() == 2);
+    CHECK(ruleset.getInstalled(makeKey(0x11), makeKey(0x20)).empty());
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x20)).size() == 2);
+
+    // The installed rules do not depend on the rules of the ruleset.
+    ruleset.clear();
+    CHECK(ruleset.getInstalled(makeKey(0x10), makeKey(0x20)).size() == 2);
+}
+
+TEST(DiffKeepsMatchingRulesAndReplacesTheOthers)
+{
+    std::vector<Rule> desired{makeRule(53), makeRule(54)};
+    std::vector<InstalledRule> installed{
+        {makeKey(1), hashRule(makeRule(53)), false},
+        {makeKey(2), hashRule(makeRule(80)), false},
+    };
+
+    auto result = diff(installed, desired, false);
+
+    CHECK(result.kept.size() == 1);
+    CHECK(result.kept[0].filterKey == makeKey(1));
+    CHECK(result.deletions == std::vector<Key>{makeKey(2)});
+    CHECK(result.additions == std::vector<size_t>{1});
+}
+
+TEST(DiffDeletesInstalledDuplicates)
+{
+    std::vector<Rule> desired{makeRule(53)};
+    std::vector<InstalledRule> installed{
+        {makeKey(1), hashRule(makeRule(53)), false},
+        {makeKey(2), hashRule(makeRule(53)), false},
+    };
+
+    auto result = diff(installed, desired, false);
+
+    CHECK(result.kept.size() == 1);
+    CHECK(result.deletions.size() == 1);
+    CHECK(result.additions.empty());
+}
+
+TEST(DiffReplacesRulesWithOtherPersistence)
+{
+    std::vector<Rule> desired{makeRule(53)};
+    std::vector<InstalledRule> installed{{makeKey(1), hashRule(makeRule(53)), true}};
+
+    auto result = diff(installed, desired, false);
+
+    CHECK(result.kept.empty());
+    CHECK(result.deletions == std::vector<Key>{makeKey(1)});
+    CHECK(result.additions == std::vector<size_t>{0});
+}
+
+TEST(ReconcileDeletesUnstampedFilters)
+{
+    std::vector<Rule> desired{makeRule(53), makeRule(54)};
+    auto filters = stampAll(desired, true);
+    filters.push_back({makeKey(0x30), {1, 2, 3}, true});
+    filters.push_back({makeKey(0x31), {}, true});
+
+    auto result = reconcile(filters, desired, true);
+
+    CHECK(result.kept.size() == 2);
+    CHECK(result.additions.empty());
+    CHECK((result.deletions == std::vector<Key>{makeKey(0x30), makeKey(0x31)}));
+}
+
+TEST(ReconcileReplacesFiltersWithOtherPersistence)
+{
+    std::vector<Rule> desired{makeRule(53)};
+
+    auto result = reconcile(stampAll(desired, false), desired, true);
+
+    CHECK(result.kept.empty());
+    CHECK(result.deletions.size() == 1);
+    CHECK(result.additions.size() == 1);
+}
+
+TEST(StampRoundTripsAndRejectsOtherData)
+{
+    auto stamp = encodeStamp(0x0123456789abcdefULL);
+    Hash hash{};
+
+    CHECK(decodeStamp(stamp.data(), stamp.size(), hash));
+    CHECK(hash == 0x0123456789abcdefULL);
+
+    CHECK(!decodeStamp(nullptr, 0, hash));
+    CHECK(!decodeStamp(stamp.data(), stamp.size() - 1, hash));
+
+    auto other = stamp;
+    other[0] ^= 1;
+    CHECK(!decodeStamp(other.data(), other.size(), hash));
+}
+
+// Test vectors of FIPS 180-2, covering padding into one and two blocks.
+TEST(Sha1MatchesKnownDigests)
+{
+    CHECK(sha1Hex("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    CHECK(sha1Hex("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    CHECK(sha1Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    CHECK(sha1Hex(std::string(1000000, 'a')) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+}
+
+TEST(NameUuidMatchesKnownValue)
+{
+    // 6ba7b810-9dad-11d1-80b4-00c04fd430c8, the DNS namespace of RFC 4122, in GUID layout.
+    const Key dnsNamespace{0x10, 0xb8, 0xa7, 0x6b, 0xad, 0x9d, 0xd1, 0x11, 0x80, 0xb4, 0x00, 0xc0, 0x4f, 0xd4, 0x30, 0xc8};
+    // 886313e1-3b8a-5372-9b90-0c9aee199e5d in GUID layout.
+    const Key expected{0xe1, 0x13, 0x63, 0x88, 0x8a, 0x3b, 0x72, 0x53, 0x9b, 0x90, 0x0c, 0x9a, 0xee, 0x19, 0x9e, 0x5d};
+    const char name[] = "python.org";
+
+    auto key = uuid::makeNameUuid(dnsNamespace, reinterpret_cast<const uint8_t*>(name), std::strlen(name));
+
+    CHECK(key == expected);
+}
+
+TEST(RuleUuidDependsOnContentAndNamespace)
+{
+    auto rule = makeRule(53);
+    auto reordered = rule;
+    std::swap(reordered.conditions[0], reordered.conditions[1]);
+
+    auto key = uuid::makeRuleUuid(makeKey(1), rule);
+
+    CHECK(key == uuid::makeRuleUuid(makeKey(1), reordered));
+    CHECK(key != uuid::makeRuleUuid(makeKey(2), rule));
+    CHECK(key != uuid::makeRuleUuid(makeKey(1), makeRule(54)));
+}
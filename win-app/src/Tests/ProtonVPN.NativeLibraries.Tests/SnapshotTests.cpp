@@ -0,0 +1,332 @@
+#include "Check.h"
+#include "snapshot.h"
+
+#include <random>
+#include <stdexcept>
+
+using namespace ipfilter::snapshot;
+
+namespace
+{
+    Key makeKey(uint8_t value)
+    {
+        Key key{};
+        key.fill(value);
+
+        return key;
+    }
+
+    Provider makeProvider(uint8_t id)
+    {
+        Provider provider{};
+        provider.key = makeKey(id);
+        provider.displayData = {L"Provider", L"Provider description"};
+        provider.flags = 1;
+        provider.providerData = {1, 2, 3};
+        provider.serviceName = L"Service";
+
+        return provider;
+    }
+
+    Sublayer makeSublayer(uint8_t id, uint8_t providerId)
+    {
+        Sublayer sublayer{};
+        sublayer.key = makeKey(id);
+        sublayer.displayData = {L"Sublayer", L""};
+        sublayer.providerKey = makeKey(providerId);
+        sublayer.weight = 0x1234;
+
+        return sublayer;
+    }
+
+    Callout makeCallout(uint8_t id, uint8_t providerId)
+    {
+        Callout callout{};
+        callout.key = makeKey(id);
+        callout.displayData = {L"Callout", L"Callout description"};
+        callout.providerKey = makeKey(providerId);
+        callout.applicableLayer = makeKey(0x70);
+
+        return callout;
+    }
+
+    ProviderContext makeProviderContext(uint8_t id, uint8_t providerId)
+    {
+        ProviderContext context{};
+        context.key = makeKey(id);
+        context.displayData = {L"Context", L""};
+        context.providerKey = makeKey(providerId);
+        context.type = 9;
+        context.data = {0xde, 0xad, 0xbe, 0xef};
+
+        return context;
+    }
+
+    Filter makeFilter(uint8_t id, uint8_t providerId, uint8_t sublayerId)
+    {
+        Filter filter{};
+        filter.key = makeKey(id);
+        filter.displayData = {L"Filter", L"Filter description"};
+        filter.flags = 8;
+        filter.providerKey = makeKey(providerId);
+        filter.providerData = {4, 5};
+        filter.layerKey = makeKey(0x71);
+        filter.sublayerKey = makeKey(sublayerId);
+        filter.weight = {3, {0x0f}};
+        filter.conditions.push_back({makeKey(0x72), 0, {3, {0x35, 0x00}}});
+        filter.conditions.push_back({makeKey(0x73), 1, {0x13, {1, 2, 3, 4, 5, 6}}});
+        filter.actionType = 0x1001;
+
+        return filter;
+    }
+
+    Snapshot makeSnapshot()
+    {
+        Snapshot snapshot{};
+        snapshot.providers.push_back(makeProvider(0x10));
+        snapshot.sublayers.push_back(makeSublayer(0x20, 0x10));
+        snapshot.callouts.push_back(makeCallout(0x30, 0x10));
+        snapshot.providerContexts.push_back(makeProviderContext(0x40, 0x10));
+        snapshot.filters.push_back(makeFilter(0x50, 0x10, 0x20));
+
+        auto calloutFilter = makeFilter(0x51, 0x10, 0x20);
+        calloutFilter.actionType = 0x5003;
+        calloutFilter.actionKey = makeKey(0x30);
+        calloutFilter.context = makeKey(0x40);
+        snapshot.filters.push_back(calloutFilter);
+
+        return snapshot;
+    }
+
+    bool isEmpty(const Snapshot& snapshot)
+    {
+        return snapshot.providers.empty() && snapshot.sublayers.empty() && snapshot.callouts.empty() &&
+            snapshot.providerContexts.empty() && snapshot.filters.empty();
+    }
+}
+
+TEST(EncodedSnapshotDecodesToTheSameObjects)
+{
+    auto snapshot = makeSnapshot();
+    auto data = encode(snapshot);
+
+    auto decoded = decode(data.data(), data.size());
+
+    CHECK(encode(decoded) == data);
+    CHECK(decoded.providers.size() == 1);
+    CHECK(decoded.providers[0].serviceName == L"Service");
+    CHECK(decoded.sublayers[0].weight == 0x1234);
+    CHECK(decoded.providerContexts[0].data == snapshot.providerContexts[0].data);
+    CHECK(decoded.filters.size() == 2);
+    CHECK(decoded.filters[0].conditions.size() == 2);
+    CHECK(decoded.filters[0].conditions[1].value.data == snapshot.filters[0].conditions[1].value.data);
+    CHECK(decoded.filters[1].actionKey == makeKey(0x30));
+    CHECK(decoded.filters[1].context == makeKey(0x40));
+}
+
+TEST(EmptySnapshotRoundTrips)
+{
+    auto data = encode(Snapshot{});
+
+    CHECK(isEmpty(decode(data.data(), data.size())));
+}
+
+TEST(EveryTruncationIsRejected)
+{
+    auto data = encode(makeSnapshot());
+
+    for (size_t length = 0; length < data.size(); length++)
+    {
+        CHECK_THROWS(decode(data.data(), length), std::invalid_argument);
+    }
+}
+
+TEST(OtherMagicOrVersionIsRejected)
+{
+    auto data = encode(makeSnapshot());
+
+    auto otherMagic = data;
+    otherMagic[0] ^= 0xff;
+    CHECK_THROWS(decode(otherMagic.data(), otherMagic.size()), std::invalid_argument);
+
+    auto otherVersion = data;
+    otherVersion[4]++;
+    CHECK_THROWS(decode(otherVersion.data(), otherVersion.size()), std::invalid_argument);
+}
+
+TEST(HugeCountIsRejectedBeforeAllocating)
+{
+    auto data = encode(Snapshot{});
+    // Provider count.
+    data[8] = data[9] = data[10] = data[11] = 0xff;
+
+    CHECK_THROWS(decode(data.data(), data.size()), std::invalid_argument);
+}
+
+// Mutated snapshots either decode to objects that encode again, or are rejected as invalid data.
+// The seed is fixed, so failures reproduce.
+TEST(MutatedSnapshotsDecodeOrAreRejected)
+{
+    auto data = encode(makeSnapshot());
+    std::mt19937 random(0x5eed);
+
+    for (int i = 0; i < 20000; i++)
+    {
+        auto mutated = data;
+        auto mutations = 1 + random() % 4;
+        for (unsigned int j = 0; j < mutations; j++)
+        {
+            auto offset = random() % mutated.size();
+            switch (random() % 3)
+            {
+            case 0:
+                mutated[offset] = static_cast<uint8_t>(random());
+                break;
+            case 1:
+                mutated[offset] ^= static_cast<uint8_t>(1 << (random() % 8));
+                break;
+            default:
+                mutated.resize(offset);
+                break;
+            }
+
+            if (mutated.empty())
+            {
+                break;
+            }
+        }
+
+        try
+        {
+            auto decoded = decode(mutated.data(), mutated.size());
+            auto encoded = encode(decoded);
+            CHECK(encode(decode(encoded.data(), encoded.size())) == encoded);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+}
+
+TEST(SameSnapshotHasNoChanges)
+{
+    auto snapshot = makeSnapshot();
+
+    auto result = changes(snapshot, snapshot);
+
+    CHECK(isEmpty(result.deletions));
+    CHECK(isEmpty(result.additions));
+}
+
+TEST(MissingObjectsAreAdded)
+{
+    auto desired = makeSnapshot();
+    auto installed = desired;
+    installed.filters.pop_back();
+
+    auto result = changes(desired, installed);
+
+    CHECK(isEmpty(result.deletions));
+    CHECK(result.additions.filters.size() == 1);
+    CHECK(result.additions.filters[0].key == makeKey(0x51));
+    CHECK(result.additions.providers.empty());
+}
+
+TEST(ExtraObjectsAreDeleted)
+{
+    auto desired = makeSnapshot();
+    auto installed = desired;
+    installed.filters.push_back(makeFilter(0x52, 0x10, 0x20));
+
+    auto result = changes(desired, installed);
+
+    CHECK(isEmpty(result.additions));
+    CHECK(result.deletions.filters.size() == 1);
+    CHECK(result.deletions.filters[0].key == makeKey(0x52));
+}
+
+TEST(ChangedFilterIsReplaced)
+{
+    auto desired = makeSnapshot();
+    auto installed = desired;
+    installed.filters[0].conditions[0].value.data = {0x36, 0x00};
+
+    auto result = changes(desired, installed);
+
+    CHECK(result.deletions.filters.size() == 1);
+    CHECK(result.deletions.filters[0].conditions[0].value.data == installed.filters[0].conditions[0].value.data);
+    CHECK(result.additions.filters.size() == 1);
+    CHECK(result.additions.filters[0].conditions[0].value.data == desired.filters[0].conditions[0].value.data);
+    CHECK(result.deletions.sublayers.empty());
+}
+
+TEST(ChangedCalloutReplacesItsFilters)
+{
+    auto desired = makeSnapshot();
+    auto installed = desired;
+    installed.callouts[0].applicableLayer = makeKey(0x74);
+
+    auto result = changes(desired, installed);
+
+    CHECK(result.deletions.callouts.size() == 1);
+    CHECK(result.additions.callouts.size() == 1);
+    CHECK(result.deletions.filters.size() == 1);
+    CHECK(result.deletions.filters[0].key == makeKey(0x51));
+    CHECK(result.additions.filters.size() == 1);
+    CHECK(result.deletions.providerContexts.empty());
+}
+
+TEST(ChangedProviderReplacesEverything)
+{
+    auto desired = makeSnapshot();
+    auto installed = desired;
+    installed.providers[0].serviceName = L"Other";
+
+    auto result = changes(desired, installed);
+
+    CHECK(encode(result.deletions) == encode(installed));
+    CHECK(encode(result.additions) == encode(desired));
+}
+
+TEST(FilterChangesLeaveFilterDependencies)
+{
+    auto desired = makeSnapshot();
+    auto installed = desired;
+    installed.filters[0].flags = 0;
+    installed.filters.push_back(makeFilter(0x52, 0x10, 0x20));
+
+    CHECK(!deletesFilterDependencies(changes(desired, installed)));
+
+    // Missing sublayers and callouts are only added.
+    installed = desired;
+    installed.sublayers.clear();
+    installed.callouts.clear();
+    installed.filters.clear();
+
+    CHECK(!deletesFilterDependencies(changes(desired, installed)));
+}
+
+TEST(ReplacedOrExtraContainersDeleteFilterDependencies)
+{
+    auto desired = makeSnapshot();
+
+    auto installed = desired;
+    installed.sublayers[0].weight = 1;
+    CHECK(deletesFilterDependencies(changes(desired, installed)));
+
+    installed = desired;
+    installed.providers[0].flags = 0;
+    CHECK(deletesFilterDependencies(changes(desired, installed)));
+
+    installed = desired;
+    installed.sublayers.push_back(makeSublayer(0x21, 0x10));
+    CHECK(deletesFilterDependencies(changes(desired, installed)));
+
+    installed = desired;
+    installed.providerContexts[0].data = {1};
+    CHECK(deletesFilterDependencies(changes(desired, installed)));
+
+    installed = desired;
+    installed.callouts.push_back(makeCallout(0x31, 0x10));
+    CHECK(deletesFilterDependencies(changes(desired, installed)));
+}
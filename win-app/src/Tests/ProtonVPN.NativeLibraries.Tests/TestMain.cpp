@@ -0,0 +1,36 @@
+#include "Check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+// Runs every test of the executable, or only those whose name contains the first argument.
+// Benchmarks run only when the argument selects them.
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+
+    for (const auto& test : tests::registeredTests())
+    {
+        if (filter != nullptr ? std::strstr(test.name, filter) == nullptr : test.benchmark)
+        {
+            continue;
+        }
+
+        auto failures = tests::failureCount();
+
+        try
+        {
+            test.function();
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "%s: unexpected exception: %s\n", test.name, e.what());
+            tests::failureCount()++;
+        }
+
+        std::printf("%s %s\n", tests::failureCount() == failures ? "PASS" : "FAIL", test.name);
+    }
+
+    return tests::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+#include "Check.h"
+#include "transaction.h"
+
+#include <set>
+#include <initializer_list>
+#include <stdexcept>
+
+using namespace ipfilter;
+
+namespace
+{
+    const unsigned int AddFailed = 0x80320009;
+    const unsigned int BeginFailed = 0x8032000B;
+    const unsigned int CommitFailed = 0x8032000F;
+
+    // Session whose filters are staged in the open transaction and become visible when committed.
+    // Nested transactions are refused like the engine does.
+    class FakeEngine : public TransactionEngine
+    {
+    public:
+        std::set<int> staged;
+        std::set<int> committed;
+        int begins{};
+        int commits{};
+        int aborts{};
+        unsigned int beginResult{};
+        unsigned int commitResult{};
+        bool inTransaction{};
+
+        unsigned int beginTransaction() override
+        {
+            this->begins++;
+            if (this->beginResult != 0)
+            {
+                return this->beginResult;
+            }
+
+            if (this->inTransaction)
+            {
+                return TransactionInProgressResult;
+            }
+
+            this->inTransaction = true;
+            return 0;
+        }
+
+        unsigned int commitTransaction() override
+        {
+            this->commits++;
+            this->inTransaction = false;
+            if (this->commitResult != 0)
+            {
+                this->staged.clear();
+                return this->commitResult;
+            }
+
+            this->committed.insert(this->staged.begin(), this->staged.end());
+            this->staged.clear();
+            return 0;
+        }
+
+        unsigned int abortTransaction() override
+        {
+            this->aborts++;
+            this->inTransaction = false;
+            this->staged.clear();
+            return 0;
+        }
+
+        unsigned int add(int id)
+        {
+            if (id < 0)
+            {
+                return AddFailed;
+            }
+
+            if (this->inTransaction)
+            {
+                this->staged.insert(id);
+            }
+            else
+            {
+                this->committed.insert(id);
+            }
+
+            return 0;
+        }
+    };
+
+    // Adds the ids in order and stops at the first failure, like IPFilterAddFilters.
+    unsigned int addBatch(FakeEngine& engine, std::initializer_list<int> ids)
+    {
+        return transact(engine, [&]()
+        {
+            for (auto id : ids)
+            {
+                auto result = engine.add(id);
+                if (result != 0)
+                {
+                    return result;
+                }
+            }
+
+            return 0u;
+        });
+    }
+}
+
+TEST(BatchIsCommittedInItsOwnTransaction)
+{
+    FakeEngine engine{};
+    bool ownsTransaction{};
+
+    auto result = transact(engine, [&]()
+    {
+        engine.add(1);
+        engine.add(2);
+        return 0u;
+    }, ownsTransaction);
+
+    CHECK(result == 0);
+    CHECK(ownsTransaction);
+    CHECK((engine.committed == std::set<int>{1, 2}));
+    CHECK(engine.commits == 1);
+    CHECK(engine.aborts == 0);
+    CHECK(!engine.inTransaction);
+}
+
+TEST(FailedBatchIsRolledBack)
+{
+    FakeEngine engine{};
+    engine.add(7);
+
+    CHECK(addBatch(engine, {1, 2, -1, 3}) == AddFailed);
+
+    CHECK((engine.committed == std::set<int>{7}));
+    CHECK(engine.staged.empty());
+    CHECK(engine.aborts == 1);
+    CHECK(engine.commits == 0);
+    CHECK(!engine.inTransaction);
+}
+
+TEST(ThrowingBatchIsRolledBackAndRethrown)
+{
+    FakeEngine engine{};
+
+    CHECK_THROWS(transact(engine, [&]() -> unsigned int
+    {
+        engine.add(1);
+        throw std::runtime_error("conversion failed");
+    }), std::runtime_error);
+
+    CHECK(engine.committed.empty());
+    CHECK(engine.aborts == 1);
+    CHECK(!engine.inTransaction);
+}
+
+TEST(BatchJoinsTheOpenTransaction)
+{
+    FakeEngine engine{};
+    CHECK(engine.beginTransaction() == 0);
+
+    bool ownsTransaction = true;
+    auto result = transact(engine, [&]()
+    {
+        return engine.add(1);
+    }, ownsTransaction);
+
+    // Committing is left to the owner of the transaction.
+    CHECK(result == 0);
+    CHECK(!ownsTransaction);
+    CHECK(engine.commits == 0);
+    CHECK(engine.inTransaction);
+    CHECK((engine.staged == std::set<int>{1}));
+
+    CHECK(engine.commitTransaction() == 0);
+    CHECK((engine.committed == std::set<int>{1}));
+}
+
+TEST(FailedJoinedBatchLeavesTheRollbackToTheOwner)
+{
+    FakeEngine engine{};
+
+    auto result = transact(engine, [&]()
+    {
+        auto added = addBatch(engine, {1});
+        if (added != 0)
+        {
+            return added;
+        }
+
+        // The joined batch fails without aborting, the outer transaction is still open.
+        added = addBatch(engine, {2, -1});
+        CHECK(added == AddFailed);
+        CHECK(engine.inTransaction);
+        CHECK(engine.aborts == 0);
+
+        return added;
+    });
+
+    CHECK(result == AddFailed);
+    CHECK(engine.committed.empty());
+    CHECK(engine.aborts == 1);
+    CHECK(engine.commits == 0);
+    CHECK(engine.begins == 3);
+}
+
+TEST(FailedBeginIsReportedWithoutRunningTheBatch)
+{
+    FakeEngine engine{};
+    engine.beginResult = BeginFailed;
+    bool ran = false;
+
+    auto result = transact(engine, [&]()
+    {
+        ran = true;
+        return 0u;
+    });
+
+    CHECK(result == BeginFailed);
+    CHECK(!ran);
+    CHECK(engine.aborts == 0);
+    CHECK(engine.commits == 0);
+}
+
+TEST(FailedCommitIsReported)
+{
+    FakeEngine engine{};
+    engine.commitResult = CommitFailed;
+
+    CHECK(addBatch(engine, {1, 2}) == CommitFailed);
+    CHECK(engine.committed.empty());
+    CHECK(engine.aborts == 0);
+}